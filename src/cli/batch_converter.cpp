@@ -0,0 +1,397 @@
+/*
+ *    Copyright 2018 The OpenOrienteering developers
+ *
+ *    This file is part of OpenOrienteering.
+ *
+ *    OpenOrienteering is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    OpenOrienteering is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with OpenOrienteering.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "batch_converter.h"
+
+#include <atomic>
+#include <cstddef>
+#include <exception>
+#include <memory>
+
+#include <Qt>
+#include <QtGlobal>
+#include <QByteArray>
+#include <QColor>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QImage>
+#include <QImageWriter>
+#include <QIODevice>
+#include <QLatin1Char>
+#include <QLatin1String>
+#include <QMutexLocker>
+#include <QPainter>
+#include <QPrinter>
+#include <QRectF>
+#include <QRunnable>
+#include <QSaveFile>
+#include <QSizeF>
+#include <QTextStream>
+#include <QThread>
+#include <QThreadPool>
+
+#include <mapper_config.h>
+
+#include "core/map.h"
+#include "core/map_printer.h"
+#include "core/map_view.h"
+#include "core/renderables/glyph_path_cache.h"
+#include "fileformats/file_format.h"
+#include "fileformats/file_format_registry.h"
+#include "fileformats/file_import_export.h"
+#include "util/parallel.h"
+
+
+namespace OpenOrienteering {
+
+namespace {
+
+/**
+ * Processes a single batch job on a thread of the converter's pool.
+ */
+class BatchJobRunnable : public QRunnable
+{
+public:
+	BatchJobRunnable(BatchConverter& converter, const BatchJob& job, std::atomic<int>& num_failed)
+	: converter(converter)
+	, job(job)
+	, num_failed(num_failed)
+	{}
+
+	void run() override
+	{
+		if (!converter.process(job))
+			++num_failed;
+	}
+
+private:
+	BatchConverter& converter;
+	const BatchJob& job;
+	std::atomic<int>& num_failed;
+};
+
+
+}  // namespace
+
+
+
+BatchConverter::BatchConverter(QTextStream& log)
+: log(log)
+{
+	// nothing else
+}
+
+BatchConverter::~BatchConverter() = default;
+
+
+
+void BatchConverter::setMaxParallelJobs(int count)
+{
+	max_parallel_jobs = count;
+}
+
+void BatchConverter::setResolution(int dpi)
+{
+	resolution = dpi;
+}
+
+void BatchConverter::setTileSize(int pixels)
+{
+	tile_size = pixels;
+}
+
+
+
+int BatchConverter::run(const std::vector<BatchJob>& jobs)
+{
+	QElapsedTimer timer;
+	timer.start();
+
+	// A dedicated pool: The threads of the global pool may be needed
+	// for rendering the pages of a single job in parallel.
+	QThreadPool pool;
+	pool.setMaxThreadCount(max_parallel_jobs > 0 ? max_parallel_jobs : QThread::idealThreadCount());
+
+	std::atomic<int> num_failed { 0 };
+	for (const auto& job : jobs)
+		pool.start(new BatchJobRunnable(*this, job, num_failed));
+	pool.waitForDone();
+
+	report(tr("%n job(s), %1 failed, %2 ms", nullptr, int(jobs.size()))
+	       .arg(num_failed.load()).arg(timer.elapsed()));
+
+	const auto glyph_stats = GlyphPathCache::instance().statistics();
+	report(tr("Glyph path cache: %1 glyphs, %2 hits, %3 misses, %4 fallbacks")
+	       .arg(glyph_stats.glyphs).arg(glyph_stats.hits).arg(glyph_stats.misses).arg(glyph_stats.fallbacks));
+	return num_failed;
+}
+
+
+bool BatchConverter::process(const BatchJob& job)
+{
+	QElapsedTimer total_timer;
+	total_timer.start();
+	QElapsedTimer stage_timer;
+	stage_timer.start();
+
+	Map map;
+	MapView view { nullptr, &map };
+	QString import_error;
+	if (!importMap(map, view, job.input, import_error))
+	{
+		report(tr("%1: Cannot open file: %2").arg(job.input, import_error));
+		return false;
+	}
+
+	QStringList stages;
+	stages.reserve(job.outputs.size() + 2);
+	stages.push_back(tr("load %1 ms").arg(stage_timer.restart()));
+
+	bool success = true;
+	for (const auto& output : job.outputs)
+	{
+		const auto suffix = QFileInfo(output).suffix().toLower();
+		const auto format = FileFormats.findFormatForFilename(output);
+
+		QString error;
+		bool exported = false;
+		if (format && format->supportsExport())
+			exported = exportMap(map, view, *format, output, error);
+		else if (suffix == QLatin1String("pdf"))
+			exported = exportPdf(map, view, output, error);
+		else if (QImageWriter::supportedImageFormats().contains(suffix.toLatin1()))
+			exported = exportImage(map, view, output, error);
+		else
+			error = tr("Unsupported output type.");
+
+		const auto name = QFileInfo(output).fileName();
+		if (exported)
+		{
+			stages.push_back(tr("%1 %2 ms").arg(name).arg(stage_timer.restart()));
+		}
+		else
+		{
+			success = false;
+			stages.push_back(tr("%1 failed: %2").arg(name, error));
+			stage_timer.restart();
+		}
+	}
+
+	stages.push_back(tr("total %1 ms").arg(total_timer.elapsed()));
+	report(job.input + QLatin1String(": ") + stages.join(QLatin1String(", ")));
+	return success;
+}
+
+
+
+bool BatchConverter::importMap(Map& map, MapView& view, const QString& path, QString& error)
+{
+	// Like Map::loadFrom(), but without message boxes
+	QFile file(path);
+	if (!file.open(QIODevice::ReadOnly))
+	{
+		error = file.errorString();
+		return false;
+	}
+
+	// Read a block at the beginning of the file for magic number checking.
+	const auto header = file.peek(256);
+	const auto header_data = reinterpret_cast<const unsigned char*>(header.constData());
+
+	error = tr("Invalid file type.");
+	for (auto format : FileFormats.formats())
+	{
+		if (!format->supportsImport() || !format->understands(header_data, std::size_t(header.size())))
+			continue;
+
+		std::unique_ptr<Importer> importer { format->createImporter(&file, &map, &view) };
+		try
+		{
+			importer->doImport(false, QFileInfo(path).absolutePath());
+			importer->finishImport();
+		}
+		catch (FileFormatException& e)
+		{
+			error = e.message();
+			map.reset();
+			file.seek(0);
+			continue;
+		}
+		catch (std::exception& e)
+		{
+			error = QString::fromLocal8Bit(e.what());
+			map.reset();
+			file.seek(0);
+			continue;
+		}
+
+		for (const auto& warning : importer->warnings())
+			report(path + QLatin1String(": ") + warning);
+		map.updateAllObjects();
+		return true;
+	}
+	return false;
+}
+
+
+bool BatchConverter::exportMap(Map& map, MapView& view, const FileFormat& format, const QString& path, QString& error)
+{
+	// Like Map::exportTo(), but without message boxes
+	QSaveFile file(path);
+	std::unique_ptr<Exporter> exporter { format.createExporter(&file, &map, &view) };
+	if (!file.open(QIODevice::WriteOnly))
+	{
+		error = file.errorString();
+		return false;
+	}
+
+	try
+	{
+		exporter->doExport();
+	}
+	catch (std::exception& e)
+	{
+		file.cancelWriting();
+		error = QString::fromLocal8Bit(e.what());
+		return false;
+	}
+
+	if (!file.commit())
+	{
+		error = file.errorString();
+		return false;
+	}
+
+	for (const auto& warning : exporter->warnings())
+		report(path + QLatin1String(": ") + warning);
+	return true;
+}
+
+
+bool BatchConverter::exportPdf(Map& map, MapView& view, const QString& path, QString& error) const
+{
+	MapPrinter map_printer(map, &view);
+	map_printer.setTarget(MapPrinter::pdfTarget());
+	if (resolution > 0)
+		map_printer.setResolution(resolution);
+
+	auto printer = map_printer.makePrinter();
+	if (!printer)
+	{
+		error = tr("Failed to prepare the PDF export.");
+		return false;
+	}
+
+	printer->setOutputFormat(QPrinter::PdfFormat);
+	printer->setCreator(APP_NAME);
+	printer->setDocName(QFileInfo(path).baseName());
+	printer->setOutputFileName(path);
+	if (!map_printer.printMap(printer.get()))
+	{
+		error = tr("Failed to print the map.");
+		return false;
+	}
+	return true;
+}
+
+
+bool BatchConverter::exportImage(Map& map, MapView& view, const QString& path, QString& error) const
+{
+	MapPrinter map_printer(map, &view);
+	map_printer.setTarget(MapPrinter::imageTarget());
+	if (resolution > 0)
+		map_printer.setResolution(resolution);
+
+	// Cf. PrintWidget::exportToImage()
+	const auto pixel_per_mm = map_printer.getOptions().resolution / 25.4;
+	const auto width  = qRound(map_printer.getPrintAreaPaperSize().width() * pixel_per_mm);
+	const auto height = qRound(map_printer.getPrintAreaPaperSize().height() * pixel_per_mm);
+	if (width <= 0 || height <= 0)
+	{
+		error = tr("The print area is empty.");
+		return false;
+	}
+
+	const auto tile_width  = tile_size > 0 ? tile_size : width;
+	const auto tile_height = tile_size > 0 ? tile_size : height;
+	const auto columns = (width + tile_width - 1) / tile_width;
+	const auto rows    = (height + tile_height - 1) / tile_height;
+
+	const auto& print_area = map_printer.getPrintArea();
+	const auto map_units_per_pixel = 1 / (pixel_per_mm * map_printer.getScaleAdjustment());
+	const auto dots_per_meter = qRound(pixel_per_mm * 1000);
+
+	const auto info = QFileInfo(path);
+	const auto tile_path_template = QString(info.path() + QLatin1Char('/') + info.completeBaseName()
+	                                        + QLatin1String("_%1_%2.") + info.suffix());
+
+	// Tiles are drawn concurrently.
+	map.updateObjects();
+	std::vector<QString> errors(std::size_t(rows * columns));
+	parallelFor(errors.size(), [&](std::size_t i) {
+		const auto row    = int(i) / columns;
+		const auto column = int(i) % columns;
+		QImage image(qMin(tile_width, width - column * tile_width),
+		             qMin(tile_height, height - row * tile_height),
+		             QImage::Format_ARGB32_Premultiplied);
+		if (image.isNull())
+		{
+			errors[i] = tr("Failed to prepare the image. Not enough memory.");
+			return;
+		}
+
+		image.setDotsPerMeterX(dots_per_meter);
+		image.setDotsPerMeterY(dots_per_meter);
+		image.fill(QColor(Qt::white));
+
+		const auto extent = QRectF { print_area.left() + column * tile_width * map_units_per_pixel,
+		                             print_area.top() + row * tile_height * map_units_per_pixel,
+		                             image.width() * map_units_per_pixel,
+		                             image.height() * map_units_per_pixel };
+		QPainter painter(&image);
+		map_printer.drawPage(&painter, extent, &image);
+		painter.end();
+
+		const auto image_path = tile_size > 0 ? tile_path_template.arg(row).arg(column) : path;
+		if (!image.save(image_path))
+			errors[i] = tr("Failed to save the image %1.").arg(image_path);
+	});
+
+	for (const auto& tile_error : errors)
+	{
+		if (!tile_error.isEmpty())
+		{
+			error = tile_error;
+			return false;
+		}
+	}
+	return true;
+}
+
+
+
+void BatchConverter::report(const QString& line)
+{
+	QMutexLocker locker(&log_mutex);
+	log << line << endl;
+}
+
+
+}  // namespace OpenOrienteering
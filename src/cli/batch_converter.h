@@ -0,0 +1,159 @@
+/*
+ *    Copyright 2018 The OpenOrienteering developers
+ *
+ *    This file is part of OpenOrienteering.
+ *
+ *    OpenOrienteering is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    OpenOrienteering is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with OpenOrienteering.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef OPENORIENTEERING_BATCH_CONVERTER_H
+#define OPENORIENTEERING_BATCH_CONVERTER_H
+
+#include <vector>
+
+#include <QCoreApplication>
+#include <QMutex>
+#include <QString>
+#include <QStringList>
+
+class QTextStream;
+
+namespace OpenOrienteering {
+
+class FileFormat;
+class Map;
+class MapView;
+
+
+/**
+ * A batch job: a map file, and the files to be created from it.
+ *
+ * The type of each output is determined from its file name suffix:
+ * - the extension of a file format which supports export: the map is saved in this format,
+ * - "pdf": the map is printed to PDF,
+ * - a raster image format supported by Qt: the map is rendered to an image.
+ */
+struct BatchJob
+{
+	QString input;
+	QStringList outputs;
+};
+
+
+/**
+ * Processes batch jobs without user interaction.
+ *
+ * Each job loads its map once and then creates all its outputs. Independent
+ * jobs run in parallel on a dedicated thread pool, so that the global thread
+ * pool remains available for the parallel rendering of a single map.
+ *
+ * For each job, a line with the timings of the individual stages is written
+ * to the log.
+ */
+class BatchConverter
+{
+	Q_DECLARE_TR_FUNCTIONS(OpenOrienteering::BatchConverter)
+
+public:
+	/**
+	 * Constructs a converter which writes its report to the given stream.
+	 */
+	explicit BatchConverter(QTextStream& log);
+
+	BatchConverter(const BatchConverter&) = delete;
+	BatchConverter& operator=(const BatchConverter&) = delete;
+
+	~BatchConverter();
+
+
+	/**
+	 * Sets the maximum number of jobs which are processed in parallel.
+	 *
+	 * Values less than 1 select the number of processor cores.
+	 */
+	void setMaxParallelJobs(int count);
+
+	/**
+	 * Sets the resolution for PDF and image output.
+	 *
+	 * Values less than 1 select the resolution from the map's print settings.
+	 */
+	void setResolution(int dpi);
+
+	/**
+	 * Sets the size of image tiles in pixels.
+	 *
+	 * When the size is greater than 0, images are not written as a single file
+	 * but as tiles named after the output file with the suffixes "_ROW_COL".
+	 */
+	void setTileSize(int pixels);
+
+
+	/**
+	 * Processes the given jobs, and returns the number of failed jobs.
+	 */
+	int run(const std::vector<BatchJob>& jobs);
+
+	/**
+	 * Processes a single job.
+	 *
+	 * This function may be called concurrently.
+	 */
+	bool process(const BatchJob& job);
+
+
+protected:
+	/**
+	 * Loads the map from the given file.
+	 *
+	 * Import warnings are written to the log. On failure, the error is
+	 * the message of the last importer which tried to read the file.
+	 */
+	bool importMap(Map& map, MapView& view, const QString& path, QString& error);
+
+	/**
+	 * Saves the map in the given file format.
+	 *
+	 * Export warnings are written to the log.
+	 */
+	bool exportMap(Map& map, MapView& view, const FileFormat& format, const QString& path, QString& error);
+
+	/**
+	 * Prints the map to a PDF file, using the map's print settings.
+	 */
+	bool exportPdf(Map& map, MapView& view, const QString& path, QString& error) const;
+
+	/**
+	 * Renders the map's print area to an image file, or to image tiles.
+	 */
+	bool exportImage(Map& map, MapView& view, const QString& path, QString& error) const;
+
+	/**
+	 * Writes a line to the log.
+	 */
+	void report(const QString& line);
+
+
+private:
+	QTextStream& log;
+	QMutex log_mutex;
+	int max_parallel_jobs = 0;
+	int resolution = 0;
+	int tile_size = 0;
+};
+
+
+}  // namespace OpenOrienteering
+
+#endif
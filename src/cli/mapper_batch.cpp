@@ -0,0 +1,177 @@
+/*
+ *    Copyright 2018 The OpenOrienteering developers
+ *
+ *    This file is part of OpenOrienteering.
+ *
+ *    OpenOrienteering is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    OpenOrienteering is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with OpenOrienteering.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <clocale>
+#include <cstdio>
+#include <vector>
+
+#include <QtGlobal>
+#include <QApplication>
+#include <QCommandLineOption>
+#include <QCommandLineParser>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QIODevice>
+#include <QLatin1Char>
+#include <QLatin1String>
+#include <QString>
+#include <QStringList>
+#include <QTextStream>
+
+#include <mapper_config.h>
+
+#include "global.h"
+#include "mapper_resource.h"
+#include "cli/batch_converter.h"
+
+using namespace OpenOrienteering;
+
+
+namespace {
+
+/**
+ * Reads jobs from a text file.
+ *
+ * Each non-empty line which does not start with '#' holds the input file
+ * followed by the output files, separated by tabs.
+ */
+bool readJobList(const QString& path, std::vector<BatchJob>& jobs, QTextStream& err)
+{
+	QFile file(path);
+	if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
+	{
+		err << QString::fromLatin1("Cannot open file for reading: %1").arg(path) << endl;
+		return false;
+	}
+
+	QTextStream stream(&file);
+	stream.setCodec("UTF-8");
+	while (!stream.atEnd())
+	{
+		const auto line = stream.readLine().trimmed();
+		if (line.isEmpty() || line.startsWith(QLatin1Char('#')))
+			continue;
+
+		auto fields = line.split(QLatin1Char('\t'), QString::SkipEmptyParts);
+		BatchJob job;
+		job.input = fields.takeFirst();
+		job.outputs = fields;
+		jobs.push_back(job);
+	}
+	return true;
+}
+
+
+}  // namespace
+
+
+
+int main(int argc, char** argv)
+{
+	// Run without a display
+	if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM"))
+		qputenv("QT_QPA_PLATFORM", "offscreen");
+
+	QApplication qapp(argc, argv);
+
+	// Load resources
+	Q_INIT_RESOURCE(resources);
+
+	QApplication::setOrganizationName(QString::fromLatin1("OpenOrienteering.org"));
+	QApplication::setApplicationName(QString::fromLatin1("Mapper"));
+	QApplication::setApplicationVersion(QString::fromUtf8(APP_VERSION));
+
+	MapperResource::setSeachPaths();
+
+	// Avoid numeric issues in libraries such as GDAL
+	setlocale(LC_NUMERIC, "C");
+
+	// Initialize static things like the file format registry.
+	doStaticInitializations();
+
+	QCommandLineParser parser;
+	parser.setApplicationDescription(QString::fromLatin1(
+	    "Converts maps and renders them to PDF and images, without user interaction.\n"
+	    "The type of each output is determined by the file name suffix: "
+	    "map file formats (e.g. omap, ocd), pdf, or image formats (e.g. png, jpg)."));
+	parser.addHelpOption();
+	parser.addVersionOption();
+	QCommandLineOption format_option({ QString::fromLatin1("f"), QString::fromLatin1("format") },
+	                                 QString::fromLatin1("Create an output file with suffix <ext> for each input file. May be repeated."),
+	                                 QString::fromLatin1("ext"));
+	QCommandLineOption output_dir_option({ QString::fromLatin1("o"), QString::fromLatin1("output-dir") },
+	                                     QString::fromLatin1("Write the outputs for --format to <dir> instead of the input file's directory."),
+	                                     QString::fromLatin1("dir"));
+	QCommandLineOption job_list_option({ QString::fromLatin1("l"), QString::fromLatin1("job-list") },
+	                                   QString::fromLatin1("Read jobs from <file>: one line per job, input and outputs separated by tabs."),
+	                                   QString::fromLatin1("file"));
+	QCommandLineOption jobs_option({ QString::fromLatin1("j"), QString::fromLatin1("jobs") },
+	                               QString::fromLatin1("Process up to <n> maps in parallel. Default: number of cores."),
+	                               QString::fromLatin1("n"));
+	QCommandLineOption resolution_option({ QString::fromLatin1("r"), QString::fromLatin1("resolution") },
+	                                     QString::fromLatin1("Resolution for PDF and image output. Default: print settings of the map."),
+	                                     QString::fromLatin1("dpi"));
+	QCommandLineOption tile_size_option({ QString::fromLatin1("t"), QString::fromLatin1("tile-size") },
+	                                    QString::fromLatin1("Write images as tiles of <px> x <px> pixels, named FILE_ROW_COL.EXT."),
+	                                    QString::fromLatin1("px"));
+	parser.addOption(format_option);
+	parser.addOption(output_dir_option);
+	parser.addOption(job_list_option);
+	parser.addOption(jobs_option);
+	parser.addOption(resolution_option);
+	parser.addOption(tile_size_option);
+	parser.addPositionalArgument(QString::fromLatin1("files"),
+	                             QString::fromLatin1("Input map files, to be processed with --format."),
+	                             QString::fromLatin1("[files...]"));
+	parser.process(qapp);
+
+	QTextStream out(stdout);
+	QTextStream err(stderr);
+
+	std::vector<BatchJob> jobs;
+	if (parser.isSet(job_list_option))
+	{
+		if (!readJobList(parser.value(job_list_option), jobs, err))
+			return 1;
+	}
+
+	const auto formats = parser.values(format_option);
+	const auto output_dir = parser.value(output_dir_option);
+	for (const auto& input : parser.positionalArguments())
+	{
+		const auto info = QFileInfo(input);
+		const auto dir = QDir(output_dir.isEmpty() ? info.path() : output_dir);
+		BatchJob job;
+		job.input = input;
+		for (const auto& format : formats)
+			job.outputs.push_back(dir.filePath(info.completeBaseName() + QLatin1Char('.') + format));
+		jobs.push_back(job);
+	}
+
+	if (jobs.empty())
+		parser.showHelp(1);
+
+	BatchConverter converter(out);
+	converter.setMaxParallelJobs(parser.value(jobs_option).toInt());
+	converter.setResolution(parser.value(resolution_option).toInt());
+	converter.setTileSize(parser.value(tile_size_option).toInt());
+	return converter.run(jobs) == 0 ? 0 : 1;
+}
@@ -22,7 +22,9 @@
 
 #include <QtGlobal>
 #include <QLatin1String>
+#include <QRunnable>
 #include <QString>
+#include <QThreadPool>
 #include <QTimer>
 #include <QVariant>
 
@@ -31,19 +33,56 @@
 
 namespace OpenOrienteering {
 
+namespace {
+
+/**
+ * Runs the background autosave of an AutosavePrivate object.
+ */
+class BackgroundAutosaveRunnable : public QRunnable
+{
+public:
+	BackgroundAutosaveRunnable(const Autosave::BackgroundAutosave& function, Autosave::AutosaveResult& result, QSemaphore& done, AutosavePrivate& notify)
+	: function(function)
+	, result(result)
+	, done(done)
+	, notify(notify)
+	{}
+	
+	void run() override
+	{
+		result = function();
+		emit notify.backgroundAutosaveFinished();
+		done.release();
+	}
+	
+private:
+	const Autosave::BackgroundAutosave& function;
+	Autosave::AutosaveResult& result;
+	QSemaphore& done;
+	AutosavePrivate& notify;
+};
+
+}  // namespace
+
+
+
 AutosavePrivate::AutosavePrivate(Autosave& document)
 : document(document)
 , autosave_needed(false)
+, background_result(Autosave::Success)
 {
 	autosave_timer.setSingleShot(true);
 	connect(&autosave_timer, &QTimer::timeout, this, &AutosavePrivate::autosave);
 	connect(&Settings::getInstance(), &Settings::settingsChanged, this, &AutosavePrivate::settingsChanged);
+	connect(this, &AutosavePrivate::backgroundAutosaveFinished, this, &AutosavePrivate::finishBackgroundAutosave, Qt::QueuedConnection);
 	settingsChanged();
 }
 
 AutosavePrivate::~AutosavePrivate()
 {
-	// nothing, not inlined
+	// The document is gone, so there is no need to report the result.
+	if (background_autosave)
+		background_done.acquire();
 }
 
 void AutosavePrivate::settingsChanged()
@@ -90,7 +129,44 @@ void AutosavePrivate::setAutosaveNeeded(bool needed)
 
 void AutosavePrivate::autosave()
 {
-	Autosave::AutosaveResult result = document.autosave();
+	if (background_autosave)
+	{
+		// The previous autosave is still running.
+		autosaveDone(Autosave::TemporaryFailure);
+		return;
+	}
+	
+	Autosave::AutosaveResult result = Autosave::PermanentFailure;
+	background_autosave = document.prepareAutosave(result);
+	if (!background_autosave)
+	{
+		autosaveDone(result);
+		return;
+	}
+	
+	QThreadPool::globalInstance()->start(new BackgroundAutosaveRunnable(background_autosave, background_result, background_done, *this));
+}
+
+void AutosavePrivate::waitForAutosave()
+{
+	if (background_autosave)
+		finishBackgroundAutosave();
+}
+
+void AutosavePrivate::finishBackgroundAutosave()
+{
+	// After waitForAutosave(), there may still be a queued notification.
+	if (!background_autosave)
+		return;
+	
+	background_done.acquire();
+	background_autosave = {};
+	document.autosaveFinished(background_result);
+	autosaveDone(background_result);
+}
+
+void AutosavePrivate::autosaveDone(Autosave::AutosaveResult result)
+{
 	if (autosave_interval)
 	{
 		switch (result)
@@ -129,6 +205,22 @@ QString Autosave::autosavePath(const QString &path) const
 	return path + QLatin1String(".autosave");
 }
 
+Autosave::BackgroundAutosave Autosave::prepareAutosave(Autosave::AutosaveResult& result)
+{
+	result = autosave();
+	return {};
+}
+
+void Autosave::autosaveFinished(Autosave::AutosaveResult /*result*/)
+{
+	// Nothing, not inlined
+}
+
+void Autosave::waitForAutosave()
+{
+	autosave_controller->waitForAutosave();
+}
+
 void Autosave::setAutosaveNeeded(bool needed)
 {
 	autosave_controller->setAutosaveNeeded(needed);
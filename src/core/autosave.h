@@ -20,6 +20,8 @@
 #ifndef OPENORIENTEERING_AUTOSAVE_H
 #define OPENORIENTEERING_AUTOSAVE_H
 
+#include <functional>
+
 #include <QScopedPointer>
 
 class QString;
@@ -47,6 +49,10 @@ class AutosavePrivate;
  * regular autosaving period.
  * On temporary failure, autosave() will be called again after five seconds.
  * 
+ * Classes may also implement prepareAutosave() in order to save a snapshot of
+ * the data on a worker thread. Then the GUI thread only needs to wait for
+ * taking the snapshot.
+ * 
  * The autosave period (in minutes) is taken from the setting
  * Settings::General_AutosaveInterval.
  */
@@ -67,6 +73,38 @@ public:
 	/** @brief Performs an autosave, if possible. */
 	virtual AutosaveResult autosave() = 0;
 	
+	/** @brief A function which completes an autosave on a worker thread. */
+	using BackgroundAutosave = std::function<AutosaveResult ()>;
+	
+	/**
+	 * @brief Prepares an autosave which is completed on a worker thread.
+	 * 
+	 * This function is called on the GUI thread instead of autosave(). It may
+	 * take a snapshot of the data and return a function which saves the
+	 * snapshot. This function must not access the original data. It is
+	 * destroyed on the GUI thread, after autosaveFinished() was called.
+	 * 
+	 * If the returned function is empty, the autosave is finished, and its
+	 * result is taken from the result parameter.
+	 * 
+	 * The default implementation calls autosave() and returns an empty function.
+	 */
+	virtual BackgroundAutosave prepareAutosave(AutosaveResult& result);
+	
+	/**
+	 * @brief Informs about the result of an autosave on a worker thread.
+	 * 
+	 * The default implementation does nothing.
+	 */
+	virtual void autosaveFinished(AutosaveResult result);
+	
+	/**
+	 * @brief Waits for the completion of an autosave on a worker thread.
+	 * 
+	 * Call this function before touching the autosaved file in other ways.
+	 */
+	void waitForAutosave();
+	
 	/** @brief Informs Autosave whether autosaving is needed or not. */
 	void setAutosaveNeeded(bool);
 	
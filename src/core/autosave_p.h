@@ -21,6 +21,7 @@
 #define OPENORIENTEERING_AUTOSAVE_P_H
 
 #include <QObject>
+#include <QSemaphore>
 #include <QTimer>
 
 #include "autosave.h"
@@ -49,18 +50,35 @@ public:
 	
 	void setAutosaveNeeded(bool);
 	
+	void waitForAutosave();
+	
+signals:
+	/**
+	 * @brief Emitted from the worker thread when the background autosave has finished.
+	 */
+	void backgroundAutosaveFinished();
+	
 public slots:
 	void autosave();
 	
 	void settingsChanged();
 	
+private slots:
+	void finishBackgroundAutosave();
+	
 private:
 	Q_DISABLE_COPY(AutosavePrivate)
 	
+	void autosaveDone(Autosave::AutosaveResult result);
+	
 	Autosave& document;
 	QTimer autosave_timer;
 	bool autosave_needed;
 	int  autosave_interval;
+	
+	Autosave::BackgroundAutosave background_autosave;
+	Autosave::AutosaveResult background_result;
+	QSemaphore background_done;
 };
 
 
@@ -142,6 +142,19 @@ namespace
 	};
 	
 	
+	/**
+	 * Moves the success flags of a batch transformation to the output,
+	 * if requested, and returns true if all coordinates were transformed.
+	 */
+	bool reportPointsOk(std::vector<bool>&& point_ok, std::vector<bool>* ok)
+	{
+		auto const all_ok = std::find(begin(point_ok), end(point_ok), false) == end(point_ok);
+		if (ok)
+			*ok = std::move(point_ok);
+		return all_ok;
+	}
+	
+	
 }  // namespace
 
 
@@ -819,6 +832,141 @@ QString Georeferencing::getErrorText() const
 	return (err_no == 0) ? QString() : QString::fromLatin1(pj_strerrno(err_no));
 }
 
+bool Georeferencing::toGeographicCoords(const QPointF* projected_coords, std::size_t count, LatLon* lat_lon, std::vector<bool>* ok) const
+{
+	std::vector<double> x(count), y(count);
+	for (std::size_t i = 0; i < count; ++i)
+	{
+		x[i] = projected_coords[i].x();
+		y[i] = projected_coords[i].y();
+	}
+	
+	std::vector<bool> point_ok(count, false);
+	if (projected_crs && geographic_crs)
+	{
+		point_ok.assign(count, true);
+		transformPoints(projected_crs, geographic_crs, x, y, point_ok);
+	}
+	
+	for (std::size_t i = 0; i < count; ++i)
+		lat_lon[i] = LatLon::fromRadiant(y[i], x[i]);
+	return reportPointsOk(std::move(point_ok), ok);
+}
+
+bool Georeferencing::toProjectedCoords(const LatLon* lat_lon, std::size_t count, QPointF* projected_coords, std::vector<bool>* ok) const
+{
+	std::vector<double> x(count), y(count);
+	for (std::size_t i = 0; i < count; ++i)
+	{
+		x[i] = degToRad(lat_lon[i].longitude());
+		y[i] = degToRad(lat_lon[i].latitude());
+	}
+	
+	std::vector<bool> point_ok(count, false);
+	if (projected_crs && geographic_crs)
+	{
+		point_ok.assign(count, true);
+		transformPoints(geographic_crs, projected_crs, x, y, point_ok);
+	}
+	
+	for (std::size_t i = 0; i < count; ++i)
+		projected_coords[i] = QPointF(x[i], y[i]);
+	return reportPointsOk(std::move(point_ok), ok);
+}
+
+void Georeferencing::toMapCoordF(const QPointF* projected_coords, std::size_t count, MapCoordF* map_coords) const
+{
+	for (std::size_t i = 0; i < count; ++i)
+		map_coords[i] = MapCoordF(from_projected.map(projected_coords[i]));
+}
+
+bool Georeferencing::toMapCoordF(const LatLon* lat_lon, std::size_t count, MapCoordF* map_coords, std::vector<bool>* ok) const
+{
+	std::vector<QPointF> projected_coords(count);
+	auto all_ok = toProjectedCoords(lat_lon, count, projected_coords.data(), ok);
+	toMapCoordF(projected_coords.data(), count, map_coords);
+	return all_ok;
+}
+
+bool Georeferencing::toMapCoordF(const Georeferencing* other, const MapCoordF* map_coords, std::size_t count, MapCoordF* result, std::vector<bool>* ok) const
+{
+	if (!other)
+	{
+		std::copy(map_coords, map_coords + count, result);
+		return reportPointsOk(std::vector<bool>(count, true), ok);
+	}
+	
+	std::vector<double> x(count), y(count);
+	for (std::size_t i = 0; i < count; ++i)
+	{
+		auto const projected_coords = other->toProjectedCoords(map_coords[i]);
+		x[i] = projected_coords.x();
+		y[i] = projected_coords.y();
+	}
+	
+	std::vector<bool> point_ok(count, true);
+	if (!isLocal() && !other->isLocal())
+	{
+		if (projected_crs && other->projected_crs)
+		{
+			// Use geographic coordinates as intermediate step to enforce
+			// that coordinates are assumed to have WGS84 datum if datum is specified in only one CRS spec:
+			transformPoints(other->projected_crs, geographic_crs, x, y, point_ok);
+			transformPoints(geographic_crs, projected_crs, x, y, point_ok);
+		}
+		else
+		{
+			point_ok.assign(count, false);
+		}
+	}
+	
+	for (std::size_t i = 0; i < count; ++i)
+		result[i] = MapCoordF(from_projected.map(QPointF(x[i], y[i])));
+	return reportPointsOk(std::move(point_ok), ok);
+}
+
+// static
+void Georeferencing::transformPoints(projPJ source, projPJ target, std::vector<double>& x, std::vector<double>& y, std::vector<bool>& ok)
+{
+	Q_ASSERT(x.size() == y.size());
+	Q_ASSERT(ok.size() == x.size());
+	
+	auto const count = x.size();
+	if (count > 1)
+	{
+		// PROJ marks coordinates which cannot be transformed with HUGE_VAL,
+		// without failing the whole batch. Failed input is skipped.
+		auto batch_x = x;
+		auto batch_y = y;
+		for (std::size_t i = 0; i < count; ++i)
+		{
+			if (!ok[i])
+				batch_x[i] = batch_y[i] = HUGE_VAL;
+		}
+		if (pj_transform(source, target, long(count), 1, batch_x.data(), batch_y.data(), nullptr) == 0)
+		{
+			for (std::size_t i = 0; i < count; ++i)
+			{
+				if (!ok[i])
+					continue;
+				x[i] = batch_x[i];
+				y[i] = batch_y[i];
+				if (x[i] == HUGE_VAL || y[i] == HUGE_VAL)
+					ok[i] = false;
+			}
+			return;
+		}
+	}
+	
+	// Point by point, as for single coordinates
+	for (std::size_t i = 0; i < count; ++i)
+	{
+		if (ok[i] && pj_transform(source, target, 1, 1, &x[i], &y[i], nullptr) != 0)
+			ok[i] = false;
+	}
+}
+
+
 double Georeferencing::radToDeg(double val)
 {
 	return RAD_TO_DEG * val;
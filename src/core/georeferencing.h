@@ -22,6 +22,7 @@
 #define OPENORIENTEERING_GEOREFERENCING_H
 
 #include <cmath>
+#include <cstddef>
 #include <vector>
 
 #include <QObject>
@@ -458,6 +459,62 @@ public:
 	MapCoordF toMapCoordF(const Georeferencing* other, const MapCoordF& map_coords, bool* ok = nullptr) const;
 	
 	
+	/**
+	 * Transforms an array of CRS coordinates to geographic coordinates (lat/lon).
+	 * 
+	 * This is the batch variant of toGeographicCoords(const QPointF&, bool*).
+	 * All coordinates are passed to PROJ in a single call. The output array
+	 * must have room for count elements.
+	 * 
+	 * If ok is not null, it receives the success of each single coordinate.
+	 * Returns false if the transformation failed for any coordinate.
+	 */
+	bool toGeographicCoords(const QPointF* projected_coords, std::size_t count, LatLon* lat_lon, std::vector<bool>* ok = nullptr) const;
+	
+	/**
+	 * Transforms an array of geographic coordinates (lat/lon) to CRS coordinates.
+	 * 
+	 * This is the batch variant of toProjectedCoords(const LatLon&, bool*).
+	 * All coordinates are passed to PROJ in a single call. The output array
+	 * must have room for count elements.
+	 * 
+	 * If ok is not null, it receives the success of each single coordinate.
+	 * Returns false if the transformation failed for any coordinate.
+	 */
+	bool toProjectedCoords(const LatLon* lat_lon, std::size_t count, QPointF* projected_coords, std::vector<bool>* ok = nullptr) const;
+	
+	/**
+	 * Transforms an array of projected coordinates to map (paper) coordinates.
+	 * 
+	 * The output array must have room for count elements.
+	 */
+	void toMapCoordF(const QPointF* projected_coords, std::size_t count, MapCoordF* map_coords) const;
+	
+	/**
+	 * Transforms an array of geographic coordinates (lat/lon) to map coordinates.
+	 * 
+	 * This is the batch variant of toMapCoordF(const LatLon&, bool*).
+	 * The output array must have room for count elements.
+	 * 
+	 * If ok is not null, it receives the success of each single coordinate.
+	 * Returns false if the transformation failed for any coordinate.
+	 */
+	bool toMapCoordF(const LatLon* lat_lon, std::size_t count, MapCoordF* map_coords, std::vector<bool>* ok = nullptr) const;
+	
+	/**
+	 * Transforms an array of map coordinates from the other georeferencing
+	 * to map coordinates of this georeferencing, if possible.
+	 * 
+	 * This is the batch variant of toMapCoordF(const Georeferencing*, const MapCoordF&, bool*).
+	 * The output array must have room for count elements. It may be the same
+	 * as the input array.
+	 * 
+	 * If ok is not null, it receives the success of each single coordinate.
+	 * Returns false if the transformation failed for any coordinate.
+	 */
+	bool toMapCoordF(const Georeferencing* other, const MapCoordF* map_coords, std::size_t count, MapCoordF* result, std::vector<bool>* ok = nullptr) const;
+	
+	
 	/**
 	 * Returns the current error text.
 	 */
@@ -546,6 +603,16 @@ signals:
 private:
 	void setDeclinationAndGrivation(double declination, double grivation);
 	
+	/**
+	 * Transforms the given coordinate arrays in place, in a single PROJ call.
+	 * 
+	 * Coordinates which cannot be transformed are marked as false in ok.
+	 * Coordinates which are already marked as false are not transformed.
+	 * If PROJ fails for the whole batch, the coordinates are transformed
+	 * one by one, with the same result as for single coordinates.
+	 */
+	static void transformPoints(projPJ source, projPJ target, std::vector<double>& x, std::vector<double>& y, std::vector<bool>& ok);
+	
 	State state;
 	
 	unsigned int scale_denominator;
@@ -22,6 +22,12 @@
 
 #include <QImage>
 
+// SSE2 is part of the x86-64 baseline, so it needs no detection at runtime.
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#  define MAPPER_SSE2_IMAGE_FIXUP
+#  include <emmintrin.h>
+#endif
+
 namespace OpenOrienteering {
 
 
@@ -74,10 +80,25 @@ public:
 	 * Checks all pixels of the image for the known wrong result of composing
 	 * fully transparent pixels, and replaces them with a fully transparent 
 	 * pixel.
+	 * 
+	 * With SSE2, four pixels are checked at once. Pixels are written only
+	 * when there is a match.
 	 */
 	inline void operator()() const
 	{
-		for (QRgb* px = dest; px < dest_end; px++)
+		QRgb* px = dest;
+#ifdef MAPPER_SSE2_IMAGE_FIXUP
+		const __m128i wrong = _mm_set1_epi32(0x01000000);
+		for (; dest_end - px >= 4; px += 4)
+		{
+			__m128i* pixels = reinterpret_cast<__m128i*>(px);
+			const __m128i value = _mm_loadu_si128(pixels);
+			const __m128i match = _mm_cmpeq_epi32(value, wrong);
+			if (_mm_movemask_epi8(match))
+				_mm_storeu_si128(pixels, _mm_andnot_si128(match, value));
+		}
+#endif
+		for (; px < dest_end; px++)
 		{
 			if (*px == 0x01000000) /* qRgba(0, 0, 0, 1) */
 				*px = 0x00000000;  /* qRgba(0, 0, 0, 0) */
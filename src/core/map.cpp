@@ -40,6 +40,7 @@
 #include <QLatin1String>
 #include <QLocale>
 #include <QMessageBox>
+#include <QMutexLocker>
 #include <QPaintEngine>
 #include <QPainter>
 #include <QPoint>
@@ -59,7 +60,10 @@
 #include "core/map_view.h"
 #include "core/objects/object.h"
 #include "core/objects/object_operations.h"
+#include "core/objects/object_query.h"
+#include "core/objects/object_query_index.h"
 #include "core/renderables/renderable.h"
+#include "core/snapping_index.h"
 #include "core/symbols/combined_symbol.h"
 #include "core/symbols/line_symbol.h"
 #include "core/symbols/point_symbol.h"
@@ -68,6 +72,8 @@
 #include "fileformats/file_format.h"
 #include "fileformats/file_format_registry.h"
 #include "fileformats/file_import_export.h"
+#include "fileformats/xml_object_cache.h"
+#include "fileformats/xml_object_stream.h"
 #include "gui/map/map_widget.h"
 #include "gui/text_browser_dialog.h"
 #include "templates/template.h"
@@ -75,6 +81,7 @@
 #include "undo/object_undo.h"
 #include "undo/undo.h"
 #include "undo/undo_manager.h"
+#include "util/parallel.h"
 #include "util/util.h"
 #include "util/transformation.h"
 
@@ -434,7 +441,6 @@ MapColorMap Map::MapColorSet::importSet(const Map::MapColorSet& other, std::vect
 
 // ### Map ###
 
-bool Map::static_initialized = false;
 MapColor Map::covering_white(MapColor::CoveringWhite);
 MapColor Map::covering_red(MapColor::CoveringRed);
 MapColor Map::undefined_symbol_color(MapColor::Undefined);
@@ -455,8 +461,9 @@ Map::Map()
  , renderable_options(Symbol::RenderNormal)
  , printer_config(nullptr)
 {
-	if (!static_initialized)
-		initStatic();
+	// Thread-safe one-time initialization (batch jobs create maps concurrently)
+	static const auto static_initialized = (initStatic(), true);
+	Q_UNUSED(static_initialized);
 	
 	georeferencing.reset(new Georeferencing());
 	init();
@@ -474,6 +481,10 @@ Map::~Map()
 
 void Map::clear()
 {
+	object_stream.reset();
+	snapping_index.reset();
+	object_query_index.reset();
+	xml_object_cache.reset();
 	undo_manager->clear();
 	
 	for (auto temp : templates)
@@ -495,6 +506,8 @@ void Map::clear()
 		delete part;
 	parts.clear();
 	current_part_index = 0;
+	dirty_objects.clear();
+	tag_pool.clear();
 	
 	for (auto symbol : symbols)
 		delete symbol;
@@ -552,6 +565,8 @@ void Map::changeScale(unsigned int new_scale_denominator, const MapCoord& scalin
 	if (new_scale_denominator == getScaleDenominator())
 		return;
 	
+	finishLoadingObjects();
+	
 	double factor = getScaleDenominator() / (double)new_scale_denominator;
 	
 	if (scale_symbols)
@@ -601,6 +616,7 @@ void Map::rotateMap(double rotation, const MapCoord& center, bool adjust_georefe
 	if (std::fmod(rotation, 2 * M_PI) == 0)
 		return;
 	
+	finishLoadingObjects();
 	undo_manager->clear();
 	rotateAllObjects(rotation, center);
 	
@@ -664,6 +680,8 @@ bool Map::exportTo(const QString& path, MapView* view, const FileFormat* format)
 {
 	Q_ASSERT(view && "Saving a file without view information is not supported!");
 	
+	finishLoadingObjects();
+	
 	if (!format)
 		format = FileFormats.findFormatForFilename(path);
 
@@ -730,7 +748,7 @@ bool Map::exportTo(const QString& path, MapView* view, const FileFormat* format)
 	return success;
 }
 
-bool Map::loadFrom(const QString& path, QWidget* dialog_parent, MapView* view, bool load_symbols_only, bool show_error_messages)
+bool Map::loadFrom(const QString& path, QWidget* dialog_parent, MapView* view, bool load_symbols_only, bool show_error_messages, bool stream_objects)
 {
 	// Ensure the file exists and is readable.
 	QFile file(path);
@@ -765,6 +783,7 @@ bool Map::loadFrom(const QString& path, QWidget* dialog_parent, MapView* view, b
 			try {
 				// Create an importer instance for this file and map.
 				importer = format->createImporter(&file, this, view);
+				importer->setOption(QString::fromLatin1("streamObjects"), stream_objects);
 
 				// Run the first pass.
 				importer->doImport(load_symbols_only, QFileInfo(path).absolutePath());
@@ -801,6 +820,8 @@ bool Map::loadFrom(const QString& path, QWidget* dialog_parent, MapView* view, b
 				error_msg = QString::fromLatin1(e.what());
 			}
 			if (importer) delete importer;
+			if (!import_complete)
+				object_stream.reset();
 		}
 		// If the last importer finished successfully
 		if (import_complete) break;
@@ -826,10 +847,25 @@ bool Map::loadFrom(const QString& path, QWidget* dialog_parent, MapView* view, b
 	updateAllObjects(); // TODO: is the comment above still applicable?
 	
 	setHasUnsavedChanges(false);
+	
+	// Continue loading objects in the background
+	if (object_stream)
+		object_stream->start(show_error_messages ? dialog_parent : nullptr);
 
 	return true;
 }
 
+bool Map::isLoadingObjects() const
+{
+	return object_stream && !object_stream->isFinished();
+}
+
+void Map::finishLoadingObjects()
+{
+	if (object_stream)
+		object_stream->finish();
+}
+
 void Map::importMap(
         const Map* other,
         ImportMode mode,
@@ -839,6 +875,8 @@ void Map::importMap(
         bool merge_duplicate_symbols,
         QHash<const Symbol*, Symbol*>* out_symbol_map )
 {
+	finishLoadingObjects();
+	
 	// Check if there is something to import
 	if (other->getNumColors() == 0
 	    && other->getNumSymbols() == 0
@@ -921,6 +959,8 @@ QHash<const Symbol*, Symbol*> Map::importMap(
         bool merge_duplicate_symbols,
         const QTransform& transform)
 {
+	finishLoadingObjects();
+	
 	// Determine which symbols and colors to import
 	std::vector<bool> color_filter(std::size_t(imported_map.getNumColors()), true);
 	std::vector<bool> symbol_filter(std::size_t(imported_map.getNumSymbols()), true);
@@ -1024,6 +1064,7 @@ QHash<const Symbol*, Symbol*> Map::importMap(
 
 bool Map::exportToIODevice(QIODevice* stream)
 {
+	finishLoadingObjects();
 	stream->open(QIODevice::WriteOnly);
 	Exporter* exporter = nullptr;
 	try {
@@ -1116,7 +1157,9 @@ void Map::drawTemplates(QPainter* painter, const QRectF& bounding_box, int first
 		{
 			Q_ASSERT(visibility.opacity == 1 || painter->paintEngine()->hasFeature(QPaintEngine::ConstantOpacity));
 			painter->save();
+			QMutexLocker locker(&temp->drawingMutex());  // Templates may keep caches for drawing.
 			temp->drawTemplate(painter, bounding_box, scale, on_screen, visibility.opacity);
+			locker.unlock();
 			painter->restore();
 		}
 	}
@@ -1124,8 +1167,69 @@ void Map::drawTemplates(QPainter* painter, const QRectF& bounding_box, int first
 
 void Map::updateObjects()
 {
-	// TODO: It maybe would be better if the objects entered themselves into a separate list when they get dirty so not all objects have to be traversed here
-	applyOnAllObjects(&Object::update);
+	// Without dirty objects, this function doesn't modify the map.
+	// This allows concurrent drawing, e.g. of map tiles.
+	if (dirty_objects.empty())
+		return;
+	
+	// Objects which get dirty during the update are left for the next call.
+	std::unordered_set<const Object*> objects;
+	objects.swap(dirty_objects);
+	
+	std::vector<const Object*> dirty;
+	dirty.reserve(objects.size());
+	for (const Object* object : objects)
+	{
+		// Objects may have been removed from the map, or even deleted,
+		// after they were marked as dirty.
+		if (std::any_of(begin(parts), end(parts), [object](const MapPart* part) { return part->contains(object); })
+		    && object->isOutputDirty())
+		{
+			dirty.push_back(object);
+		}
+	}
+	updateObjects(dirty);
+}
+
+void Map::updateObjects(const std::vector<const Object*>& objects)
+{
+	// Below this size, the overhead of parallelization isn't worth it.
+	const std::size_t min_parallel_objects = 16;
+	if (objects.size() < min_parallel_objects)
+	{
+		for (const Object* object : objects)
+			object->update();
+		return;
+	}
+	
+	std::vector<const Object*> concurrent_objects;
+	concurrent_objects.reserve(objects.size());
+	for (const Object* object : objects)
+	{
+		Q_ASSERT(object->getMap() == this);
+		if (object->getExtent().isValid())
+			setObjectAreaDirty(object->getExtent());
+		
+		// Text layout depends on fonts which must not be shared across threads.
+		if (object->getType() == Object::Text)
+			object->createOutput();
+		else
+			concurrent_objects.push_back(object);
+	}
+	
+	parallelFor(concurrent_objects.size(), [&concurrent_objects](std::size_t i) {
+		concurrent_objects[i]->createOutput();
+	});
+	
+	for (const Object* object : objects)
+		object->publishOutput();
+}
+
+void Map::markOutputDirty(const Object* object)
+{
+	dirty_objects.insert(object);
+	invalidateSnappingIndex(object);
+	invalidateXmlObjectCache(object);
 }
 
 void Map::removeRenderablesOfObject(const Object* object, bool mark_area_as_dirty)
@@ -1141,6 +1245,94 @@ void Map::insertRenderablesOfObject(const Object* object)
 		addSelectionRenderables(object);
 }
 
+void Map::updateObjectIndex(const Object* object)
+{
+	// Selected objects share their renderables with the map.
+	selection_renderables->updateExtentOfObject(object);
+	
+	invalidateSnappingIndex(object);
+	
+	for (MapPart* part : parts)
+	{
+		if (part->updateObjectIndex(object))
+			return;
+	}
+}
+
+const SnappingIndex& Map::getSnappingIndex()
+{
+	if (!snapping_index)
+	{
+		// Object::update() calls back into updateObjectIndex(),
+		// so the objects are updated before the index exists.
+		updateObjects();
+		snapping_index.reset(new SnappingIndex());
+		for (MapPart* part : parts)
+			part->applyOnAllObjects([this](Object* object) { snapping_index->insert(object); });
+	}
+	else if (snapping_index->needsUpdate())
+	{
+		// Only the invalidated objects are updated.
+		snapping_index->update([this](const Object* object) {
+			if (std::none_of(begin(parts), end(parts), [object](const MapPart* part) { return part->contains(object); }))
+				return false;
+			object->update();
+			return true;
+		});
+	}
+	return *snapping_index;
+}
+
+void Map::invalidateSnappingIndex(const Object* object)
+{
+	if (snapping_index)
+		snapping_index->invalidate(object);
+}
+
+const ObjectQueryIndex& Map::getObjectQueryIndex()
+{
+	finishLoadingObjects();
+	if (!object_query_index)
+	{
+		object_query_index.reset(new ObjectQueryIndex(*this));
+	}
+	else if (object_query_index->needsUpdate())
+	{
+		// Only the invalidated objects are updated.
+		object_query_index->update([this](const Object* object) -> MapPart* {
+			auto part = std::find_if(begin(parts), end(parts), [object](const MapPart* part) { return part->contains(object); });
+			return part != end(parts) ? *part : nullptr;
+		});
+	}
+	return *object_query_index;
+}
+
+void Map::invalidateObjectQueryIndex()
+{
+	object_query_index.reset();
+}
+
+void Map::invalidateObjectQueryIndex(const Object* object)
+{
+	if (object_query_index)
+		object_query_index->invalidate(object);
+}
+
+const XmlObjectCache& Map::getXmlObjectCache()
+{
+	finishLoadingObjects();
+	if (!xml_object_cache)
+		xml_object_cache.reset(new XmlObjectCache());
+	xml_object_cache->update(*this);
+	return *xml_object_cache;
+}
+
+void Map::invalidateXmlObjectCache(const Object* object)
+{
+	if (xml_object_cache)
+		xml_object_cache->invalidate(object);
+}
+
 
 void Map::markAsIrregular(Object* object)
 {
@@ -1244,7 +1436,7 @@ void Map::drawSelection(QPainter* painter, bool force_min_size, MapWidget* widge
 	if (!replacement_renderables)
 		replacement_renderables = selection_renderables.data();
 	
-	RenderConfig::Options options = RenderConfig::Screen | RenderConfig::HelperSymbols;
+	auto options = RenderConfig::screenOptions(RenderConfig::HelperSymbols);
 	qreal selection_opacity = 1.0;
 	if (force_min_size)
 		options |= RenderConfig::ForceMinSize;
@@ -1757,8 +1949,6 @@ void Map::removeSelectionRenderables(const Object* object)
 
 void Map::initStatic()
 {
-	static_initialized = true;
-	
 	covering_white_line = new LineSymbol();
 	covering_white_line->setColor(&covering_white);
 	covering_white_line->setLineWidth(3.0);
@@ -1835,6 +2025,8 @@ Symbol* Map::getSymbol(int i)
 
 void Map::setSymbol(Symbol* symbol, int pos)
 {
+	finishLoadingObjects();
+	
 	Symbol* old_symbol = symbols[pos];
 	
 	// Check if an object with this symbol is selected
@@ -1872,6 +2064,8 @@ void Map::setSymbol(Symbol* symbol, int pos)
 
 void Map::deleteSymbol(int pos)
 {
+	finishLoadingObjects();
+	
 	if (deleteAllObjectsWithSymbol(symbols[pos]))
 		undo_manager->clear();
 	
@@ -2208,6 +2402,7 @@ void Map::addPart(MapPart* part, std::size_t index)
 	Q_ASSERT(index <= parts.size());
 	
 	parts.insert(parts.begin() + index, part);
+	invalidateObjectQueryIndex();
 	if (current_part_index >= index)
 		setCurrentPartIndex(current_part_index + 1);
 	
@@ -2219,6 +2414,8 @@ void Map::addPart(MapPart* part, std::size_t index)
 
 void Map::removePart(std::size_t index)
 {
+	finishLoadingObjects();
+	
 	Q_ASSERT(index < parts.size());
 	Q_ASSERT(parts.size() > 1);
 	
@@ -2233,6 +2430,7 @@ void Map::removePart(std::size_t index)
 		part->deleteObject(0, false);
 	
 	parts.erase(parts.begin() + index);
+	invalidateObjectQueryIndex();
 	if (current_part_index >= index)
 		setCurrentPartIndex((index == parts.size()) ? (parts.size() - 1) : index);
 	
@@ -2277,6 +2475,8 @@ void Map::setCurrentPartIndex(std::size_t index)
 
 int Map::reassignObjectsToMapPart(std::vector<int>::const_iterator first, std::vector<int>::const_iterator last, std::size_t source, std::size_t destination)
 {
+	finishLoadingObjects();
+	
 	Q_ASSERT(source < parts.size());
 	Q_ASSERT(destination < parts.size());
 	
@@ -2306,6 +2506,8 @@ int Map::reassignObjectsToMapPart(std::vector<int>::const_iterator first, std::v
 
 int Map::mergeParts(std::size_t source, std::size_t destination)
 {
+	finishLoadingObjects();
+	
 	Q_ASSERT(source < parts.size());
 	Q_ASSERT(destination < parts.size());
 	
@@ -2466,6 +2668,13 @@ void Map::applyOnMatchingObjects(const std::function<void (Object*, MapPart*, in
 }
 
 
+void Map::applyOnMatchingObjects(const std::function<void (Object*)>& operation, const ObjectQuery& query)
+{
+	for (auto part : parts)
+		part->applyOnMatchingObjects(operation, query);
+}
+
+
 void Map::applyOnAllObjects(const std::function<void (Object*)>& operation)
 {
 	for (auto part : parts)
@@ -2493,12 +2702,46 @@ void Map::rotateAllObjects(double rotation, const MapCoord& center)
 
 void Map::updateAllObjects()
 {
-	applyOnAllObjects(&Object::forceUpdate);
+	std::vector<const Object*> objects;
+	objects.reserve(std::size_t(getNumObjects()));
+	applyOnAllObjects([&objects](Object* object) {
+		object->output.deleteVariants();
+		object->output_dirty = true;
+		objects.push_back(object);
+	});
+	updateObjects(objects);
 }
 
 void Map::updateAllObjectsWithSymbol(const Symbol* symbol)
 {
-	applyOnMatchingObjects(&Object::forceUpdate, ObjectOp::HasSymbol{symbol});
+	std::vector<const Object*> objects;
+	applyOnMatchingObjects([&objects](Object* object) {
+		object->output.deleteVariants();
+		object->output_dirty = true;
+		objects.push_back(object);
+	}, ObjectOp::HasSymbol{symbol});
+	updateObjects(objects);
+}
+
+void Map::updateRenderableOptions(const std::function<bool (const Object*)>& condition)
+{
+	std::vector<const Object*> objects;
+	applyOnMatchingObjects([&objects](Object* object) {
+		if (!object->switchOutput())
+			objects.push_back(object);
+	}, condition);
+	updateObjects(objects);
+}
+
+void Map::updateRenderableOptions()
+{
+	std::vector<const Object*> objects;
+	objects.reserve(std::size_t(getNumObjects()));
+	applyOnAllObjects([&objects](Object* object) {
+		if (!object->switchOutput())
+			objects.push_back(object);
+	});
+	updateObjects(objects);
 }
 
 void Map::changeSymbolForAllObjects(const Symbol* old_symbol, const Symbol* new_symbol)
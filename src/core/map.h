@@ -25,7 +25,9 @@
 #include <algorithm>
 #include <cstddef>
 #include <functional>
+#include <memory>
 #include <set>
+#include <unordered_set>
 #include <vector>
 
 #include <QtGlobal>
@@ -44,6 +46,7 @@
 #include "core/map_coord.h"
 #include "core/map_grid.h"
 #include "core/map_part.h"
+#include "core/objects/tag_pool.h"
 
 class QIODevice;
 class QPainter;
@@ -64,13 +67,18 @@ class MapRenderables;
 class MapView;
 class MapWidget;
 class Object;
+class ObjectQuery;
+class ObjectQueryIndex;
 class PointSymbol;
 class RenderConfig;
+class SnappingIndex;
 class Symbol;
 class Template;
 class TextSymbol;
 class UndoManager;
 class UndoStep;
+class XmlObjectCache;
+class XmlObjectStream;
 
 
 /**
@@ -88,6 +96,7 @@ extern QPointer<QTranslator> map_symbol_translator;
 class Map : public QObject
 {
 Q_OBJECT
+friend class BinaryFileImporter;
 friend class MapTest;
 friend class MapRenderables;
 friend class OCAD8FileImport;
@@ -95,6 +104,7 @@ friend class NativeFileImport;
 friend class NativeFileExport;
 friend class XMLFileImporter;
 friend class XMLFileExporter;
+friend class XmlObjectStream;
 public:
 	/** A set of selected objects represented by a std::set of object pointers. */
 	typedef std::set<Object*> ObjectSelection;
@@ -188,11 +198,29 @@ public:
 	 * @param load_symbols_only Loads only symbols from the chosen file.
 	 *     Useful to load symbol sets.
 	 * @param show_error_messages Whether to show import errors and warnings.
+	 * @param stream_objects Whether to load the objects of native XML files
+	 *     on a worker thread after returning from this function.
+	 *     The objects are added from the event loop, cf. isLoadingObjects().
 	 */
 	bool loadFrom(const QString& path,
 	              QWidget* dialog_parent,
 	              MapView* view = nullptr,
-	              bool load_symbols_only = false, bool show_error_messages = true);
+	              bool load_symbols_only = false, bool show_error_messages = true,
+	              bool stream_objects = false);
+	
+	/**
+	 * Returns true while objects are still being loaded in the background.
+	 * 
+	 * @see loadFrom()
+	 */
+	bool isLoadingObjects() const;
+	
+	/**
+	 * Waits until all objects are loaded, and adds them to the map.
+	 * 
+	 * This does nothing when the map is not loading objects.
+	 */
+	void finishLoadingObjects();
 	
 	/**
 	 * Imports the other map into this map with the following strategy:
@@ -262,6 +290,9 @@ public:
 	 * Draws a spot color overprinting simulation for the part of the map
 	 * which is visible in the given bounding box.
 	 * 
+	 * For screen output, the config's options shall be created by
+	 * RenderConfig::screenOptions() on the GUI thread.
+	 * 
 	 * @param painter Must be a QPainter on a QImage of Format_ARGB32_Premultiplied.
 	 * @param config  The rendering configuration
 	 */
@@ -315,9 +346,20 @@ public:
 	/**
 	 * Updates the renderables and extent of all objects which have changed.
 	 * This is automatically called by draw(), you normally do not need to call it directly.
+	 * 
+	 * Only the objects registered by markOutputDirty() are visited.
 	 */
 	void updateObjects();
 	
+	/**
+	 * Registers an object whose output needs to be regenerated.
+	 * 
+	 * This is called by Object::setOutputDirty(). Objects which are not in
+	 * one of the map parts when updateObjects() is called are ignored.
+	 */
+	void markOutputDirty(const Object* object);
+	
+	
 	/** 
 	 * Calculates the extent of all map elements. 
 	 * 
@@ -943,6 +985,13 @@ public:
 	 */
 	void applyOnMatchingObjects(const std::function<void (Object*, MapPart*, int)>& operation, const std::function<bool (const Object*)>& condition);
 	
+	/**
+	 * Applies an operation on all objects which match an object query.
+	 * 
+	 * The matching objects are found via the object query index.
+	 */
+	void applyOnMatchingObjects(const std::function<void (Object*)>& operation, const ObjectQuery& query);
+	
 	/**
 	 * Applies an operation on all objects.
 	 */
@@ -966,6 +1015,20 @@ public:
 	/** Forces an update of all objects with the given symbol. */
 	void updateAllObjectsWithSymbol(const Symbol* symbol);
 	
+	/**
+	 * Switches the matching objects to the current renderable options.
+	 * 
+	 * Objects keep the renderables for other renderable options until they
+	 * are modified. So this only creates renderables for objects which did
+	 * not have the current options before.
+	 */
+	void updateRenderableOptions(const std::function<bool (const Object*)>& condition);
+	
+	/**
+	 * Switches all objects to the current renderable options.
+	 */
+	void updateRenderableOptions();
+	
 	/** For all symbols with old_symbol, replaces the symbol by new_symbol. */
 	void changeSymbolForAllObjects(const Symbol* old_symbol, const Symbol* new_symbol);
 	
@@ -995,6 +1058,72 @@ public:
 	 */
 	void insertRenderablesOfObject(const Object* object);
 	
+	/**
+	 * Updates the spatial index entries of the given object.
+	 * 
+	 * This is called by Object::update() after the object's extent was
+	 * recalculated. It covers the map parts, the selection renderables,
+	 * and the snapping index.
+	 */
+	void updateObjectIndex(const Object* object);
+	
+	/**
+	 * Returns the index of object vertices and path segments for snapping.
+	 * 
+	 * The index is created on first use. Afterwards, it is kept up to date
+	 * incrementally: Changed, added and deleted objects are registered again
+	 * on the next call, and only these objects are updated. Objects with
+	 * hidden symbols are included.
+	 */
+	const SnappingIndex& getSnappingIndex();
+	
+	/**
+	 * Marks an object for update in the snapping index.
+	 * 
+	 * This is called when the object was modified, added, removed or
+	 * deleted. The object is not accessed.
+	 */
+	void invalidateSnappingIndex(const Object* object);
+	
+	/**
+	 * Returns the pool of shared strings for the tags of the map's objects.
+	 */
+	TagPool& tagPool();
+	
+	/**
+	 * Returns the index of objects by tags and by symbol for object queries.
+	 * 
+	 * The index is created on first use. Later, only the objects which were
+	 * invalidated since the last call are updated.
+	 */
+	const ObjectQueryIndex& getObjectQueryIndex();
+	
+	/**
+	 * Discards the object query index.
+	 */
+	void invalidateObjectQueryIndex();
+	
+	/**
+	 * Marks an object as added, deleted, or with changed symbol or tags,
+	 * for the next update of the object query index.
+	 */
+	void invalidateObjectQueryIndex(const Object* object);
+	
+	/**
+	 * Returns the cached XML data of the objects, for saving snapshots.
+	 * 
+	 * The cache is created on first use. Later, only the objects which were
+	 * invalidated since the last call are saved again. The data is written
+	 * for the active XML file format version (cf. XMLFileExporter).
+	 */
+	const XmlObjectCache& getXmlObjectCache();
+	
+	/**
+	 * Marks an object as added, deleted or modified, for the next update
+	 * of the XML object cache. The object is not accessed.
+	 */
+	void invalidateXmlObjectCache(const Object* object);
+	
 	
 	/**
 	 * Marks an object as irregular.
@@ -1432,6 +1561,11 @@ signals:
 	 */
 	void mapPartDeleted(std::size_t index, const MapPart* part);
 	
+	/**
+	 * Emitted when all objects are loaded after loading with object streaming.
+	 */
+	void objectsLoaded();
+	
 protected slots:
 	void checkSpotColorPresence();
 	
@@ -1502,6 +1636,16 @@ private:
 	void updateSelectionRenderables(const Object* object);
 	void removeSelectionRenderables(const Object* object);
 	
+	/**
+	 * Updates the renderables and extent of the given objects.
+	 * 
+	 * All objects must belong to this map and have dirty output.
+	 * The renderables of larger numbers of objects are created concurrently.
+	 * Only the insertion into the map is serialized.
+	 */
+	void updateObjects(const std::vector<const Object*>& objects);
+	
+	/** Initializes the static symbols, once, from the first constructor call. */
 	static void initStatic();
 	
 	QExplicitlySharedDataPointer<MapColorSet> color_set;
@@ -1545,9 +1689,16 @@ private:
 	
 	std::set<Object*> irregular_objects;
 	
+	std::unordered_set<const Object*> dirty_objects;  ///< Objects waiting for updateObjects()
+	
+	std::unique_ptr<XmlObjectStream> object_stream;  ///< Loads objects after loadFrom()
+	std::unique_ptr<SnappingIndex> snapping_index;   ///< Created by getSnappingIndex()
+	std::unique_ptr<ObjectQueryIndex> object_query_index;  ///< Created by getObjectQueryIndex()
+	std::unique_ptr<XmlObjectCache> xml_object_cache;      ///< Created by getXmlObjectCache()
+	TagPool tag_pool;
+	
 	// Static
 	
-	static bool static_initialized;
 	static MapColor covering_white;
 	static MapColor covering_red;
 	static MapColor undefined_symbol_color;
@@ -1697,6 +1848,12 @@ int Map::getNumParts() const
 	return parts.size();
 }
 
+inline
+TagPool& Map::tagPool()
+{
+	return tag_pool;
+}
+
 inline
 MapPart* Map::getPart(std::size_t i) const
 {
@@ -20,7 +20,10 @@
 
 #include "map_coord.h"
 
+#include <algorithm>
 #include <cstddef>
+#include <cstdint>
+#include <iterator>
 #include <limits>
 #include <stdexcept>
 #include <type_traits>
@@ -33,6 +36,12 @@
 
 #include "util/xml_stream_util.h"
 
+// SSE2 is part of the x86-64 baseline, so it needs no detection at runtime.
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#  define MAPPER_SSE2_COORD_TEXT
+#  include <emmintrin.h>
+#endif
+
 
 namespace OpenOrienteering {
 
@@ -139,7 +148,8 @@ namespace
 constexpr qint64 min_coord = -50000000;
 constexpr qint64 max_coord = +50000000;
 
-MapCoord::BoundsOffset bounds_offset;
+// Per thread, so that objects can be loaded on worker threads.
+thread_local MapCoord::BoundsOffset bounds_offset;
 
 inline
 void applyBoundsOffset(qint64& x64, qint64& y64)
@@ -183,10 +193,250 @@ void ensureBoundsForQint32(qint64 x64, qint64 y64)
 	}
 }
 
+
+// ### Coordinate text encoding ###
+
+/**
+ * Writes the decimal digits of value, without leading zeros,
+ * and returns a pointer to the end of the written data.
+ * 
+ * Eight digits are computed at once by SIMD arithmetic when available.
+ * This covers all regular coordinates (cf. min_coord, max_coord).
+ */
+QChar* writeDigits(QChar* buffer, quint32 value);
+
+/**
+ * Parses the run of decimal digits at data[i], and moves i to the first
+ * character which is not a digit.
+ * 
+ * When available, SIMD comparisons detect the end of the run, and SIMD
+ * multiply-add operations combine up to eight digits at once.
+ */
+qint64 parseDigits(const QChar* data, int& i, int len);
+
+
+#ifdef MAPPER_SSE2_COORD_TEXT
+
+/**
+ * Powers of ten, for combining parsed chunks of digits.
+ */
+constexpr qint64 powers_of_ten[9] = {
+    1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000
+};
+
+/**
+ * Returns the number of decimal digits of value, which must be less than 10^8.
+ */
+inline
+int countDigits(quint32 value)
+{
+	return 1 + int(value >= 10) + int(value >= 100) + int(value >= 1000)
+	         + int(value >= 10000) + int(value >= 100000) + int(value >= 1000000)
+	         + int(value >= 10000000);
+}
+
+/**
+ * Computes the eight decimal digits of value, which must be less than 10^8,
+ * as 16 bit lanes.
+ * 
+ * The value is split into two groups of four digits. Each group is repeated
+ * four times, and the lanes are divided by 1000, 100, 10, and 1 by means of
+ * multiplication with fixed-point reciprocals. Subtracting ten times the
+ * neighbouring lane leaves a single digit in each lane.
+ */
+inline
+__m128i convertEightDigits(quint32 value)
+{
+	// abcd, efgh = abcdefgh divmod 10000
+	auto const abcdefgh = _mm_cvtsi32_si128(int(value));
+	auto const abcd = _mm_srli_epi64(_mm_mul_epu32(abcdefgh, _mm_set1_epi32(int(0xd1b71759))), 45);
+	auto const efgh = _mm_sub_epi32(abcdefgh, _mm_mul_epu32(abcd, _mm_set1_epi32(10000)));
+	
+	// [ abcd*4, abcd*4, abcd*4, abcd*4, efgh*4, efgh*4, efgh*4, efgh*4 ]
+	auto const v1 = _mm_slli_epi64(_mm_unpacklo_epi16(abcd, efgh), 2);
+	auto const v2 = _mm_unpacklo_epi16(v1, v1);
+	auto const v3 = _mm_unpacklo_epi32(v2, v2);
+	
+	// [ a, ab, abc, abcd, e, ef, efg, efgh ]
+	auto const v4 = _mm_mulhi_epu16(v3, _mm_setr_epi16(8389, 5243, 13108, -32768, 8389, 5243, 13108, -32768));
+	auto const v5 = _mm_mulhi_epu16(v4, _mm_setr_epi16(1 << 7, 1 << 11, 1 << 13, -32768, 1 << 7, 1 << 11, 1 << 13, -32768));
+	
+	// [ a, b, c, d, e, f, g, h ]
+	auto const v6 = _mm_slli_epi64(_mm_mullo_epi16(v5, _mm_set1_epi16(10)), 16);
+	return _mm_sub_epi16(v5, v6);
+}
+
+QChar* writeDigits(QChar* buffer, quint32 value)
+{
+	if (Q_LIKELY(value < 100000000u))
+	{
+		alignas(16) QChar digits[8];
+		_mm_store_si128(reinterpret_cast<__m128i*>(digits),
+		                _mm_add_epi16(convertEightDigits(value), _mm_set1_epi16('0')));
+		auto const count = countDigits(value);
+		std::copy(digits + 8 - count, digits + 8, buffer);
+		return buffer + count;
+	}
+	
+	// Ten digits: the two leading digits, and eight digits at once.
+	buffer = writeDigits(buffer, value / 100000000u);
+	alignas(16) QChar digits[8];
+	_mm_store_si128(reinterpret_cast<__m128i*>(digits),
+	                _mm_add_epi16(convertEightDigits(value % 100000000u), _mm_set1_epi16('0')));
+	return std::copy(digits, digits + 8, buffer);
+}
+
+/**
+ * The number of trailing one bits of an 8 bit mask, i.e. of leading digits.
+ */
+constexpr std::uint8_t trailing_ones[256] = {
+    0, 1, 0, 2, 0, 1, 0, 3, 0, 1, 0, 2, 0, 1, 0, 4,
+    0, 1, 0, 2, 0, 1, 0, 3, 0, 1, 0, 2, 0, 1, 0, 5,
+    0, 1, 0, 2, 0, 1, 0, 3, 0, 1, 0, 2, 0, 1, 0, 4,
+    0, 1, 0, 2, 0, 1, 0, 3, 0, 1, 0, 2, 0, 1, 0, 6,
+    0, 1, 0, 2, 0, 1, 0, 3, 0, 1, 0, 2, 0, 1, 0, 4,
+    0, 1, 0, 2, 0, 1, 0, 3, 0, 1, 0, 2, 0, 1, 0, 5,
+    0, 1, 0, 2, 0, 1, 0, 3, 0, 1, 0, 2, 0, 1, 0, 4,
+    0, 1, 0, 2, 0, 1, 0, 3, 0, 1, 0, 2, 0, 1, 0, 7,
+    0, 1, 0, 2, 0, 1, 0, 3, 0, 1, 0, 2, 0, 1, 0, 4,
+    0, 1, 0, 2, 0, 1, 0, 3, 0, 1, 0, 2, 0, 1, 0, 5,
+    0, 1, 0, 2, 0, 1, 0, 3, 0, 1, 0, 2, 0, 1, 0, 4,
+    0, 1, 0, 2, 0, 1, 0, 3, 0, 1, 0, 2, 0, 1, 0, 6,
+    0, 1, 0, 2, 0, 1, 0, 3, 0, 1, 0, 2, 0, 1, 0, 4,
+    0, 1, 0, 2, 0, 1, 0, 3, 0, 1, 0, 2, 0, 1, 0, 5,
+    0, 1, 0, 2, 0, 1, 0, 3, 0, 1, 0, 2, 0, 1, 0, 4,
+    0, 1, 0, 2, 0, 1, 0, 3, 0, 1, 0, 2, 0, 1, 0, 8
+};
+
+/**
+ * Masks which keep the given number of leading 16 bit lanes.
+ */
+alignas(16) constexpr qint16 leading_lanes[9][8] = {
+    { 0, 0, 0, 0, 0, 0, 0, 0 },
+    { -1, 0, 0, 0, 0, 0, 0, 0 },
+    { -1, -1, 0, 0, 0, 0, 0, 0 },
+    { -1, -1, -1, 0, 0, 0, 0, 0 },
+    { -1, -1, -1, -1, 0, 0, 0, 0 },
+    { -1, -1, -1, -1, -1, 0, 0, 0 },
+    { -1, -1, -1, -1, -1, -1, 0, 0 },
+    { -1, -1, -1, -1, -1, -1, -1, 0 },
+    { -1, -1, -1, -1, -1, -1, -1, -1 }
+};
+
+/**
+ * Parses a run of up to eight decimal digits at data, and returns the number
+ * of digits. Their value is stored in value.
+ * 
+ * Eight characters must be readable at data.
+ */
+inline
+int parseEightDigits(const QChar* data, quint32& value)
+{
+	auto const digits = _mm_sub_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data)),
+	                                  _mm_set1_epi16('0'));
+	auto const is_digit = _mm_and_si128(_mm_cmpgt_epi16(digits, _mm_set1_epi16(-1)),
+	                                    _mm_cmplt_epi16(digits, _mm_set1_epi16(10)));
+	
+	// The number of leading lanes which hold a digit.
+	auto const mask = _mm_movemask_epi8(_mm_packs_epi16(is_digit, is_digit)) & 0xff;
+	auto const count = trailing_ones[mask];
+	
+	// Clear the lanes from the first non-digit, then combine neighbouring
+	// digits to [ ab, cd, ef, gh ] and [ abcd, efgh ].
+	auto const leading = _mm_and_si128(digits, _mm_load_si128(reinterpret_cast<const __m128i*>(leading_lanes[count])));
+	auto const pairs = _mm_madd_epi16(leading, _mm_setr_epi16(10, 1, 10, 1, 10, 1, 10, 1));
+	auto const quads = _mm_madd_epi16(_mm_packs_epi32(pairs, pairs), _mm_setr_epi16(100, 1, 100, 1, 100, 1, 100, 1));
+	auto const abcd = quint32(_mm_cvtsi128_si32(quads));
+	auto const efgh = quint32(_mm_cvtsi128_si32(_mm_srli_si128(quads, 4)));
+	
+	// The digits are left-aligned: divide by 10^(8-count). The division is
+	// exact, so it is a shift by (8-count) and a multiplication with the
+	// multiplicative inverse of 5^(8-count), modulo 2^32.
+	static constexpr quint32 inverse_powers_of_five[9] = {
+	    0x00000001u, 0xcccccccdu, 0xc28f5c29u, 0x26e978d5u, 0x3afb7e91u,
+	    0x0bcbe61du, 0x68c26139u, 0xae8d46a5u, 0x22e90e21u
+	};
+	auto const shift = 8 - count;
+	value = ((abcd * 10000u + efgh) >> shift) * inverse_powers_of_five[shift];
+	return count;
+}
+
+qint64 parseDigits(const QChar* data, int& i, int len)
+{
+	qint64 value = 0;
+	while (len - i >= 8)
+	{
+		quint32 chunk;
+		auto const count = parseEightDigits(data + i, chunk);
+		value = value * powers_of_ten[count] + chunk;
+		i += count;
+		if (count < 8)
+			return value;
+	}
+	for (; i < len; ++i)
+	{
+		auto c = data[i].unicode();
+		if (c < '0' || c > '9')
+			break;
+		value = 10*value + c - '0';
+	}
+	return value;
+}
+
+#else
+
+QChar* writeDigits(QChar* buffer, quint32 value)
+{
+	// For efficiency, we construct the digits from the back.
+	QChar digits[10];
+	auto first = std::end(digits);
+	do
+	{
+		*--first = QChar(ushort('0' + value % 10));
+		value = value / 10;
+	}
+	while (value != 0);
+	return std::copy(first, std::end(digits), buffer);
+}
+
+qint64 parseDigits(const QChar* data, int& i, int len)
+{
+	qint64 value = 0;
+	for (; i < len; ++i)
+	{
+		auto c = data[i].unicode();
+		if (c < '0' || c > '9')
+			break;
+		value = 10*value + c - '0';
+	}
+	return value;
+}
+
+#endif  // MAPPER_SSE2_COORD_TEXT
+
+
+/**
+ * Writes value in decimal notation, and returns a pointer to the end of the
+ * written data.
+ */
+inline
+QChar* writeInteger(QChar* buffer, qint32 value)
+{
+	if (value < 0)
+	{
+		*buffer++ = QLatin1Char{'-'};
+		return writeDigits(buffer, quint32(-qint64(value)));
+	}
+	return writeDigits(buffer, quint32(value));
+}
+
 }  // namespace
 
 
 
+constexpr int MapCoord::max_string_length;
+
+
 MapCoord::BoundsOffset& MapCoord::boundsOffset()
 {
 	return bounds_offset;
@@ -267,6 +517,12 @@ MapCoord::MapCoord(const LegacyMapCoord& coord) noexcept
 #endif
 
 QString MapCoord::toString() const
+{
+	QChar buffer[max_string_length];
+	return QString(buffer, int(toUtf16(buffer) - buffer));
+}
+
+QChar* MapCoord::toUtf16(QChar* buffer) const
 {
 	/* The buffer size must allow for
 	 *  1x ';':   1
@@ -277,89 +533,21 @@ QString MapCoord::toString() const
 	 *  1x the decimal digits for 0..2^8-1:
 	 *            3
 	 *  Total:   28 */
-	constexpr std::size_t buf_size = 1+2+2+20+3;
-	static const QChar encoded[10] = {
-	    QLatin1Char{'0'}, QLatin1Char{'1'},
-	    QLatin1Char{'2'}, QLatin1Char{'3'},
-	    QLatin1Char{'4'}, QLatin1Char{'5'},
-	    QLatin1Char{'6'}, QLatin1Char{'7'},
-	    QLatin1Char{'8'}, QLatin1Char{'9'}
-	};
-	QChar buffer[buf_size];
+	static_assert(max_string_length == 1+2+2+20+3, "max_string_length must match the text format");
 	
-	// For efficiency, we construct the string from the back.
-	std::size_t j = buf_size - 1;
-	buffer[j] = QLatin1Char{';'};
-	--j;
+	buffer = writeInteger(buffer, xp);
+	*buffer++ = QChar::Space;
+	buffer = writeInteger(buffer, yp);
 	
-	auto flags = Flags::Int(fp);
+	auto const flags = Flags::Int(fp);
 	if (flags > 0)
 	{
-		do
-		{
-			buffer[j] = encoded[flags % 10];
-			flags = flags / 10;
-			--j;
-		}
-		while (flags != 0);
-		
-		buffer[j] = QChar::Space;
-		--j;
+		*buffer++ = QChar::Space;
+		buffer = writeDigits(buffer, quint32(flags));
 	}
 	
-	qint64 tmp = yp;
-	static_assert(sizeof(decltype(tmp)) > sizeof(decltype(MapCoord::yp)),
-	              "decltype(tmp) must be large enough to hold"
-	              "-std::numeric_limits<decltype(MapCoord::yp)>::min()" );
-	QChar sign { QChar::Null };
-	if (tmp < 0)
-	{
-		sign = QLatin1Char{'-'};
-		tmp = -tmp;
-	}
-	do
-	{
-		buffer[j] = encoded[tmp % 10];
-		tmp = tmp / 10;
-		--j;
-	}
-	while (tmp != 0);
-	if (!sign.isNull())
-	{
-		buffer[j] = sign;
-		--j;
-		sign = QChar::Null;
-	}
-	
-	buffer[j] = QChar::Space;
-	--j;
-	
-	static_assert(sizeof(decltype(tmp)) > sizeof(decltype(MapCoord::xp)),
-	              "decltype(tmp) must be large enough to hold"
-	              "-std::numeric_limits<decltype(MapCoord::xp)>::min()" );
-	tmp = xp;
-	if (tmp < 0)
-	{
-		sign = QLatin1Char{'-'};
-		tmp = -tmp;
-	}
-	do
-	{
-		buffer[j] = encoded[tmp % 10];
-		tmp = tmp / 10;
-		--j;
-	}
-	while (tmp != 0);
-	if (!sign.isNull())
-	{
-		buffer[j] = sign;
-		--j;
-	}
-	
-	++j;
-	Q_ASSERT(j < buf_size);
-	j = qMin(j, buf_size);
-	return QString(buffer+j, buf_size-j);
+	*buffer++ = QLatin1Char{';'};
+	return buffer;
 }
 
 MapCoord::MapCoord(QStringRef& text)
@@ -372,61 +560,30 @@ MapCoord::MapCoord(QStringRef& text)
 	auto data = text.constData();
 	int i = 0;
 	
-	qint64 x64 = data[0].unicode();
-	if (x64 == '-')
+	qint64 x64;
+	if (data[0] == QLatin1Char{'-'})
 	{
-		x64 = '0' - data[1].unicode();
-		for (i = 2; i != len; ++i)
-		{
-			auto c = data[i].unicode();
-			if (c < '0' || c > '9')
-				break;
-			else
-				x64 = 10*x64 + '0' - c;
-		}
+		i = 1;
+		x64 = -parseDigits(data, i, len);
 	}
-	else if (x64 >= '0' && x64 <= '9')
+	else
 	{
-		x64 -= '0';
-		for (i = 1; i != len; ++i)
-		{
-			auto c = data[i].unicode();
-			if (c < '0' || c > '9')
-				break;
-			else
-				x64 = 10*x64 + c - '0';
-		}
+		x64 = parseDigits(data, i, len);
 	}
 	
 	++i;
 	if (Q_UNLIKELY(i+1 >= len))
 		throw std::invalid_argument("Premature end of data");
 	
-	qint64 y64 = data[i].unicode();
-	if (y64 == '-')
+	qint64 y64;
+	if (data[i] == QLatin1Char{'-'})
 	{
 		++i;
-		y64 = '0' - data[i].unicode();
-		for (++i; i != len; ++i)
-		{
-			auto c = data[i].unicode();
-			if (c < '0' || c > '9')
-				break;
-			else
-				y64 = 10*y64 + '0' - c;
-		}
+		y64 = -parseDigits(data, i, len);
 	}
-	else if (y64 >= '0' && y64 <= '9')
+	else
 	{
-		y64 -= '0';
-		for (++i; i != len; ++i)
-		{
-			auto c = data[i].unicode();
-			if (c < '0' || c > '9')
-				break;
-			else
-				y64 = 10*y64 + c - '0';
-		}
+		y64 = parseDigits(data, i, len);
 	}
 	
 	handleBoundsOffset(x64, y64);
@@ -441,15 +598,7 @@ MapCoord::MapCoord(QStringRef& text)
 			throw std::invalid_argument("Premature end of data");
 		
 		// there are no negative flags
-		fp = Flags(data[i].unicode() - '0');
-		for (++i; i < len; ++i)
-		{
-			auto c = data[i].unicode();
-			if (c < '0' || c > '9')
-				break;
-			else
-				fp = Flags(10*int(fp) + c - '0');
-		}
+		fp = Flags(int(parseDigits(data, i, len)));
 	}
 	
 	if (Q_UNLIKELY(i >= len || data[i] != QLatin1Char{';'}))
@@ -157,7 +157,7 @@ private:
 	Flags  fp;
 	
 public:
-	/** Returns the global bounds offset.
+	/** Returns the bounds offset of the current thread.
 	 *
 	 * It is returned as a non-const reference, so that it can be used in
 	 * QScopedValueRollack.
@@ -403,11 +403,25 @@ public:
 	constexpr explicit operator QPointF() const;
 	
 	
+	/**
+	 * The maximum number of characters written by toUtf16().
+	 */
+	static constexpr int max_string_length = 28;
+	
 	/**
 	 * Writes raw coordinates and flags to a string.
 	 */
 	QString toString() const;
 	
+	/**
+	 * Writes raw coordinates and flags to the given buffer, in the format of
+	 * toString(), and returns a pointer to the end of the written data.
+	 * 
+	 * The buffer must have space for at least max_string_length characters.
+	 * This function avoids the allocation of a temporary string.
+	 */
+	QChar* toUtf16(QChar* buffer) const;
+	
 	/**
 	 * Constructs the MapCoord from the beginning of text, and moves the 
 	 * reference to behind the this coordinates data.
@@ -22,7 +22,11 @@
 #include "map_part.h"
 
 #include <algorithm>
+#include <cmath>
+#include <cstddef>
 #include <iterator>
+#include <unordered_map>
+#include <vector>
 
 #include <QtGlobal>
 #include <QIODevice>
@@ -35,6 +39,7 @@
 #include "core/map.h"
 #include "core/map_coord.h"
 #include "core/objects/object.h"
+#include "core/objects/object_query_index.h"
 #include "core/symbols/symbol.h"
 #include "undo/object_undo.h"
 #include "util/util.h"
@@ -54,6 +59,28 @@ namespace literal
 
 namespace OpenOrienteering {
 
+namespace {
+
+/**
+ * Sorts the range of query results into the order of the objects in the part.
+ * 
+ * The spatial index reports objects in an arbitrary order, but callers such
+ * as ObjectSelector resolve ties by the order of the objects. The positions
+ * must be up to date.
+ */
+template <class Iterator, class GetObject>
+void sortByPartOrder(const std::unordered_map<const Object*, std::size_t>& positions, Iterator first, Iterator last, GetObject get_object)
+{
+	std::sort(first, last, [&positions, &get_object](const auto& a, const auto& b) {
+		return positions.at(get_object(a)) < positions.at(get_object(b));
+	});
+}
+
+
+}  // namespace
+
+
+
 MapPart::MapPart(const QString& name, Map* map)
 : name(name)
 , map(map)
@@ -65,7 +92,15 @@ MapPart::MapPart(const QString& name, Map* map)
 MapPart::~MapPart()
 {
 	for (Object* object : objects)
+	{
+		if (map)
+		{
+			map->invalidateSnappingIndex(object);
+			map->invalidateObjectQueryIndex(object);
+			map->invalidateXmlObjectCache(object);
+		}
 		delete object;
+	}
 }
 
 
@@ -85,16 +120,17 @@ bool MapPart::load(QIODevice* file, int version, Map* map)
 	
 	int size;
 	file->read((char*)&size, sizeof(int));
-	objects.resize(size, nullptr);
+	objects.reserve(size);
 	
-	for (Object*& object : objects)
+	for (int i = 0; i < size; ++i)
 	{
 		int save_type;
 		file->read((char*)&save_type, sizeof(int));
-		object = Object::getObjectForType(static_cast<Object::Type>(save_type), nullptr);
+		auto object = Object::getObjectForType(static_cast<Object::Type>(save_type), nullptr);
 		if (!object)
 			return false;
 		object->load(file, version, map);
+		appendObject(object);
 	}
 	return true;
 }
@@ -137,7 +173,7 @@ MapPart* MapPart::load(QXmlStreamReader& xml, Map& map, SymbolDictionary& symbol
 			while (xml.readNextStartElement())
 			{
 				if (xml.name() == literal::object)
-					part->objects.push_back(Object::load(xml, &map, symbol_dict));
+					part->appendObject(Object::load(xml, &map, symbol_dict));
 				else
 					xml.skipCurrentElement(); // unknown
 			}
@@ -151,12 +187,10 @@ MapPart* MapPart::load(QXmlStreamReader& xml, Map& map, SymbolDictionary& symbol
 
 int MapPart::findObjectIndex(const Object* object) const
 {
-	int size = objects.size();
-	for (int i = size - 1; i >= 0; --i)
-	{
-		if (objects[i] == object)
-			return i;
-	}
+	updatePositions();
+	auto found = positions.find(object);
+	if (found != positions.end())
+		return int(found->second);
 	Q_ASSERT(false);
 	return -1;
 }
@@ -164,10 +198,21 @@ int MapPart::findObjectIndex(const Object* object) const
 void MapPart::setObject(Object* object, int pos, bool delete_old)
 {
 	map->removeRenderablesOfObject(objects[pos], true);
+	object_index.remove(objects[pos]);
+	positions.erase(objects[pos]);
+	map->invalidateSnappingIndex(objects[pos]);
+	map->invalidateObjectQueryIndex(objects[pos]);
+	map->invalidateXmlObjectCache(objects[pos]);
 	if (delete_old)
 		delete objects[pos];
 	
 	objects[pos] = object;
+	object_index.insert(object, {});
+	if (std::size_t(pos) < first_stale_position)
+		positions[object] = std::size_t(pos);
+	map->invalidateSnappingIndex(object);
+	map->invalidateObjectQueryIndex(object);
+	map->invalidateXmlObjectCache(object);
 	object->setMap(map);
 	object->update();
 	map->setObjectsDirty(); // TODO: remove from here, dirty state handling should be separate
@@ -180,7 +225,15 @@ void MapPart::addObject(Object* object)
 
 void MapPart::addObject(Object* object, int pos)
 {
+	// New objects must not end up before objects which are still loading.
+	map->finishLoadingObjects();
+	
 	objects.insert(objects.begin() + pos, object);
+	object_index.insert(object, {});
+	invalidatePositions(std::size_t(pos));
+	map->invalidateSnappingIndex(object);
+	map->invalidateObjectQueryIndex(object);
+	map->invalidateXmlObjectCache(object);
 	object->setMap(map);
 	object->update();
 	
@@ -191,6 +244,12 @@ void MapPart::addObject(Object* object, int pos)
 void MapPart::deleteObject(int pos, bool remove_only)
 {
 	map->removeRenderablesOfObject(objects[pos], true);
+	object_index.remove(objects[pos]);
+	positions.erase(objects[pos]);
+	invalidatePositions(std::size_t(pos));
+	map->invalidateSnappingIndex(objects[pos]);
+	map->invalidateObjectQueryIndex(objects[pos]);
+	map->invalidateXmlObjectCache(objects[pos]);
 	if (remove_only)
 		objects[pos]->setMap(nullptr);
 	else
@@ -203,16 +262,11 @@ void MapPart::deleteObject(int pos, bool remove_only)
 
 bool MapPart::deleteObject(Object* object, bool remove_only)
 {
-	int size = objects.size();
-	for (int i = size - 1; i >= 0; --i)
-	{
-		if (objects[i] == object)
-		{
-			deleteObject(i, remove_only);
-			return true;
-		}
-	}
-	return false;
+	if (!contains(object))
+		return false;
+	
+	deleteObject(findObjectIndex(object), remove_only);
+	return true;
 }
 
 std::unique_ptr<UndoStep> MapPart::importPart(const MapPart* other, const QHash<const Symbol*, Symbol*>& symbol_map, const QTransform& transform, bool select_new_objects)
@@ -233,7 +287,7 @@ std::unique_ptr<UndoStep> MapPart::importPart(const MapPart* other, const QHash<
 			new_object->setSymbol(symbol_map.value(new_object->getSymbol()), true);
 		new_object->transform(transform);
 		
-		objects.push_back(new_object);
+		appendObject(new_object);
 		new_object->setMap(map);
 		new_object->update();
 		
@@ -264,18 +318,26 @@ void MapPart::findObjectsAt(
         bool include_protected_objects,
         SelectionInfoVector& out ) const
 {
-	for (Object* object : objects)
-	{
+	// Object::update() calls back into updateObjectIndex().
+	map->updateObjects();
+	
+	// Object::isPointOnObject() compares the squared distance to point objects
+	// with the tolerance, so the search rect must cover both.
+	auto const margin = qMax(qreal(tolerance), std::sqrt(qreal(tolerance)));
+	auto const rect = QRectF(coord.x() - margin, coord.y() - margin, 2 * margin, 2 * margin);
+	auto const first_result = out.size();
+	object_index.query(rect, [&](Object* object) {
 		if (!include_hidden_objects && object->getSymbol()->isHidden())
-			continue;
+			return;
 		if (!include_protected_objects && object->getSymbol()->isProtected())
-			continue;
+			return;
 		
-		object->update();
 		int selected_type = object->isPointOnObject(coord, tolerance, treat_areas_as_paths, extended_selection);
 		if (selected_type != (int)Symbol::NoSymbol)
 			out.emplace_back(selected_type, object);
-	}
+	});
+	updatePositions();
+	sortByPartOrder(positions, out.begin() + first_result, out.end(), [](const auto& info) { return info.second; });
 }
 
 void MapPart::findObjectsAtBox(
@@ -285,31 +347,36 @@ void MapPart::findObjectsAtBox(
         bool include_protected_objects,
         std::vector< Object* >& out ) const
 {
+	// Object::update() calls back into updateObjectIndex().
+	map->updateObjects();
+	
 	auto rect = QRectF(corner1, corner2).normalized();
-	for (Object* object : objects)
-	{
+	auto const first_result = out.size();
+	object_index.query(rect, [&](Object* object) {
 		if (!include_hidden_objects && object->getSymbol()->isHidden())
-			continue;
+			return;
 		if (!include_protected_objects && object->getSymbol()->isProtected())
-			continue;
+			return;
 		
-		object->update();
 		if (rect.intersects(object->getExtent()) && object->intersectsBox(rect))
 			out.push_back(object);
-	}
+	});
+	updatePositions();
+	sortByPartOrder(positions, out.begin() + first_result, out.end(), [](const Object* object) { return object; });
 }
 
 int MapPart::countObjectsInRect(const QRectF& map_coord_rect, bool include_hidden_objects) const
 {
+	// Object::update() calls back into updateObjectIndex().
+	map->updateObjects();
+	
 	int count = 0;
-	for (const Object* object : objects)
-	{
+	object_index.query(map_coord_rect.normalized(), [&](const Object* object) {
 		if (object->getSymbol()->isHidden() && !include_hidden_objects)
-			continue;
-		object->update();
+			return;
 		if (object->getExtent().intersects(map_coord_rect))
 			++count;
-	}
+	});
 	return count;
 }
 
@@ -329,6 +396,71 @@ QRectF MapPart::calculateExtent(bool include_helper_symbols) const
 }
 
 
+bool MapPart::updateObjectIndex(const Object* object)
+{
+	// The index is keyed by non-const pointers to the objects owned by this part.
+	auto key = const_cast<Object*>(object);
+	if (!object_index.contains(key))
+		return false;
+	
+	object_index.insert(key, indexRect(object));
+	return true;
+}
+
+
+bool MapPart::contains(const Object* object) const
+{
+	return object_index.contains(const_cast<Object*>(object));
+}
+
+
+void MapPart::appendObject(Object* object)
+{
+	objects.push_back(object);
+	object_index.insert(object, {});
+	if (first_stale_position + 1 == objects.size())
+	{
+		positions[object] = first_stale_position;
+		++first_stale_position;
+	}
+	map->invalidateSnappingIndex(object);
+	map->invalidateObjectQueryIndex(object);
+	map->invalidateXmlObjectCache(object);
+	map->markOutputDirty(object);
+}
+
+
+void MapPart::invalidatePositions(std::size_t first)
+{
+	first_stale_position = std::min(first_stale_position, first);
+}
+
+
+void MapPart::updatePositions() const
+{
+	for (auto i = first_stale_position; i < objects.size(); ++i)
+		positions[objects[i]] = i;
+	first_stale_position = objects.size();
+}
+
+
+QRectF MapPart::indexRect(const Object* object)
+{
+	auto rect = object->getExtent();
+	if (object->getType() == Object::Point)
+	{
+		// Point objects may also be found at their coordinate,
+		// cf. Object::isPointOnObject().
+		auto const coord = MapCoordF(object->getRawCoordinateVector().front());
+		if (rect.isNull())
+			rect = QRectF(coord.x(), coord.y(), 0.0001, 0.0001);
+		else
+			rectInclude(rect, coord);
+	}
+	return rect;
+}
+
+
 
 bool MapPart::existsObject(const std::function<bool(const Object*)>& condition) const
 {
@@ -357,6 +489,24 @@ void MapPart::applyOnMatchingObjects(const std::function<void (Object*, MapPart*
 }
 
 
+void MapPart::applyOnMatchingObjects(const std::function<void (Object*)>& operation, const ObjectQuery& query)
+{
+	// The operation may change the index.
+	const auto& index = map->getObjectQueryIndex();
+	const auto matches = index.findMatching(query, this);
+	std::vector<Object*> matching_objects;
+	matching_objects.reserve(matches.size());
+	std::transform(begin(matches), end(matches), std::back_inserter(matching_objects), [&index](auto number) {
+		return index.entry(number).object;
+	});
+	
+	// Like the other overloads, in reverse order
+	updatePositions();
+	sortByPartOrder(positions, begin(matching_objects), end(matching_objects), [](const Object* object) { return object; });
+	std::for_each(matching_objects.rbegin(), matching_objects.rend(), operation);
+}
+
+
 void MapPart::applyOnAllObjects(const std::function<void (Object*)>& operation)
 {
 	std::for_each(objects.rbegin(), objects.rend(), operation);
@@ -25,6 +25,7 @@
 #include <cstddef>
 #include <functional>
 #include <memory>
+#include <unordered_map>
 #include <vector>
 #include <utility>
 
@@ -32,6 +33,8 @@
 #include <QRectF>
 #include <QString>
 
+#include "core/spatial_index.h"
+
 class QIODevice;
 class QTransform;
 class QXmlStreamReader;
@@ -43,6 +46,7 @@ namespace OpenOrienteering {
 class Map;
 class MapCoordF;
 class Object;
+class ObjectQuery;
 class Symbol;
 using SymbolDictionary = QHash<QString, Symbol*>; // from symbol.h
 class UndoStep;
@@ -67,7 +71,9 @@ using SelectionInfoVector = std::vector<std::pair<int, Object*>> ;
  */
 class MapPart
 {
+friend class BinaryFileImporter;
 friend class OCAD8FileImport;
+friend class XmlObjectStream;
 public:
 	/**
 	 * Creates a new map part with the given name for a map.
@@ -131,7 +137,8 @@ public:
 	/**
 	 * Returns the index of the object.
 	 * 
-	 * Loops over all objects in the part and looks for the given pointer.
+	 * The positions of the objects are kept in a hash table which is updated
+	 * lazily after insertions and deletions.
 	 * The object must be contained in this part,
 	 * otherwise an assert is triggered (in debug builds),
 	 * or -1 is returned (release builds).
@@ -210,6 +217,21 @@ public:
 	 */
 	QRectF calculateExtent(bool include_helper_symbols) const;
 	
+	/**
+	 * Updates the spatial index entry of the given object from its extent.
+	 * 
+	 * This is called when the object's output was regenerated.
+	 * Returns false if the object is not a member of this part.
+	 */
+	bool updateObjectIndex(const Object* object);
+	
+	/**
+	 * Returns true if the object belongs to this part.
+	 * 
+	 * Unlike findObjectIndex(), this doesn't need up-to-date positions.
+	 */
+	bool contains(const Object* object) const;
+	
 	
 	/**
 	 * Applies a condition on all objects (until the first match is found).
@@ -230,6 +252,12 @@ public:
 	 */
 	void applyOnMatchingObjects(const std::function<void (Object*, MapPart*, int)>& operation, const std::function<bool (const Object*)>& condition);
 	
+	/**
+	 * @copybrief   Map::applyOnMatchingObjects()
+	 * @copydetails Map::applyOnMatchingObjects()
+	 */
+	void applyOnMatchingObjects(const std::function<void (Object*)>& operation, const ObjectQuery& query);
+	
 	/**
 	 * @copybrief   Map::applyOnAllObjects()
 	 * @copydetails Map::applyOnAllObjects()
@@ -245,9 +273,37 @@ public:
 	
 private:
 	typedef std::vector<Object*> ObjectList;
-
+	
+	/**
+	 * Appends the object to the list of objects and registers it in the index.
+	 * 
+	 * Unlike addObject(), this does not set the object's map. The object is
+	 * left for the next Map::updateObjects(). It is meant for loading and
+	 * importing objects.
+	 */
+	void appendObject(Object* object);
+	
+	/**
+	 * Returns the rectangle to be used for the object in the spatial index.
+	 */
+	static QRectF indexRect(const Object* object);
+	
+	/**
+	 * Marks the positions of the objects from the given index onwards as outdated.
+	 */
+	void invalidatePositions(std::size_t first);
+	
+	/**
+	 * Brings the positions of all objects up to date.
+	 */
+	void updatePositions() const;
+	
+	
 	QString name;
-	ObjectList objects;  ///< @todo This could be a spatial representation optimized for quick access
+	ObjectList objects;
+	SpatialIndex<Object*> object_index;  ///< Object extents, for quick spatial lookup
+	mutable std::unordered_map<const Object*, std::size_t> positions;  ///< Object indexes, valid below first_stale_position
+	mutable std::size_t first_stale_position = 0;
 	Map* const map;
 };
 
@@ -21,7 +21,11 @@
 
 #include "map_printer.h"
 
+#include <algorithm>
+#include <atomic>
 #include <cmath>
+#include <cstddef>
+#include <utility>
 
 #include <Qt>
 #include <QtMath>
@@ -30,13 +34,18 @@
 #include <QHash>
 #include <QImage>
 #include <QLatin1String>
+#include <QMutex>
+#include <QMutexLocker>
 #include <QPagedPaintDevice>
 #include <QPaintDevice>
 #include <QPaintEngine> // IWYU pragma: keep
 #include <QPainter>
 #include <QPointF>
+#include <QRunnable>
 #include <QStringRef>
+#include <QThreadPool>
 #include <QTransform>
+#include <QWaitCondition>
 #include <QXmlStreamReader>
 
 
@@ -347,6 +356,116 @@ void MapPrinterConfig::save(QXmlStreamWriter& xml, const QLatin1String& element_
 
 #ifdef QT_PRINTSUPPORT_LIB
 
+// ### PagePipeline ###
+
+namespace {
+
+/**
+ * The maximum memory for pages rendered concurrently by printMap(), in bytes.
+ */
+constexpr qint64 max_print_memory = qint64(sizeof(void*) >= 8 ? 2048 : 512) << 20;
+
+
+/**
+ * The shared state of rendering raster pages concurrently.
+ * 
+ * The pages are rendered on worker threads, and taken in order by the thread
+ * which prints the map.
+ */
+class PagePipeline
+{
+public:
+	PagePipeline(const MapPrinter& map_printer, std::vector<QRectF> page_extents, QSize buffer_size)
+	: map_printer(map_printer)
+	, page_extents(std::move(page_extents))
+	, buffer_size(buffer_size)
+	, pages(this->page_extents.size())
+	, done(this->page_extents.size(), false)
+	{}
+	
+	/** Renders the page with the given index. Runs on a worker thread. */
+	void render(std::size_t index)
+	{
+		QImage page;
+		if (!canceled)
+		{
+			page = QImage(buffer_size, QImage::Format_RGB32);
+			if (!page.isNull())
+			{
+				page.fill(QColor(Qt::white));
+				QPainter painter(&page);
+				map_printer.drawPage(&painter, page_extents[index], &page);
+				if (painter.isActive())
+					painter.end();
+				else
+					page = {};  // drawPage() signals errors by ending the painter.
+			}
+		}
+		
+		QMutexLocker locker(&mutex);
+		pages[index] = std::move(page);
+		done[index] = true;
+		++num_done;
+		page_done.wakeAll();
+	}
+	
+	/** Waits for the page with the given index, and returns it. */
+	QImage take(std::size_t index)
+	{
+		QMutexLocker locker(&mutex);
+		while (!done[index])
+			page_done.wait(&mutex);
+		return std::move(pages[index]);
+	}
+	
+	/** Stops rendering, and waits for the given number of started pages. */
+	void finish(std::size_t num_started)
+	{
+		canceled = true;
+		QMutexLocker locker(&mutex);
+		while (num_done < num_started)
+			page_done.wait(&mutex);
+	}
+	
+	std::size_t size() const { return page_extents.size(); }
+	
+private:
+	const MapPrinter& map_printer;
+	const std::vector<QRectF> page_extents;
+	const QSize buffer_size;
+	std::atomic_bool canceled { false };
+	
+	QMutex mutex;
+	QWaitCondition page_done;
+	std::vector<QImage> pages;  ///< Guarded by mutex
+	std::vector<bool> done;     ///< Guarded by mutex
+	std::size_t num_done = 0;   ///< Guarded by mutex
+};
+
+
+class PageRunnable : public QRunnable
+{
+public:
+	PageRunnable(PagePipeline& pipeline, std::size_t index)
+	: pipeline(pipeline)
+	, index(index)
+	{}
+	
+	void run() override
+	{
+		pipeline.render(index);
+	}
+	
+private:
+	PagePipeline& pipeline;
+	const std::size_t index;
+};
+
+
+}  // namespace
+
+
+
 // ### MapPrinter ###
 
 const QPrinterInfo* MapPrinter::pdfTarget()
@@ -893,6 +1012,30 @@ void MapPrinter::takePrinterSettings(const QPrinter* printer)
 }
 
 
+QSize MapPrinter::pageBufferSize(const QPainter* device_painter) const
+{
+	// Logical units per mm
+	const qreal units_per_mm = options.resolution / 25.4;
+	
+	int w = qCeil(page_format.paper_dimensions.width() * units_per_mm);
+	int h = qCeil(page_format.paper_dimensions.height() * units_per_mm);
+#if defined (Q_OS_MACOS)
+	if (device_painter->device()->physicalDpiX() == 0)
+	{
+		// Possible Qt bug, since according to QPaintDevice documentation,
+		// "if the physicalDpiX() doesn't equal the logicalDpiX(),
+		// the corresponding QPaintEngine must handle the resolution mapping"
+		// which doesn't seem to happen here.
+		qreal corr = device_painter->device()->logicalDpiX() / 72.0;
+		w = qCeil(page_format.paper_dimensions.width() * units_per_mm * corr);
+		h = qCeil(page_format.paper_dimensions.height() * units_per_mm * corr);
+	}
+#else
+	Q_UNUSED(device_painter)
+#endif
+	return { w, h };
+}
+
 void MapPrinter::drawPage(QPainter* device_painter, const QRectF& page_extent, QImage* page_buffer) const
 {
 	// Logical units per mm
@@ -970,22 +1113,7 @@ void MapPrinter::drawPage(QPainter* device_painter, const QRectF& page_extent, Q
 	QPainter local_page_painter;
 	if (use_page_buffer && !page_buffer)
 	{
-		int w = qCeil(page_format.paper_dimensions.width() * units_per_mm);
-		int h = qCeil(page_format.paper_dimensions.height() * units_per_mm);
-#if defined (Q_OS_MACOS)
-		if (device_painter->device()->physicalDpiX() == 0)
-		{
-			// Possible Qt bug, since according to QPaintDevice documentation,
-			// "if the physicalDpiX() doesn't equal the logicalDpiX(),
-			// the corresponding QPaintEngine must handle the resolution mapping"
-			// which doesn't seem to happen here.
-			qreal corr = device_painter->device()->logicalDpiX() / 72.0;
-			w = qCeil(page_format.paper_dimensions.width() * units_per_mm * corr);
-			h = qCeil(page_format.paper_dimensions.height() * units_per_mm * corr);
-		}
-#endif
-		
-		local_page_buffer = QImage(w, h, QImage::Format_RGB32);
+		local_page_buffer = QImage(pageBufferSize(device_painter), QImage::Format_RGB32);
 		if (local_page_buffer.isNull())
 		{
 			// Allocation failed
@@ -1302,47 +1430,56 @@ bool MapPrinter::printMap(QPrinter* printer)
 	auto message = message_template.arg(1);
 	emit printProgress(0, message);
 	
-	bool need_new_page = false;
-	for (auto vpos : v_page_pos)
+	if (!separationsModeSelected() && num_steps > 1
+	    && (rasterModeSelected() || engineWillRasterize()))
 	{
-		if (!painter.isActive())
-		{
-			break;
-		}
-		
-		for (auto hpos : h_page_pos)
+		// Each page is drawn to a raster buffer anyway.
+		printPagesConcurrently(printer, &painter, message_template);
+	}
+	else
+	{
+		bool need_new_page = false;
+		for (auto vpos : v_page_pos)
 		{
 			if (!painter.isActive())
 			{
 				break;
 			}
-			
-			++step;
-			auto progress = qMin(99, qMax(1, int((100 * static_cast<decltype(num_steps)>(step) - 50) / num_steps)));
-			emit printProgress(progress, message_template.arg(step));
-			
-			if (cancel_print_map) /* during printProgress handling */
+		
+			for (auto hpos : h_page_pos)
 			{
-				painter.end();
-				break;
-			}
+				if (!painter.isActive())
+				{
+					break;
+				}
 				
-			if (need_new_page)
-			{
-				printer->newPage();
-			}
-			
-			QRectF page_extent = QRectF(QPointF(hpos, vpos), extent_size);
-			if (separationsModeSelected())
-			{
-				drawSeparationPages(printer, &painter, page_extent);
-			}
-			else
-			{
-				drawPage(&painter, page_extent);
+				++step;
+				auto progress = qMin(99, qMax(1, int((100 * static_cast<decltype(num_steps)>(step) - 50) / num_steps)));
+				emit printProgress(progress, message_template.arg(step));
+				
+				if (cancel_print_map) /* during printProgress handling */
+				{
+					painter.end();
+					break;
+				}
+					
+				if (need_new_page)
+				{
+					printer->newPage();
+				}
+				
+				QRectF page_extent = QRectF(QPointF(hpos, vpos), extent_size);
+				if (separationsModeSelected())
+				{
+					drawSeparationPages(printer, &painter, page_extent);
+				}
+				else
+				{
+					drawPage(&painter, page_extent);
+				}
+				
+				need_new_page = true;
 			}
-			
-			need_new_page = true;
 		}
 	}
 	
@@ -1362,6 +1499,69 @@ bool MapPrinter::printMap(QPrinter* printer)
 	return true;
 }
 
+void MapPrinter::printPagesConcurrently(QPrinter* printer, QPainter* device_painter, const QString& message_template)
+{
+	const QSizeF extent_size = page_format.page_rect.size() / scale_adjustment;
+	std::vector<QRectF> page_extents;
+	page_extents.reserve(v_page_pos.size() * h_page_pos.size());
+	for (auto vpos : v_page_pos)
+	{
+		for (auto hpos : h_page_pos)
+			page_extents.emplace_back(QPointF(hpos, vpos), extent_size);
+	}
+	
+	// Streamed objects must be loaded, and dirty objects must be updated,
+	// before rendering concurrently.
+	map.finishLoadingObjects();
+	map.updateObjects();
+	
+	// Each page in progress needs its buffer, and a map buffer of the same size.
+	const auto buffer_size = pageBufferSize(device_painter);
+	const auto page_bytes = std::max(qint64(4) * buffer_size.width() * buffer_size.height(), qint64(1));
+	auto pool = QThreadPool::globalInstance();
+	const auto max_pending = std::size_t(std::max(1, int(std::min(qint64(pool->maxThreadCount()), max_print_memory / (2 * page_bytes)))));
+	
+	PagePipeline pipeline(*this, std::move(page_extents), buffer_size);
+	const auto num_pages = pipeline.size();
+	const auto saved_hints = device_painter->renderHints();
+	std::size_t num_started = 0;
+	for (std::size_t i = 0; i < num_pages; ++i)
+	{
+		if (!device_painter->isActive())
+			break;
+		
+		// Keep the workers busy, within the memory limit.
+		for (; num_started < num_pages && num_started < i + max_pending; ++num_started)
+			pool->start(new PageRunnable(pipeline, num_started));
+		
+		auto progress = qMin(99, qMax(1, int((100 * (i + 1) - 50) / num_pages)));
+		emit printProgress(progress, message_template.arg(i + 1));
+		
+		if (cancel_print_map) /* during printProgress handling */
+		{
+			device_painter->end();
+			break;
+		}
+		
+		auto page = pipeline.take(i);
+		if (page.isNull())
+		{
+			// Allocation failed
+			device_painter->end(); // Signal error
+			break;
+		}
+		
+		if (i > 0)
+			printer->newPage();
+		
+		device_painter->setRenderHint(QPainter::SmoothPixmapTransform, false);
+		device_painter->drawImage(0, 0, page);
+		device_painter->setRenderHints(saved_hints);
+	}
+	
+	pipeline.finish(num_started);
+}
+
 void MapPrinter::cancelPrintMap()
 {
 	cancel_print_map = true;
@@ -311,6 +311,9 @@ public:
 	 * 
 	 *  This will first update this object's properties from the printer's properties.
 	 *
+	 *  When the pages are rasterized anyway, multiple pages are rendered
+	 *  concurrently, and sent to the printer in order.
+	 *
 	 *  @return true on success, false on error. */
 	bool printMap(QPrinter* printer);
 	
@@ -428,6 +431,13 @@ protected:
 	/** Updates the scale adjustment and page breaks. */
 	void mapScaleChanged();
 	
+	/** Returns the size of a raster buffer for a full page on the given painter's device. */
+	QSize pageBufferSize(const QPainter* device_painter) const;
+	
+	/** Renders raster page buffers on worker threads, and draws them to the
+	 *  painter in order. Used by printMap(). */
+	void printPagesConcurrently(QPrinter* printer, QPainter* device_painter, const QString& message_template);
+	
 	Map& map;
 	const MapView* view;
 	const QPrinterInfo* target;
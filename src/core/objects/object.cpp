@@ -21,7 +21,11 @@
 
 #include "object.h"
 
+#include <algorithm>
 #include <cmath>
+#include <cstddef>
+#include <utility>
+#include <vector>
 
 #include <QtMath>
 #include <QtNumeric>
@@ -66,6 +70,29 @@ namespace literal
 
 namespace OpenOrienteering {
 
+namespace {
+
+/**
+ * Compares tags by key, for the sorted Object::TagList.
+ */
+struct TagKeyLess
+{
+	bool operator()(const Object::Tag& tag, const QString& key) const
+	{
+		return tag.first < key;
+	}
+	
+	bool operator()(const Object::Tag& lhs, const Object::Tag& rhs) const
+	{
+		return lhs.first < rhs.first;
+	}
+};
+
+
+}  // namespace
+
+
+
 // ### Object implementation ###
 
 Object::Object(Object::Type type, const Symbol* symbol)
@@ -121,8 +148,11 @@ void Object::copyFrom(const Object& other)
 	coords = other.coords;
 	// map unchanged!
 	object_tags = other.object_tags;
-	output_dirty = true;
+	internTags();
+	setOutputDirty();
 	extent = other.extent;
+	if (map)
+		map->invalidateObjectQueryIndex(this);
 }
 
 bool Object::equals(const Object* other, bool compare_symbol) const
@@ -359,18 +389,23 @@ void Object::load(QIODevice* file, int version, Map* map)
 		path->recalculateParts();
 	}
 	
-	output_dirty = true;
+	setOutputDirty();
 }
 
 #endif
 
 void Object::save(QXmlStreamWriter& xml) const
 {
-	XmlElementWriter object_element(xml, literal::object);
-	object_element.writeAttribute(literal::type, type);
 	int symbol_index = -1;
 	if (map)
 		symbol_index = map->findSymbolIndex(symbol);
+	save(xml, symbol_index);
+}
+
+void Object::save(QXmlStreamWriter& xml, int symbol_index) const
+{
+	XmlElementWriter object_element(xml, literal::object);
+	object_element.writeAttribute(literal::type, type);
 	if (symbol_index != -1)
 		object_element.writeAttribute(literal::symbol, symbol_index);
 	
@@ -547,7 +582,9 @@ Object* Object::load(QXmlStreamReader& xml, Map* map, const SymbolDictionary& sy
 		}
 		else if (xml.name() == literal::tags)
 		{
-			XmlElementReader(xml).read(object->object_tags);
+			Tags tags;
+			XmlElementReader(xml).read(tags);
+			object->initTags(tags);
 		}
 		else
 			xml.skipCurrentElement(); // unknown
@@ -558,7 +595,7 @@ Object* Object::load(QXmlStreamReader& xml, Map* map, const SymbolDictionary& sy
 		PathObject* path = reinterpret_cast<PathObject*>(object);
 		path->recalculateParts();
 	}
-	object->output_dirty = true;
+	object->setOutputDirty();
 	
 	if (map &&
 	    ( object->coords.empty()
@@ -571,26 +608,54 @@ Object* Object::load(QXmlStreamReader& xml, Map* map, const SymbolDictionary& sy
 	return object;
 }
 
+void Object::setOutputDirty(bool dirty)
+{
+	output_dirty = dirty;
+	if (dirty)
+	{
+		output.deleteVariants();
+		if (map)
+			map->markOutputDirty(this);
+	}
+}
+
 void Object::forceUpdate() const
 {
+	output.deleteVariants();
 	output_dirty = true;
 	update();
 }
 
+void Object::updateRenderableOptions() const
+{
+	if (!switchOutput())
+		update();
+}
+
 bool Object::update() const
 {
 	if (!output_dirty)
 		return false;
 	
+	if (map && extent.isValid())
+		map->setObjectAreaDirty(extent);
+	
+	createOutput();
+	
+	if (map)
+		publishOutput();
+	
+	return true;
+}
+
+void Object::createOutput() const
+{
 	Symbol::RenderableOptions options = Symbol::RenderNormal;
 	if (map)
-	{
 		options = QFlag(map->renderableOptions());
-		if (extent.isValid())
-			map->setObjectAreaDirty(extent);
-	}
 	
 	output.deleteRenderables();
+	output.setRenderableOptions(int(options));
 	
 	extent = QRectF();
 	
@@ -600,14 +665,39 @@ bool Object::update() const
 	
 	Q_ASSERT(extent.right() < 60000000);	// assert if bogus values are returned
 	output_dirty = false;
+}
+
+void Object::publishOutput() const
+{
+	Q_ASSERT(map);
+	map->insertRenderablesOfObject(this);
+	map->updateObjectIndex(this);
+	if (extent.isValid())
+		map->setObjectAreaDirty(extent);
+}
+
+bool Object::switchOutput() const
+{
+	if (output_dirty)
+		return false;
 	
-	if (map)
+	if (!map)
+		return true;
+	
+	auto options = map->renderableOptions();
+	if (options == output.renderableOptions())
+		return true;
+	
+	if (extent.isValid())
+		map->setObjectAreaDirty(extent);
+	
+	if (!output.switchVariant(options))
 	{
-		map->insertRenderablesOfObject(this);
-		if (extent.isValid())
-			map->setObjectAreaDirty(extent);
+		output_dirty = true;
+		return false;
 	}
 	
+	publishOutput();
 	return true;
 }
 
@@ -765,10 +855,21 @@ void Object::takeRenderables()
 
 void Object::clearRenderables()
 {
+	output.deleteVariants();
 	output.deleteRenderables();
 	extent = QRectF();
 }
 
+void Object::setMap(Map* map)
+{
+	if (map != this->map)
+	{
+		this->map = map;
+		internTags();
+	}
+	setOutputDirty();
+}
+
 bool Object::setSymbol(const Symbol* new_symbol, bool no_checks)
 {
 	if (!no_checks && new_symbol)
@@ -779,6 +880,8 @@ bool Object::setSymbol(const Symbol* new_symbol, bool no_checks)
 	
 	symbol = new_symbol;
 	setOutputDirty();
+	if (map)
+		map->invalidateObjectQueryIndex(this);
 	return true;
 }
 
@@ -797,13 +900,50 @@ Object* Object::getObjectForType(Object::Type type, const Symbol* symbol)
 	}
 }
 
+Object::Tags Object::tags() const
+{
+	Tags tags;
+	tags.reserve(int(object_tags.size()));
+	for (const auto& tag : object_tags)
+		tags.insert(tag.first, tag.second);
+	return tags;
+}
+
+Object::TagList::const_iterator Object::findTag(const QString& key) const
+{
+	auto tag = std::lower_bound(begin(object_tags), end(object_tags), key, TagKeyLess());
+	if (tag != end(object_tags) && tag->first == key)
+		return tag;
+	return end(object_tags);
+}
+
+// static
+Object::TagList Object::toTagList(const Object::Tags& tags)
+{
+	TagList list;
+	list.reserve(std::size_t(tags.size()));
+	for (auto tag = tags.begin(), last = tags.end(); tag != last; ++tag)
+		list.emplace_back(tag.key(), tag.value());
+	std::sort(begin(list), end(list), TagKeyLess());
+	return list;
+}
+
 void Object::setTags(const Object::Tags& tags)
 {
+	setTags(toTagList(tags));
+}
+
+void Object::setTags(const Object::TagList& tags)
+{
+	Q_ASSERT(std::is_sorted(begin(tags), end(tags), TagKeyLess()));
 	if (object_tags != tags)
 	{
 		object_tags = tags;
+		internTags();
 		if (map)
 		{
+			map->invalidateObjectQueryIndex(this);
+			map->invalidateXmlObjectCache(this);
 			map->setObjectsDirty();
 			if (map->isObjectSelected(this))
 				map->emitSelectionEdited();
@@ -811,27 +951,66 @@ void Object::setTags(const Object::Tags& tags)
 	}
 }
 
+QString Object::getTag(const QString& key) const
+{
+	auto tag = findTag(key);
+	return (tag != end(object_tags)) ? tag->second : QString{};
+}
+
 void Object::setTag(const QString& key, const QString& value)
 {
-	if (!object_tags.contains(key) || object_tags.value(key) != value)
+	auto tag = std::lower_bound(begin(object_tags), end(object_tags), key, TagKeyLess());
+	if (tag == end(object_tags) || tag->first != key)
+		tag = object_tags.emplace(tag, key, value);
+	else if (tag->second != value)
+		tag->second = value;
+	else
+		return;
+	
+	if (map)
+	{
+		auto& pool = map->tagPool();
+		tag->first = pool.intern(tag->first);
+		tag->second = pool.intern(tag->second);
+		map->invalidateObjectQueryIndex(this);
+		map->invalidateXmlObjectCache(this);
+		map->setObjectsDirty();
+		if (map->isObjectSelected(this))
+			map->emitSelectionEdited();
+	}
+}
+
+void Object::removeTag(const QString& key)
+{
+	auto tag = findTag(key);
+	if (tag != end(object_tags))
 	{
-		object_tags.insert(key, value);
+		object_tags.erase(tag);
 		if (map)
 		{
+			map->invalidateObjectQueryIndex(this);
+			map->invalidateXmlObjectCache(this);
 			map->setObjectsDirty();
-			if (map->isObjectSelected(this))
-				map->emitSelectionEdited();
 		}
 	}
 }
 
-void Object::removeTag(const QString& key)
+void Object::initTags(const Object::Tags& tags)
 {
-	if (object_tags.contains(key))
+	object_tags = toTagList(tags);
+	internTags();
+}
+
+void Object::internTags()
+{
+	if (map)
 	{
-		object_tags.remove(key);
-		if (map)
-			map->setObjectsDirty();
+		auto& pool = map->tagPool();
+		for (auto& tag : object_tags)
+		{
+			tag.first = pool.intern(tag.first);
+			tag.second = pool.intern(tag.second);
+		}
 	}
 }
 
@@ -2624,6 +2803,117 @@ void PathObject::Intersections::normalize()
 	erase(std::unique(begin(), end()), end());
 }
 
+namespace {
+
+/**
+ * The bounding box of a segment between two path coords.
+ * 
+ * The segment is identified by its part and by the index of its end.
+ */
+struct SegmentBox
+{
+	double left;
+	double top;
+	double right;
+	double bottom;
+	PathPartVector::size_type part;
+	PathCoordVector::size_type index;
+};
+
+/**
+ * Returns the bounding boxes of all segments of the given parts, in order.
+ * 
+ * The boxes are enlarged by a margin which covers the tolerances of the
+ * intersection calculation.
+ */
+std::vector<SegmentBox> segmentBoxes(const PathPartVector& parts)
+{
+	const double margin = 1e-4;
+	
+	std::vector<SegmentBox> boxes;
+	for (PathPartVector::size_type part_index = 0; part_index < parts.size(); ++part_index)
+	{
+		const auto& path_coords = parts[part_index].path_coords;
+		for (auto i = PathCoordVector::size_type { 1 }; i < path_coords.size(); ++i)
+		{
+			const auto& p0 = path_coords[i-1].pos;
+			const auto& p1 = path_coords[i].pos;
+			boxes.push_back({ std::min(p0.x(), p1.x()) - margin, std::min(p0.y(), p1.y()) - margin,
+			                  std::max(p0.x(), p1.x()) + margin, std::max(p0.y(), p1.y()) + margin,
+			                  part_index, i });
+		}
+	}
+	return boxes;
+}
+
+/**
+ * Returns the pairs of indices of boxes from a and b which overlap,
+ * sorted by the index in a and then by the index in b.
+ * 
+ * This is a sweep in x direction: When the sweep line reaches the left side
+ * of a box, the box is tested against the active boxes from the other set,
+ * i.e. the boxes which have been reached but not yet passed.
+ */
+std::vector<std::pair<std::size_t, std::size_t>> overlappingBoxes(const std::vector<SegmentBox>& a, const std::vector<SegmentBox>& b)
+{
+	std::vector<std::pair<std::size_t, std::size_t>> result;
+	
+	auto byLeft = [](const std::vector<SegmentBox>& boxes) {
+		std::vector<std::size_t> order(boxes.size());
+		for (std::size_t i = 0; i < order.size(); ++i)
+			order[i] = i;
+		std::sort(begin(order), end(order), [&boxes](std::size_t i, std::size_t j) {
+			return boxes[i].left < boxes[j].left;
+		});
+		return order;
+	};
+	const auto a_order = byLeft(a);
+	const auto b_order = byLeft(b);
+	
+	std::vector<std::size_t> a_active;
+	std::vector<std::size_t> b_active;
+	auto insert = [](const SegmentBox& box, std::vector<std::size_t>& active, const std::vector<SegmentBox>& other_boxes, auto emit) {
+		for (auto it = begin(active); it != end(active); )
+		{
+			const auto& other_box = other_boxes[*it];
+			if (other_box.right < box.left)
+			{
+				// Passed by the sweep line
+				*it = active.back();
+				active.pop_back();
+				continue;
+			}
+			if (other_box.top <= box.bottom && box.top <= other_box.bottom)
+				emit(*it);
+			++it;
+		}
+	};
+	
+	auto a_next = begin(a_order);
+	auto b_next = begin(b_order);
+	while (a_next != end(a_order) || b_next != end(b_order))
+	{
+		if (b_next == end(b_order) || (a_next != end(a_order) && a[*a_next].left <= b[*b_next].left))
+		{
+			const auto i = *a_next++;
+			insert(a[i], b_active, b, [&result, i](std::size_t j) { result.emplace_back(i, j); });
+			a_active.push_back(i);
+		}
+		else
+		{
+			const auto j = *b_next++;
+			insert(b[j], a_active, a, [&result, j](std::size_t i) { result.emplace_back(i, j); });
+			b_active.push_back(j);
+		}
+	}
+	
+	std::sort(begin(result), end(result));
+	return result;
+}
+
+}  // namespace
+
+
 void PathObject::calcAllIntersectionsWith(const PathObject* other, PathObject::Intersections& out) const
 {
 	update();
@@ -2633,12 +2923,26 @@ void PathObject::calcAllIntersectionsWith(const PathObject* other, PathObject::I
 	const double zero_minus_epsilon = 0 - epsilon;
 	const double one_plus_epsilon = 1 + epsilon;
 	
+	// Segments which do not overlap can be skipped, except for
+	// finishing a collision which is tracked along the other path.
+	const auto boxes = segmentBoxes(path_parts);
+	const auto other_boxes = segmentBoxes(other->path_parts);
+	const auto candidates = overlappingBoxes(boxes, other_boxes);
+	auto candidate = begin(candidates);
+	auto box_index = std::size_t(0);
+	
 	for (size_t part_index = 0; part_index < path_parts.size(); ++part_index)
 	{
 		const PathPart& part = path_parts[part_index];
 		auto path_coord_end_index = part.path_coords.size() - 1;
-		for (auto i = PathCoordVector::size_type { 1 }; i <= path_coord_end_index; ++i)
+		for (auto i = PathCoordVector::size_type { 1 }; i <= path_coord_end_index; ++i, ++box_index)
 		{
+			if (candidate == end(candidates) || candidate->first != box_index)
+				continue;
+			const auto last_candidate = std::find_if(candidate, end(candidates), [box_index](const auto& c) {
+				return c.first != box_index;
+			});
+			
 			// Get information about this path coord
 			bool has_segment_before = (i > 1) || part.isClosed();
 			MapCoordF ingoing_direction;
@@ -2677,216 +2981,236 @@ void PathObject::calcAllIntersectionsWith(const PathObject* other, PathObject::I
 			// when the next segment suddenly is not colliding anymore.
 			Intersection last_intersection;
 			
-			for (size_t other_part_index = 0; other_part_index < other->path_parts.size(); ++other_part_index)
+			// The last segment of the other path which was tested.
+			const SegmentBox* previous = nullptr;
+			auto skipsSegments = [other](const SegmentBox* last, const SegmentBox* next) {
+				// Skipping the first segment of a part doesn't matter:
+				// it resets the collision state, without entering an intersection.
+				if (next && next->part == last->part)
+					return next->index > last->index + 1;
+				return last->index + 1 < other->path_parts[last->part].path_coords.size();
+			};
+			
+			for (; candidate != last_candidate; ++candidate)
 			{
-				const PathPart& other_part = other->path_parts[part_index]; /// \todo FIXME: part_index or other_part_index ???
+				const SegmentBox& other_box = other_boxes[candidate->second];
+				if (previous && colliding && skipsSegments(previous, &other_box))
+					out.push_back(last_intersection);
+				if (previous && (previous->part != other_box.part || skipsSegments(previous, &other_box)))
+					colliding = false;
+				previous = &other_box;
+				
+				const auto other_part_index = other_box.part;
+				const PathPart& other_part = other->path_parts[other_part_index];
 				auto other_path_coord_end_index = other_part.path_coords.size() - 1;
-				for (auto k = PathCoordVector::size_type { 1 }; k <= other_path_coord_end_index; ++k)
+				auto k = other_box.index;
+				
+				// Test the two line segments against each other.
+				// Naming: segment in this path is a, segment in other path is b
+				const PathCoord& a0 = part.path_coords[i-1];
+				const PathCoord& a1 = part.path_coords[i];
+				const PathCoord& b0 = other_part.path_coords[k-1];
+				const PathCoord& b1 = other_part.path_coords[k];
+				MapCoordF b_direction = b1.pos - b0.pos;
+				b_direction.normalize();
+				
+				bool first_other_segment = (k == 1);
+				if (first_other_segment)
 				{
-					// Test the two line segments against each other.
-					// Naming: segment in this path is a, segment in other path is b
-					const PathCoord& a0 = part.path_coords[i-1];
-					const PathCoord& a1 = part.path_coords[i];
-					const PathCoord& b0 = other_part.path_coords[k-1];
-					const PathCoord& b1 = other_part.path_coords[k];
-					MapCoordF b_direction = b1.pos - b0.pos;
-					b_direction.normalize();
-					
-					bool first_other_segment = (k == 1);
-					if (first_other_segment)
+					colliding = isPointOnSegment(a0.pos, a1.pos, b0.pos);
+					if (colliding && !other_part.isClosed())
 					{
-						colliding = isPointOnSegment(a0.pos, a1.pos, b0.pos);
-						if (colliding && !other_part.isClosed())
-						{
-							// Enter intersection at start of other segment
-							bool ok;
-							double a = parameterOfPointOnLine(a0.pos.x(), a0.pos.y(), a1.pos.x() - a0.pos.x(), a1.pos.y() - a0.pos.y(), b0.pos.x(), b0.pos.y(), ok);
-							Q_ASSERT(ok);
-							out.push_back(Intersection::makeIntersectionAt(a, 0, a0, a1, b0, b1, part_index, other_part_index));
-						}
+						// Enter intersection at start of other segment
+						bool ok;
+						double a = parameterOfPointOnLine(a0.pos.x(), a0.pos.y(), a1.pos.x() - a0.pos.x(), a1.pos.y() - a0.pos.y(), b0.pos.x(), b0.pos.y(), ok);
+						Q_ASSERT(ok);
+						out.push_back(Intersection::makeIntersectionAt(a, 0, a0, a1, b0, b1, part_index, other_part_index));
+					}
+				}
+				
+				bool last_other_segment = (k == other_path_coord_end_index);
+				if (last_other_segment)
+				{
+					bool collision_at_end = isPointOnSegment(a0.pos, a1.pos, b1.pos);
+					if (collision_at_end && !other_part.isClosed())
+					{
+						// Enter intersection at end of other segment
+						bool ok;
+						double a = parameterOfPointOnLine(a0.pos.x(), a0.pos.y(), a1.pos.x() - a0.pos.x(), a1.pos.y() - a0.pos.y(), b1.pos.x(), b1.pos.y(), ok);
+						Q_ASSERT(ok);
+						out.push_back(Intersection::makeIntersectionAt(a, 1, a0, a1, b0, b1, part_index, other_part_index));
+					}
+				}
+				
+				double denominator = a0.pos.x()*b0.pos.y() - a0.pos.y()*b0.pos.x() - a0.pos.x()*b1.pos.y() - a1.pos.x()*b0.pos.y() + a0.pos.y()*b1.pos.x() + a1.pos.y()*b0.pos.x() + a1.pos.x()*b1.pos.y() - a1.pos.y()*b1.pos.x();
+				if (denominator == 0)
+				{
+					// Parallel lines, calculate parameters for b's start and end points in a and b.
+					// This also checks whether the lines are actually on the same level.
+					bool ok;
+					double b_start = 0;
+					double a_start = parameterOfPointOnLine(a0.pos.x(), a0.pos.y(), a1.pos.x() - a0.pos.x(), a1.pos.y() - a0.pos.y(), b0.pos.x(), b0.pos.y(), ok);
+					if (!ok)
+					{
+						if (colliding) out.push_back(last_intersection);
+						colliding = false;
+						continue;
+					}
+					double b_end = 1;
+					double a_end = parameterOfPointOnLine(a0.pos.x(), a0.pos.y(), a1.pos.x() - a0.pos.x(), a1.pos.y() - a0.pos.y(), b1.pos.x(), b1.pos.y(), ok);
+					if (!ok)
+					{
+						if (colliding) out.push_back(last_intersection);
+						colliding = false;
+						continue;
 					}
 					
-					bool last_other_segment = (k == other_path_coord_end_index);
-					if (last_other_segment)
+					// Cull ranges
+					if (a_start < zero_minus_epsilon && a_end < zero_minus_epsilon)
 					{
-						bool collision_at_end = isPointOnSegment(a0.pos, a1.pos, b1.pos);
-						if (collision_at_end && !other_part.isClosed())
-						{
-							// Enter intersection at end of other segment
-							bool ok;
-							double a = parameterOfPointOnLine(a0.pos.x(), a0.pos.y(), a1.pos.x() - a0.pos.x(), a1.pos.y() - a0.pos.y(), b1.pos.x(), b1.pos.y(), ok);
-							Q_ASSERT(ok);
-							out.push_back(Intersection::makeIntersectionAt(a, 1, a0, a1, b0, b1, part_index, other_part_index));
-						}
+						if (colliding) out.push_back(last_intersection);
+						colliding = false;
+						continue;
+					}
+					if (a_start > one_plus_epsilon && a_end > one_plus_epsilon)
+					{
+						if (colliding) out.push_back(last_intersection);
+						colliding = false;
+						continue;
 					}
 					
-					double denominator = a0.pos.x()*b0.pos.y() - a0.pos.y()*b0.pos.x() - a0.pos.x()*b1.pos.y() - a1.pos.x()*b0.pos.y() + a0.pos.y()*b1.pos.x() + a1.pos.y()*b0.pos.x() + a1.pos.x()*b1.pos.y() - a1.pos.y()*b1.pos.x();
-					if (denominator == 0)
+					// b overlaps somehow with a, check if we have to enter one or two collisions
+					// (provided the incoming / outgoing tangents are not parallel!)
+					if (!colliding)
 					{
-						// Parallel lines, calculate parameters for b's start and end points in a and b.
-						// This also checks whether the lines are actually on the same level.
-						bool ok;
-						double b_start = 0;
-						double a_start = parameterOfPointOnLine(a0.pos.x(), a0.pos.y(), a1.pos.x() - a0.pos.x(), a1.pos.y() - a0.pos.y(), b0.pos.x(), b0.pos.y(), ok);
-						if (!ok)
-						{
-							if (colliding) out.push_back(last_intersection);
-							colliding = false;
-							continue;
-						}
-						double b_end = 1;
-						double a_end = parameterOfPointOnLine(a0.pos.x(), a0.pos.y(), a1.pos.x() - a0.pos.x(), a1.pos.y() - a0.pos.y(), b1.pos.x(), b1.pos.y(), ok);
-						if (!ok)
-						{
-							if (colliding) out.push_back(last_intersection);
-							colliding = false;
-							continue;
-						}
-						
-						// Cull ranges
-						if (a_start < zero_minus_epsilon && a_end < zero_minus_epsilon)
-						{
-							if (colliding) out.push_back(last_intersection);
-							colliding = false;
-							continue;
-						}
-						if (a_start > one_plus_epsilon && a_end > one_plus_epsilon)
+						if (a_start <= 0)
 						{
-							if (colliding) out.push_back(last_intersection);
-							colliding = false;
-							continue;
-						}
-						
-						// b overlaps somehow with a, check if we have to enter one or two collisions
-						// (provided the incoming / outgoing tangents are not parallel!)
-						if (!colliding)
-						{
-							if (a_start <= 0)
-							{
-								// b comes in over the start of a
-								Q_ASSERT(a_end >= 0);
-								
-								// Check for parallel tangent case
-								if (!has_segment_before || MapCoordF::dotProduct(b_direction, ingoing_direction) < 1 - epsilon)
-								{
-									// Enter intersection at a=0
-									double b = b_start + (0 - a_start) / (a_end - a_start) * (b_end - b_start);
-									out.push_back(Intersection::makeIntersectionAt(0, b, a0, a1, b0, b1, part_index, other_part_index));
-								}
-								
-								colliding = true;
-							}
-							else if (a_start >= 1)
+							// b comes in over the start of a
+							Q_ASSERT(a_end >= 0);
+							
+							// Check for parallel tangent case
+							if (!has_segment_before || MapCoordF::dotProduct(b_direction, ingoing_direction) < 1 - epsilon)
 							{
-								// b comes in over the end of a
-								Q_ASSERT(a_end <= 1);
-								
-								// Check for parallel tangent case
-								if (!has_segment_after || -1 * MapCoordF::dotProduct(b_direction, outgoing_direction) < 1 - epsilon)
-								{
-									// Enter intersection at a=1
-									double b = b_start + (1 - a_start) / (a_end - a_start) * (b_end - b_start);
-									out.push_back(Intersection::makeIntersectionAt(1, b, a0, a1, b0, b1, part_index, other_part_index));
-								}
-								
-								colliding = true;
+								// Enter intersection at a=0
+								double b = b_start + (0 - a_start) / (a_end - a_start) * (b_end - b_start);
+								out.push_back(Intersection::makeIntersectionAt(0, b, a0, a1, b0, b1, part_index, other_part_index));
 							}
-							else
-								Q_ASSERT(false);
+							
+							colliding = true;
 						}
-						if (colliding)
+						else if (a_start >= 1)
 						{
-							if (a_end > 1)
-							{
-								// b goes out over the end of a
-								Q_ASSERT(a_start <= 1);
-								
-								// Check for parallel tangent case
-								if (!has_segment_after || MapCoordF::dotProduct(b_direction, outgoing_direction) < 1 - epsilon)
-								{
-									// Enter intersection at a=1
-									double b = b_start + (1 - a_start) / (a_end - a_start) * (b_end - b_start);
-									out.push_back(Intersection::makeIntersectionAt(1, b, a0, a1, b0, b1, part_index, other_part_index));
-								}
-								
-								colliding = false;
-							}
-							else if (a_end < 0)
-							{
-								// b goes out over the start of a
-								Q_ASSERT(a_start >= 1);
-								
-								// Check for parallel tangent case
-								if (!has_segment_before || -1 * MapCoordF::dotProduct(b_direction, ingoing_direction) < 1 - epsilon)
-								{
-									// Enter intersection at a=0
-									double b = b_start + (0 - a_start) / (a_end - a_start) * (b_end - b_start);
-									out.push_back(Intersection::makeIntersectionAt(1, b, a0, a1, b0, b1, part_index, other_part_index));
-								}
-								
-								colliding = false;
-							}
-							else
+							// b comes in over the end of a
+							Q_ASSERT(a_end <= 1);
+							
+							// Check for parallel tangent case
+							if (!has_segment_after || -1 * MapCoordF::dotProduct(b_direction, outgoing_direction) < 1 - epsilon)
 							{
-								// b stops in the middle of a.
-								// Remember last known colliding point, the endpoint of b.
-								last_intersection = Intersection::makeIntersectionAt(a_end, 1, a0, a1, b0, b1, part_index, other_part_index);
+								// Enter intersection at a=1
+								double b = b_start + (1 - a_start) / (a_end - a_start) * (b_end - b_start);
+								out.push_back(Intersection::makeIntersectionAt(1, b, a0, a1, b0, b1, part_index, other_part_index));
 							}
+							
+							colliding = true;
 						}
-						
-						// Check if there is a collision at the endpoint
-						Q_ASSERT(colliding == (a_end >= 0 && a_end <= 1));
+						else
+							Q_ASSERT(false);
 					}
-					else
+					if (colliding)
 					{
-						// Non-parallel lines, calculate intersection parameters and check if in range
-						double a = +(a0.pos.x()*b0.pos.y() - a0.pos.y()*b0.pos.x() - a0.pos.x()*b1.pos.y() + a0.pos.y()*b1.pos.x() + b0.pos.x()*b1.pos.y() - b1.pos.x()*b0.pos.y()) / denominator;
-						if (a < zero_minus_epsilon || a > one_plus_epsilon)
+						if (a_end > 1)
 						{
-							if (colliding) out.push_back(last_intersection);
+							// b goes out over the end of a
+							Q_ASSERT(a_start <= 1);
+							
+							// Check for parallel tangent case
+							if (!has_segment_after || MapCoordF::dotProduct(b_direction, outgoing_direction) < 1 - epsilon)
+							{
+								// Enter intersection at a=1
+								double b = b_start + (1 - a_start) / (a_end - a_start) * (b_end - b_start);
+								out.push_back(Intersection::makeIntersectionAt(1, b, a0, a1, b0, b1, part_index, other_part_index));
+							}
+							
 							colliding = false;
-							continue;
 						}
-						
-						double b = -(a0.pos.x()*a1.pos.y() - a1.pos.x()*a0.pos.y() - a0.pos.x()*b0.pos.y() + a0.pos.y()*b0.pos.x() + a1.pos.x()*b0.pos.y() - a1.pos.y()*b0.pos.x()) / denominator;
-						if (b < zero_minus_epsilon || b > one_plus_epsilon)
+						else if (a_end < 0)
 						{
-							if (colliding) out.push_back(last_intersection);
+							// b goes out over the start of a
+							Q_ASSERT(a_start >= 1);
+							
+							// Check for parallel tangent case
+							if (!has_segment_before || -1 * MapCoordF::dotProduct(b_direction, ingoing_direction) < 1 - epsilon)
+							{
+								// Enter intersection at a=0
+								double b = b_start + (0 - a_start) / (a_end - a_start) * (b_end - b_start);
+								out.push_back(Intersection::makeIntersectionAt(1, b, a0, a1, b0, b1, part_index, other_part_index));
+							}
+							
 							colliding = false;
-							continue;
-						}
-						
-						// Special case for overlapping (cloned / traced) polylines: check if b is parallel to adjacent direction.
-						// If so, set colliding to true / false without entering an intersection because the other line
-						// simply continues along / comes from the path of both polylines instead of intersecting.
-						double dot = -1;
-						if (has_segment_before && a <= 0 + epsilon)
-						{
-							// Ingoing direction
-							dot = MapCoordF::dotProduct(b_direction, ingoing_direction);
-							if (b <= 0 + epsilon)
-								dot = -1 * dot;
-						}
-						else if (has_segment_after && a >= 1 - epsilon)
-						{
-							// Outgoing direction
-							dot = MapCoordF::dotProduct(b_direction, outgoing_direction);
-							if (b >= 1 - epsilon)
-								dot = -1 * dot;
 						}
-						if (dot >= 1 - epsilon)
+						else
 						{
-							colliding = (b > 0.5);
-							continue;
+							// b stops in the middle of a.
+							// Remember last known colliding point, the endpoint of b.
+							last_intersection = Intersection::makeIntersectionAt(a_end, 1, a0, a1, b0, b1, part_index, other_part_index);
 						}
-						
-						// Enter the intersection
-						last_intersection = Intersection::makeIntersectionAt(a, b, a0, a1, b0, b1, part_index, other_part_index);
-						out.push_back(last_intersection);
-						colliding = (b == 1);
 					}
+					
+					// Check if there is a collision at the endpoint
+					Q_ASSERT(colliding == (a_end >= 0 && a_end <= 1));
+				}
+				else
+				{
+					// Non-parallel lines, calculate intersection parameters and check if in range
+					double a = +(a0.pos.x()*b0.pos.y() - a0.pos.y()*b0.pos.x() - a0.pos.x()*b1.pos.y() + a0.pos.y()*b1.pos.x() + b0.pos.x()*b1.pos.y() - b1.pos.x()*b0.pos.y()) / denominator;
+					if (a < zero_minus_epsilon || a > one_plus_epsilon)
+					{
+						if (colliding) out.push_back(last_intersection);
+						colliding = false;
+						continue;
+					}
+					
+					double b = -(a0.pos.x()*a1.pos.y() - a1.pos.x()*a0.pos.y() - a0.pos.x()*b0.pos.y() + a0.pos.y()*b0.pos.x() + a1.pos.x()*b0.pos.y() - a1.pos.y()*b0.pos.x()) / denominator;
+					if (b < zero_minus_epsilon || b > one_plus_epsilon)
+					{
+						if (colliding) out.push_back(last_intersection);
+						colliding = false;
+						continue;
+					}
+					
+					// Special case for overlapping (cloned / traced) polylines: check if b is parallel to adjacent direction.
+					// If so, set colliding to true / false without entering an intersection because the other line
+					// simply continues along / comes from the path of both polylines instead of intersecting.
+					double dot = -1;
+					if (has_segment_before && a <= 0 + epsilon)
+					{
+						// Ingoing direction
+						dot = MapCoordF::dotProduct(b_direction, ingoing_direction);
+						if (b <= 0 + epsilon)
+							dot = -1 * dot;
+					}
+					else if (has_segment_after && a >= 1 - epsilon)
+					{
+						// Outgoing direction
+						dot = MapCoordF::dotProduct(b_direction, outgoing_direction);
+						if (b >= 1 - epsilon)
+							dot = -1 * dot;
+					}
+					if (dot >= 1 - epsilon)
+					{
+						colliding = (b > 0.5);
+						continue;
+					}
+					
+					// Enter the intersection
+					last_intersection = Intersection::makeIntersectionAt(a, b, a0, a1, b0, b1, part_index, other_part_index);
+					out.push_back(last_intersection);
+					colliding = (b == 1);
 				}
 			}
+			
+			if (previous && colliding && skipsSegments(previous, nullptr))
+				out.push_back(last_intersection);
 		}
 	}
 }
@@ -24,6 +24,7 @@
 
 #include <algorithm>
 #include <limits>
+#include <utility>
 #include <vector>
 
 #include <QtGlobal>
@@ -66,6 +67,8 @@ class VirtualCoordVector;
  */
 class Object  // clazy:exclude=copyable-polymorphic
 {
+friend class BinaryFileImporter;
+friend class Map;
 friend class ObjectRenderables;
 friend class OCAD8FileImport;
 friend class XMLImportExport;
@@ -151,6 +154,14 @@ public:
 	
 	/** Saves the object in xml format to the given stream. */
 	void save(QXmlStreamWriter& xml) const;
+	
+	/**
+	 * Saves the object in xml format to the given stream,
+	 * referring to the symbol by the given index.
+	 * 
+	 * Unlike save(QXmlStreamWriter&), this function does not access the map.
+	 */
+	void save(QXmlStreamWriter& xml, int symbol_index) const;
 	/**
 	 * Loads the object in xml format from the given stream.
 	 * @param xml The stream to load the object from, must be at the correct tag.
@@ -176,6 +187,16 @@ public:
 	 */
 	void forceUpdate() const;
 	
+	/**
+	 * Switches the output to the map's current renderable options,
+	 * and updates the object's map.
+	 * 
+	 * The renderables for other renderable options are kept until the object
+	 * is modified. Renderables are only created when there are none for the
+	 * current options yet.
+	 */
+	void updateRenderableOptions() const;
+	
 	
 	/** Moves the whole object
 	 * @param dx X offset in native map coordinates.
@@ -243,7 +264,12 @@ public:
 	 */
 	const MapCoordVector& getRawCoordinateVector() const;
 	
-	/** Sets the object output's dirty state. */
+	/**
+	 * Sets the object output's dirty state.
+	 * 
+	 * When the object belongs to a map, a dirty object is registered with
+	 * the map for the next Map::updateObjects().
+	 */
 	void setOutputDirty(bool dirty = true);
 	/** Returns if the object's output must be regenerated. */
 	bool isOutputDirty() const;
@@ -279,12 +305,39 @@ public:
 	/** Defines a type which maps keys to values, to be used for tagging objects. */
 	typedef QHash<QString, QString> Tags;
 	
-	/** Returns a const reference to the object's tags. */
-	const Tags& tags() const;
+	/** A single tag, i.e. a key and a value. */
+	typedef std::pair<QString, QString> Tag;
+	
+	/**
+	 * Defines the compact storage of an object's tags.
+	 * 
+	 * The tags are sorted by key, and each key occurs only once. When the
+	 * object is in a map, keys and values are shared via the map's TagPool.
+	 */
+	typedef std::vector<Tag> TagList;
+	
+	/**
+	 * Returns a copy of the object's tags.
+	 * 
+	 * This builds a new hash on each call. tagList() is cheaper.
+	 */
+	Tags tags() const;
+	
+	/** Returns the object's tags, sorted by key. */
+	const TagList& tagList() const;
+	
+	/** Returns the tag with the given key, or tagList().end(). */
+	TagList::const_iterator findTag(const QString& key) const;
 	
 	/** Replaces the object's tags. */
 	void setTags(const Tags& tags);
 	
+	/** Replaces the object's tags by a list which is sorted by key, cf. tagList(). */
+	void setTags(const TagList& tags);
+	
+	/** Returns the given tags as a list sorted by key. */
+	static TagList toTagList(const Tags& tags);
+	
 	/** Returns the value of the given tag key. */
 	QString getTag(const QString& key) const;
 	
@@ -309,9 +362,45 @@ protected:
 	const Symbol* symbol;
 	MapCoordVector coords;
 	Map* map;
-	Tags object_tags;
+	TagList object_tags;
 	
 private:
+	/**
+	 * Replaces the object's tags without notifying the map.
+	 * 
+	 * This is meant for loading objects.
+	 */
+	void initTags(const Tags& tags);
+	
+	/**
+	 * Shares the keys and values of the tags via the map's TagPool.
+	 */
+	void internTags();
+	
+	/**
+	 * Regenerates output and extent, without modifying the map.
+	 * 
+	 * This is the part of update() which may run concurrently for
+	 * different objects.
+	 */
+	void createOutput() const;
+	
+	/**
+	 * Inserts the output into the object's map and marks its area as dirty.
+	 * 
+	 * This is the part of update() which must not run concurrently.
+	 */
+	void publishOutput() const;
+	
+	/**
+	 * Switches the output to the map's current renderable options,
+	 * using renderables which were kept from earlier updates.
+	 * 
+	 * Returns false if the output is dirty now and needs to be created.
+	 * This function must not run concurrently.
+	 */
+	bool switchOutput() const;
+	
 	mutable bool output_dirty;        // does the output have to be re-generated because of changes?
 	mutable QRectF extent;            // only valid after calling update()
 	mutable ObjectRenderables output; // only valid after calling update()
@@ -1090,12 +1179,6 @@ const MapCoordVector& Object::getRawCoordinateVector() const
 	return coords;
 }
 
-inline
-void Object::setOutputDirty(bool dirty)
-{
-	output_dirty = dirty;
-}
-
 inline
 bool Object::isOutputDirty() const
 {
@@ -1114,13 +1197,6 @@ const QRectF& Object::getExtent() const
 	return extent;
 }
 
-inline
-void Object::setMap(Map* map)
-{
-	this->map = map;
-	setOutputDirty();
-}
-
 inline
 Map* Object::getMap() const
 {
@@ -1128,17 +1204,11 @@ Map* Object::getMap() const
 }
 
 inline
-const Object::Tags& Object::tags() const
+const Object::TagList& Object::tagList() const
 {
 	return object_tags;
 }
 
-inline
-QString Object::getTag(const QString& key) const
-{
-	return object_tags.value(key);
-}
-
 
 
 //### PathPart inline code ###
@@ -22,6 +22,7 @@
 #include "object_query.h"
 
 #include <algorithm>
+#include <cstddef>
 #include <iterator>
 #include <new>
 
@@ -329,24 +330,33 @@ QString ObjectQuery::labelFor(ObjectQuery::Operator op)
 
 bool ObjectQuery::operator()(const Object* object) const
 {
-	const auto& object_tags = object->tags();
+	const auto& object_tags = object->tagList();
 
 	switch(op)
 	{
 	case OperatorIs:
-		return object_tags.contains(tags.key) && object_tags.value(tags.key) == tags.value;
+		{
+			auto tag = object->findTag(tags.key);
+			return tag != object_tags.end() && tag->second == tags.value;
+		}
 	case OperatorIsNot:
-		// If the object does have the tag, not is true
-		return !object_tags.contains(tags.key) || object_tags.value(tags.key) != tags.value;
+		{
+			// If the object does have the tag, not is true
+			auto tag = object->findTag(tags.key);
+			return tag == object_tags.end() || tag->second != tags.value;
+		}
 	case OperatorContains:
-		return object_tags.contains(tags.key) && object_tags.value(tags.key).contains(tags.value);
+		{
+			auto tag = object->findTag(tags.key);
+			return tag != object_tags.end() && tag->second.contains(tags.value);
+		}
 	case OperatorSearch:
 		if (object->getSymbol() && object->getSymbol()->getName().contains(tags.value, Qt::CaseInsensitive))
 			return true;
-		for (auto it = object_tags.begin(), last = object_tags.end(); it != last; ++it)
+		for (const auto& tag : object_tags)
 		{
-			if (it.key().contains(tags.value, Qt::CaseInsensitive)
-			    || it.value().contains(tags.value, Qt::CaseInsensitive))
+			if (tag.first.contains(tags.value, Qt::CaseInsensitive)
+			    || tag.second.contains(tags.value, Qt::CaseInsensitive))
 				return true;
 		}
 		return false;
@@ -553,6 +563,148 @@ bool operator==(const ObjectQuery& lhs, const ObjectQuery& rhs)
 }
 
 
+
+// ### CompiledObjectQuery ###
+
+CompiledObjectQuery::CompiledObjectQuery(const ObjectQuery& query)
+{
+	compile(query);
+}
+
+
+CompiledObjectQuery::~CompiledObjectQuery() = default;
+
+
+void CompiledObjectQuery::compile(const ObjectQuery& query)
+{
+	switch (query.getOperator())
+	{
+	case ObjectQuery::OperatorIs:
+	case ObjectQuery::OperatorIsNot:
+	case ObjectQuery::OperatorContains:
+		{
+			static const OpCode opcodes[] = { TagIs, TagIsNot, TagContains };
+			auto operands = query.tagOperands();
+			program.push_back({ opcodes[query.getOperator() - ObjectQuery::OperatorIs], keySlot(operands->key), operands->value, nullptr });
+		}
+		return;
+	case ObjectQuery::OperatorSearch:
+		program.push_back({ Search, -1, query.tagOperands()->value, nullptr });
+		return;
+	case ObjectQuery::OperatorObjectText:
+		program.push_back({ ObjectText, -1, query.tagOperands()->value, nullptr });
+		return;
+		
+	case ObjectQuery::OperatorAnd:
+	case ObjectQuery::OperatorOr:
+		{
+			auto operands = query.logicalOperands();
+			compile(*operands->first);
+			auto jump = program.size();
+			program.push_back({ query.getOperator() == ObjectQuery::OperatorAnd ? JumpIfFalse : JumpIfTrue, -1, {}, nullptr });
+			compile(*operands->second);
+			program[jump].operand = int(program.size());
+		}
+		return;
+		
+	case ObjectQuery::OperatorSymbol:
+		program.push_back({ SymbolIs, -1, {}, query.symbolOperand() });
+		return;
+		
+	case ObjectQuery::OperatorInvalid:
+		program.push_back({ False, -1, {}, nullptr });
+		return;
+	}
+	
+	Q_UNREACHABLE();
+}
+
+
+int CompiledObjectQuery::keySlot(const QString& key)
+{
+	auto found = std::find(begin(keys), end(keys), key);
+	if (found != end(keys))
+		return int(std::distance(begin(keys), found));
+	
+	keys.push_back(key);
+	return int(keys.size()) - 1;
+}
+
+
+bool CompiledObjectQuery::operator()(const Object* object) const
+{
+	const auto& object_tags = object->tagList();
+	
+	// Tag values by key slot, looked up on demand
+	QVarLengthArray<bool, 8> looked_up(int(keys.size()));
+	QVarLengthArray<const QString*, 8> values(int(keys.size()));
+	std::fill(looked_up.begin(), looked_up.end(), false);
+	auto tagValue = [&](int slot) -> const QString* {
+		if (!looked_up[slot])
+		{
+			auto found = object->findTag(keys[std::size_t(slot)]);
+			values[slot] = (found != object_tags.end()) ? &found->second : nullptr;
+			looked_up[slot] = true;
+		}
+		return values[slot];
+	};
+	
+	auto result = false;
+	for (std::size_t pc = 0, size = program.size(); pc < size; )
+	{
+		const auto& instruction = program[pc];
+		switch (instruction.op)
+		{
+		case TagIs:
+			{
+				auto value = tagValue(instruction.operand);
+				result = value && *value == instruction.value;
+			}
+			break;
+		case TagIsNot:
+			{
+				auto value = tagValue(instruction.operand);
+				result = !value || *value != instruction.value;
+			}
+			break;
+		case TagContains:
+			{
+				auto value = tagValue(instruction.operand);
+				result = value && value->contains(instruction.value);
+			}
+			break;
+		case Search:
+			result = object->getSymbol() && object->getSymbol()->getName().contains(instruction.value, Qt::CaseInsensitive);
+			for (auto tag = object_tags.begin(), last = object_tags.end(); !result && tag != last; ++tag)
+			{
+				result = tag->first.contains(instruction.value, Qt::CaseInsensitive)
+				         || tag->second.contains(instruction.value, Qt::CaseInsensitive);
+			}
+			break;
+		case ObjectText:
+			result = object->getType() == Object::Text
+			         && static_cast<const TextObject*>(object)->getText().contains(instruction.value, Qt::CaseInsensitive);
+			break;
+		case SymbolIs:
+			result = object->getSymbol() == instruction.symbol;
+			break;
+		case False:
+			result = false;
+			break;
+			
+		case JumpIfFalse:
+			pc = result ? pc + 1 : std::size_t(instruction.operand);
+			continue;
+		case JumpIfTrue:
+			pc = result ? std::size_t(instruction.operand) : pc + 1;
+			continue;
+		}
+		++pc;
+	}
+	return result;
+}
+
+
 ObjectQuery ObjectQueryParser::parse(const QString& text)
 {
 	auto result = ObjectQuery{};
@@ -22,6 +22,7 @@
 #define OPENORIENTEERING_OBJECT_QUERY_H
 
 #include <memory>
+#include <vector>
 
 #include <QCoreApplication>
 #include <QMetaType>
@@ -216,6 +217,68 @@ bool operator!=(const ObjectQuery::StringOperands& lhs, const ObjectQuery::Strin
 
 
 
+/**
+ * An ObjectQuery lowered to a flat program, for repeated evaluation.
+ * 
+ * The program is a sequence of predicates and conditional jumps which
+ * implement the short-circuit evaluation of OperatorAnd and OperatorOr.
+ * The tag keys of the query are interned: Each distinct key is looked up
+ * at most once per object, no matter how many predicates refer to it.
+ * 
+ * Evaluation gives the same result as ObjectQuery::operator(). It does not
+ * modify the program, so a compiled query may be used from multiple threads.
+ */
+class CompiledObjectQuery
+{
+public:
+	/**
+	 * Compiles the given query.
+	 */
+	explicit CompiledObjectQuery(const ObjectQuery& query);
+	
+	CompiledObjectQuery(const CompiledObjectQuery&) = default;
+	CompiledObjectQuery(CompiledObjectQuery&&) = default;
+	CompiledObjectQuery& operator=(const CompiledObjectQuery&) = default;
+	CompiledObjectQuery& operator=(CompiledObjectQuery&&) = default;
+	~CompiledObjectQuery();
+	
+	/**
+	 * Evaluates the program on the given object and returns whether it matches.
+	 */
+	bool operator()(const Object* object) const;
+	
+private:
+	enum OpCode
+	{
+		TagIs,
+		TagIsNot,
+		TagContains,
+		Search,
+		ObjectText,
+		SymbolIs,
+		False,
+		JumpIfFalse,
+		JumpIfTrue,
+	};
+	
+	struct Instruction
+	{
+		OpCode op;
+		int operand;            ///< The key slot, or the jump target
+		QString value;
+		const Symbol* symbol;
+	};
+	
+	void compile(const ObjectQuery& query);
+	
+	int keySlot(const QString& key);
+	
+	std::vector<Instruction> program;
+	std::vector<QString> keys;
+};
+
+
+
 /**
  * Utility to contruct object queries from text.
  * 
@@ -0,0 +1,317 @@
+/*
+ *    Copyright 2018 The OpenOrienteering developers
+ *
+ *    This file is part of OpenOrienteering.
+ *
+ *    OpenOrienteering is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    OpenOrienteering is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with OpenOrienteering.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "object_query_index.h"
+
+#include <algorithm>
+#include <iterator>
+#include <utility>
+
+#include <Qt>
+
+#include "core/map.h"
+#include "core/map_part.h"
+#include "core/objects/object.h"
+#include "core/objects/object_query.h"
+#include "core/symbols/symbol.h"
+
+
+namespace OpenOrienteering {
+
+namespace {
+
+/**
+ * Sorts a list of object numbers, and removes duplicates.
+ */
+void normalize(std::vector<quint32>& postings)
+{
+	std::sort(begin(postings), end(postings));
+	postings.erase(std::unique(begin(postings), end(postings)), end(postings));
+}
+
+/**
+ * Appends a list of object numbers to another list.
+ */
+void append(std::vector<quint32>& postings, const std::vector<quint32>& other)
+{
+	postings.insert(end(postings), begin(other), end(other));
+}
+
+/**
+ * Removes an object number from a sorted list.
+ */
+void erase(std::vector<quint32>& postings, quint32 number)
+{
+	auto found = std::lower_bound(begin(postings), end(postings), number);
+	if (found != end(postings) && *found == number)
+		postings.erase(found);
+}
+
+
+}  // namespace
+
+
+
+ObjectQueryIndex::ObjectQueryIndex(const Map& map)
+{
+	entries.reserve(std::size_t(map.getNumObjects()));
+	numbers.reserve(std::size_t(map.getNumObjects()));
+	for (int i = 0; i < map.getNumParts(); ++i)
+	{
+		auto part = map.getPart(std::size_t(i));
+		for (int j = 0; j < part->getNumObjects(); ++j)
+			insert(part->getObject(j), part);
+	}
+}
+
+
+ObjectQueryIndex::~ObjectQueryIndex() = default;
+
+
+
+void ObjectQueryIndex::insert(Object* object, MapPart* part)
+{
+	remove(object);
+	
+	// New numbers are higher than all existing numbers,
+	// so appending keeps the lists sorted.
+	auto number = quint32(entries.size());
+	entries.push_back({ object, part, object->getSymbol(), object->tagList(), object->getType() == Object::Text });
+	numbers[object] = number;
+	
+	symbols[object->getSymbol()].push_back(number);
+	if (object->getType() == Object::Text)
+		text_objects.push_back(number);
+	for (const auto& tag : object->tagList())
+	{
+		auto& key_postings = tags[tag.first];
+		key_postings.all.push_back(number);
+		key_postings.values[tag.second].push_back(number);
+	}
+}
+
+
+bool ObjectQueryIndex::remove(const Object* object)
+{
+	auto found = numbers.find(object);
+	if (found == numbers.end())
+		return false;
+	
+	auto number = found->second;
+	numbers.erase(found);
+	
+	auto& entry = entries[number];
+	auto symbol_postings = symbols.find(entry.symbol);
+	erase(*symbol_postings, number);
+	if (symbol_postings->empty())
+		symbols.erase(symbol_postings);
+	if (entry.is_text)
+		erase(text_objects, number);
+	for (const auto& tag : entry.tags)
+	{
+		auto key_postings = tags.find(tag.first);
+		erase(key_postings->all, number);
+		auto value_postings = key_postings->values.find(tag.second);
+		erase(*value_postings, number);
+		if (value_postings->empty())
+			key_postings->values.erase(value_postings);
+		if (key_postings->all.empty())
+			tags.erase(key_postings);
+	}
+	
+	entry = { nullptr, nullptr, nullptr, {}, false };
+	return true;
+}
+
+
+void ObjectQueryIndex::invalidate(const Object* object)
+{
+	invalidated.insert(object);
+}
+
+
+bool ObjectQueryIndex::needsUpdate() const
+{
+	return !invalidated.empty();
+}
+
+
+void ObjectQueryIndex::update(const std::function<MapPart* (const Object*)>& find_part)
+{
+	auto objects = std::unordered_set<const Object*>{};
+	objects.swap(invalidated);
+	
+	// Remove all objects first: The address of a deleted object
+	// may have been reused for a new object.
+	for (auto object : objects)
+		remove(object);
+	for (auto object : objects)
+	{
+		if (auto part = find_part(object))
+			insert(const_cast<Object*>(object), part);
+	}
+}
+
+
+
+std::vector<quint32> ObjectQueryIndex::findMatching(const ObjectQuery& query, const MapPart* part) const
+{
+	const auto compiled = CompiledObjectQuery(query);
+	
+	Postings result;
+	Postings candidate_list;
+	if (candidates(query, candidate_list))
+	{
+		std::copy_if(begin(candidate_list), end(candidate_list), std::back_inserter(result), [this, part, &compiled](quint32 number) {
+			const auto& entry = entries[number];
+			return (!part || entry.part == part) && compiled(entry.object);
+		});
+	}
+	else if (part)
+	{
+		// Only the objects of the given part are evaluated.
+		for (int i = 0; i < part->getNumObjects(); ++i)
+		{
+			auto object = part->getObject(i);
+			if (compiled(object))
+				result.push_back(numbers.at(object));
+		}
+		std::sort(begin(result), end(result));
+	}
+	else
+	{
+		for (auto number = quint32(0); number < entries.size(); ++number)
+		{
+			const auto& entry = entries[number];
+			if (entry.object && compiled(entry.object))
+				result.push_back(number);
+		}
+	}
+	return result;
+}
+
+
+bool ObjectQueryIndex::candidates(const ObjectQuery& query, Postings& out) const
+{
+	out.clear();
+	switch (query.getOperator())
+	{
+	case ObjectQuery::OperatorIs:
+		{
+			auto operands = query.tagOperands();
+			auto key_postings = tags.constFind(operands->key);
+			if (key_postings != tags.constEnd())
+				out = key_postings->values.value(operands->value);
+		}
+		return true;
+
+	case ObjectQuery::OperatorContains:
+		{
+			auto operands = query.tagOperands();
+			auto key_postings = tags.constFind(operands->key);
+			if (key_postings != tags.constEnd())
+			{
+				for (auto value = key_postings->values.begin(), last = key_postings->values.end(); value != last; ++value)
+				{
+					if (value.key().contains(operands->value))
+						append(out, value.value());
+				}
+				normalize(out);
+			}
+		}
+		return true;
+
+	case ObjectQuery::OperatorSearch:
+		{
+			// The number of distinct symbols, keys and values is usually much
+			// smaller than the number of objects.
+			const auto& text = query.tagOperands()->value;
+			for (auto symbol = symbols.begin(), last = symbols.end(); symbol != last; ++symbol)
+			{
+				if (symbol.key() && symbol.key()->getName().contains(text, Qt::CaseInsensitive))
+					append(out, symbol.value());
+			}
+			for (auto key = tags.begin(), last = tags.end(); key != last; ++key)
+			{
+				if (key.key().contains(text, Qt::CaseInsensitive))
+				{
+					append(out, key->all);
+					continue;
+				}
+				for (auto value = key->values.begin(), last_value = key->values.end(); value != last_value; ++value)
+				{
+					if (value.key().contains(text, Qt::CaseInsensitive))
+						append(out, value.value());
+				}
+			}
+			normalize(out);
+		}
+		return true;
+
+	case ObjectQuery::OperatorObjectText:
+		out = text_objects;
+		return true;
+
+	case ObjectQuery::OperatorSymbol:
+		out = symbols.value(query.symbolOperand());
+		return true;
+
+	case ObjectQuery::OperatorAnd:
+		{
+			auto operands = query.logicalOperands();
+			Postings first, second;
+			auto first_selective = candidates(*operands->first, first);
+			if (first_selective && first.empty())
+				return true;
+			auto second_selective = candidates(*operands->second, second);
+			if (first_selective && second_selective)
+				std::set_intersection(begin(first), end(first), begin(second), end(second), std::back_inserter(out));
+			else if (first_selective)
+				out.swap(first);
+			else if (second_selective)
+				out.swap(second);
+			else
+				return false;
+		}
+		return true;
+
+	case ObjectQuery::OperatorOr:
+		{
+			auto operands = query.logicalOperands();
+			Postings first, second;
+			if (!candidates(*operands->first, first)
+			    || !candidates(*operands->second, second))
+				return false;
+			std::set_union(begin(first), end(first), begin(second), end(second), std::back_inserter(out));
+		}
+		return true;
+
+	case ObjectQuery::OperatorIsNot:
+		return false;
+
+	case ObjectQuery::OperatorInvalid:
+		return true;
+	}
+
+	Q_UNREACHABLE();
+}
+
+
+}  // namespace OpenOrienteering
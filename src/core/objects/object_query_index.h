@@ -0,0 +1,167 @@
+/*
+ *    Copyright 2018 The OpenOrienteering developers
+ *
+ *    This file is part of OpenOrienteering.
+ *
+ *    OpenOrienteering is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    OpenOrienteering is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with OpenOrienteering.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef OPENORIENTEERING_OBJECT_QUERY_INDEX_H
+#define OPENORIENTEERING_OBJECT_QUERY_INDEX_H
+
+#include <cstddef>
+#include <functional>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include <QtGlobal>
+#include <QHash>
+#include <QString>
+
+namespace OpenOrienteering {
+
+class Map;
+class MapPart;
+class Object;
+class ObjectQuery;
+class Symbol;
+
+
+/**
+ * Inverted indexes of a map's objects by symbol and by tags, for object queries.
+ *
+ * The index numbers the objects. When the index is created, the numbers
+ * follow the map order, i.e. the order by part and by the index in the part.
+ * Objects which are registered later get higher numbers. For each symbol,
+ * each tag key, and each tag key/value pair, the index holds the sorted list
+ * of the numbers of the matching objects.
+ *
+ * findMatching() resolves the selective parts of a query from these lists:
+ * OperatorIs, OperatorContains, OperatorSearch, OperatorObjectText and
+ * OperatorSymbol, and their combinations. Only the resulting candidates are
+ * evaluated with the compiled query. OperatorIsNot is not selective.
+ *
+ * Objects are identified by their address only. invalidate() marks an object
+ * as added, changed or deleted, without accessing it. update() removes all
+ * invalidated objects from the index, and registers them again if they are
+ * still part of the map, cf. Map::getObjectQueryIndex().
+ */
+class ObjectQueryIndex
+{
+public:
+	/** An object in the index. */
+	struct Entry
+	{
+		Object* object;        ///< nullptr if the object was removed
+		MapPart* part;
+		const Symbol* symbol;  ///< The symbol at registration
+		std::vector<std::pair<QString, QString>> tags;  ///< The tags at registration
+		bool is_text;
+	};
+
+	/**
+	 * Creates the index for the objects of the given map.
+	 */
+	explicit ObjectQueryIndex(const Map& map);
+
+	ObjectQueryIndex(const ObjectQueryIndex&) = delete;
+	ObjectQueryIndex& operator=(const ObjectQueryIndex&) = delete;
+
+	~ObjectQueryIndex();
+
+
+	/**
+	 * Returns the number of object numbers, including the numbers of
+	 * removed objects.
+	 */
+	std::size_t size() const { return entries.size(); }
+
+	/**
+	 * Returns the object with the given number.
+	 */
+	const Entry& entry(std::size_t i) const { return entries[i]; }
+
+	/**
+	 * Registers the object with the current symbol and tags, under a new number.
+	 *
+	 * If the object is already registered, it is removed first.
+	 */
+	void insert(Object* object, MapPart* part);
+
+	/**
+	 * Removes the object from the index, without accessing it.
+	 *
+	 * Returns false if the object was not registered.
+	 */
+	bool remove(const Object* object);
+
+	/**
+	 * Marks the object as added, changed or deleted, without accessing it.
+	 */
+	void invalidate(const Object* object);
+
+	/**
+	 * Returns true if there are invalidated objects.
+	 */
+	bool needsUpdate() const;
+
+	/**
+	 * Removes all invalidated objects, and registers them again with the
+	 * part returned by find_part, unless it is nullptr.
+	 */
+	void update(const std::function<MapPart* (const Object*)>& find_part);
+
+
+	/**
+	 * Returns the numbers of the objects which match the query, sorted.
+	 *
+	 * If part is not nullptr, only objects from this part are considered.
+	 * For a query which is not selective, only the objects of this part
+	 * are evaluated then.
+	 */
+	std::vector<quint32> findMatching(const ObjectQuery& query, const MapPart* part = nullptr) const;
+
+
+private:
+	using Postings = std::vector<quint32>;
+
+	struct TagPostings
+	{
+		Postings all;                     ///< All objects with the key
+		QHash<QString, Postings> values;  ///< The objects by value
+	};
+
+	/**
+	 * Determines the objects which may match the query.
+	 *
+	 * Returns false if the query is not selective, i.e. if any object may
+	 * match. Otherwise, the result is sorted.
+	 */
+	bool candidates(const ObjectQuery& query, Postings& out) const;
+
+
+	std::vector<Entry> entries;
+	std::unordered_map<const Object*, quint32> numbers;
+	std::unordered_set<const Object*> invalidated;
+	QHash<const Symbol*, Postings> symbols;
+	QHash<QString, TagPostings> tags;
+	Postings text_objects;
+};
+
+
+}  // namespace OpenOrienteering
+
+#endif
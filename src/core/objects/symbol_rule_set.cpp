@@ -27,6 +27,8 @@
 #include <memory>
 #include <type_traits>
 #include <unordered_set>
+#include <utility>
+#include <vector>
 
 #include <QtGlobal>
 #include <QChar>
@@ -38,6 +40,7 @@
 
 #include "core/map.h"
 #include "core/objects/object.h"
+#include "core/objects/object_query_index.h"
 #include "core/symbols/symbol.h"
 #include "undo/undo_manager.h"
 
@@ -371,7 +374,31 @@ void SymbolRuleSet::apply(Map& object_map, const Map& symbol_set, Options option
 	}
 	
 	// Change symbols for all objects
-	object_map.applyOnAllObjects(std::cref(*this));
+	{
+		// The first matching rule wins, as in operator().
+		// Changing a symbol changes the index, so the matches are collected first.
+		const auto& index = object_map.getObjectQueryIndex();
+		std::vector<const Symbol*> assignments(index.size(), nullptr);
+		for (const auto& item : *this)
+		{
+			if (!item.symbol)
+				continue;
+			for (auto number : index.findMatching(item.query))
+			{
+				if (!assignments[number])
+					assignments[number] = item.symbol;
+			}
+		}
+		
+		std::vector<std::pair<Object*, const Symbol*>> changes;
+		for (std::size_t number = 0; number < assignments.size(); ++number)
+		{
+			if (assignments[number])
+				changes.emplace_back(index.entry(number).object, assignments[number]);
+		}
+		for (const auto& change : changes)
+			change.first->setSymbol(change.second, false);
+	}
 	
 	// Delete unused old symbols
 	if (!old_symbols.empty())
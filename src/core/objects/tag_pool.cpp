@@ -0,0 +1,84 @@
+/*
+ *    Copyright 2018 The OpenOrienteering developers
+ *
+ *    This file is part of OpenOrienteering.
+ *
+ *    OpenOrienteering is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    OpenOrienteering is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with OpenOrienteering.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "tag_pool.h"
+
+#include <algorithm>
+
+
+namespace OpenOrienteering {
+
+namespace {
+
+/// The minimum size of the pool for automatic pruning
+constexpr int min_prune_size = 1000;
+
+}  // namespace
+
+
+
+TagPool::TagPool()
+: prune_size(min_prune_size)
+{
+	// nothing
+}
+
+
+TagPool::~TagPool() = default;
+
+
+
+QString TagPool::intern(const QString& string)
+{
+	auto found = strings.constFind(string);
+	if (found == strings.constEnd())
+	{
+		if (strings.size() >= prune_size)
+			prune();
+		found = strings.insert(string);
+	}
+	return *found;
+}
+
+
+int TagPool::prune()
+{
+	auto const old_size = strings.size();
+	for (auto string = strings.begin(); string != strings.end(); )
+	{
+		// A detached string is referenced by the pool only.
+		if (string->isDetached())
+			string = strings.erase(string);
+		else
+			++string;
+	}
+	prune_size = std::max(min_prune_size, 2 * strings.size());
+	return old_size - strings.size();
+}
+
+
+void TagPool::clear()
+{
+	strings.clear();
+	prune_size = min_prune_size;
+}
+
+
+}  // namespace OpenOrienteering
@@ -0,0 +1,89 @@
+/*
+ *    Copyright 2018 The OpenOrienteering developers
+ *
+ *    This file is part of OpenOrienteering.
+ *
+ *    OpenOrienteering is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    OpenOrienteering is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with OpenOrienteering.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef OPENORIENTEERING_TAG_POOL_H
+#define OPENORIENTEERING_TAG_POOL_H
+
+#include <QSet>
+#include <QString>
+
+namespace OpenOrienteering {
+
+
+/**
+ * A pool of shared strings for the tags of a map's objects.
+ * 
+ * Imported data often attaches the same keys and values to many objects.
+ * intern() returns a single implicitly shared QString for all equal strings,
+ * so that the objects share the memory of repeated keys and values.
+ * 
+ * Interned strings are ordinary QStrings. They remain valid when objects
+ * are moved to another map, or when the pool is cleared or destroyed.
+ * prune() releases the strings which are no longer used outside the pool.
+ * 
+ * The pool is not thread-safe. It is used from the map's thread.
+ */
+class TagPool
+{
+public:
+	TagPool();
+	
+	TagPool(const TagPool&) = delete;
+	TagPool& operator=(const TagPool&) = delete;
+	
+	~TagPool();
+	
+	
+	/**
+	 * Returns the pooled string which is equal to the given string.
+	 * 
+	 * The string is added to the pool if there is no such string yet.
+	 * When the pool has doubled in size since the last prune(), it is
+	 * pruned before adding the string.
+	 */
+	QString intern(const QString& string);
+	
+	/**
+	 * Removes the strings which are no longer used outside the pool,
+	 * e.g. after deleting objects or changing their tags.
+	 * 
+	 * Returns the number of removed strings.
+	 */
+	int prune();
+	
+	/**
+	 * Returns the number of distinct strings in the pool.
+	 */
+	int size() const { return strings.size(); }
+	
+	/**
+	 * Removes all strings from the pool.
+	 */
+	void clear();
+	
+	
+private:
+	QSet<QString> strings;
+	int prune_size;  ///< The size which triggers the next prune()
+};
+
+
+}  // namespace OpenOrienteering
+
+#endif
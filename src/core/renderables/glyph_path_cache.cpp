@@ -0,0 +1,254 @@
+/*
+ *    Copyright 2018 The OpenOrienteering developers
+ *
+ *    This file is part of OpenOrienteering.
+ *
+ *    OpenOrienteering is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    OpenOrienteering is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with OpenOrienteering.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "glyph_path_cache.h"
+
+#include <cstddef>
+#include <initializer_list>
+#include <vector>
+
+#include <QChar>
+#include <QFont>
+#include <QFontMetricsF>
+#include <QLatin1String>
+#include <QMutexLocker>
+#include <QPointF>
+#include <QRawFont>
+#include <QVector>
+
+
+namespace OpenOrienteering {
+
+namespace {
+
+/**
+ * Returns true if text in this font can be assembled from glyph outlines.
+ *
+ * Letter spacing, word spacing, capitalization, overline and strikeout
+ * are left to QPainterPath::addText().
+ */
+bool isPlainFont(const QFont& font)
+{
+	return (qIsNull(font.letterSpacing())
+	        || (font.letterSpacingType() == QFont::PercentageSpacing && qFuzzyCompare(font.letterSpacing(), 100.0)))
+	       && qIsNull(font.wordSpacing())
+	       && font.capitalization() == QFont::MixedCase
+	       && !font.overline()
+	       && !font.strikeOut();
+}
+
+/**
+ * Returns true if the text can be assembled from glyph outlines.
+ *
+ * This is the case when each character maps to a single glyph, without
+ * contextual shaping: Latin, Greek, and Cyrillic characters, but no
+ * combining marks, no control or format characters, and no surrogates.
+ * Common Latin ligatures are excluded, too.
+ */
+bool isPlainText(const QString& text)
+{
+	for (const auto c : text)
+	{
+		switch (c.script())
+		{
+		case QChar::Script_Common:
+		case QChar::Script_Latin:
+		case QChar::Script_Greek:
+		case QChar::Script_Cyrillic:
+			break;
+		default:
+			return false;
+		}
+
+		switch (c.category())
+		{
+		case QChar::Mark_NonSpacing:
+		case QChar::Mark_SpacingCombining:
+		case QChar::Mark_Enclosing:
+		case QChar::Separator_Line:
+		case QChar::Separator_Paragraph:
+		case QChar::Other_Control:
+		case QChar::Other_Format:
+		case QChar::Other_Surrogate:
+		case QChar::Other_PrivateUse:
+		case QChar::Other_NotAssigned:
+			return false;
+		default:
+			break;
+		}
+	}
+
+	for (const auto ligature : { "ff", "fi", "fl" })
+	{
+		if (text.contains(QLatin1String(ligature)))
+			return false;
+	}
+
+	return true;
+}
+
+
+}  // namespace
+
+
+
+// static
+GlyphPathCache& GlyphPathCache::instance()
+{
+	static GlyphPathCache cache;
+	return cache;
+}
+
+
+GlyphPathCache::GlyphPathCache()
+: stats { 0, 0, 0, 0 }
+{
+	// nothing else
+}
+
+
+GlyphPathCache::~GlyphPathCache() = default;
+
+
+
+void GlyphPathCache::addText(QPainterPath& path, qreal x, qreal y, const QFont& font, const QString& text)
+{
+	if (text.isEmpty())
+		return;
+
+	// Whether a text can be assembled from the cache is determined once per
+	// font and text. So the shaping of the text is not repeated.
+	const auto font_key = font.key();
+	const auto plain_font = isPlainFont(font);
+	auto verified = false;
+	auto assemble = plain_font;
+	if (plain_font)
+	{
+		QMutexLocker locker(&mutex);
+		const auto& texts = fonts[font_key].texts;
+		const auto known = texts.constFind(text);
+		verified = known != texts.constEnd();
+		if (verified)
+			assemble = *known;
+	}
+
+	QRawFont raw_font;
+	QVector<quint32> glyph_indexes;
+	QVector<QPointF> advances;
+	if (assemble && (verified || isPlainText(text)))
+	{
+		raw_font = QRawFont::fromFont(font);
+		if (raw_font.isValid())
+			glyph_indexes = raw_font.glyphIndexesForString(text);
+		// Glyphs which need a fallback font have index 0.
+		assemble = !glyph_indexes.isEmpty() && !glyph_indexes.contains(0);
+	}
+	else
+	{
+		assemble = false;
+	}
+
+	if (assemble)
+	{
+		advances = raw_font.advancesForGlyphIndexes(glyph_indexes, font.kerning() ? QRawFont::KernedAdvances : QRawFont::SeparateAdvances);
+		if (!verified)
+		{
+			// QRawFont kerning uses the legacy 'kern' table only, and ligatures
+			// may be formed from other characters than the ones rejected above.
+			// So the summed advances must match the width of the shaped text.
+			auto width = qreal(0);
+			for (const auto& advance : advances)
+				width += advance.x();
+			const auto shaped_width = QFontMetricsF(font).width(text);
+			assemble = qAbs(width - shaped_width) <= 0.001 * qAbs(shaped_width) + 0.01;
+		}
+	}
+
+	if (plain_font && !verified)
+	{
+		QMutexLocker locker(&mutex);
+		fonts[font_key].texts.insert(text, assemble);
+	}
+
+	if (!assemble)
+	{
+		// Complex text, or glyphs which need a fallback font
+		{
+			QMutexLocker locker(&mutex);
+			++stats.fallbacks;
+		}
+		path.addText(x, y, font, text);
+		return;
+	}
+
+	std::vector<QPainterPath> outlines;
+	outlines.reserve(std::size_t(glyph_indexes.size()));
+	{
+		QMutexLocker locker(&mutex);
+		auto& glyphs = fonts[font_key].glyphs;
+		for (const auto glyph_index : glyph_indexes)
+		{
+			auto outline = glyphs.constFind(glyph_index);
+			if (outline == glyphs.constEnd())
+			{
+				outline = glyphs.insert(glyph_index, raw_font.pathForGlyph(glyph_index));
+				++stats.misses;
+				++stats.glyphs;
+			}
+			else
+			{
+				++stats.hits;
+			}
+			outlines.push_back(*outline);
+		}
+	}
+
+	auto glyph_x = x;
+	for (std::size_t i = 0; i < outlines.size(); ++i)
+	{
+		path.addPath(outlines[i].translated(glyph_x, y));
+		glyph_x += advances[int(i)].x();
+	}
+
+	if (font.underline())
+	{
+		// Like QPainterPath::addText()
+		path.addRect(x, y + raw_font.underlinePosition(), glyph_x - x, raw_font.lineThickness());
+	}
+}
+
+
+
+GlyphPathCache::Statistics GlyphPathCache::statistics() const
+{
+	QMutexLocker locker(&mutex);
+	return stats;
+}
+
+
+void GlyphPathCache::clear()
+{
+	QMutexLocker locker(&mutex);
+	fonts.clear();
+	stats = { 0, 0, 0, 0 };
+}
+
+
+}  // namespace OpenOrienteering
@@ -0,0 +1,111 @@
+/*
+ *    Copyright 2018 The OpenOrienteering developers
+ *
+ *    This file is part of OpenOrienteering.
+ *
+ *    OpenOrienteering is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    OpenOrienteering is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with OpenOrienteering.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef OPENORIENTEERING_GLYPH_PATH_CACHE_H
+#define OPENORIENTEERING_GLYPH_PATH_CACHE_H
+
+#include <QtGlobal>
+#include <QHash>
+#include <QMutex>
+#include <QPainterPath>
+#include <QString>
+
+class QFont;
+
+namespace OpenOrienteering {
+
+
+/**
+ * A process-wide cache of glyph outlines.
+ *
+ * Text paths are assembled from the cached outlines of the individual glyphs,
+ * translated to their positions. This avoids the repeated extraction of glyph
+ * outlines from the font engine which QPainterPath::addText() does for every
+ * call. The cache is keyed by the font (QFont::key()) and the glyph index.
+ *
+ * Only text which doesn't need complex shaping is assembled from the cache:
+ * Latin, Greek and Cyrillic text without combining marks and without common
+ * ligatures, in a font which provides all glyphs. In addition, the summed
+ * glyph advances must match the width of the shaped text as reported by
+ * QFontMetricsF, which isn't the case e.g. for kerning from OpenType GPOS
+ * tables or for other ligatures. Other text falls back to
+ * QPainterPath::addText(). The result of these checks is cached per font and
+ * text, so that the text is shaped only once.
+ *
+ * All functions are thread-safe.
+ */
+class GlyphPathCache
+{
+public:
+	/** Usage statistics of the cache. */
+	struct Statistics
+	{
+		quint64 hits;       ///< Glyphs taken from the cache
+		quint64 misses;     ///< Glyphs added to the cache
+		quint64 fallbacks;  ///< Texts which were handled by QPainterPath::addText()
+		int glyphs;         ///< Number of glyphs in the cache
+	};
+
+	/**
+	 * Returns the process-wide instance.
+	 */
+	static GlyphPathCache& instance();
+
+	GlyphPathCache();
+	GlyphPathCache(const GlyphPathCache&) = delete;
+	GlyphPathCache& operator=(const GlyphPathCache&) = delete;
+	~GlyphPathCache();
+
+	/**
+	 * Adds the outline of the text to the path, with the left end of the
+	 * baseline at (x, y).
+	 *
+	 * The result is meant to match QPainterPath::addText(), with the same
+	 * glyph positions and underline. This is verified by GlyphPathCacheTest
+	 * for the text which is assembled from the cache.
+	 */
+	void addText(QPainterPath& path, qreal x, qreal y, const QFont& font, const QString& text);
+
+	/**
+	 * Returns the current usage statistics.
+	 */
+	Statistics statistics() const;
+
+	/**
+	 * Removes all glyphs from the cache, and resets the statistics.
+	 */
+	void clear();
+
+private:
+	/** The cached data for a single font. */
+	struct FontData
+	{
+		QHash<quint32, QPainterPath> glyphs;  ///< Outlines by glyph index
+		QHash<QString, bool> texts;           ///< Whether a text is assembled from glyphs
+	};
+
+	mutable QMutex mutex;
+	QHash<QString, FontData> fonts;
+	Statistics stats;
+};
+
+
+}  // namespace OpenOrienteering
+
+#endif
@@ -21,8 +21,10 @@
 #include "renderable.h"
 
 #include <algorithm>
+#include <functional>
 #include <iterator>
 #include <utility>
+#include <vector>
 
 #include <Qt>
 #include <QBrush>
@@ -32,13 +34,16 @@
 #include <QPainterPath>
 #include <QPen>
 #include <QRgb>
+#include <QThreadPool>
 #include <QTransform>
 
+#include "settings.h"
 #include "core/image_transparency_fixup.h"
 #include "core/map_color.h"
 #include "core/map.h"
 #include "core/objects/object.h"
 #include "core/symbols/symbol.h"
+#include "util/parallel.h"
 #include "util/util.h"
 
 #if defined(Q_OS_ANDROID) && defined(QT_PRINTSUPPORT_LIB)
@@ -84,6 +89,60 @@ namespace OpenOrienteering {
 
 
 
+namespace {
+
+/**
+ * The maximum memory for concurrently drawn separations, in bytes.
+ */
+constexpr qint64 max_overprinting_memory = qint64(256) << 20;
+
+#if MAPPER_OVERPRINTING_CORRECTION > 0
+
+/**
+ * Reduces the alpha of the normal output for the overprinting correction.
+ * 
+ * Each pixel is a premultipled RGBA, so the alpha value is adjusted by
+ * applying the same factor to all 4 channels (bytes). This is implemented
+ * by bitwise operators for efficiency, on four pixels at once with SSE2.
+ */
+void applyOverprintingCorrection(QImage& image)
+{
+	constexpr int shift = (MAPPER_OVERPRINTING_CORRECTION >= 3) ? 1 : 4 - MAPPER_OVERPRINTING_CORRECTION;
+	constexpr quint32 mask = (0xffu >> shift) * 0x01010101u;
+	
+	QRgb* px = reinterpret_cast<QRgb*>(image.bits());
+	const QRgb* px_end = px + image.byteCount() / sizeof(QRgb);
+#ifdef MAPPER_SSE2_IMAGE_FIXUP
+	const __m128i mask_x4 = _mm_set1_epi32(int(mask));
+	for (; px_end - px >= 4; px += 4)
+	{
+		__m128i* pixels = reinterpret_cast<__m128i*>(px);
+		_mm_storeu_si128(pixels, _mm_and_si128(_mm_srli_epi32(_mm_loadu_si128(pixels), shift), mask_x4));
+	}
+#endif
+	for (; px < px_end; ++px)
+		*px = (*px >> shift) & mask;
+}
+
+#endif
+
+}  // namespace
+
+
+
+// ### RenderConfig ###
+
+// static
+RenderConfig::Options RenderConfig::screenOptions(Options options)
+{
+	options |= Screen;
+	if (!Settings::getInstance().getSettingCached(Settings::MapDisplay_TextAntialiasing).toBool())
+		options |= DisableTextAntialiasing;
+	return options;
+}
+
+
+
 // ### Renderable ###
 
 Renderable::~Renderable() = default;
@@ -219,6 +278,55 @@ void ObjectRenderables::deleteRenderables()
 	}
 }
 
+int ObjectRenderables::renderableOptions() const
+{
+	return renderable_options;
+}
+
+void ObjectRenderables::setRenderableOptions(int options)
+{
+	renderable_options = options;
+}
+
+bool ObjectRenderables::switchVariant(int options)
+{
+	if (options == renderable_options)
+		return true;
+	
+	Q_ASSERT(variants.find(renderable_options) == variants.end());
+	auto& stored = variants[renderable_options];
+	for (auto& color : *this)
+	{
+		auto& container = stored.renderables[color.first];
+		container = new SharedRenderables();
+		container->swap(*color.second);
+	}
+	stored.extent = extent;
+	
+	renderable_options = options;
+	extent = QRectF();
+	
+	auto variant = variants.find(options);
+	if (variant == variants.end())
+		return false;
+	
+	for (auto& color : variant->second.renderables)
+	{
+		auto& container = operator[](color.first);
+		if (!container)
+			container = new SharedRenderables();
+		container->swap(*color.second);
+	}
+	extent = variant->second.extent;
+	variants.erase(variant);
+	return true;
+}
+
+void ObjectRenderables::deleteVariants()
+{
+	variants.clear();
+}
+
 
 
 // ### MapRenderables ###
@@ -237,8 +345,6 @@ MapRenderables::MapRenderables(Map* map)
 
 void MapRenderables::draw(QPainter *painter, const RenderConfig &config) const
 {
-	// TODO: improve performance by using some spatial acceleration structure?
-	
 #ifdef Q_OS_ANDROID
 	const qreal min_dimension = 1.0/config.scaling;
 #endif
@@ -246,6 +352,8 @@ void MapRenderables::draw(QPainter *painter, const RenderConfig &config) const
 	QPainterPath initial_clip = painter->clipPath();
 	const QPainterPath* current_clip = nullptr;
 	
+	std::vector<const ObjectRenderablesMap::value_type*> visible_objects;
+	
 	painter->save();
 	auto end_of_colors = rend();
 	auto color = rbegin();
@@ -261,19 +369,20 @@ void MapRenderables::draw(QPainter *painter, const RenderConfig &config) const
 			continue;
 		}
 		
-		for (const auto& object : color->second)
+		findObjects(color->second, color->first, config.bounding_box, visible_objects);
+		for (const auto* object : visible_objects)
 		{
 			// Settings check
-			const Symbol* symbol = object.first->getSymbol();
+			const Symbol* symbol = object->first->getSymbol();
 			if (!config.testFlag(RenderConfig::HelperSymbols) && symbol->isHelperSymbol())
 				continue;
 			if (symbol->isHidden())
 				continue;
 			
-			if (!object.first->getExtent().intersects(config.bounding_box))
+			if (!object->first->getExtent().intersects(config.bounding_box))
 				continue;
 			
-			for (const auto& renderables : *object.second)
+			for (const auto& renderables : *object->second)
 			{
 				// Render the renderables
 				const PainterConfig& state = renderables.first;
@@ -324,22 +433,71 @@ void MapRenderables::drawOverprintingSimulation(QPainter* painter, const RenderC
 	painter->resetTransform();
 	painter->setCompositionMode(QPainter::CompositionMode_Multiply); // Alternative: CompositionMode_Darken
 	
-	QImage separation(image->size(), QImage::Format_ARGB32_Premultiplied);
-	
+	// The layers of the composition: the spot color separations, in reverse
+	// order of priority, and the correction (nullptr).
+	std::vector<const MapColor*> layers;
+	layers.reserve(map->color_set->colors.size() + 1);
 	for (auto map_color = map->color_set->colors.rbegin();
 	     map_color != map->color_set->colors.rend();
 	     map_color++)
 	{
 		if ((*map_color)->getSpotColorMethod() == MapColor::SpotColor)
-		{
+			layers.push_back(*map_color);
+	}
+#if MAPPER_OVERPRINTING_CORRECTION > 0
+	layers.push_back(nullptr);
+#endif
+	
+	// The layers are drawn concurrently, in groups which are limited by the
+	// number of threads and by memory, and composed in order.
+	auto const image_bytes = std::max(qint64(image->bytesPerLine()) * image->height(), qint64(1));
+	auto const group_size = std::max(std::size_t(1), std::min({
+	    layers.size(),
+	    std::size_t(std::max(QThreadPool::globalInstance()->maxThreadCount(), 1)),
+	    std::size_t(max_overprinting_memory / image_bytes) }));
+	std::vector<QImage> separations(group_size);
+	
+	for (std::size_t first = 0; first < layers.size(); first += group_size)
+	{
+		auto const count = std::min(group_size, layers.size() - first);
+		parallelFor(count, [&](std::size_t i) {
+			auto& separation = separations[i];
+			if (separation.isNull())
+				separation = QImage(image->size(), QImage::Format_ARGB32_Premultiplied);
 			separation.fill(Qt::GlobalColor(Qt::transparent));
 			
-			// Collect all halftones and knockouts of a single color
 			QPainter p(&separation);
 			p.setRenderHints(hints);
 			p.setWorldTransform(t, false);
-			drawColorSeparation(&p, config, *map_color, true);
-			p.end();
+			if (auto map_color = layers[first + i])
+			{
+				// Collect all halftones and knockouts of a single color
+				drawColorSeparation(&p, config, map_color, true);
+				p.end();
+			}
+#if MAPPER_OVERPRINTING_CORRECTION > 0
+			else
+			{
+				// The normal output, with reduced alpha
+				RenderConfig config_copy = config;
+				config_copy.options |= RenderConfig::RequireSpotColor;
+				draw(&p, config_copy);
+				p.end();
+				applyOverprintingCorrection(separation);
+			}
+#endif
+		});
+		
+		for (std::size_t i = 0; i < count; ++i)
+		{
+			auto const& separation = separations[i];
+			auto const map_color = layers[first + i];
+			if (!map_color)
+			{
+				painter->setCompositionMode(QPainter::CompositionMode_SourceOver);
+				painter->drawImage(0, 0, separation);
+				continue;
+			}
 			
 			// Add this separation to the composition with multiplication.
 			painter->setCompositionMode(QPainter::CompositionMode_Multiply);
@@ -349,7 +507,7 @@ void MapRenderables::drawOverprintingSimulation(QPainter* painter, const RenderC
 #if MAPPER_OVERPRINTING_CORRECTION == -1
 			// Add some opacity to the multiplication, but not for black,
 			// since halftones (i.e. grey) might unduly lighten the composition.
-			if (static_cast<QRgb>(**map_color) != 0xff000000)
+			if (static_cast<QRgb>(*map_color) != 0xff000000)
 			{
 				// FIXME: Implement this for Format_ARGB32_Premultiplied,
 				//        if efficiently possible.
@@ -369,35 +527,6 @@ void MapRenderables::drawOverprintingSimulation(QPainter* painter, const RenderC
 	}
 	
 	painter->setCompositionMode(QPainter::CompositionMode_SourceOver);
-	
-#if MAPPER_OVERPRINTING_CORRECTION > 0
-	separation.fill(Qt::GlobalColor(Qt::transparent));
-	QPainter p(&separation);
-	p.setRenderHints(hints);
-	p.setWorldTransform(t, false);
-	RenderConfig config_copy = config;
-	config_copy.options |= RenderConfig::RequireSpotColor;
-	draw(&p, config_copy);
-	p.end();
-	QRgb* dest = reinterpret_cast<QRgb*>(separation.bits());
-	const QRgb* dest_end = dest + separation.byteCount() / sizeof(QRgb);
-	for (QRgb* px = dest; px < dest_end; ++px)
-	{
-		/* Each pixel is a premultipled RGBA, so the alpha value is adjusted
-		 * by applying the same factor to all 4 channels (bytes).
-		 * Implemented by bitwise operators for efficiency.
-		 */
-#if MAPPER_OVERPRINTING_CORRECTION == 1
-		*px = (*px >> 3) & 0x1f1f1f1f;
-#elif MAPPER_OVERPRINTING_CORRECTION == 2
-		*px = (*px >> 2) & 0x3f3f3f3f;
-#else /* MAPPER_OVERPRINTING_CORRECTION == 3 or stronger */
-		*px = (*px >> 1) & 0x7f7f7f7f;
-#endif
-	}
-	painter->drawImage(0, 0, separation);
-#endif
-	
 	painter->restore();
 	
 	if (config.testFlag(RenderConfig::Screen))
@@ -418,6 +547,8 @@ void MapRenderables::drawColorSeparation(QPainter* painter, const RenderConfig&
 	// we need to take care of knockouts.
 	bool drawing_started = false;
 	
+	std::vector<const ObjectRenderablesMap::value_type*> visible_objects;
+	
 	// For each pair of color priority and its renderables collection...
 	auto end_of_colors = rend();
 	auto color = rbegin();
@@ -518,20 +649,21 @@ void MapRenderables::drawColorSeparation(QPainter* painter, const RenderConfig&
 		}
 		
 		// For each pair of object and its renderables [states] for a particular map color...
-		for (const auto& object : color->second)
+		findObjects(color->second, color->first, config.bounding_box, visible_objects);
+		for (const auto* object : visible_objects)
 		{
 			// Check whether the symbol and object is to be drawn at all.
-			const Symbol* symbol = object.first->getSymbol();
+			const Symbol* symbol = object->first->getSymbol();
 			if (!config.testFlag(RenderConfig::HelperSymbols) && symbol->isHelperSymbol())
 				continue;
 			if (symbol->isHidden())
 				continue;
 			
-			if (!object.first->getExtent().intersects(config.bounding_box))
+			if (!object->first->getExtent().intersects(config.bounding_box))
 				continue;
 			
 			// For each pair of common rendering attributes and collection of renderables...
-			for (const auto& renderables : *object.second)
+			for (const auto& renderables : *object->second)
 			{
 				const PainterConfig& state = renderables.first;
 				
@@ -584,6 +716,7 @@ void MapRenderables::insertRenderablesOfObject(const Object* object)
 	for (; color != end_of_colors; ++color)
 	{
 		operator[](color->first)[object] = color->second;
+		object_index[color->first].insert(object, object->getExtent());
 	}
 }
 
@@ -613,10 +746,21 @@ void MapRenderables::removeRenderablesOfObject(const Object* object, bool mark_a
 			}
 			
 			color.second.erase(obj);
+			object_index[color.first].remove(object);
 		}
 	}
 }
 
+void MapRenderables::updateExtentOfObject(const Object* object)
+{
+	for (const auto& color : object->renderables())
+	{
+		auto index = object_index.find(color.first);
+		if (index != object_index.end() && index->second.contains(object))
+			index->second.insert(object, object->getExtent());
+	}
+}
+
 void MapRenderables::clear(bool mark_area_as_dirty)
 {
 	if (mark_area_as_dirty)
@@ -636,6 +780,33 @@ void MapRenderables::clear(bool mark_area_as_dirty)
 		}
 	}
 	std::map<int, ObjectRenderablesMap>::clear();
+	object_index.clear();
+}
+
+void MapRenderables::findObjects(const ObjectRenderablesMap& objects, int color_priority, const QRectF& rect, std::vector<const ObjectRenderablesMap::value_type*>& result) const
+{
+	result.clear();
+	
+	auto index = object_index.find(color_priority);
+	if (index == object_index.end())
+		return;
+	
+	std::vector<const Object*> candidates;
+	candidates.reserve(std::min(objects.size(), index->second.size()));
+	index->second.query(rect.normalized(), [&candidates](const Object* object) {
+		candidates.push_back(object);
+	});
+	
+	// Keep the drawing order independent of the index.
+	std::sort(begin(candidates), end(candidates), std::less<const Object*>());
+	
+	result.reserve(candidates.size());
+	for (auto object : candidates)
+	{
+		auto item = objects.find(object);
+		if (item != objects.end())
+			result.push_back(&*item);
+	}
 }
 
 // ### PainterConfig ###
@@ -31,6 +31,7 @@
 #include <QExplicitlySharedDataPointer>
 
 #include "core/map_color.h"
+#include "core/spatial_index.h"
 
 class QColor;
 class QPainter;
@@ -72,6 +73,8 @@ public:
 		HelperSymbols       = 1<<3, ///< Activates display of symbols with the "helper symbol" flag.
 		Highlighted         = 1<<4, ///< Makes the color appear highlighted.
 		RequireSpotColor    = 1<<5, ///< Skips colors which do not have a spot color definition.
+		DisableTextAntialiasing = 1<<6, ///< Disables antialiasing for texts.
+		                            ///  Set by screenOptions() according to the user's settings.
 		Tool                = Screen | ForceMinSize | HelperSymbols, ///< The recommended flags for tools.
 		NoOptions           = 0     ///< No option activated.
 	};
@@ -104,6 +107,15 @@ public:
 	 * \see QFlags::testFlag()
 	 */
 	bool testFlag(const Option flag) const;
+	
+	/**
+	 * Returns the given options with the options for drawing on the screen.
+	 * 
+	 * This adds Screen, and it applies the user's text antialiasing setting.
+	 * It reads the settings, so it must be called from the GUI thread, not
+	 * from the threads which do the actual rendering.
+	 */
+	static Options screenOptions(Options options);
 };
 
 
@@ -120,6 +132,9 @@ protected:
 	/** The constructor for new renderables. */
 	explicit Renderable(const MapColor* color);
 	
+	/** The constructor for renderables which are composed of other renderables. */
+	explicit Renderable(int color_priority);
+	
 public:
 	Renderable(const Renderable&) = delete;
 	Renderable(Renderable&&) = delete;
@@ -254,10 +269,15 @@ public:
 /**
  * A high-level container for all renderables of a single object, 
  * grouped by color priority and common render attributes.
+ * 
+ * The container may keep renderables which were created for other renderable
+ * options (cf. Symbol::RenderableOptions), so that the object can switch
+ * between these options without creating the renderables again.
  */
 class ObjectRenderables : protected std::map<int, SharedRenderables::Pointer>
 {
 friend class MapRenderables;
+friend class PointPatternRenderable;
 public:
 	ObjectRenderables(Object& object);
 	ObjectRenderables(const ObjectRenderables&) = delete;
@@ -271,6 +291,36 @@ public:
 	void deleteRenderables();
 	void takeRenderables();
 	
+	/**
+	 * Returns the renderable options for which the current renderables were created.
+	 */
+	int renderableOptions() const;
+	
+	/**
+	 * Sets the renderable options for which the current renderables are created.
+	 */
+	void setRenderableOptions(int options);
+	
+	/**
+	 * Switches to the renderables for the given renderable options.
+	 * 
+	 * The current renderables are kept as the variant for the current options.
+	 * If there is a variant for the given options, it becomes the current
+	 * renderables, and this function returns true. Otherwise the current
+	 * renderables are left empty, and this function returns false.
+	 * 
+	 * The containers which are shared with MapRenderables are retained, only
+	 * their content is exchanged.
+	 */
+	bool switchVariant(int options);
+	
+	/**
+	 * Deletes the renderables which were kept for other renderable options.
+	 * 
+	 * This must be called when the object is modified.
+	 */
+	void deleteVariants();
+	
 	/**
 	 * Draws all renderables matching the given map color with the given color.
 	 * 
@@ -286,8 +336,16 @@ public:
 	const QRectF& getExtent() const;
 	
 private:
+	struct Variant
+	{
+		std::map<int, SharedRenderables::Pointer> renderables;
+		QRectF extent;
+	};
+	
 	QRectF& extent;
 	const QPainterPath* clip_path = nullptr; // no memory management here!
+	int renderable_options = 0;
+	std::map<int, Variant> variants;
 };
 
 
@@ -339,6 +397,10 @@ public:
 	/**
 	 * Draws the renderables in a spot color overprinting simulation.
 	 * 
+	 * The separations are drawn concurrently, on worker threads. The config
+	 * must carry all options which depend on the user's settings, such as
+	 * the text antialiasing set by RenderConfig::screenOptions().
+	 * 
 	 * @param painter Must be a QPainter on a QImage of Format_ARGB32_Premultiplied.
 	 * @param config  The rendering configuration
 	 */
@@ -364,12 +426,32 @@ public:
 	/* NOTE: does not delete the renderables, just removes them from display */
 	void removeRenderablesOfObject(const Object* object, bool mark_area_as_dirty);
 	
+	/**
+	 * Updates the spatial index after the extent of the object changed.
+	 * 
+	 * This is needed when the object's renderables were regenerated in place,
+	 * without being inserted again. It does nothing for objects which are not
+	 * in this container.
+	 */
+	void updateExtentOfObject(const Object* object);
+	
 	void clear(bool mark_area_as_dirty = false);
 	
 	inline bool empty() const;
 	
 private:
+	/**
+	 * Collects the objects of a color priority which may intersect the given rect.
+	 * 
+	 * The result is in the order of the ObjectRenderablesMap.
+	 */
+	void findObjects(const ObjectRenderablesMap& objects, int color_priority, const QRectF& rect,
+	                 std::vector<const ObjectRenderablesMap::value_type*>& result) const;
+	
 	Map* const map;
+	
+	/// Object extents per color priority, for culling when drawing
+	std::map<int, SpatialIndex<const Object*>> object_index;
 };
 
 
@@ -393,6 +475,13 @@ Renderable::Renderable(const MapColor* color)
 	; // nothing
 }
 
+inline
+Renderable::Renderable(int color_priority)
+ : color_priority(color_priority)
+{
+	; // nothing
+}
+
 inline
 const QRectF&Renderable::getExtent() const
 {
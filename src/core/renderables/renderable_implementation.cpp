@@ -20,8 +20,11 @@
 
 #include "renderable_implementation.h"
 
+#include <algorithm>
+#include <cmath>
 #include <cstddef>
 #include <iterator>
+#include <limits>
 #include <memory>
 #include <vector>
 
@@ -29,19 +32,21 @@
 #include <QtNumeric>
 #include <QFont>
 #include <QFontMetricsF>
+#include <QMutexLocker>
 #include <QPaintEngine>
 #include <QPainter>
 #include <QPen>
 #include <QPoint>
+#include <QPointF>
 #include <QTransform>
 // IWYU pragma: no_include <QVariant>
 
-#include "settings.h"
 #include "core/map_coord.h"
 #include "core/virtual_coord_vector.h"
 #include "core/virtual_path.h"
 #include "core/objects/object.h"
 #include "core/objects/text_object.h"
+#include "core/renderables/glyph_path_cache.h"
 #include "core/renderables/renderable.h"
 #include "core/symbols/area_symbol.h"
 #include "core/symbols/line_symbol.h"
@@ -85,6 +90,36 @@ inline void fixPenForPdf(QPen& pen, const QPainter& painter)
 #endif
 }
 
+/**
+ * Restricts the range [first, last] of indices i to those where the value
+ * start + i * step is inside [min, max].
+ * 
+ * The range is empty when last < first.
+ */
+void restrictRange(qreal start, qreal step, qreal min, qreal max, int& first, int& last)
+{
+	if (step == 0)
+	{
+		if (start < min || start > max)
+			last = first - 1;
+		return;
+	}
+	
+	auto t0 = (min - start) / step;
+	auto t1 = (max - start) / step;
+	if (t0 > t1)
+		std::swap(t0, t1);
+	if (t0 > last || t1 < first)
+	{
+		last = first - 1;
+		return;
+	}
+	if (t0 > first)
+		first = int(std::ceil(t0));
+	if (t1 < last)
+		last = int(std::floor(t1));
+}
+
 }  // namespace
 
 
@@ -594,6 +629,88 @@ void LineRenderable::render(QPainter &painter, const RenderConfig &config) const
 	painter.setPen(pen);*/
 }
 
+// ### LinePatternRenderable ###
+
+LinePatternRenderable::LinePatternRenderable(const LineSymbol* symbol, const QRectF& area, qreal angle, qreal offset, qreal spacing)
+ : Renderable(symbol->getColor())
+ , line_width(0.001 * symbol->getLineWidth())
+ , area(area)
+ , normal(std::sin(angle), std::cos(angle))
+ , offset(offset)
+ , spacing(spacing)
+{
+	Q_ASSERT(spacing > 0);
+	
+	qreal half_line_width = (color_priority < 0) ? 0 : line_width/2;
+	extent = area.adjusted(-half_line_width, -half_line_width, half_line_width, half_line_width);
+}
+
+PainterConfig LinePatternRenderable::getPainterConfig(const QPainterPath* clip_path) const
+{
+	return { color_priority, PainterConfig::PenOnly, line_width, clip_path };
+}
+
+void LinePatternRenderable::render(QPainter& painter, const RenderConfig& config) const
+{
+	// Like LineRenderable for single lines
+	QPen pen(painter.pen());
+	pen.setCapStyle(Qt::FlatCap);
+	pen.setJoinStyle(Qt::MiterJoin);
+	pen.setMiterLimit(LineSymbol::miterLimit());
+	fixPenForPdf(pen, painter);
+	painter.setPen(pen);
+	
+	// Lines are cut at a distance from the bounding box where the cut
+	// doesn't affect the visible output.
+	const auto box = area.intersected(config.bounding_box.adjusted(-line_width, -line_width, line_width, line_width));
+	if (box.isEmpty())
+		return;
+	
+	// The range of k where lines may cross the box
+	const auto values = {
+	    MapCoordF::dotProduct(normal, MapCoordF(box.topLeft())),
+	    MapCoordF::dotProduct(normal, MapCoordF(box.topRight())),
+	    MapCoordF::dotProduct(normal, MapCoordF(box.bottomLeft())),
+	    MapCoordF::dotProduct(normal, MapCoordF(box.bottomRight())),
+	};
+	const auto min_max = std::minmax(values);
+	const auto first = std::ceil((min_max.first - offset) / spacing);
+	const auto last = std::floor((min_max.second - offset) / spacing);
+	
+	const auto direction = MapCoordF(normal.y(), -normal.x());
+	for (auto k = first; k <= last; ++k)
+	{
+		const auto base = normal * (offset + k * spacing);
+		
+		// Clip the line to the box
+		auto t_min = std::numeric_limits<qreal>::lowest();
+		auto t_max = std::numeric_limits<qreal>::max();
+		if (direction.x() != 0)
+		{
+			auto t0 = (box.left() - base.x()) / direction.x();
+			auto t1 = (box.right() - base.x()) / direction.x();
+			t_min = std::max(t_min, std::min(t0, t1));
+			t_max = std::min(t_max, std::max(t0, t1));
+		}
+		if (direction.y() != 0)
+		{
+			auto t0 = (box.top() - base.y()) / direction.y();
+			auto t1 = (box.bottom() - base.y()) / direction.y();
+			t_min = std::max(t_min, std::min(t0, t1));
+			t_max = std::min(t_max, std::max(t0, t1));
+		}
+		if (t_min >= t_max)
+			continue;
+		
+		QPainterPath path;
+		path.moveTo(base + direction * t_min);
+		path.lineTo(base + direction * t_max);
+		painter.drawPath(path);
+	}
+}
+
+
+
 // ### AreaRenderable ###
 
 AreaRenderable::AreaRenderable(const AreaSymbol* symbol, const PathPartVector& path_parts)
@@ -688,6 +805,7 @@ TextRenderable::TextRenderable(const TextSymbol* symbol, const TextObject* text_
 	
 	const QFont& font(symbol->getQFont());
 	const QFontMetricsF& metrics(symbol->getFontMetrics());
+	auto& glyph_path_cache = GlyphPathCache::instance();
 	
 	int num_lines = text_object->getNumLines();
 	for (int i=0; i < num_lines; i++)
@@ -718,7 +836,7 @@ TextRenderable::TextRenderable(const TextSymbol* symbol, const TextObject* text_
 				}
 				underline_x0 = part.part_x;
 			}
-			path.addText(part.part_x, line_y, font, part.part_text);
+			glyph_path_cache.addText(path, part.part_x, line_y, font, part.part_text);
 		}
 	}
 	
@@ -749,8 +867,7 @@ void TextRenderable::render(QPainter &painter, const RenderConfig &config) const
 
 void TextRenderable::renderCommon(QPainter& painter, const RenderConfig& config) const
 {
-	bool disable_antialiasing = config.options.testFlag(RenderConfig::Screen) && !(Settings::getInstance().getSettingCached(Settings::MapDisplay_TextAntialiasing).toBool());
-	if (disable_antialiasing)
+	if (config.testFlag(RenderConfig::DisableTextAntialiasing))
 	{
 		painter.setRenderHint(QPainter::Antialiasing, false);
 		painter.setRenderHint(QPainter::TextAntialiasing, false);
@@ -793,4 +910,149 @@ void TextFramingRenderable::render(QPainter& painter, const RenderConfig& config
 }
 
 
+
+// ### PointPatternRenderable ###
+
+// static
+bool PointPatternRenderable::canStamp(const ObjectRenderables& prototype)
+{
+	return std::none_of(begin(prototype), end(prototype), [](const auto& color) {
+		return std::any_of(begin(*color.second), end(*color.second), [](const auto& config_renderables) {
+			return config_renderables.first.clip_path != nullptr;
+		});
+	});
+}
+
+// static
+void PointPatternRenderable::create(const ObjectRenderables& prototype, const std::shared_ptr<const Rows>& rows, ObjectRenderables& output)
+{
+	Q_ASSERT(canStamp(prototype));
+	if (rows->empty())
+		return;
+	
+	for (const auto& color : prototype)
+	{
+		for (const auto& config_renderables : *color.second)
+		{
+			if (!config_renderables.second.empty())
+				output.insertRenderable(new PointPatternRenderable(color.second, config_renderables, rows));
+		}
+	}
+}
+
+PointPatternRenderable::PointPatternRenderable(const SharedRenderables::Pointer& prototype, const SharedRenderables::value_type& config_renderables, const std::shared_ptr<const Rows>& rows)
+ : Renderable(config_renderables.first.color_priority)
+ , prototype(prototype)
+ , renderables(config_renderables.second)
+ , rows(rows)
+ , mode(config_renderables.first.mode)
+ , pen_width(config_renderables.first.pen_width)
+{
+	for (const auto renderable : renderables)
+		rectIncludeSafe(prototype_extent, renderable->getExtent());
+	
+	for (const auto& row : *rows)
+	{
+		auto const last = row.start + row.step * (row.count - 1);
+		rectIncludeSafe(extent, prototype_extent.translated(row.start));
+		rectIncludeSafe(extent, prototype_extent.translated(last));
+	}
+}
+
+PainterConfig PointPatternRenderable::getPainterConfig(const QPainterPath* clip_path) const
+{
+	return { color_priority, mode, pen_width, clip_path };
+}
+
+void PointPatternRenderable::render(QPainter& painter, const RenderConfig& config) const
+{
+	// The positions where the prototype may intersect the bounding box
+	const auto& box = config.bounding_box;
+	const auto area = QRectF(QPointF(box.left() - prototype_extent.right(), box.top() - prototype_extent.bottom()),
+	                         QPointF(box.right() - prototype_extent.left(), box.bottom() - prototype_extent.top()));
+	
+	const auto transform = painter.worldTransform();
+	const auto image_stamp = stamp(painter, config);
+	if (!image_stamp.image.isNull())
+		painter.setWorldTransform({});
+	
+	for (const auto& row : *rows)
+	{
+		auto first = 0;
+		auto last = row.count - 1;
+		restrictRange(row.start.x(), row.step.x(), area.left(), area.right(), first, last);
+		restrictRange(row.start.y(), row.step.y(), area.top(), area.bottom(), first, last);
+		for (auto i = first; i <= last; ++i)
+		{
+			const auto position = row.start + row.step * i;
+			if (!image_stamp.image.isNull())
+			{
+				painter.drawImage(transform.map(QPointF(position)).toPoint() + image_stamp.offset, image_stamp.image);
+				continue;
+			}
+			
+			painter.setWorldTransform(QTransform::fromTranslate(position.x(), position.y()) * transform);
+			
+			const RenderConfig local_config = { config.map, box.translated(-position), config.scaling, config.options, config.opacity };
+			for (const auto renderable : renderables)
+			{
+				if (renderable->intersects(local_config.bounding_box))
+					renderable->render(painter, local_config);
+			}
+		}
+	}
+	painter.setWorldTransform(transform);
+}
+
+PointPatternRenderable::Stamp PointPatternRenderable::stamp(const QPainter& painter, const RenderConfig& config) const
+{
+	// Larger stamps mean that only few positions are visible.
+	constexpr int max_stamp_size = 512;
+	
+	// Vector output must remain vector output, and overprinting simulation
+	// must compose each element with the background.
+	const auto transform = painter.worldTransform();
+	if (!painter.paintEngine()
+	    || painter.paintEngine()->type() != QPaintEngine::Raster
+	    || painter.compositionMode() != QPainter::CompositionMode_SourceOver
+	    || !transform.isAffine()
+	    || !prototype_extent.isValid())
+	{
+		return {};
+	}
+	
+	const auto linear = QTransform(transform.m11(), transform.m12(), transform.m21(), transform.m22(), 0, 0);
+	QMutexLocker locker(&stamp_mutex);
+	if (cached_stamp.linear == linear
+	    && cached_stamp.pen == painter.pen()
+	    && cached_stamp.brush == painter.brush()
+	    && qFuzzyCompare(cached_stamp.scaling, config.scaling)
+	    && cached_stamp.options == config.options)
+	{
+		return cached_stamp;
+	}
+	
+	// One pixel of margin for antialiasing
+	const auto rect = linear.mapRect(prototype_extent).toAlignedRect().adjusted(-1, -1, 1, 1);
+	auto image = QImage();
+	if (rect.width() <= max_stamp_size && rect.height() <= max_stamp_size)
+	{
+		image = QImage(rect.size(), QImage::Format_ARGB32_Premultiplied);
+		image.fill(Qt::transparent);
+		QPainter image_painter(&image);
+		image_painter.setRenderHints(painter.renderHints());
+		image_painter.setPen(painter.pen());
+		image_painter.setBrush(painter.brush());
+		image_painter.setWorldTransform(linear * QTransform::fromTranslate(-rect.left(), -rect.top()));
+		
+		const RenderConfig local_config = { config.map, prototype_extent, config.scaling, config.options, 1 };
+		for (const auto renderable : renderables)
+			renderable->render(image_painter, local_config);
+	}
+	
+	cached_stamp = { image, rect.topLeft(), linear, painter.pen(), painter.brush(), config.scaling, config.options };
+	return cached_stamp;
+}
+
+
 }  // namespace OpenOrienteering
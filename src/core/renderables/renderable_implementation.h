@@ -22,13 +22,23 @@
 #ifndef OPENORIENTEERING_RENDERABLE_IMPLENTATION_H
 #define OPENORIENTEERING_RENDERABLE_IMPLENTATION_H
 
+#include <memory>
+#include <vector>
+
 #include <Qt>
 #include <QtGlobal>
+#include <QBrush>
+#include <QImage>
+#include <QMutex>
 #include <QPainterPath>
+#include <QPen>
+#include <QPoint>
 #include <QPointF>
 #include <QRectF>
+#include <QTransform>
 
 #include "renderable.h"
+#include "core/map_coord.h"
 
 class QPainter;
 class QPointF;
@@ -38,7 +48,6 @@ namespace OpenOrienteering {
 class AreaSymbol;
 class LineSymbol;
 class MapColor;
-class MapCoordF;
 class PathPartVector;
 class PointSymbol;
 class TextObject;
@@ -88,6 +97,33 @@ protected:
 	Qt::PenJoinStyle join_style;
 };
 
+/**
+ * Renderable for displaying the lines of an area's line pattern.
+ * 
+ * Instead of a renderable for each single line, this renderable stores the
+ * parameters of the pattern and the area which is covered by the lines. When
+ * drawing, it generates only the lines which cross the visible part of the
+ * area. Thus memory usage does not depend on the number of lines.
+ * 
+ * The lines are the sets of points p where
+ * sin(angle) * p.x() + cos(angle) * p.y() == offset + k * spacing
+ * for any integer k.
+ */
+class LinePatternRenderable : public Renderable
+{
+public:
+	LinePatternRenderable(const LineSymbol* symbol, const QRectF& area, qreal angle, qreal offset, qreal spacing);
+	void render(QPainter& painter, const RenderConfig& config) const override;
+	PainterConfig getPainterConfig(const QPainterPath* clip_path = nullptr) const override;
+	
+protected:
+	const qreal line_width;
+	QRectF area;
+	MapCoordF normal;
+	qreal offset;
+	qreal spacing;
+};
+
 /** Renderable for displaying an area. */
 class AreaRenderable : public Renderable
 {
@@ -135,6 +171,88 @@ protected:
 	qreal framing_line_width;
 };
 
+/**
+ * A row of equidistant positions in a point pattern.
+ */
+struct PointPatternRow
+{
+	MapCoordF start;  ///< The first position
+	MapCoordF step;   ///< The offset from one position to the next
+	int count;        ///< The number of positions
+};
+
+/**
+ * Renderable for displaying the points of an area's point pattern.
+ * 
+ * Instead of a separate set of renderables for each single point, this
+ * renderable stores the positions as rows of the pattern lattice, together
+ * with a prototype rendering of the point symbol at the origin. When drawing,
+ * the prototype is stamped at each position which may affect the bounding box.
+ * Memory usage depends on the number of pattern rows, not on the number of
+ * points, and drawing a small part of a large area is cheap.
+ * 
+ * On raster paint devices, the prototype is rendered once into an image for
+ * the current transformation, pen and brush, and this image is drawn at each
+ * position. Other devices, e.g. for PDF, get the prototype's vector output at
+ * each position.
+ * 
+ * One renderable is created for each painter configuration of the prototype.
+ */
+class PointPatternRenderable : public Renderable
+{
+public:
+	using Rows = std::vector<PointPatternRow>;
+	
+	/**
+	 * Returns true if the prototype renderables can be stamped.
+	 * 
+	 * This is not the case if the prototype has its own clip paths.
+	 */
+	static bool canStamp(const ObjectRenderables& prototype);
+	
+	/**
+	 * Creates the renderables which stamp the prototype at the positions
+	 * of the given rows, and inserts them into the output.
+	 */
+	static void create(const ObjectRenderables& prototype, const std::shared_ptr<const Rows>& rows, ObjectRenderables& output);
+	
+	PainterConfig getPainterConfig(const QPainterPath* clip_path = nullptr) const override;
+	void render(QPainter& painter, const RenderConfig& config) const override;
+	
+protected:
+	PointPatternRenderable(const SharedRenderables::Pointer& prototype, const SharedRenderables::value_type& config_renderables, const std::shared_ptr<const Rows>& rows);
+	
+	/**
+	 * A raster image of the prototype.
+	 */
+	struct Stamp
+	{
+		QImage image;
+		QPoint offset;      ///< The position of the image relative to the origin, in device pixels
+		QTransform linear;  ///< The linear part of the world transform
+		QPen pen;
+		QBrush brush;
+		qreal scaling = 0;
+		RenderConfig::Options options;
+	};
+	
+	/**
+	 * Returns the raster image of the prototype for the painter's state.
+	 * 
+	 * Returns a null image if stamping images isn't suitable.
+	 */
+	Stamp stamp(const QPainter& painter, const RenderConfig& config) const;
+	
+	const SharedRenderables::Pointer prototype;  ///< Keeps the prototype renderables alive.
+	const RenderableVector& renderables;
+	const std::shared_ptr<const Rows> rows;
+	const PainterConfig::PainterMode mode;
+	const qreal pen_width;
+	QRectF prototype_extent;
+	mutable QMutex stamp_mutex;  ///< Renderables may be drawn concurrently.
+	mutable Stamp cached_stamp;
+};
+
 
 
 // ### AreaRenderable inline code ###
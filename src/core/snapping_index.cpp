@@ -0,0 +1,435 @@
+/*
+ *    Copyright 2018 The OpenOrienteering developers
+ *
+ *    This file is part of OpenOrienteering.
+ *
+ *    OpenOrienteering is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    OpenOrienteering is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with OpenOrienteering.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "snapping_index.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iterator>
+#include <utility>
+
+#include "core/virtual_path.h"
+#include "core/objects/object.h"
+
+
+namespace OpenOrienteering {
+
+SnappingIndex::SnappingIndex(qreal cell_size)
+: cell_size(cell_size)
+{
+	Q_ASSERT(cell_size > 0);
+}
+
+SnappingIndex::~SnappingIndex() = default;
+
+
+
+void SnappingIndex::clear()
+{
+	entries.clear();
+	free_slots.clear();
+	slots.clear();
+	invalidated.clear();
+	vertex_cells.clear();
+	segment_cells.clear();
+	min_x = min_y = 0;
+	max_x = max_y = -1;
+}
+
+std::size_t SnappingIndex::size() const
+{
+	return slots.size();
+}
+
+bool SnappingIndex::contains(const Object* object) const
+{
+	return slots.find(object) != slots.end();
+}
+
+
+void SnappingIndex::insert(const Object* object)
+{
+	remove(object);
+
+	auto const type = object->getType();
+	if (type != Object::Point && type != Object::Path)
+		return;
+
+	quint32 slot;
+	if (free_slots.empty())
+	{
+		slot = quint32(entries.size());
+		entries.emplace_back();
+	}
+	else
+	{
+		slot = free_slots.back();
+		free_slots.pop_back();
+	}
+	slots.emplace(object, slot);
+
+	auto& entry = entries[slot];
+	entry.object = object;
+
+	// Vertices, cf. PathObject::calcClosestCoordinate()
+	auto const& coords = object->getRawCoordinateVector();
+	for (quint32 i = 0; i < coords.size(); ++i)
+	{
+		addVertex(slot, i, MapCoordF(coords[i]), entry.vertex_keys);
+		if (coords[i].isCurveStart())
+			i += 2;
+	}
+
+	// Segments, cf. VirtualPath::findClosestPointTo()
+	if (type == Object::Path)
+	{
+		quint32 offset = 0;
+		for (auto const& part : object->asPath()->parts())
+		{
+			entry.part_offsets.push_back(offset);
+			auto const& path_coords = part.path_coords;
+			auto const size = quint32(path_coords.size());
+			for (quint32 i = 0; i < size; ++i)
+			{
+				// The last path coord of a part is registered as a segment of zero length.
+				auto const next = std::min(i + 1, size - 1);
+				addSegment(slot, offset + i, path_coords[i].pos, path_coords[next].pos, entry.segment_keys);
+			}
+			offset += size;
+		}
+	}
+
+	for (auto* keys : { &entry.vertex_keys, &entry.segment_keys })
+	{
+		std::sort(begin(*keys), end(*keys));
+		keys->erase(std::unique(begin(*keys), end(*keys)), end(*keys));
+		keys->shrink_to_fit();
+	}
+}
+
+bool SnappingIndex::remove(const Object* object)
+{
+	auto found = slots.find(object);
+	if (found == slots.end())
+		return false;
+
+	auto const slot = found->second;
+	auto& entry = entries[slot];
+	removeFrom(vertex_cells, entry.vertex_keys, slot);
+	removeFrom(segment_cells, entry.segment_keys, slot);
+	entry = {};
+
+	free_slots.push_back(slot);
+	slots.erase(found);
+	return true;
+}
+
+
+void SnappingIndex::invalidate(const Object* object)
+{
+	invalidated.insert(object);
+}
+
+bool SnappingIndex::needsUpdate() const
+{
+	return !invalidated.empty();
+}
+
+void SnappingIndex::update(const std::function<bool (const Object*)>& is_alive)
+{
+	auto objects = std::unordered_set<const Object*>{};
+	objects.swap(invalidated);
+
+	// Remove all objects first: The address of a deleted object
+	// may have been reused for a new object.
+	for (auto object : objects)
+		remove(object);
+	for (auto object : objects)
+	{
+		if (is_alive(object))
+			insert(object);
+	}
+	for (auto object : objects)
+		invalidated.erase(object);
+}
+
+
+
+template <class Function>
+void SnappingIndex::visitCells(const CellMap& cells, MapCoordF pos, qreal max_distance, Function&& function) const
+{
+	if (cells.empty())
+		return;
+
+	auto const cx = qint64(cellIndex(pos.x()));
+	auto const cy = qint64(cellIndex(pos.y()));
+	auto bound = max_distance;
+
+	auto visit = [&](qint64 x, qint64 y) {
+		if (x < min_x || x > max_x || y < min_y || y > max_y)
+			return;
+		auto cell = cells.find(key(qint32(x), qint32(y)));
+		if (cell != cells.end())
+			bound = std::min(bound, qreal(function(cell->second)));
+	};
+
+	for (qint64 r = 0; ; ++r)
+	{
+		// The cells of ring r are at least (r - 1) cells away from pos.
+		if (r > 0 && (r - 1) * cell_size > bound)
+			break;
+		// Stop when the ring is outside the bounds of all cells.
+		if (cx - r < min_x && cx + r > max_x && cy - r < min_y && cy + r > max_y)
+			break;
+
+		if (r == 0)
+		{
+			visit(cx, cy);
+			continue;
+		}
+		for (auto x = cx - r; x <= cx + r; ++x)
+		{
+			visit(x, cy - r);
+			visit(x, cy + r);
+		}
+		for (auto y = cy - r + 1; y < cy + r; ++y)
+		{
+			visit(cx - r, y);
+			visit(cx + r, y);
+		}
+	}
+}
+
+
+bool SnappingIndex::findClosestVertex(MapCoordF pos, qreal max_distance, const Filter& filter, Vertex& out) const
+{
+	auto const vertices = findNearestVertices(pos, 1, max_distance, filter);
+	if (vertices.empty())
+		return false;
+
+	out = vertices.front();
+	return true;
+}
+
+std::vector<SnappingIndex::Vertex> SnappingIndex::findNearestVertices(MapCoordF pos, std::size_t k, qreal max_distance, const Filter& filter) const
+{
+	std::vector<Vertex> result;
+	if (k == 0)
+		return result;
+
+	result.reserve(std::min(k, std::size_t(64)));
+	auto const max_distance_sq = float(max_distance * max_distance);
+	auto const by_distance = [](const Vertex& a, const Vertex& b) { return a.distance_sq < b.distance_sq; };
+
+	visitCells(vertex_cells, pos, max_distance, [&](const Cell& cell) -> qreal {
+		for (auto const& ref : cell)
+		{
+			auto const& entry = entries[ref.slot];
+			auto const vertex_pos = MapCoordF(entry.object->getRawCoordinateVector()[ref.item]);
+			auto const distance_sq = float(vertex_pos.distanceSquaredTo(pos));
+			if (distance_sq >= max_distance_sq
+			    || (result.size() == k && distance_sq >= result.back().distance_sq)
+			    || (filter && !filter(entry.object)))
+				continue;
+
+			auto const vertex = Vertex { entry.object, ref.item, vertex_pos, distance_sq };
+			result.insert(std::upper_bound(begin(result), end(result), vertex, by_distance), vertex);
+			if (result.size() > k)
+				result.pop_back();
+		}
+		return result.size() == k ? std::sqrt(qreal(result.back().distance_sq)) : max_distance;
+	});
+
+	return result;
+}
+
+bool SnappingIndex::findClosestPathPoint(MapCoordF pos, qreal max_distance, const Filter& filter, PathPoint& out) const
+{
+	auto bound_sq = float(max_distance * max_distance);
+	auto found = false;
+
+	visitCells(segment_cells, pos, max_distance, [&](const Cell& cell) -> qreal {
+		for (auto const& ref : cell)
+		{
+			auto const& entry = entries[ref.slot];
+			float distance_sq;
+			auto const path_coord = closestPathCoord(entry, ref.item, pos, distance_sq);
+			if (distance_sq < bound_sq && (!filter || filter(entry.object)))
+			{
+				bound_sq = distance_sq;
+				out = { entry.object, path_coord, distance_sq };
+				found = true;
+			}
+		}
+		return std::sqrt(qreal(bound_sq));
+	});
+
+	return found;
+}
+
+
+
+// static
+quint64 SnappingIndex::key(qint32 x, qint32 y)
+{
+	return (quint64(quint32(x)) << 32) | quint64(quint32(y));
+}
+
+qint32 SnappingIndex::cellIndex(qreal value) const
+{
+	constexpr qreal limit = 1 << 30;
+	return qint32(qBound(-limit, std::floor(value / cell_size), limit));
+}
+
+void SnappingIndex::includeCell(qint32 x, qint32 y)
+{
+	if (max_x < min_x)
+	{
+		min_x = max_x = x;
+		min_y = max_y = y;
+		return;
+	}
+	min_x = std::min(min_x, x);
+	max_x = std::max(max_x, x);
+	min_y = std::min(min_y, y);
+	max_y = std::max(max_y, y);
+}
+
+void SnappingIndex::addVertex(quint32 slot, quint32 item, MapCoordF pos, std::vector<quint64>& keys)
+{
+	auto const x = cellIndex(pos.x());
+	auto const y = cellIndex(pos.y());
+	includeCell(x, y);
+
+	auto const cell_key = key(x, y);
+	vertex_cells[cell_key].push_back({ slot, item });
+	if (keys.empty() || keys.back() != cell_key)
+		keys.push_back(cell_key);
+}
+
+void SnappingIndex::addSegment(quint32 slot, quint32 item, MapCoordF start, MapCoordF end, std::vector<quint64>& keys)
+{
+	// Long segments are registered in the cells along the segment,
+	// in steps of at most one cell in each direction.
+	auto const delta = end - start;
+	auto const steps = std::max(1, int(std::ceil(delta.length() / cell_size)));
+	for (int i = 0; i < steps; ++i)
+	{
+		auto const p0 = start + delta * (qreal(i) / steps);
+		auto const p1 = start + delta * (qreal(i + 1) / steps);
+		auto const left   = cellIndex(std::min(p0.x(), p1.x()));
+		auto const right  = cellIndex(std::max(p0.x(), p1.x()));
+		auto const top    = cellIndex(std::min(p0.y(), p1.y()));
+		auto const bottom = cellIndex(std::max(p0.y(), p1.y()));
+		includeCell(left, top);
+		includeCell(right, bottom);
+		for (auto y = top; y <= bottom; ++y)
+		{
+			for (auto x = left; x <= right; ++x)
+			{
+				auto const cell_key = key(x, y);
+				auto& cell = segment_cells[cell_key];
+				// Adjacent steps may touch the same cell.
+				if (!cell.empty() && cell.back().slot == slot && cell.back().item == item)
+					continue;
+				cell.push_back({ slot, item });
+				keys.push_back(cell_key);
+			}
+		}
+	}
+}
+
+// static
+void SnappingIndex::removeFrom(CellMap& cells, const std::vector<quint64>& keys, quint32 slot)
+{
+	for (auto cell_key : keys)
+	{
+		auto cell = cells.find(cell_key);
+		Q_ASSERT(cell != cells.end());
+		auto& refs = cell->second;
+		refs.erase(std::remove_if(begin(refs), end(refs), [slot](const ItemRef& ref) { return ref.slot == slot; }), end(refs));
+		if (refs.empty())
+			cells.erase(cell);
+	}
+}
+
+
+PathCoord SnappingIndex::closestPathCoord(const Entry& entry, quint32 item, MapCoordF pos, float& distance_sq) const
+{
+	auto const& parts = entry.object->asPath()->parts();
+	auto const part_index = std::size_t(std::distance(begin(entry.part_offsets),
+	                                                  std::upper_bound(begin(entry.part_offsets), end(entry.part_offsets), item)) - 1);
+	auto const& part = parts[part_index];
+	auto const& path_coords = part.path_coords;
+	auto const i = std::size_t(item - entry.part_offsets[part_index]);
+
+	// Same calculations as in VirtualPath::findClosestPointTo(), for a single edge
+	auto const& pc = path_coords[i];
+	auto result = pc;
+	auto to_coord = pos - pc.pos;
+	distance_sq = float(to_coord.lengthSquared());
+	if (i + 1 >= path_coords.size())
+		return result;
+
+	auto const& next_pc = path_coords[i + 1];
+	float line_length = next_pc.clen - pc.clen;
+	if (line_length <= 0)
+		return result;
+
+	auto tangent = next_pc.pos - pc.pos;
+	tangent.normalize();
+
+	float dist_along_line = MapCoordF::dotProduct(to_coord, tangent);
+	if (dist_along_line <= 0)
+		return result;
+
+	if (dist_along_line >= line_length)
+	{
+		distance_sq = float(pos.distanceSquaredTo(next_pc.pos));
+		return next_pc;
+	}
+
+	auto right = tangent.perpRight();
+	float dist_from_line = MapCoordF::dotProduct(right, to_coord);
+	distance_sq = dist_from_line * dist_from_line;
+	result.clen = pc.clen + dist_along_line;
+	result.index = pc.index;
+	auto factor = dist_along_line / line_length;
+	if (next_pc.index == pc.index)
+		result.param = pc.param + (next_pc.param - pc.param) * factor;
+	else
+		result.param = pc.param + (1.0 - pc.param) * factor;
+
+	auto const& flags = part.coords.flags;
+	if (flags[result.index].isCurveStart())
+	{
+		MapCoordF unused;
+		PathCoord::splitBezierCurve(MapCoordF(flags[result.index]), MapCoordF(flags[result.index+1]),
+		                            MapCoordF(flags[result.index+2]), MapCoordF(flags[result.index+3]),
+		                            result.param, unused, unused, result.pos, unused, unused);
+	}
+	else
+	{
+		result.pos = pc.pos + (next_pc.pos - pc.pos) * factor;
+	}
+	return result;
+}
+
+
+}  // namespace OpenOrienteering
@@ -0,0 +1,228 @@
+/*
+ *    Copyright 2018 The OpenOrienteering developers
+ *
+ *    This file is part of OpenOrienteering.
+ *
+ *    OpenOrienteering is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    OpenOrienteering is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with OpenOrienteering.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef OPENORIENTEERING_SNAPPING_INDEX_H
+#define OPENORIENTEERING_SNAPPING_INDEX_H
+
+#include <cstddef>
+#include <functional>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include <QtGlobal>
+
+#include "core/map_coord.h"
+#include "core/path_coord.h"
+
+namespace OpenOrienteering {
+
+class Object;
+
+
+/**
+ * An index of the vertices and path segments of objects, for snapping.
+ *
+ * The index is a sparse uniform grid, like SpatialIndex, but it registers
+ * the individual vertices and segments of the objects instead of the
+ * objects' extents. Thus the cost of a query depends on the number of
+ * vertices and segments near the query position, not on the size of the
+ * objects.
+ *
+ * Vertices are the coordinates of point objects, and the coordinates of
+ * path objects without curve handles, cf. PathObject::calcClosestCoordinate().
+ * Segments are the edges between consecutive flattened path coords of path
+ * parts, cf. PathObject::calcClosestPointOnPath(). Text objects are not
+ * indexed.
+ *
+ * Objects are identified by their address only. invalidate() marks an object
+ * for update, without accessing it. update() removes all invalidated objects
+ * from the index, and re-registers those which are reported as alive.
+ */
+class SnappingIndex
+{
+public:
+	/** The objects accepted by a query. */
+	using Filter = std::function<bool (const Object*)>;
+
+	/** A vertex found by a query. */
+	struct Vertex
+	{
+		const Object* object;
+		MapCoordVector::size_type coord_index;
+		MapCoordF pos;
+		float distance_sq;
+	};
+
+	/** A point on a path found by a query. */
+	struct PathPoint
+	{
+		const Object* object;
+		PathCoord path_coord;
+		float distance_sq;
+	};
+
+
+	/**
+	 * Constructs an empty index.
+	 *
+	 * The cell size is given in map units (millimeters).
+	 */
+	explicit SnappingIndex(qreal cell_size = 4.0);
+
+	SnappingIndex(const SnappingIndex&) = delete;
+	SnappingIndex& operator=(const SnappingIndex&) = delete;
+
+	~SnappingIndex();
+
+
+	/**
+	 * Removes all objects from the index.
+	 */
+	void clear();
+
+	/**
+	 * Returns the number of objects in the index.
+	 */
+	std::size_t size() const;
+
+	/**
+	 * Returns true if the object is registered in the index.
+	 */
+	bool contains(const Object* object) const;
+
+	/**
+	 * Registers the vertices and segments of the object.
+	 *
+	 * If the object is already registered, its entries are replaced.
+	 * The object's output must be up to date.
+	 */
+	void insert(const Object* object);
+
+	/**
+	 * Removes the object from the index, without accessing it.
+	 *
+	 * Returns false if the object was not registered.
+	 */
+	bool remove(const Object* object);
+
+	/**
+	 * Marks the object as changed or deleted, without accessing it.
+	 */
+	void invalidate(const Object* object);
+
+	/**
+	 * Returns true if there are invalidated objects.
+	 */
+	bool needsUpdate() const;
+
+	/**
+	 * Removes all invalidated objects, and registers them again if
+	 * is_alive returns true for them.
+	 *
+	 * is_alive may bring the object's output up to date. Invalidations of
+	 * the given object during this call are ignored.
+	 */
+	void update(const std::function<bool (const Object*)>& is_alive);
+
+
+	/**
+	 * Finds the vertex which is closest to the given position.
+	 *
+	 * Only vertices with a distance less than max_distance are considered.
+	 * Returns false if no such vertex is found.
+	 */
+	bool findClosestVertex(MapCoordF pos, qreal max_distance, const Filter& filter, Vertex& out) const;
+
+	/**
+	 * Finds the up to k vertices which are closest to the given position.
+	 *
+	 * Only vertices with a distance less than max_distance are considered.
+	 * The result is sorted by distance.
+	 */
+	std::vector<Vertex> findNearestVertices(MapCoordF pos, std::size_t k, qreal max_distance, const Filter& filter) const;
+
+	/**
+	 * Finds the point on a path which is closest to the given position.
+	 *
+	 * Only points with a distance less than max_distance are considered.
+	 * Returns false if no such point is found. The result is the same as from
+	 * PathObject::calcClosestPointOnPath() for the object found.
+	 */
+	bool findClosestPathPoint(MapCoordF pos, qreal max_distance, const Filter& filter, PathPoint& out) const;
+
+
+private:
+	/** A reference to an item of a registered object. */
+	struct ItemRef
+	{
+		quint32 slot;  ///< The index of the object's entry
+		quint32 item;  ///< The coord index (vertices), or the flat path coord index (segments)
+	};
+
+	using Cell = std::vector<ItemRef>;
+	using CellMap = std::unordered_map<quint64, Cell>;
+
+	struct Entry
+	{
+		const Object* object = nullptr;
+		std::vector<quint64> vertex_keys;      ///< The cells with vertices of the object
+		std::vector<quint64> segment_keys;     ///< The cells with segments of the object
+		std::vector<quint32> part_offsets;     ///< The flat index of each part's first path coord
+	};
+
+	static quint64 key(qint32 x, qint32 y);
+
+	qint32 cellIndex(qreal value) const;
+
+	void includeCell(qint32 x, qint32 y);
+
+	void addVertex(quint32 slot, quint32 item, MapCoordF pos, std::vector<quint64>& keys);
+
+	void addSegment(quint32 slot, quint32 item, MapCoordF start, MapCoordF end, std::vector<quint64>& keys);
+
+	static void removeFrom(CellMap& cells, const std::vector<quint64>& keys, quint32 slot);
+
+	/**
+	 * Visits the cells around pos in rings of growing distance.
+	 *
+	 * The function is called for each cell, and it returns the current
+	 * distance bound. Visiting stops when no cell within this bound and
+	 * within max_distance is left.
+	 */
+	template <class Function>
+	void visitCells(const CellMap& cells, MapCoordF pos, qreal max_distance, Function&& function) const;
+
+	PathCoord closestPathCoord(const Entry& entry, quint32 item, MapCoordF pos, float& distance_sq) const;
+
+
+	qreal cell_size;
+	std::vector<Entry> entries;
+	std::vector<quint32> free_slots;
+	std::unordered_map<const Object*, quint32> slots;
+	std::unordered_set<const Object*> invalidated;
+	CellMap vertex_cells;
+	CellMap segment_cells;
+	qint32 min_x = 0, min_y = 0, max_x = -1, max_y = -1;  ///< Bounds of all cells ever used
+};
+
+
+}  // namespace OpenOrienteering
+
+#endif
@@ -0,0 +1,385 @@
+/*
+ *    Copyright 2018 The OpenOrienteering developers
+ *
+ *    This file is part of OpenOrienteering.
+ *
+ *    OpenOrienteering is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    OpenOrienteering is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with OpenOrienteering.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef OPENORIENTEERING_SPATIAL_INDEX_H
+#define OPENORIENTEERING_SPATIAL_INDEX_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <unordered_map>
+#include <vector>
+
+#include <QtGlobal>
+#include <QRectF>
+
+// IWYU pragma: no_forward_declare QRectF
+
+namespace OpenOrienteering {
+
+
+/**
+ * A spatial index for items with rectangular extents.
+ *
+ * The index is a sparse uniform grid. Each item is registered in all grid
+ * cells which are touched by its extent. Queries visit only the cells which
+ * are touched by the query rectangle, so the cost of a query depends on the
+ * number of items near the query rectangle, not on the total number of items.
+ *
+ * Items which would occupy too many cells, and items without a usable extent
+ * (i.e. a null or negative size rectangle), are kept in a separate list which
+ * is visited by every query. For items without a usable extent, queries cannot
+ * make any spatial decision. Such items are always reported, and it is up to
+ * the caller to apply the precise test.
+ *
+ * Item type T must be usable as key in a std::unordered_map.
+ * Typically, it is a pointer type.
+ */
+template <class T>
+class SpatialIndex
+{
+public:
+	/**
+	 * Constructs an empty index.
+	 *
+	 * The cell size is given in map units (millimeters).
+	 */
+	explicit SpatialIndex(qreal cell_size = 10.0);
+
+	/**
+	 * Removes all items from the index.
+	 */
+	void clear();
+
+	/**
+	 * Returns the number of items in the index.
+	 */
+	std::size_t size() const;
+
+	/**
+	 * Returns true if the item is registered in the index.
+	 */
+	bool contains(T item) const;
+
+	/**
+	 * Returns the extent which is registered for the given item.
+	 *
+	 * Returns an invalid rectangle if the item isn't registered.
+	 */
+	QRectF extent(T item) const;
+
+	/**
+	 * Registers the item with the given extent.
+	 *
+	 * If the item is already registered, its entry is replaced.
+	 */
+	void insert(T item, const QRectF& extent);
+
+	/**
+	 * Removes the item from the index.
+	 *
+	 * Returns false if the item was not registered.
+	 */
+	bool remove(T item);
+
+	/**
+	 * Calls the given function once for each item whose registered extent
+	 * intersects (or touches) the given rectangle.
+	 *
+	 * The rectangle must be normalized. Items without usable extent are always
+	 * passed to the function. The function must not modify the index.
+	 */
+	template <class Function>
+	void query(const QRectF& rect, Function&& function) const;
+
+	/**
+	 * Calls the given function once for each item in the index.
+	 *
+	 * The function must not modify the index.
+	 */
+	template <class Function>
+	void forEach(Function&& function) const;
+
+
+private:
+	/**
+	 * Items touching more cells than this are kept in the list of big items.
+	 */
+	static constexpr int max_cells_per_item = 64;
+
+	struct CellRange
+	{
+		qint32 left;
+		qint32 top;
+		qint32 right;
+		qint32 bottom;
+
+		qint64 count() const { return qint64(right - left + 1) * qint64(bottom - top + 1); }
+	};
+
+	struct Entry
+	{
+		QRectF extent;
+		CellRange cells;
+		std::size_t big_index;  ///< The position in big_items, if is_big
+		bool is_big;
+	};
+
+	using Cell = std::vector<T>;
+
+	static bool isLocated(const QRectF& extent);
+
+	static bool touches(const QRectF& a, const QRectF& b);
+
+	static quint64 key(qint32 x, qint32 y);
+
+	qint32 cellIndex(qreal value) const;
+
+	CellRange cellRange(const QRectF& rect) const;
+
+	static void removeFrom(std::vector<T>& list, T item);
+
+	void removeBigItem(const Entry& entry);
+
+
+	qreal cell_size;
+	std::unordered_map<T, Entry> entries;
+	std::unordered_map<quint64, Cell> cells;
+	std::vector<T> big_items;
+};
+
+
+
+// ### SpatialIndex template code ###
+
+template <class T>
+SpatialIndex<T>::SpatialIndex(qreal cell_size)
+: cell_size(cell_size)
+{
+	Q_ASSERT(cell_size > 0);
+}
+
+template <class T>
+void SpatialIndex<T>::clear()
+{
+	entries.clear();
+	cells.clear();
+	big_items.clear();
+}
+
+template <class T>
+std::size_t SpatialIndex<T>::size() const
+{
+	return entries.size();
+}
+
+template <class T>
+bool SpatialIndex<T>::contains(T item) const
+{
+	return entries.find(item) != entries.end();
+}
+
+template <class T>
+QRectF SpatialIndex<T>::extent(T item) const
+{
+	auto entry = entries.find(item);
+	return entry == entries.end() ? QRectF{} : entry->second.extent;
+}
+
+template <class T>
+void SpatialIndex<T>::insert(T item, const QRectF& extent)
+{
+	remove(item);
+
+	auto& entry = entries[item];
+	entry.extent = extent;
+	entry.is_big = !isLocated(extent);
+	if (!entry.is_big)
+	{
+		entry.cells = cellRange(extent);
+		entry.is_big = entry.cells.count() > max_cells_per_item;
+	}
+
+	if (entry.is_big)
+	{
+		entry.big_index = big_items.size();
+		big_items.push_back(item);
+		return;
+	}
+
+	for (auto y = entry.cells.top; y <= entry.cells.bottom; ++y)
+	{
+		for (auto x = entry.cells.left; x <= entry.cells.right; ++x)
+			cells[key(x, y)].push_back(item);
+	}
+}
+
+template <class T>
+bool SpatialIndex<T>::remove(T item)
+{
+	auto entry = entries.find(item);
+	if (entry == entries.end())
+		return false;
+
+	if (entry->second.is_big)
+	{
+		removeBigItem(entry->second);
+	}
+	else
+	{
+		auto const& range = entry->second.cells;
+		for (auto y = range.top; y <= range.bottom; ++y)
+		{
+			for (auto x = range.left; x <= range.right; ++x)
+			{
+				auto cell = cells.find(key(x, y));
+				Q_ASSERT(cell != cells.end());
+				removeFrom(cell->second, item);
+				if (cell->second.empty())
+					cells.erase(cell);
+			}
+		}
+	}
+
+	entries.erase(entry);
+	return true;
+}
+
+template <class T>
+template <class Function>
+void SpatialIndex<T>::query(const QRectF& rect, Function&& function) const
+{
+	for (auto item : big_items)
+	{
+		auto const& extent = entries.at(item).extent;
+		if (!isLocated(extent) || touches(extent, rect))
+			function(item);
+	}
+
+	auto const range = cellRange(rect);
+	if (range.count() > qint64(entries.size()))
+	{
+		// The query covers more cells than there are items.
+		// Visiting the items directly is cheaper.
+		for (auto const& entry : entries)
+		{
+			if (!entry.second.is_big && touches(entry.second.extent, rect))
+				function(entry.first);
+		}
+		return;
+	}
+
+	for (auto y = range.top; y <= range.bottom; ++y)
+	{
+		for (auto x = range.left; x <= range.right; ++x)
+		{
+			auto cell = cells.find(key(x, y));
+			if (cell == cells.end())
+				continue;
+
+			for (auto item : cell->second)
+			{
+				// An item which spans multiple cells is reported only from
+				// the first cell which is shared by the item and the query.
+				auto const& entry = entries.at(item);
+				if (x == std::max(entry.cells.left, range.left)
+				    && y == std::max(entry.cells.top, range.top)
+				    && touches(entry.extent, rect))
+				{
+					function(item);
+				}
+			}
+		}
+	}
+}
+
+template <class T>
+template <class Function>
+void SpatialIndex<T>::forEach(Function&& function) const
+{
+	for (auto const& entry : entries)
+		function(entry.first);
+}
+
+// static
+template <class T>
+bool SpatialIndex<T>::isLocated(const QRectF& extent)
+{
+	// Zero width or height is fine, e.g. for straight lines without width.
+	return !extent.isNull() && extent.width() >= 0 && extent.height() >= 0;
+}
+
+// static
+template <class T>
+bool SpatialIndex<T>::touches(const QRectF& a, const QRectF& b)
+{
+	// Unlike QRectF::intersects, this accepts rectangles of zero width
+	// or height, and rectangles which share just an edge.
+	return a.left() <= b.right() && b.left() <= a.right()
+	       && a.top() <= b.bottom() && b.top() <= a.bottom();
+}
+
+// static
+template <class T>
+quint64 SpatialIndex<T>::key(qint32 x, qint32 y)
+{
+	return (quint64(quint32(x)) << 32) | quint64(quint32(y));
+}
+
+template <class T>
+qint32 SpatialIndex<T>::cellIndex(qreal value) const
+{
+	constexpr qreal limit = 1 << 30;
+	return qint32(qBound(-limit, std::floor(value / cell_size), limit));
+}
+
+template <class T>
+typename SpatialIndex<T>::CellRange SpatialIndex<T>::cellRange(const QRectF& rect) const
+{
+	return { cellIndex(rect.left()), cellIndex(rect.top()), cellIndex(rect.right()), cellIndex(rect.bottom()) };
+}
+
+template <class T>
+void SpatialIndex<T>::removeBigItem(const Entry& entry)
+{
+	// Big items may be numerous, e.g. objects without extent after loading.
+	auto const last = big_items.back();
+	big_items[entry.big_index] = last;
+	entries.at(last).big_index = entry.big_index;
+	big_items.pop_back();
+}
+
+// static
+template <class T>
+void SpatialIndex<T>::removeFrom(std::vector<T>& list, T item)
+{
+	// The cells are small, so a linear scan is fine.
+	auto found = std::find(begin(list), end(list), item);
+	if (found != end(list))
+	{
+		*found = list.back();
+		list.pop_back();
+	}
+}
+
+
+}  // namespace OpenOrienteering
+
+#endif
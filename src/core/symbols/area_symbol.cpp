@@ -282,21 +282,6 @@ const MapColor* AreaSymbol::FillPattern::guessDominantColor() const
 
 
 
-template <>
-inline
-void AreaSymbol::FillPattern::createLine<AreaSymbol::FillPattern::LinePattern>(
-        MapCoordF first, MapCoordF second,
-        qreal,
-        LineSymbol* line,
-        float,
-        const AreaRenderable&,
-        ObjectRenderables& output ) const
-{
-	// out of inlining
-	output.insertRenderable(new LineRenderable(line, first, second));
-}
-
-
 template <>
 inline
 void AreaSymbol::FillPattern::createLine<AreaSymbol::FillPattern::PointPattern>(
@@ -305,19 +290,18 @@ void AreaSymbol::FillPattern::createLine<AreaSymbol::FillPattern::PointPattern>(
         LineSymbol*,
         float rotation,
         const AreaRenderable& outline,
+        std::vector<PointPatternRow>* rows,
         ObjectRenderables& output ) const
 {
 	// out of inlining
-	createPointPatternLine(first, second, delta_offset, rotation, outline, output);
+	createPointPatternLine(first, second, delta_offset, rotation, outline, rows, output);
 }
 
 
-// This template will be instantiated in non-template createRenderables()
-// once for each type of pattern, thus duplicating the complex body.
-// This is by intention, in order to let the compiler optimize each
-// instantiation independently, with regard to unused parameters in
-// createLine(), and to eliminate any runtime checks for pattern type
-// outside of non-template createRenderables().
+// This template is instantiated in non-template createRenderables()
+// for point patterns. (Line patterns are generated when drawing, by a
+// single LinePatternRenderable.) Keeping the loops in a template lets
+// the compiler optimize away unused parameters in createLine().
 template <int T>
 void AreaSymbol::FillPattern::createRenderables(
         const AreaRenderable& outline,
@@ -326,6 +310,7 @@ void AreaSymbol::FillPattern::createRenderables(
         const QRectF& point_extent,
         LineSymbol* line,
         qreal rotation,
+        std::vector<PointPatternRow>* rows,
         ObjectRenderables& output ) const
 {
 	auto extent = outline.getExtent();
@@ -362,7 +347,7 @@ void AreaSymbol::FillPattern::createRenderables(
 		{
 			first = MapCoordF(cur, extent.top());
 			second = MapCoordF(cur, extent.bottom());
-			createLine<T>(first, second, delta_along_line_offset, line, delta_rotation, outline, output);
+			createLine<T>(first, second, delta_along_line_offset, line, delta_rotation, outline, rows, output);
 		}
 	}
 	else if (qAbs(rotation - 0) < 0.0001)
@@ -373,7 +358,7 @@ void AreaSymbol::FillPattern::createRenderables(
 		{
 			first = MapCoordF(extent.left(), cur);
 			second = MapCoordF(extent.right(), cur);
-			createLine<T>(first, second, delta_along_line_offset, line, delta_rotation, outline, output);
+			createLine<T>(first, second, delta_along_line_offset, line, delta_rotation, outline, rows, output);
 		}
 	}
 	else
@@ -420,7 +405,7 @@ void AreaSymbol::FillPattern::createRenderables(
 				// Create the renderable(s)
 				first = MapCoordF(start_x, start_y);
 				second = MapCoordF(end_x, end_y);
-				createLine<T>(first, second, delta_along_line_offset, line, delta_rotation, outline, output);
+				createLine<T>(first, second, delta_along_line_offset, line, delta_rotation, outline, rows, output);
 				
 				// Move to next position
 				start_x += dist_x;
@@ -457,7 +442,7 @@ void AreaSymbol::FillPattern::createRenderables(
 				// Create the renderable(s)
 				first = MapCoordF(start_x, start_y);
 				second = MapCoordF(end_x, end_y);
-				createLine<T>(first, second, delta_along_line_offset, line, delta_rotation, outline, output);
+				createLine<T>(first, second, delta_along_line_offset, line, delta_rotation, outline, rows, output);
 				
 				// Move to next position
 				start_x += dist_x;
@@ -501,8 +486,18 @@ void AreaSymbol::FillPattern::createRenderables(const AreaRenderable& outline, f
 			line.setLineWidth(line_width_f);
 			
 			auto margin = line_width_f / 2;
-			auto point_extent = QRectF{-margin, -margin, margin, margin};
-			createRenderables<LinePattern>(outline, delta_rotation, pattern_origin, point_extent, &line, rotation, output);
+			
+			// A single renderable generates the visible lines when drawing.
+			auto area = outline.getExtent();
+			area.adjust(-margin, -margin, margin, margin);
+			if (qAbs(rotation - M_PI/2) < 0.0001)
+				rotation = M_PI/2;
+			else if (qAbs(rotation - 0) < 0.0001)
+				rotation = 0;
+			auto offset = 0.001 * line_offset;
+			if (rotatable())
+				offset += MapCoordF::dotProduct(MapCoordF(sin(rotation), cos(rotation)), MapCoordF(pattern_origin));
+			output.insertRenderable(new LinePatternRenderable(&line, area, rotation, offset, 0.001 * line_spacing));
 		}
 		break;
 	case PointPattern:
@@ -512,7 +507,20 @@ void AreaSymbol::FillPattern::createRenderables(const AreaRenderable& outline, f
 			point_object.setRotation(delta_rotation);
 			point_object.update();
 			auto point_extent = point_object.getExtent();
-			createRenderables<PointPattern>(outline, delta_rotation, pattern_origin, point_extent, nullptr, rotation, output);
+			
+			// With plain clipping, a single prototype rendering of the
+			// point symbol can be stamped at all positions.
+			ObjectRenderables prototype(point_object);
+			std::shared_ptr<PointPatternRenderable::Rows> rows;
+			if ((flags & Option::AlternativeToClipping) == Option::Default)
+			{
+				point->createRenderablesScaled(MapCoordF(0, 0), -delta_rotation, prototype);
+				if (PointPatternRenderable::canStamp(prototype))
+					rows = std::make_shared<PointPatternRenderable::Rows>();
+			}
+			createRenderables<PointPattern>(outline, delta_rotation, pattern_origin, point_extent, nullptr, rotation, rows.get(), output);
+			if (rows)
+				PointPatternRenderable::create(prototype, rows, output);
 		}
 		break;
 	}
@@ -526,6 +534,7 @@ void AreaSymbol::FillPattern::createPointPatternLine(
         qreal delta_offset,
         float rotation,
         const AreaRenderable& outline,
+        std::vector<PointPatternRow>* rows,
         ObjectRenderables& output ) const
 {
 	auto direction = second - first;
@@ -539,6 +548,16 @@ void AreaSymbol::FillPattern::createPointPatternLine(
 	auto to_next = direction * step_length;
 	auto coord = first + direction * start_length;
 	
+	if (rows)
+	{
+		auto count = 0;
+		for (auto cur = start_length; cur < length; cur += step_length)
+			++count;
+		if (count > 0)
+			rows->push_back({ coord, to_next, count });
+		return;
+	}
+	
 	// Duplicated loops for optimum locality of code
 	switch (flags & Option::AlternativeToClipping)
 	{
@@ -52,6 +52,7 @@ class ObjectRenderables;
 class PathObject;
 class PathPartVector;
 class PointSymbol;
+struct PointPatternRow;
 class SymbolPropertiesWidget;
 class SymbolSettingDialog;
 class VirtualCoordVector;
@@ -182,6 +183,10 @@ public:
 		
 		/**
 		 * Creates renderables for this pattern to fill the area surrounded by the outline.
+		 * 
+		 * Where possible, a single renderable represents many lines or points
+		 * of the pattern.
+		 * 
 		 * @param outline A renderable giving the extent and outline.
 		 * @param delta_rotation Rotation offest which is added to the pattern angle.
 		 * @param pattern_origin Origin point for line / point placement.
@@ -203,6 +208,7 @@ public:
 			const QRectF& point_extent,
 			LineSymbol* line,
 			qreal rotation,
+			std::vector<PointPatternRow>* rows,
 			ObjectRenderables& output
 		) const;
 		
@@ -214,15 +220,22 @@ public:
 			LineSymbol* line,
 			float rotation,
 			const AreaRenderable& outline,
+			std::vector<PointPatternRow>* rows,
 			ObjectRenderables& output
 		) const;
 		
-		/** Creates a single line of renderables for a PointPattern. */
+		/**
+		 * Creates a single line of renderables for a PointPattern.
+		 * 
+		 * If rows is not null, the line's positions are appended to rows
+		 * instead, for instanced rendering by PointPatternRenderable.
+		 */
 		void createPointPatternLine(
 			MapCoordF first, MapCoordF second,
 			qreal delta_offset,
 			float rotation,
 			const AreaRenderable& outline,
+			std::vector<PointPatternRow>* rows,
 			ObjectRenderables& output
 		) const;
 		
@@ -681,6 +681,12 @@ QImage Symbol::createIcon(const Map& map, int side_length, bool antialiasing, qr
 }
 
 
+void Symbol::setCachedIcon(const QImage& image) const
+{
+	icon = image;
+}
+
+
 void Symbol::resetIcon()
 {
 	icon = {};
@@ -277,6 +277,21 @@ public:
 	 */
 	QImage getIcon(const Map* map) const;
 	
+	/**
+	 * Returns the symbol's cached icon, or a null image.
+	 * 
+	 * Unlike getIcon(), this function never creates the icon.
+	 */
+	QImage getCachedIcon() const { return icon; }
+	
+	/**
+	 * Sets the symbol's cached icon.
+	 * 
+	 * This is meant for icons which are created asynchronously,
+	 * cf. SymbolIconCache. Like getIcon(), it only changes the cache.
+	 */
+	void setCachedIcon(const QImage& image) const;
+	
 	/**
 	 * Creates a symbol icon with the given side length (pixels).
 	 * 
@@ -0,0 +1,370 @@
+/*
+ *    Copyright 2018 The OpenOrienteering developers
+ *
+ *    This file is part of OpenOrienteering.
+ *
+ *    OpenOrienteering is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    OpenOrienteering is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with OpenOrienteering.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "symbol_icon_cache.h"
+
+#include <algorithm>
+#include <iterator>
+
+#include <Qt>
+#include <QColor>
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QHash>
+#include <QIODevice>
+#include <QLatin1Char>
+#include <QLatin1String>
+#include <QMutexLocker>
+#include <QPainter>
+#include <QRgb>
+#include <QRunnable>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QStringList>
+#include <QThreadPool>
+#include <QTimer>
+#include <QXmlStreamWriter>
+
+#include <mapper_config.h>
+
+#include "core/map.h"
+#include "core/map_color.h"
+#include "core/symbols/symbol.h"
+
+
+namespace OpenOrienteering {
+
+namespace {
+
+/// The size limit of the disk cache, in bytes
+constexpr qint64 max_disk_cache_size = 32 * 1024 * 1024;
+
+/// The age limit of files in the disk cache, in days
+constexpr int max_disk_cache_age = 90;
+
+
+/**
+ * Prunes the disk cache on a worker thread.
+ */
+class DiskCachePruneRunnable : public QRunnable
+{
+public:
+	explicit DiskCachePruneRunnable(const QString& path)
+	: path(path)
+	{}
+
+	void run() override
+	{
+		SymbolIconCache::pruneDiskCache(path, max_disk_cache_size, max_disk_cache_age);
+	}
+
+private:
+	const QString path;
+};
+
+
+}  // namespace
+
+
+
+/**
+ * Creates a single icon of a SymbolIconCache on a worker thread.
+ */
+class SymbolIconRunnable : public QRunnable
+{
+public:
+	SymbolIconRunnable(SymbolIconCache& cache, SymbolIconCache::Batch& batch, SymbolIconCache::Job& job)
+	: cache(cache)
+	, batch(batch)
+	, job(job)
+	{}
+
+	void run() override
+	{
+		cache.createIcon(batch, job);
+	}
+
+private:
+	SymbolIconCache& cache;
+	SymbolIconCache::Batch& batch;
+	SymbolIconCache::Job& job;
+};
+
+
+
+SymbolIconCache::SymbolIconCache(Map& map, QObject* parent)
+: QObject(parent)
+, map(map)
+, disk_cache_path(diskCachePath())
+{
+	if (!disk_cache_path.isEmpty() && !QDir().mkpath(disk_cache_path))
+		disk_cache_path.clear();
+
+	// Once per process is enough.
+	static bool pruned = false;
+	if (!pruned && !disk_cache_path.isEmpty())
+	{
+		pruned = true;
+		QThreadPool::globalInstance()->start(new DiskCachePruneRunnable(disk_cache_path));
+	}
+
+	connect(this, &SymbolIconCache::iconsAvailable, this, &SymbolIconCache::deliverIcons, Qt::QueuedConnection);
+
+	// Changes which affect icons, cf. iconKey()
+	connect(&map, &Map::colorAdded, this, &SymbolIconCache::mapChanged);
+	connect(&map, &Map::colorChanged, this, &SymbolIconCache::mapChanged);
+	connect(&map, &Map::colorDeleted, this, &SymbolIconCache::mapChanged);
+	connect(&map, &Map::symbolAdded, this, &SymbolIconCache::mapChanged);
+	connect(&map, &Map::symbolChanged, this, &SymbolIconCache::mapChanged);
+	connect(&map, &Map::symbolIconChanged, this, &SymbolIconCache::mapChanged);
+	connect(&map, &Map::symbolDeleted, this, &SymbolIconCache::mapChanged);
+	connect(&map, &Map::symbolIconZoomChanged, this, &SymbolIconCache::mapChanged);
+}
+
+
+SymbolIconCache::~SymbolIconCache()
+{
+	for (auto& batch : batches)
+		batch->canceled = true;
+	for (auto& batch : batches)
+		batch->done.acquire(int(batch->jobs.size()));
+}
+
+
+
+QImage SymbolIconCache::icon(const Symbol* symbol, int side_length)
+{
+	auto image = symbol->getCachedIcon();
+	if (!image.isNull())
+		return image;
+
+	if (placeholder.width() != side_length)
+	{
+		this->side_length = side_length;
+		placeholder = QImage(side_length, side_length, QImage::Format_ARGB32_Premultiplied);
+		placeholder.fill(Qt::transparent);
+		QPainter painter(&placeholder);
+		painter.setPen(Qt::NoPen);
+		painter.setBrush(QColor(128, 128, 128, 48));
+		painter.drawRect(side_length / 4, side_length / 4, side_length / 2, side_length / 2);
+	}
+
+	if (pending.insert(symbol).second)
+	{
+		if (requested.empty())
+			QTimer::singleShot(0, this, SLOT(startJobs()));
+		requested.push_back(symbol);
+	}
+	return placeholder;
+}
+
+
+// static
+QString SymbolIconCache::diskCachePath()
+{
+	auto path = QStandardPaths::writableLocation(QStandardPaths::CacheLocation);
+	if (!path.isEmpty())
+		path += QLatin1String("/symbol-icons");
+	return path;
+}
+
+
+// static
+void SymbolIconCache::pruneDiskCache(const QString& path, qint64 max_size, int max_age_days)
+{
+	// Newest first
+	const auto files = QDir(path).entryInfoList(QStringList{ QStringLiteral("*.png") }, QDir::Files, QDir::Time);
+	const auto expiry = QDateTime::currentDateTime().addDays(-max_age_days);
+	auto total_size = qint64(0);
+	for (const auto& info : files)
+	{
+		total_size += info.size();
+		if (total_size > max_size || info.lastModified() < expiry)
+			QFile::remove(info.absoluteFilePath());
+	}
+}
+
+
+
+void SymbolIconCache::startJobs()
+{
+	// Symbols may have been deleted since the request.
+	std::vector<bool> filter(std::size_t(map.getNumSymbols()), false);
+	for (auto symbol : requested)
+	{
+		auto index = map.findSymbolIndex(symbol);
+		if (index >= 0)
+			filter[std::size_t(index)] = true;
+		else
+			pending.erase(symbol);
+	}
+	if (std::none_of(begin(filter), end(filter), [](bool b) { return b; }))
+	{
+		requested.clear();
+		return;
+	}
+
+	auto batch = std::unique_ptr<Batch>(new Batch());
+	batch->zoom = map.symbolIconZoom();
+	batch->side_length = side_length;
+	batch->change_stamp = change_stamp;
+	batch->snapshot.reset(new Map());
+	batch->snapshot->setScaleDenominator(map.getScaleDenominator());
+	auto symbol_map = batch->snapshot->importMap(map, Map::MinimalSymbolImport, &filter, -1, false);
+
+	batch->jobs.reserve(requested.size());
+	for (auto symbol : requested)
+	{
+		auto copy = symbol_map.value(symbol);
+		if (copy)
+			batch->jobs.push_back({ symbol, copy, iconKey(*symbol, batch->side_length, batch->zoom), {} });
+	}
+	requested.clear();
+
+	batches.push_back(std::move(batch));
+	auto& current = *batches.back();
+	for (auto& job : current.jobs)
+		QThreadPool::globalInstance()->start(new SymbolIconRunnable(*this, current, job));
+}
+
+
+void SymbolIconCache::deliverIcons()
+{
+	decltype(finished) icons;
+	{
+		QMutexLocker locker(&mutex);
+		icons.swap(finished);
+	}
+
+	for (const auto& item : icons)
+	{
+		auto& batch = *item.first;
+		auto& job = batch.jobs[item.second];
+		pending.erase(job.symbol);
+
+		auto index = map.findSymbolIndex(job.symbol);
+		if (index >= 0)
+		{
+			// The symbol, its colors, or the zoom may have changed.
+			if (!job.image.isNull()
+			    && job.symbol->getCachedIcon().isNull()
+			    && batch.change_stamp == change_stamp
+			    && batch.side_length == side_length)
+			{
+				job.symbol->setCachedIcon(job.image);
+			}
+			emit iconChanged(index);
+		}
+
+		++batch.delivered;
+		if (batch.delivered == batch.jobs.size())
+		{
+			// Wait for the last worker to let go of the batch.
+			batch.done.acquire(int(batch.jobs.size()));
+			auto found = std::find_if(begin(batches), end(batches), [&batch](const auto& b) { return b.get() == &batch; });
+			Q_ASSERT(found != end(batches));
+			batches.erase(found);
+		}
+	}
+}
+
+
+
+void SymbolIconCache::mapChanged()
+{
+	++change_stamp;
+}
+
+
+
+QByteArray SymbolIconCache::iconKey(const Symbol& symbol, int side_length, qreal zoom) const
+{
+	QByteArray data;
+	{
+		QXmlStreamWriter xml(&data);
+		symbol.save(xml, map);
+		if (symbol.getType() == Symbol::Combined)
+		{
+			// Combined symbols refer to other symbols by index.
+			for (int i = 0; i < map.getNumSymbols(); ++i)
+			{
+				auto other = map.getSymbol(i);
+				if (other != &symbol && symbol.containsSymbol(other))
+					other->save(xml, map);
+			}
+		}
+	}
+
+	// Symbols refer to colors by index.
+	for (int i = 0; i < map.getNumColors(); ++i)
+	{
+		auto color = map.getColor(i);
+		data += QByteArray::number(QRgb(*color)) + ' ' + QByteArray::number(color->getOpacity()) + ';';
+	}
+
+	data += QByteArray::number(side_length) + ' ' + QByteArray::number(zoom)
+	        + ' ' + QByteArray::number(map.getScaleDenominator())
+	        + ' ' + APP_VERSION;
+	return QCryptographicHash::hash(data, QCryptographicHash::Sha1).toHex();
+}
+
+
+void SymbolIconCache::createIcon(Batch& batch, Job& job)
+{
+	if (!batch.canceled)
+	{
+		auto path = QString{};
+		if (!disk_cache_path.isEmpty())
+			path = disk_cache_path + QLatin1Char('/') + QString::fromLatin1(job.key) + QLatin1String(".png");
+
+		QImage image;
+		if (!path.isEmpty()
+		    && image.load(path, "PNG")
+		    && image.width() == batch.side_length
+		    && image.height() == batch.side_length)
+		{
+			job.image = image.convertToFormat(QImage::Format_ARGB32_Premultiplied);
+		}
+		else
+		{
+			job.image = job.copy->createIcon(*batch.snapshot, batch.side_length, true, batch.zoom);
+			if (!path.isEmpty())
+			{
+				// Concurrent writers (e.g. other instances) never leave partial files.
+				QSaveFile file(path);
+				if (file.open(QIODevice::WriteOnly) && job.image.save(&file, "PNG"))
+					file.commit();
+			}
+		}
+	}
+
+	{
+		QMutexLocker locker(&mutex);
+		finished.emplace_back(&batch, std::size_t(std::distance(batch.jobs.data(), &job)));
+	}
+	emit iconsAvailable();
+	batch.done.release();
+}
+
+
+}  // namespace OpenOrienteering
@@ -0,0 +1,189 @@
+/*
+ *    Copyright 2018 The OpenOrienteering developers
+ *
+ *    This file is part of OpenOrienteering.
+ *
+ *    OpenOrienteering is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    OpenOrienteering is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with OpenOrienteering.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef OPENORIENTEERING_SYMBOL_ICON_CACHE_H
+#define OPENORIENTEERING_SYMBOL_ICON_CACHE_H
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include <QtGlobal>
+#include <QByteArray>
+#include <QImage>
+#include <QMutex>
+#include <QObject>
+#include <QSemaphore>
+#include <QString>
+
+namespace OpenOrienteering {
+
+class Map;
+class Symbol;
+
+
+/**
+ * Creates the icons of a map's symbols on worker threads.
+ *
+ * icon() returns a symbol's cached icon if it is available. Otherwise it
+ * returns a placeholder, and it schedules the creation of the icon. The
+ * requests which arrive during one pass of the event loop are processed
+ * together: They are rendered in parallel on the global thread pool, from
+ * a snapshot of the requested symbols and their colors. So the map may be
+ * edited while the icons are rendered. Each finished icon is stored in its
+ * symbol on the map's thread, and iconChanged() is emitted.
+ *
+ * Icons are also stored on disk, in the user's cache directory. The file
+ * names are derived from a hash of the symbol's definition, the map's
+ * colors, the icon size and the zoom. So later requests for unchanged
+ * symbols, e.g. when the map is opened again, only need to load the file.
+ * Old files are removed when the first cache is created in a process, cf.
+ * pruneDiskCache().
+ *
+ * Icons are dropped on delivery when the map's symbols, colors, or the icon
+ * zoom changed after the icons were requested.
+ */
+class SymbolIconCache : public QObject
+{
+	Q_OBJECT
+
+public:
+	/**
+	 * Creates an icon cache for the symbols of the given map.
+	 */
+	explicit SymbolIconCache(Map& map, QObject* parent = nullptr);
+
+	SymbolIconCache(const SymbolIconCache&) = delete;
+	SymbolIconCache& operator=(const SymbolIconCache&) = delete;
+
+	/**
+	 * Destroys the cache.
+	 *
+	 * Icons which are not yet rendered are dropped. Running jobs are
+	 * waited for.
+	 */
+	~SymbolIconCache() override;
+
+
+	/**
+	 * Returns the symbol's icon, or a placeholder of the given size.
+	 *
+	 * If the symbol has no cached icon, the creation of the icon is scheduled.
+	 */
+	QImage icon(const Symbol* symbol, int side_length);
+
+	/**
+	 * Returns the directory where icons are stored on disk.
+	 */
+	static QString diskCachePath();
+
+	/**
+	 * Removes icon files which are older than max_age_days, and the oldest
+	 * files in excess of max_size bytes, from the given directory.
+	 */
+	static void pruneDiskCache(const QString& path, qint64 max_size, int max_age_days);
+
+
+signals:
+	/**
+	 * Emitted when the icon of the symbol with the given index was set.
+	 *
+	 * The signal is also emitted when a rendered icon was dropped because
+	 * the symbol changed in the meantime. Requesting the icon again will
+	 * schedule another creation.
+	 */
+	void iconChanged(int symbol_index);
+
+	/**
+	 * Emitted from worker threads when icons are waiting to be delivered.
+	 */
+	void iconsAvailable();
+
+
+private slots:
+	/**
+	 * Starts the rendering of the requested icons.
+	 */
+	void startJobs();
+
+	/**
+	 * Stores the finished icons in their symbols.
+	 */
+	void deliverIcons();
+
+	/**
+	 * Invalidates the icons which are currently rendered.
+	 */
+	void mapChanged();
+
+
+private:
+	friend class SymbolIconRunnable;
+
+	struct Job
+	{
+		const Symbol* symbol;   ///< The map's symbol
+		const Symbol* copy;     ///< The symbol in the snapshot
+		QByteArray key;         ///< The hash for the disk cache
+		QImage image;           ///< Set by the worker
+	};
+
+	struct Batch
+	{
+		std::unique_ptr<Map> snapshot;
+		std::vector<Job> jobs;
+		qreal zoom;
+		int side_length;
+		quint64 change_stamp;   ///< The cache's change_stamp when the batch was started
+		std::size_t delivered = 0;
+		std::atomic<bool> canceled { false };
+		QSemaphore done;        ///< Released by the workers
+	};
+
+	/**
+	 * Returns the disk cache key for the symbol's icon.
+	 */
+	QByteArray iconKey(const Symbol& symbol, int side_length, qreal zoom) const;
+
+	/**
+	 * Loads or renders the icon of a job. This runs on a worker thread.
+	 */
+	void createIcon(Batch& batch, Job& job);
+
+
+	Map& map;
+	QString disk_cache_path;   ///< Empty if there is no writable cache location
+	QImage placeholder;
+	int side_length = 0;
+	quint64 change_stamp = 0;  ///< Incremented when symbols, colors or the icon zoom change
+	std::vector<const Symbol*> requested;
+	std::unordered_set<const Symbol*> pending;     ///< Requested or rendering
+	std::vector<std::unique_ptr<Batch>> batches;
+
+	QMutex mutex;
+	std::vector<std::pair<Batch*, std::size_t>> finished;  ///< Guarded by mutex.
+};
+
+
+}  // namespace OpenOrienteering
+
+#endif
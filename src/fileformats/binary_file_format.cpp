@@ -0,0 +1,653 @@
+/*
+ *    Copyright 2018 The OpenOrienteering developers
+ *
+ *    This file is part of OpenOrienteering.
+ *
+ *    OpenOrienteering is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    OpenOrienteering is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with OpenOrienteering.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "binary_file_format.h"
+#include "binary_file_format_p.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+#include <utility>
+
+#include <QtGlobal>
+#include <QtEndian>
+#include <QHash>
+#include <QIODevice>
+#include <QLatin1String>
+#include <QXmlStreamReader>
+#include <QXmlStreamWriter>
+
+#include "core/map.h"
+#include "core/map_coord.h"
+#include "core/map_part.h"
+#include "core/objects/object.h"
+#include "core/objects/text_object.h"
+#include "core/symbols/point_symbol.h"
+#include "core/symbols/symbol.h"
+#include "fileformats/file_import_export.h"
+#include "util/parallel.h"
+#include "util/xml_stream_util.h"
+
+
+namespace OpenOrienteering {
+
+// ### BinaryFileFormat definition ###
+
+constexpr char BinaryFileFormat::magic_bytes[4] = { 'O', 'O', 'M', 'B' };
+
+constexpr quint32 BinaryFileFormat::current_version = 1;
+
+
+
+namespace {
+
+/// The tag of the chunk which holds the map without objects, in XML.
+constexpr char chunk_xml[] = "XMAP";
+
+/// The tag of the chunks which hold the objects of a map part.
+constexpr char chunk_part[] = "PART";
+
+/// The size of an encoded coordinate: x, y and flags.
+constexpr std::size_t coord_size = 12;
+
+/// The number of objects which are encoded together in a block.
+constexpr int objects_per_block = 512;
+
+
+template <class T>
+void writeValue(QByteArray& data, T value)
+{
+	uchar bytes[sizeof(T)];
+	qToLittleEndian<T>(value, bytes);
+	data.append(reinterpret_cast<const char*>(bytes), int(sizeof(T)));
+}
+
+void writeFloat(QByteArray& data, float value)
+{
+	quint32 bits;
+	static_assert(sizeof(bits) == sizeof(value), "float must have 32 bits");
+	std::memcpy(&bits, &value, sizeof(bits));
+	writeValue(data, bits);
+}
+
+void writeString(QByteArray& data, const QString& value)
+{
+	auto const utf8 = value.toUtf8();
+	writeValue(data, quint32(utf8.size()));
+	data.append(utf8);
+}
+
+template <class Iterator>
+void writeCoords(QByteArray& data, Iterator first, Iterator last)
+{
+	auto const count = std::size_t(std::distance(first, last));
+	writeValue(data, quint32(count));
+
+	auto const pos = data.size();
+	data.resize(pos + int(count * coord_size));
+	auto dest = reinterpret_cast<uchar*>(data.data() + pos);
+	for (; first != last; ++first)
+	{
+		qToLittleEndian<qint32>(first->nativeX(), dest);
+		qToLittleEndian<qint32>(first->nativeY(), dest + 4);
+		qToLittleEndian<quint32>(quint32(first->flags()), dest + 8);
+		dest += coord_size;
+	}
+}
+
+void writeCoord(QByteArray& data, const MapCoord& coord)
+{
+	writeCoords(data, &coord, &coord + 1);
+}
+
+
+/**
+ * Encodes a single object.
+ *
+ * Layout: type, symbol index, type specific properties, tags, coordinates.
+ */
+void encodeObject(QByteArray& data, const Object* object, int symbol_index)
+{
+	writeValue(data, quint8(object->getType()));
+	writeValue(data, qint32(symbol_index));
+
+	switch (object->getType())
+	{
+		case Object::Point:
+			writeFloat(data, static_cast<const PointObject*>(object)->getRotation());
+			break;
+		case Object::Path:
+			{
+				auto const path = static_cast<const PathObject*>(object);
+				writeFloat(data, path->getPatternRotation());
+				writeCoord(data, path->getPatternOrigin());
+			}
+			break;
+		case Object::Text:
+			{
+				auto const text = static_cast<const TextObject*>(object);
+				writeFloat(data, text->getRotation());
+				writeValue(data, quint8(text->getHorizontalAlignment()));
+				writeValue(data, quint8(text->getVerticalAlignment()));
+				writeString(data, text->getText());
+			}
+			break;
+	}
+
+	auto const& tags = object->tagList();
+	writeValue(data, quint32(tags.size()));
+	for (auto const& tag : tags)
+	{
+		writeString(data, tag.first);
+		writeString(data, tag.second);
+	}
+
+	auto const& coords = object->getRawCoordinateVector();
+	if (object->getType() == Object::Text)
+	{
+		// Like in the XML format, the box size is stored as second coordinate.
+		auto const text = static_cast<const TextObject*>(object);
+		MapCoord text_coords[2] = { coords.front(), text->hasSingleAnchor() ? MapCoord{} : text->getBoxSize() };
+		writeCoords(data, std::begin(text_coords), std::begin(text_coords) + (text->hasSingleAnchor() ? 1 : 2));
+	}
+	else
+	{
+		writeCoords(data, begin(coords), end(coords));
+	}
+}
+
+
+
+/**
+ * A bounds-checked reader for encoded data.
+ *
+ * When reading beyond the end of the data, the reader becomes invalid,
+ * and it returns zero values.
+ */
+class BlockReader
+{
+public:
+	BlockReader(const char* data, std::size_t size)
+	: pos(reinterpret_cast<const uchar*>(data))
+	, end(pos + size)
+	{}
+
+	bool isValid() const { return valid; }
+
+	bool atEnd() const { return pos == end; }
+
+	template <class T>
+	T read()
+	{
+		if (!require(sizeof(T)))
+			return T(0);
+		auto const value = qFromLittleEndian<T>(pos);
+		pos += sizeof(T);
+		return value;
+	}
+
+	float readFloat()
+	{
+		auto const bits = read<quint32>();
+		float value;
+		std::memcpy(&value, &bits, sizeof(value));
+		return value;
+	}
+
+	QString readString()
+	{
+		auto const size = read<quint32>();
+		if (!require(size))
+			return {};
+		auto const value = QString::fromUtf8(reinterpret_cast<const char*>(pos), int(size));
+		pos += size;
+		return value;
+	}
+
+	void readCoords(MapCoordVector& coords)
+	{
+		auto const count = read<quint32>();
+		if (!require(std::size_t(count) * coord_size))
+			return;
+		coords.resize(count);
+		for (auto& coord : coords)
+		{
+			coord = MapCoord::fromNative(qFromLittleEndian<qint32>(pos), qFromLittleEndian<qint32>(pos + 4));
+			coord.setFlags(MapCoord::Flags::Int(qFromLittleEndian<quint32>(pos + 8)));
+			pos += coord_size;
+		}
+	}
+
+	MapCoord readCoord()
+	{
+		MapCoordVector coords;
+		readCoords(coords);
+		if (coords.size() != 1)
+		{
+			valid = false;
+			return {};
+		}
+		return coords.front();
+	}
+
+	/** Returns a pointer to the next size bytes, and skips them. */
+	const char* skip(std::size_t size)
+	{
+		if (!require(size))
+			return nullptr;
+		auto const data = reinterpret_cast<const char*>(pos);
+		pos += size;
+		return data;
+	}
+
+private:
+	bool require(std::size_t size)
+	{
+		if (valid && std::size_t(end - pos) >= size)
+			return true;
+		valid = false;
+		pos = end;
+		return false;
+	}
+
+	const uchar* pos;
+	const uchar* end;
+	bool valid = true;
+};
+
+
+}  // namespace
+
+
+
+BinaryFileFormat::BinaryFileFormat()
+ : FileFormat(MapFile, "Binary", ::OpenOrienteering::ImportExport::tr("OpenOrienteering Mapper binary"), QString::fromLatin1("bmap"),
+              ImportSupported | ExportSupported)
+{
+	// Nothing
+}
+
+bool BinaryFileFormat::understands(const unsigned char* buffer, std::size_t sz) const
+{
+	return sz >= sizeof(magic_bytes) && std::memcmp(buffer, magic_bytes, sizeof(magic_bytes)) == 0;
+}
+
+Importer* BinaryFileFormat::createImporter(QIODevice* stream, Map *map, MapView *view) const
+{
+	return new BinaryFileImporter(stream, map, view);
+}
+
+Exporter* BinaryFileFormat::createExporter(QIODevice* stream, Map *map, MapView *view) const
+{
+	return new BinaryFileExporter(stream, map, view);
+}
+
+
+
+// ### A namespace which collects various string constants of type QLatin1String. ###
+
+namespace literal
+{
+	static const QLatin1String parts("parts");
+	static const QLatin1String count("count");
+	static const QLatin1String current("current");
+}
+
+
+
+// ### BinaryFileExporter definition ###
+
+BinaryFileExporter::BinaryFileExporter(QIODevice* stream, Map *map, MapView *view)
+: XMLFileExporter(stream, map, view)
+{
+	setOption(QString::fromLatin1("autoFormatting"), false);
+}
+
+BinaryFileExporter::~BinaryFileExporter() = default;
+
+
+void BinaryFileExporter::doExport()
+{
+	xml_buffer.setData(QByteArray());
+	xml_buffer.open(QIODevice::WriteOnly);
+	xml.setDevice(&xml_buffer);
+	XMLFileExporter::doExport();
+	xml.setDevice(nullptr);
+	xml_buffer.close();
+
+	QByteArray header(BinaryFileFormat::magic_bytes, int(sizeof(BinaryFileFormat::magic_bytes)));
+	writeValue(header, BinaryFileFormat::current_version);
+	stream->write(header);
+
+	writeChunk(chunk_xml, xml_buffer.data());
+	writePartChunks();
+}
+
+void BinaryFileExporter::exportMapParts()
+{
+	XmlElementWriter parts_element(xml, literal::parts);
+	parts_element.writeAttribute(literal::count, std::size_t(map->getNumParts()));
+	parts_element.writeAttribute(literal::current, map->getCurrentPartIndex());
+}
+
+void BinaryFileExporter::writePartChunks()
+{
+	// Replaces linear Map::findSymbolIndex() lookups.
+	QHash<const Symbol*, int> symbol_index;
+	for (int i = 0; i < map->getNumSymbols(); ++i)
+		symbol_index.insert(map->getSymbol(i), i);
+	symbol_index.insert(Map::getUndefinedPoint(), map->findSymbolIndex(Map::getUndefinedPoint()));
+	symbol_index.insert(Map::getUndefinedLine(), map->findSymbolIndex(Map::getUndefinedLine()));
+	symbol_index.insert(Map::getUndefinedText(), map->findSymbolIndex(Map::getUndefinedText()));
+
+	struct Block
+	{
+		const MapPart* part;
+		int first;
+		int last;
+		QByteArray data;
+	};
+	auto const num_parts = std::size_t(map->getNumParts());
+	std::vector<Block> blocks;
+	for (auto i = 0u; i < num_parts; ++i)
+	{
+		auto const part = map->getPart(i);
+		for (int first = 0; first < part->getNumObjects(); first += objects_per_block)
+			blocks.push_back({ part, first, std::min(part->getNumObjects(), first + objects_per_block), {} });
+	}
+
+	const auto& symbols = symbol_index;
+	parallelFor(blocks.size(), [&blocks, &symbols](std::size_t i) {
+		auto& block = blocks[i];
+		for (int j = block.first; j < block.last; ++j)
+		{
+			auto const object = block.part->getObject(j);
+			encodeObject(block.data, object, symbols.value(object->getSymbol(), -1));
+		}
+	});
+
+	auto block = begin(blocks);
+	for (auto i = 0u; i < num_parts; ++i)
+	{
+		auto const part = map->getPart(i);
+		auto const last = std::find_if(block, end(blocks), [part](const Block& b) { return b.part != part; });
+
+		QByteArray data;
+		writeString(data, part->getName());
+		writeValue(data, quint32(part->getNumObjects()));
+		writeValue(data, quint32(std::distance(block, last)));
+		for (; block != last; ++block)
+		{
+			writeValue(data, quint32(block->data.size()));
+			writeValue(data, quint32(block->last - block->first));
+			data.append(block->data);
+			block->data.clear();
+		}
+		writeChunk(chunk_part, data);
+	}
+}
+
+void BinaryFileExporter::writeChunk(const char* tag, const QByteArray& data)
+{
+	QByteArray header(tag, 4);
+	writeValue(header, quint32(data.size()));
+	stream->write(header);
+	stream->write(data);
+}
+
+
+
+// ### BinaryFileImporter definition ###
+
+BinaryFileImporter::BinaryFileImporter(QIODevice* stream, Map *map, MapView *view)
+: XMLFileImporter(stream, map, view)
+{
+	// Nothing
+}
+
+BinaryFileImporter::~BinaryFileImporter() = default;
+
+
+void BinaryFileImporter::import(bool load_symbols_only)
+{
+	data = stream->readAll();
+
+	BlockReader reader(data.constData(), std::size_t(data.size()));
+	auto const magic = reader.skip(sizeof(BinaryFileFormat::magic_bytes));
+	if (!magic || std::memcmp(magic, BinaryFileFormat::magic_bytes, sizeof(BinaryFileFormat::magic_bytes)) != 0)
+		throw FileFormatException(::OpenOrienteering::Importer::tr("Unsupported file format."));
+
+	auto const version = reader.read<quint32>();
+	if (version < 1)
+		throw FileFormatException(::OpenOrienteering::Importer::tr("Invalid file format version."));
+	else if (version > BinaryFileFormat::current_version)
+		throw FileFormatException(tr("Unsupported new file format version. Please use a newer program version to load the file."));
+
+	QByteArray xml_data;
+	part_chunks.clear();
+	while (!reader.atEnd())
+	{
+		auto const tag = reader.skip(4);
+		auto const size = reader.read<quint32>();
+		auto const chunk = reader.skip(size);
+		if (!reader.isValid())
+			throw FileFormatException(tr("The file is truncated."));
+
+		if (std::memcmp(tag, chunk_xml, 4) == 0 && xml_data.isNull())
+			xml_data = QByteArray::fromRawData(chunk, int(size));
+		else if (std::memcmp(tag, chunk_part, 4) == 0)
+			part_chunks.push_back({ chunk, size });
+		else
+			addWarning(tr("Unsupported chunk: %1").arg(QString::fromLatin1(tag, 4)));
+	}
+	if (xml_data.isNull())
+		throw FileFormatException(tr("The file is truncated."));
+
+	xml_buffer.setData(xml_data);
+	xml_buffer.open(QIODevice::ReadOnly);
+	xml.setDevice(&xml_buffer);
+	setOption(QString::fromLatin1("streamObjects"), false);  // The part chunks are decoded in parallel.
+	XMLFileImporter::import(load_symbols_only);
+}
+
+void BinaryFileImporter::importMapParts()
+{
+	XmlElementReader mapparts_element(xml);
+	auto num_parts = mapparts_element.attribute<std::size_t>(literal::count);
+	auto current_part_index = mapparts_element.attribute<std::size_t>(literal::current);
+
+	// Same lookup as in the XML format, but not depending on strings.
+	std::vector<const Symbol*> symbols(std::size_t(symbol_dict.size()));
+	for (std::size_t i = 0; i < symbols.size(); ++i)
+		symbols[i] = symbol_dict.value(QString::number(i));
+
+	struct Block
+	{
+		std::size_t part;
+		const char* data;
+		std::size_t size;
+		std::size_t count;
+		std::vector<std::unique_ptr<Object>> objects;
+		bool valid;
+	};
+	std::vector<Block> blocks;
+	std::vector<QString> part_names;
+	part_names.reserve(part_chunks.size());
+	for (const auto& chunk : part_chunks)
+	{
+		BlockReader reader(chunk.data, chunk.size);
+		part_names.push_back(reader.readString());
+		reader.read<quint32>();  // number of objects, for information
+		auto const num_blocks = reader.read<quint32>();
+		for (auto i = 0u; i < num_blocks && reader.isValid(); ++i)
+		{
+			auto const size = reader.read<quint32>();
+			auto const count = reader.read<quint32>();
+			auto const block_data = reader.skip(size);
+			blocks.push_back({ part_names.size() - 1, block_data, size, count, {}, false });
+		}
+		if (!reader.isValid() || !reader.atEnd())
+			throw FileFormatException(tr("Invalid data in map part %1.").arg(part_names.size()));
+	}
+
+	parallelFor(blocks.size(), [&blocks, &symbols](std::size_t i) {
+		auto& block = blocks[i];
+		block.valid = decodeObjects(block.data, block.size, block.count, symbols, block.objects);
+	});
+
+	for (const auto& block : blocks)
+	{
+		if (!block.valid)
+			throw FileFormatException(tr("Invalid data in map part %1.").arg(block.part + 1));
+	}
+
+	map->parts.clear();
+	map->parts.reserve(part_names.size());
+	auto block = begin(blocks);
+	for (std::size_t i = 0; i < part_names.size(); ++i)
+	{
+		auto part = new MapPart(part_names[i], map);
+		for (; block != end(blocks) && block->part == i; ++block)
+		{
+			for (auto& decoded : block->objects)
+			{
+				auto object = decoded.release();
+				object->map = map;
+				object->internTags();
+				part->appendObject(object);
+				if (object->coords.empty()
+				    || !object->coords.front().isRegular()
+				    || !object->coords.back().isRegular())
+				{
+					map->markAsIrregular(object);
+				}
+			}
+		}
+		map->parts.push_back(part);
+	}
+
+	if (current_part_index < map->parts.size())
+		map->current_part_index = current_part_index;
+
+	if (num_parts > 0 && num_parts != map->parts.size())
+		addWarning(::OpenOrienteering::XMLFileImporter::tr("Expected %1 map parts, found %2.").
+		  arg(num_parts).
+		  arg(map->parts.size())
+		);
+
+	emit map->currentMapPartIndexChanged(map->current_part_index);
+	emit map->currentMapPartChanged(map->getPart(map->current_part_index));
+}
+
+// static
+bool BinaryFileImporter::decodeObjects(const char* data, std::size_t size, std::size_t count,
+                                       const std::vector<const Symbol*>& symbols,
+                                       std::vector<std::unique_ptr<Object>>& objects)
+{
+	BlockReader reader(data, size);
+	objects.reserve(count);
+	for (std::size_t i = 0; i < count; ++i)
+	{
+		auto const type = Object::Type(reader.read<quint8>());
+		if (type != Object::Point && type != Object::Path && type != Object::Text)
+			return false;
+
+		std::unique_ptr<Object> object { Object::getObjectForType(type) };
+		auto const symbol_index = reader.read<qint32>();
+		if (symbol_index >= 0 && std::size_t(symbol_index) < symbols.size())
+			object->symbol = symbols[std::size_t(symbol_index)];
+		else if (symbol_index == -2)
+			object->symbol = Map::getUndefinedPoint();
+		else if (symbol_index == -3)
+			object->symbol = Map::getUndefinedLine();
+
+		if (!object->symbol || !object->symbol->isTypeCompatibleTo(object.get()))
+		{
+			switch (type)
+			{
+				case Object::Point:
+					object->symbol = Map::getUndefinedPoint();
+					break;
+				case Object::Path:
+					object->symbol = Map::getUndefinedLine();
+					break;
+				case Object::Text:
+					object->symbol = Map::getUndefinedText();
+					break;
+			}
+		}
+
+		switch (type)
+		{
+			case Object::Point:
+				{
+					auto const rotation = reader.readFloat();
+					if (object->symbol->asPoint()->isRotatable())
+						static_cast<PointObject*>(object.get())->setRotation(rotation);
+				}
+				break;
+			case Object::Path:
+				{
+					auto path = static_cast<PathObject*>(object.get());
+					path->setPatternRotation(reader.readFloat());
+					path->setPatternOrigin(reader.readCoord());
+				}
+				break;
+			case Object::Text:
+				{
+					auto text = static_cast<TextObject*>(object.get());
+					text->setRotation(reader.readFloat());
+					text->setHorizontalAlignment(TextObject::HorizontalAlignment(reader.read<quint8>()));
+					text->setVerticalAlignment(TextObject::VerticalAlignment(reader.read<quint8>()));
+					text->setText(reader.readString());
+				}
+				break;
+		}
+
+		auto const num_tags = reader.read<quint32>();
+		Object::Tags tags;
+		for (auto j = 0u; j < num_tags && reader.isValid(); ++j)
+		{
+			auto key = reader.readString();
+			tags.insert(key, reader.readString());
+		}
+		object->initTags(tags);
+
+		reader.readCoords(object->coords);
+		if (!reader.isValid())
+			return false;
+
+		if (type == Object::Text)
+		{
+			if (object->coords.size() > 1)
+				static_cast<TextObject*>(object.get())->setBoxSize(object->coords[1]);
+		}
+		else if (type == Object::Path)
+		{
+			static_cast<PathObject*>(object.get())->recalculateParts();
+		}
+		object->setOutputDirty();
+
+		objects.push_back(std::move(object));
+	}
+	return reader.atEnd();
+}
+
+
+}  // namespace OpenOrienteering
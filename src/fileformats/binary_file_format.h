@@ -0,0 +1,82 @@
+/*
+ *    Copyright 2018 The OpenOrienteering developers
+ *
+ *    This file is part of OpenOrienteering.
+ *
+ *    OpenOrienteering is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    OpenOrienteering is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with OpenOrienteering.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef OPENORIENTEERING_BINARY_FILE_FORMAT_H
+#define OPENORIENTEERING_BINARY_FILE_FORMAT_H
+
+#include <cstddef>
+
+#include <QtGlobal>
+
+#include "fileformats/file_format.h"
+
+class QIODevice;
+
+namespace OpenOrienteering {
+
+class Exporter;
+class Importer;
+class Map;
+class MapView;
+
+
+/**
+ * A compact binary variant of the native map file format.
+ *
+ * A file starts with the magic bytes "OOMB" and the format version, followed
+ * by a sequence of length-prefixed chunks. The first chunk holds the map
+ * without its objects (colors, symbols, templates, view, undo/redo steps) in
+ * the XML format. It is followed by one chunk for each map part.
+ *
+ * The objects of a map part are stored in length-prefixed blocks, with
+ * coordinates as raw little-endian arrays. The blocks are encoded and decoded
+ * in parallel.
+ */
+class BinaryFileFormat : public FileFormat
+{
+public:
+	/** Creates a new file format representing the binary native format.
+	 */
+	BinaryFileFormat();
+	
+	/** Returns true if the file starts with the magic byte sequence "OOMB".
+	 */
+	bool understands(const unsigned char *buffer, std::size_t sz) const override;
+	
+	/** Creates an importer for binary native files.
+	 */
+	Importer *createImporter(QIODevice* stream, Map *map, MapView *view) const override;
+	
+	/** Creates an exporter for binary native files.
+	 */
+	Exporter *createExporter(QIODevice* stream, Map *map, MapView *view) const override;
+	
+	/** The file magic: "OOMB"
+	 */
+	static const char magic_bytes[4];
+	
+	/** The version of the binary structure created by this implementation.
+	 */
+	static const quint32 current_version;
+};
+
+
+}  // namespace OpenOrienteering
+
+#endif // OPENORIENTEERING_BINARY_FILE_FORMAT_H
@@ -0,0 +1,119 @@
+/*
+ *    Copyright 2018 The OpenOrienteering developers
+ *
+ *    This file is part of OpenOrienteering.
+ *
+ *    OpenOrienteering is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    OpenOrienteering is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with OpenOrienteering.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef OPENORIENTEERING_BINARY_FILE_FORMAT_P_H
+#define OPENORIENTEERING_BINARY_FILE_FORMAT_P_H
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+#include <QCoreApplication>
+#include <QBuffer>
+#include <QByteArray>
+#include <QString>
+
+#include "fileformats/xml_file_format_p.h"
+
+class QIODevice;
+
+namespace OpenOrienteering {
+
+class Map;
+class MapView;
+class Object;
+class Symbol;
+
+
+/**
+ * Map exporter for the binary native format.
+ *
+ * Everything but the map parts is written by the XML exporter, to a buffer
+ * which becomes the first chunk of the file.
+ */
+class BinaryFileExporter : public XMLFileExporter
+{
+	Q_DECLARE_TR_FUNCTIONS(OpenOrienteering::BinaryFileExporter)
+
+public:
+	BinaryFileExporter(QIODevice* stream, Map *map, MapView *view);
+	~BinaryFileExporter() override;
+
+	void doExport() override;
+
+protected:
+	/** Writes the attributes of the map parts to the XML chunk only. */
+	void exportMapParts() override;
+
+	/** Writes a chunk for each map part. */
+	void writePartChunks();
+
+	void writeChunk(const char* tag, const QByteArray& data);
+
+private:
+	QBuffer xml_buffer;
+};
+
+
+/**
+ * Map importer for the binary native format.
+ *
+ * The XML chunk is read by the XML importer. When it reaches the map parts,
+ * the objects are decoded from the part chunks.
+ */
+class BinaryFileImporter : public XMLFileImporter
+{
+	Q_DECLARE_TR_FUNCTIONS(OpenOrienteering::BinaryFileImporter)
+
+public:
+	BinaryFileImporter(QIODevice* stream, Map *map, MapView *view);
+	~BinaryFileImporter() override;
+
+	/**
+	 * Decodes a block of objects.
+	 *
+	 * The objects are created without map. This function may be called
+	 * concurrently. It returns false if the block is invalid.
+	 */
+	static bool decodeObjects(const char* data, std::size_t size, std::size_t count,
+	                          const std::vector<const Symbol*>& symbols,
+	                          std::vector<std::unique_ptr<Object>>& objects);
+
+protected:
+	void import(bool load_symbols_only) override;
+
+	/** Reads the attributes of the map parts from the XML chunk, and loads the part chunks. */
+	void importMapParts() override;
+
+private:
+	struct PartChunk
+	{
+		const char* data;
+		std::size_t size;
+	};
+
+	QByteArray data;
+	QBuffer xml_buffer;
+	std::vector<PartChunk> part_chunks;
+};
+
+
+}  // namespace OpenOrienteering
+
+#endif
@@ -25,6 +25,7 @@
 #include <algorithm>
 #include <cmath>
 #include <iterator>
+#include <limits>
 #include <memory>
 #include <type_traits>
 #include <vector>
@@ -34,6 +35,7 @@
 #include <QCoreApplication>
 #include <QDebug>
 #include <QDir>
+#include <QFile>
 #include <QFileInfo>
 #include <QFontMetricsF>
 #include <QIODevice>
@@ -86,6 +88,38 @@ static QTextCodec* codecFromSettings()
 }	
 
 
+/**
+ * Releases a memory-mapped file, and the buffer which refers to the mapped
+ * data, when leaving the scope.
+ */
+class FileMapping
+{
+public:
+	FileMapping(QFile* file, uchar* data, QByteArray& buffer)
+	: file { file }
+	, data { data }
+	, buffer ( buffer )
+	{}
+	
+	FileMapping(const FileMapping&) = delete;
+	FileMapping& operator=(const FileMapping&) = delete;
+	
+	~FileMapping()
+	{
+		if (data)
+		{
+			buffer.clear();
+			file->unmap(data);
+		}
+	}
+	
+private:
+	QFile* file;
+	uchar* data;
+	QByteArray& buffer;
+};
+
+
 }  // namespace
 
 
@@ -2094,7 +2128,24 @@ void OcdFileImport::import(bool load_symbols_only)
 	Q_ASSERT(buffer.isEmpty());
 	
 	buffer.clear();
-	buffer.append(stream->readAll());
+	
+	// Files are mapped into memory instead of being copied to the buffer.
+	// The OcdFile views work directly on the mapped data, until the mapping
+	// is released at the end of this function.
+	uchar* mapped_data = nullptr;
+	auto file = qobject_cast<QFile*>(stream);
+	if (file && !file->isSequential())
+	{
+		auto const size = file->size() - file->pos();
+		if (size > 0 && size <= std::numeric_limits<int>::max())
+			mapped_data = file->map(file->pos(), size);
+		if (mapped_data)
+			buffer = QByteArray::fromRawData(reinterpret_cast<const char*>(mapped_data), int(size));
+	}
+	FileMapping mapping { file, mapped_data, buffer };
+	
+	if (!mapped_data)
+		buffer.append(stream->readAll());
 	if (buffer.isEmpty())
 		throw FileFormatException(::OpenOrienteering::Importer::tr("Could not read file: %1").arg(stream->errorString()));
 	
@@ -330,6 +330,7 @@ protected:
 	/// The locale is used for number formatting.
 	QLocale locale;
 	
+	/// The file data, either read from the stream or memory-mapped during import
 	QByteArray buffer;
 	
 	QScopedPointer< OCAD8FileImport > delegate;
@@ -515,7 +515,9 @@ public:
 	 * Constructs a new object for the file contents given by data.
 	 * 
 	 * We try to avoid copying the data by using the implicit sharing provided
-	 * by QByteArray.
+	 * by QByteArray. The data may also be a QByteArray created by
+	 * QByteArray::fromRawData(), e.g. for a memory-mapped file. Then the raw
+	 * data must remain valid for the lifetime of this object.
 	 */
 	OcdFile(const QByteArray& data);
 	
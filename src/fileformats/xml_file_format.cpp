@@ -23,9 +23,11 @@
 #include "xml_file_format_p.h"
 
 #include <memory>
+#include <utility>
 #include <vector>
 
 #include <QtGlobal>
+#include <QBuffer>
 #include <QByteArray>
 #include <QCoreApplication>
 #include <QDir>
@@ -37,6 +39,7 @@
 #include <QLatin1String>
 #include <QObject>
 #include <QRectF>
+#include <QSaveFile>
 #include <QScopedValueRollback>
 #include <QString>
 #include <QStringRef>
@@ -57,6 +60,8 @@
 #include "core/symbols/point_symbol.h"
 #include "core/symbols/symbol.h"
 #include "fileformats/file_import_export.h"
+#include "fileformats/xml_object_cache.h"
+#include "fileformats/xml_object_stream.h"
 #include "templates/template.h"
 #include "undo/undo_manager.h"
 #include "util/xml_stream_util.h"
@@ -69,7 +74,7 @@ namespace OpenOrienteering {
 constexpr int XMLFileFormat::minimum_version = 2;
 constexpr int XMLFileFormat::current_version = 7;
 
-int XMLFileFormat::active_version = 5; // updated by XMLFileExporter::doExport()
+thread_local int XMLFileFormat::active_version = 5; // updated by XMLFileExporter::doExport()
 
 
 
@@ -83,6 +88,52 @@ QString mapperNamespace()
 	return QStringLiteral("http://openorienteering.org/apps/mapper/xml/v2");
 }
 
+
+/**
+ * Maps the character offsets reported by QXmlStreamReader to byte offsets
+ * in UTF-8 data.
+ * 
+ * QXmlStreamReader counts UTF-16 code units. Offsets must be requested in
+ * ascending order.
+ */
+class Utf8Offsets
+{
+public:
+	Utf8Offsets(const QByteArray& data, int begin)
+	: data(data)
+	, pos(begin)
+	{}
+	
+	int byteOffset(qint64 character_offset)
+	{
+		for (; characters < character_offset && pos < data.size(); ++pos)
+		{
+			auto const byte = quint8(data.at(pos));
+			if ((byte & 0xC0) != 0x80)
+				characters += (byte >= 0xF0) ? 2 : 1;  // Leading byte
+		}
+		while (pos < data.size() && (quint8(data.at(pos)) & 0xC0) == 0x80)
+			++pos;
+		return pos;
+	}
+	
+private:
+	const QByteArray& data;
+	int pos;
+	qint64 characters = 0;
+};
+
+
+/**
+ * Writes XML data which was written by another QXmlStreamWriter.
+ */
+void writeFragment(QXmlStreamWriter& xml, const QByteArray& fragment)
+{
+	xml.writeCharacters(QString{});  // completes a pending start element
+	xml.device()->write(fragment);
+}
+
+
 }  // namespace
 
 
@@ -157,6 +208,7 @@ namespace literal
 	
 	static const QLatin1String parts("parts");
 	static const QLatin1String part("part");
+	static const QLatin1String objects("objects");
 	
 	static const QLatin1String templates("templates");
 	static const QLatin1String template_string("template");
@@ -186,7 +238,8 @@ namespace literal
 
 XMLFileExporter::XMLFileExporter(QIODevice* stream, Map *map, MapView *view)
 : Exporter(stream, map, view),
-  xml(stream)
+  xml(stream),
+  snapshot(nullptr)
 {
 	// Determine auto-formatting default from filename, if possible.
 	auto file = qobject_cast<const QFileDevice*>(stream);
@@ -375,6 +428,21 @@ void XMLFileExporter::exportSymbols()
 
 void XMLFileExporter::exportMapParts()
 {
+	if (snapshot)
+	{
+		// The cache saves only the objects which changed since the last update.
+		const auto& cache = map->getXmlObjectCache();
+		snapshot->parts.resize(std::size_t(map->getNumParts()));
+		for (std::size_t i = 0; i < snapshot->parts.size(); ++i)
+		{
+			auto map_part = map->getPart(i);
+			snapshot->parts[i].name = map_part->getName();
+			snapshot->parts[i].objects = cache.fragments(map_part);
+		}
+		snapshot->parts_pos = stream->pos();
+		return;
+	}
+	
 	XmlElementWriter parts_element(xml, literal::parts);
 	
 	auto num_parts = std::size_t(map->getNumParts());
@@ -467,25 +535,120 @@ void XMLFileExporter::exportPrint()
 
 void XMLFileExporter::exportUndo()
 {
+	if (snapshot)
+	{
+		xml.writeCharacters(QString{});  // completes the barrier element
+		snapshot->steps_pos = stream->pos();
+		snapshot->undo_steps = map->undoManager().undoData();
+		return;
+	}
+	
 	map->undoManager().saveUndo(xml);
 	writeLineBreak(xml);
 }
 
 void XMLFileExporter::exportRedo()
 {
+	if (snapshot)
+	{
+		snapshot->redo_steps = map->undoManager().redoData();
+		return;
+	}
+	
 	map->undoManager().saveRedo(xml);
 	writeLineBreak(xml);
 }
 
 
 
+// ### XMLFileSnapshot definition ###
+
+XMLFileSnapshot::XMLFileSnapshot(Map& map, MapView* view, const QString& path)
+: parts_pos(0)
+, steps_pos(-1)
+, current_part(map.getCurrentPartIndex())
+, auto_formatting(path.contains(QLatin1String(".xmap")))
+{
+	QBuffer buffer(&data);
+	buffer.open(QIODevice::WriteOnly);
+	XMLFileExporter exporter(&buffer, &map, view);
+	exporter.setOption(QString::fromLatin1("autoFormatting"), auto_formatting);
+	exporter.snapshot = this;
+	exporter.doExport();
+}
+
+XMLFileSnapshot::~XMLFileSnapshot() = default;
+
+
+bool XMLFileSnapshot::save(const QString& path) const
+{
+	QSaveFile file(path);
+	if (!file.open(QIODevice::WriteOnly))
+		return false;
+	
+	file.write(data.constData(), parts_pos);
+	{
+		// Same structure as written by XMLFileExporter::exportMapParts()
+		QXmlStreamWriter xml(&file);
+		xml.setAutoFormatting(auto_formatting);
+		XmlElementWriter parts_element(xml, literal::parts);
+		parts_element.writeAttribute(literal::count, parts.size());
+		parts_element.writeAttribute(literal::current, current_part);
+		for (const auto& part : parts)
+		{
+			writeLineBreak(xml);
+			XmlElementWriter part_element(xml, literal::part);
+			part_element.writeAttribute(literal::name, part.name);
+			XmlElementWriter objects_element(xml, literal::objects);
+			objects_element.writeAttribute(literal::count, part.objects->size());
+			for (const auto& object : *part.objects)
+			{
+				writeLineBreak(xml);
+				writeFragment(xml, object);
+			}
+			writeLineBreak(xml);
+		}
+		writeLineBreak(xml);
+	}
+	
+	if (steps_pos < 0)
+	{
+		file.write(data.constData() + parts_pos, data.size() - parts_pos);
+		return file.commit();
+	}
+	
+	file.write(data.constData() + parts_pos, steps_pos - parts_pos);
+	{
+		// Same structure as written by XMLFileExporter::exportUndo() and exportRedo()
+		QXmlStreamWriter xml(&file);
+		xml.setAutoFormatting(auto_formatting);
+		{
+			XmlElementWriter undo_element(xml, QLatin1String("undo"));
+			for (const auto& step : undo_steps)
+				writeFragment(xml, step);
+		}
+		writeLineBreak(xml);
+		{
+			XmlElementWriter redo_element(xml, QLatin1String("redo"));
+			for (const auto& step : redo_steps)
+				writeFragment(xml, step);
+		}
+		writeLineBreak(xml);
+	}
+	file.write(data.constData() + steps_pos, data.size() - steps_pos);
+	
+	return file.commit();
+}
+
+
+
 // ### XMLFileImporter definition ###
 
 XMLFileImporter::XMLFileImporter(QIODevice* stream, Map *map, MapView *view)
 : Importer(stream, map, view),
   xml(stream)
 {
-	//NOP
+	setOption(QString::fromLatin1("streamObjects"), false);
 }
 
 void XMLFileImporter::addWarningUnsupportedElement()
@@ -499,6 +662,9 @@ void XMLFileImporter::addWarningUnsupportedElement()
 
 void XMLFileImporter::import(bool load_symbols_only)
 {
+	if (!load_symbols_only && option(QString::fromLatin1("streamObjects")).toBool())
+		prepareObjectStream();
+	
 	if (!xml.readNextStartElement() || xml.name() != literal::map)
 	{
 		xml.raiseError(::OpenOrienteering::Importer::tr("Unsupported file format."));
@@ -550,6 +716,97 @@ void XMLFileImporter::import(bool load_symbols_only)
 	}
 }
 
+void XMLFileImporter::prepareObjectStream()
+{
+	object_data = stream->readAll();
+	object_data_begin = object_data_end = -1;
+	
+	// Locate the map parts section and the first part's start tag by parsing
+	// the document. The reported character offsets are mapped to byte offsets
+	// which requires UTF-8 data.
+	auto parts_begin = qint64(-1);
+	auto first_part_end = qint64(-1);
+	auto parts_end = qint64(-1);
+	{
+		QXmlStreamReader reader(object_data);
+		auto is_utf8 = false;
+		auto depth = 0;
+		auto offset = reader.characterOffset();
+		while (parts_end < 0 && !reader.atEnd())
+		{
+			switch (reader.readNext())
+			{
+			case QXmlStreamReader::StartDocument:
+				is_utf8 = reader.documentEncoding().isEmpty()
+				          || reader.documentEncoding().compare(QLatin1String("UTF-8"), Qt::CaseInsensitive) == 0;
+				break;
+				
+			case QXmlStreamReader::StartElement:
+				++depth;
+				if (depth == 2 && reader.name() == literal::parts)
+				{
+					parts_begin = offset;
+				}
+				else if (depth >= 2)
+				{
+					if (depth == 3 && first_part_end < 0 && reader.name() == literal::part)
+						first_part_end = reader.characterOffset();
+					reader.skipCurrentElement();
+					--depth;
+				}
+				break;
+				
+			case QXmlStreamReader::EndElement:
+				if (depth == 2)
+					parts_end = reader.characterOffset();
+				--depth;
+				break;
+				
+			default:
+				break;
+			}
+			offset = reader.characterOffset();
+		}
+		if (!is_utf8 || reader.hasError() || first_part_end < 0)
+			parts_end = -1;
+	}
+	
+	auto part_tag_end = -1;
+	if (parts_end >= 0)
+	{
+		// A byte order mark is not reported as a character.
+		Utf8Offsets offsets(object_data, object_data.startsWith("\xEF\xBB\xBF") ? 3 : 0);
+		object_data_begin = offsets.byteOffset(parts_begin);
+		part_tag_end = offsets.byteOffset(first_part_end) - 1;
+		object_data_end = offsets.byteOffset(parts_end);
+		if (object_data_end > object_data.size()
+		    || qstrncmp(object_data.constData() + object_data_begin, "<parts", 6) != 0
+		    || object_data.at(part_tag_end) != '>'
+		    || object_data.at(object_data_end - 1) != '>')
+			parts_end = -1;
+	}
+	
+	if (parts_end < 0)
+	{
+		object_data_begin = object_data_end = -1;
+		document_buffer.setData(object_data);
+		object_data.clear();
+	}
+	else
+	{
+		QByteArray document;
+		document.reserve(part_tag_end + 20 + object_data.size() - object_data_end);
+		document.append(object_data.constData(), part_tag_end + 1);
+		if (object_data.at(part_tag_end - 1) != '/')
+			document.append("</part>");
+		document.append("</parts>");
+		document.append(object_data.constData() + object_data_end, object_data.size() - object_data_end);
+		document_buffer.setData(document);
+	}
+	document_buffer.open(QIODevice::ReadOnly);
+	xml.setDevice(&document_buffer);
+}
+
 void XMLFileImporter::importElements(bool load_symbols_only)
 {
 	while (xml.readNextStartElement())
@@ -888,10 +1145,20 @@ void XMLFileImporter::importMapParts()
 		}
 	}
 	
+	if (object_data_begin >= 0 && !map->parts.empty())
+	{
+		// The objects are loaded by the object stream, starting with the
+		// first batch which determines the bounds offset.
+		auto object_stream = std::make_unique<XmlObjectStream>(object_data, object_data_begin, object_data_end, *map, symbol_dict, current_part_index);
+		object_data.clear();
+		if (object_stream->readFirstObjects())
+			map->object_stream = std::move(object_stream);
+	}
+	
 	if (current_part_index < map->parts.size())
 		map->current_part_index = current_part_index;
 	
-	if (num_parts > 0 && num_parts != map->parts.size())
+	if (num_parts > 0 && num_parts != map->parts.size() && !map->object_stream)
 		addWarning(tr("Expected %1 map parts, found %2.").
 		  arg(num_parts).
 		  arg(map->parts.size())
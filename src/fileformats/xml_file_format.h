@@ -21,6 +21,12 @@
 #define OPENORIENTEERING_FILE_FORMAT_XML_H
 
 #include <cstddef>
+#include <memory>
+#include <vector>
+
+#include <QtGlobal>
+#include <QByteArray>
+#include <QString>
 
 #include "fileformats/file_format.h"
 
@@ -68,9 +74,61 @@ public:
 	/** @brief The actual XML file format version to be written.
 	 * 
 	 * This value must be less than or equal to current_version.
+	 * 
+	 * Each thread has its own value, so that maps can be exported in parallel.
 	 */
-	static int active_version;
+	static thread_local int active_version;
+	
+};
+
+
+
+/**
+ * A snapshot of a map which can be saved in the XML format on another thread.
+ * 
+ * Taking the snapshot is cheap compared to exporting the map: The XML data
+ * of the objects and of the undo and redo steps is shared with the caches of
+ * the map and of the undo manager (cf. Map::getXmlObjectCache() and
+ * UndoManager::undoData()), so only objects and steps which changed since the
+ * previous snapshot are saved again. Everything else, i.e. colors, symbols,
+ * templates and view, is exported to a memory buffer immediately.
+ * 
+ * save() writes the buffered and the shared data to a file. It does not
+ * access the original map, and it may be called on any thread.
+ * 
+ * The constructor throws a FileFormatException if the map cannot be exported.
+ */
+class XMLFileSnapshot
+{
+public:
+	/** Takes a snapshot of the map and view, for saving it to the given path. */
+	XMLFileSnapshot(Map& map, MapView* view, const QString& path);
+	
+	XMLFileSnapshot(const XMLFileSnapshot&) = delete;
+	XMLFileSnapshot& operator=(const XMLFileSnapshot&) = delete;
+	
+	~XMLFileSnapshot();
+	
+	/** Saves the snapshot to the given path. Returns true on success. */
+	bool save(const QString& path) const;
+	
+private:
+	friend class XMLFileExporter;
+	
+	struct Part
+	{
+		QString name;
+		std::shared_ptr<const std::vector<QByteArray>> objects;  ///< The XML data of the objects
+	};
 	
+	QByteArray data;                     ///< The exported map, without the parts and steps
+	qint64 parts_pos;                    ///< The position of the parts in data
+	qint64 steps_pos;                    ///< The position of the undo and redo steps in data, or -1
+	std::size_t current_part;
+	bool auto_formatting;
+	std::vector<Part> parts;
+	std::vector<QByteArray> undo_steps;  ///< The XML data of the undo steps
+	std::vector<QByteArray> redo_steps;  ///< The XML data of the redo steps
 };
 
 
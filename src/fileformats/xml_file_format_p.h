@@ -21,6 +21,8 @@
 #ifndef OPENORIENTEERING_FILE_FORMAT_XML_P_H
 #define OPENORIENTEERING_FILE_FORMAT_XML_P_H
 
+#include <QBuffer>
+#include <QByteArray>
 #include <QCoreApplication>
 #include <QXmlStreamReader>
 #include <QXmlStreamWriter>
@@ -45,19 +47,28 @@ protected:
 	void exportGeoreferencing();
 	void exportColors();
 	void exportSymbols();
-	void exportMapParts();
+	virtual void exportMapParts();
 	void exportTemplates();
 	void exportView();
 	void exportPrint();
 	void exportUndo();
 	void exportRedo();
 	
-private:
 	QXmlStreamWriter xml;
+	
+private:
+	friend class XMLFileSnapshot;
+	
+	XMLFileSnapshot* snapshot;  ///< If set, the map parts are left to the snapshot.
 };
 
 
-/** Map importer for the xml based map format. */
+/**
+ * Map importer for the xml based map format.
+ * 
+ * When the option "streamObjects" is set, the objects of the map parts are
+ * left to an XmlObjectStream which continues loading after the import.
+ */
 class XMLFileImporter : public Importer
 {
 	Q_DECLARE_TR_FUNCTIONS(OpenOrienteering::XMLFileImporter)
@@ -69,6 +80,15 @@ public:
 protected:
 	void import(bool load_symbols_only) override;
 	
+	/**
+	 * Separates the map parts section from the rest of the document.
+	 * 
+	 * The document is read completely. The importer continues with a document
+	 * where the map parts section is reduced to the attributes of the first
+	 * part. If the section cannot be located, the full document is used.
+	 */
+	void prepareObjectStream();
+	
 	void importElements(bool load_symbols_only);
 	
 	void addWarningUnsupportedElement();
@@ -76,7 +96,7 @@ protected:
 	void importGeoreferencing(bool load_symbols_only);
 	void importColors();
 	void importSymbols();
-	void importMapParts();
+	virtual void importMapParts();
 	void importTemplates();
 	void importView();
 	void importPrint();
@@ -86,6 +106,12 @@ protected:
 	QXmlStreamReader xml;
 	SymbolDictionary symbol_dict;
 	bool georef_offset_adjusted;
+	
+private:
+	QBuffer document_buffer;      ///< The document without the map parts section
+	QByteArray object_data;       ///< The original document
+	int object_data_begin = -1;   ///< The start of the map parts section in object_data
+	int object_data_end = -1;     ///< The end of the map parts section in object_data
 };
 
 
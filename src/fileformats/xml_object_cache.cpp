@@ -0,0 +1,174 @@
+/*
+ *    Copyright 2018 The OpenOrienteering developers
+ *
+ *    This file is part of OpenOrienteering.
+ *
+ *    OpenOrienteering is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    OpenOrienteering is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with OpenOrienteering.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "xml_object_cache.h"
+
+#include <cstddef>
+#include <utility>
+
+#include <QtGlobal>
+#include <QBuffer>
+#include <QHash>
+#include <QIODevice>
+#include <QXmlStreamWriter>
+
+#include "core/map.h"
+#include "core/map_part.h"
+#include "core/objects/object.h"
+#include "fileformats/xml_file_format.h"
+
+
+namespace OpenOrienteering {
+
+namespace {
+
+/**
+ * Writes the XML data of objects into separate fragments.
+ */
+class FragmentWriter
+{
+public:
+	FragmentWriter(const Map& map, const std::vector<const Symbol*>& symbols)
+	: map(map)
+	, xml(&buffer)
+	{
+		for (std::size_t i = 0; i < symbols.size(); ++i)
+			symbol_index.insert(symbols[i], int(i));
+		buffer.open(QIODevice::WriteOnly);
+	}
+
+	QByteArray operator()(const Object& object)
+	{
+		auto index = symbol_index.value(object.getSymbol(), -1);
+		if (index == -1)
+			index = map.findSymbolIndex(object.getSymbol());  // undefined symbols
+
+		auto const pos = int(buffer.pos());
+		object.save(xml, index);
+		return buffer.data().mid(pos);
+	}
+
+private:
+	const Map& map;
+	QHash<const Symbol*, int> symbol_index;
+	QBuffer buffer;
+	QXmlStreamWriter xml;
+};
+
+
+}  // namespace
+
+
+
+XmlObjectCache::XmlObjectCache()
+: version(0)
+{
+	// nothing
+}
+
+XmlObjectCache::~XmlObjectCache() = default;
+
+
+void XmlObjectCache::invalidate(const Object* object)
+{
+	invalidated.insert(object);
+}
+
+
+void XmlObjectCache::update(const Map& map)
+{
+	std::vector<const Symbol*> current_symbols;
+	current_symbols.reserve(std::size_t(map.getNumSymbols()));
+	for (int i = 0; i < map.getNumSymbols(); ++i)
+		current_symbols.push_back(map.getSymbol(i));
+	if (current_symbols != symbols || version != XMLFileFormat::active_version)
+	{
+		// The symbol indices or the format are outdated.
+		symbols.swap(current_symbols);
+		version = XMLFileFormat::active_version;
+		entries.clear();
+		invalidated.clear();
+		parts.clear();
+	}
+
+	FragmentWriter fragment(map, symbols);
+
+	// Removes all invalidated objects first, so that they are never
+	// accessed if they were deleted.
+	std::unordered_set<const MapPart*> affected_parts;
+	for (auto object : invalidated)
+	{
+		auto entry = entries.find(object);
+		if (entry != end(entries))
+		{
+			affected_parts.insert(entry->second.part);
+			entries.erase(entry);
+		}
+	}
+	for (auto object : invalidated)
+	{
+		for (int i = 0; i < map.getNumParts(); ++i)
+		{
+			const MapPart* part = map.getPart(std::size_t(i));
+			if (part->contains(object))
+			{
+				affected_parts.insert(part);
+				entries.emplace(object, Entry{ fragment(*object), part });
+				break;
+			}
+		}
+	}
+	invalidated.clear();
+
+	decltype(parts) current_parts;
+	current_parts.reserve(std::size_t(map.getNumParts()));
+	for (int i = 0; i < map.getNumParts(); ++i)
+	{
+		const MapPart* part = map.getPart(std::size_t(i));
+		auto found = parts.find(part);
+		if (found != end(parts) && affected_parts.find(part) == end(affected_parts))
+		{
+			current_parts.emplace(part, std::move(found->second));
+			continue;
+		}
+
+		auto fragments = std::make_shared<Fragments>();
+		fragments->reserve(std::size_t(part->getNumObjects()));
+		for (int j = 0; j < part->getNumObjects(); ++j)
+		{
+			const Object* object = part->getObject(j);
+			auto entry = entries.find(object);
+			if (entry == end(entries))
+				entry = entries.emplace(object, Entry{ fragment(*object), part }).first;
+			fragments->push_back(entry->second.data);
+		}
+		current_parts.emplace(part, std::move(fragments));
+	}
+	parts.swap(current_parts);
+}
+
+
+std::shared_ptr<const XmlObjectCache::Fragments> XmlObjectCache::fragments(const MapPart* part) const
+{
+	return parts.at(part);
+}
+
+
+}  // namespace OpenOrienteering
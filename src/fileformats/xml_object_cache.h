@@ -0,0 +1,105 @@
+/*
+ *    Copyright 2018 The OpenOrienteering developers
+ *
+ *    This file is part of OpenOrienteering.
+ *
+ *    OpenOrienteering is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    OpenOrienteering is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with OpenOrienteering.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef OPENORIENTEERING_XML_OBJECT_CACHE_H
+#define OPENORIENTEERING_XML_OBJECT_CACHE_H
+
+#include <memory>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include <QByteArray>
+
+namespace OpenOrienteering {
+
+class Map;
+class MapPart;
+class Object;
+class Symbol;
+
+
+/**
+ * The XML data of a map's objects, as written by Object::save().
+ *
+ * For each map part, the cache holds the list of the XML fragments of its
+ * objects, in map order. The lists are implicitly shared with their users,
+ * and they are never modified after creation. So they may be passed to
+ * another thread, e.g. for saving a snapshot of the map.
+ *
+ * Objects are identified by their address only. invalidate() marks an object
+ * as added, changed or deleted, without accessing it. update() saves the
+ * invalidated objects again, and it recreates the lists of the affected map
+ * parts, cf. Map::getXmlObjectCache(). When the list of symbols changes, the
+ * symbol indices in the data are outdated, and update() saves all objects.
+ * The same happens when XMLFileFormat::active_version changes.
+ *
+ * The data is written without auto-formatting.
+ */
+class XmlObjectCache
+{
+public:
+	/** The XML fragments of the objects of a map part. */
+	using Fragments = std::vector<QByteArray>;
+
+	XmlObjectCache();
+
+	XmlObjectCache(const XmlObjectCache&) = delete;
+	XmlObjectCache& operator=(const XmlObjectCache&) = delete;
+
+	~XmlObjectCache();
+
+
+	/**
+	 * Marks the object as added, changed or deleted, without accessing it.
+	 */
+	void invalidate(const Object* object);
+
+	/**
+	 * Updates the cache for the current state of the map,
+	 * and for the active XML file format version.
+	 */
+	void update(const Map& map);
+
+	/**
+	 * Returns the XML fragments of the objects of the given part.
+	 *
+	 * The part must be part of the map at the last update().
+	 */
+	std::shared_ptr<const Fragments> fragments(const MapPart* part) const;
+
+
+private:
+	struct Entry
+	{
+		QByteArray data;
+		const MapPart* part;
+	};
+
+	std::vector<const Symbol*> symbols;  ///< The symbols at the last update
+	int version;                         ///< The file format version at the last update
+	std::unordered_map<const Object*, Entry> entries;
+	std::unordered_set<const Object*> invalidated;
+	std::unordered_map<const MapPart*, std::shared_ptr<const Fragments>> parts;
+};
+
+
+}  // namespace OpenOrienteering
+
+#endif
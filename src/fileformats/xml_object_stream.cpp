@@ -0,0 +1,383 @@
+/*
+ *    Copyright 2018 The OpenOrienteering developers
+ *
+ *    This file is part of OpenOrienteering.
+ *
+ *    OpenOrienteering is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    OpenOrienteering is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with OpenOrienteering.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "xml_object_stream.h"
+
+#include <exception>
+#include <iterator>
+#include <utility>
+
+#include <QLatin1String>
+#include <QMessageBox>
+#include <QMetaObject>
+#include <QMutexLocker>
+#include <QRunnable>
+#include <QScopedValueRollback>
+#include <QThreadPool>
+#include <QWidget>
+#include <QXmlStreamAttributes>
+#include <QXmlStreamReader>
+
+#include "core/map.h"
+#include "core/map_part.h"
+#include "core/objects/object.h"
+#include "fileformats/file_format.h"
+#include "fileformats/file_import_export.h"
+
+
+namespace OpenOrienteering {
+
+namespace literal
+{
+	static const QLatin1String part("part");
+	static const QLatin1String objects("objects");
+	static const QLatin1String object("object");
+	static const QLatin1String name("name");
+}
+
+
+/**
+ * Reads the remaining objects of an XmlObjectStream on a worker thread.
+ */
+class XmlObjectStreamRunnable : public QRunnable
+{
+public:
+	explicit XmlObjectStreamRunnable(XmlObjectStream& stream)
+	: stream(stream)
+	{}
+	
+	void run() override
+	{
+		stream.readRemainingObjects();
+	}
+	
+private:
+	XmlObjectStream& stream;
+};
+
+
+constexpr std::size_t XmlObjectStream::batch_size;
+
+
+XmlObjectStream::XmlObjectStream(const QByteArray& data, int begin, int end, Map& map, const SymbolDictionary& symbol_dict, std::size_t current_part_index)
+: map(map)
+, data(data)
+, xml(new QXmlStreamReader(QByteArray::fromRawData(data.constData() + begin, end - begin)))
+, symbol_dict(symbol_dict)
+, current_part_index(current_part_index)
+, canceled(false)
+{
+	connect(this, &XmlObjectStream::objectsAvailable, this, &XmlObjectStream::addObjects, Qt::QueuedConnection);
+
+	// The first part is created by the importer.
+	parts.push_back(map.getPart(0));
+
+	// Enter the map parts element.
+	xml->readNextStartElement();
+}
+
+XmlObjectStream::~XmlObjectStream()
+{
+	canceled = true;
+	if (started && !finished)
+		worker_finished.acquire();
+}
+
+
+
+bool XmlObjectStream::readFirstObjects()
+{
+	Batch batch;
+	auto const more = readBatch(batch);
+	if (xml->hasError())
+		throw FileFormatException(
+		        tr("Error at line %1 column %2: %3")
+		        .arg(xml->lineNumber())
+		        .arg(xml->columnNumber())
+		        .arg(xml->errorString()) );
+
+	addBatch(batch);
+
+	// The worker continues with the bounds offset of the import.
+	bounds_offset = MapCoord::boundsOffset();
+	bounds_offset.check_for_offset = false;
+
+	finished = !more;
+	return more;
+}
+
+void XmlObjectStream::start(QWidget* dialog_parent)
+{
+	Q_ASSERT(!started);
+
+	this->dialog_parent = dialog_parent;
+	started = true;
+	QThreadPool::globalInstance()->start(new XmlObjectStreamRunnable(*this));
+}
+
+void XmlObjectStream::finish()
+{
+	if (finished)
+		return;
+
+	if (started)
+	{
+		worker_finished.acquire();
+	}
+	else
+	{
+		started = true;
+		readRemainingObjects();
+		worker_finished.acquire();
+	}
+
+	std::vector<Batch> remaining;
+	{
+		QMutexLocker locker(&mutex);
+		remaining.swap(batches);
+	}
+	for (auto& batch : remaining)
+		map.updateObjects(addBatch(batch));
+
+	finishStream();
+}
+
+
+
+void XmlObjectStream::addObjects()
+{
+	if (finished)
+		return;
+
+	Batch batch;
+	bool more_batches = false;
+	bool done = false;
+	{
+		QMutexLocker locker(&mutex);
+		if (!batches.empty())
+		{
+			batch = std::move(batches.front());
+			batches.erase(begin(batches));
+		}
+		more_batches = !batches.empty();
+		done = worker_done;
+	}
+
+	if (!batch.objects.empty() || !batch.part_names.empty())
+		map.updateObjects(addBatch(batch));
+
+	if (more_batches)
+	{
+		QMetaObject::invokeMethod(this, "addObjects", Qt::QueuedConnection);
+	}
+	else if (done)
+	{
+		worker_finished.acquire();
+		finishStream();
+	}
+}
+
+
+
+void XmlObjectStream::readRemainingObjects()
+{
+	QScopedValueRollback<MapCoord::BoundsOffset> rollback { MapCoord::boundsOffset() };
+	MapCoord::boundsOffset() = bounds_offset;
+
+	QString error_message;
+	try
+	{
+		bool more = true;
+		while (more && !canceled)
+		{
+			Batch batch;
+			more = readBatch(batch);
+			if (batch.objects.empty() && batch.part_names.empty())
+				continue;
+
+			bool notify = false;
+			{
+				QMutexLocker locker(&mutex);
+				notify = batches.empty();
+				batches.push_back(std::move(batch));
+			}
+			if (notify)
+				emit objectsAvailable();
+		}
+
+		if (xml->hasError())
+			error_message = tr("Error at line %1 column %2: %3")
+			                .arg(xml->lineNumber())
+			                .arg(xml->columnNumber())
+			                .arg(xml->errorString());
+	}
+	catch (FileFormatException& e)
+	{
+		error_message = e.message();
+	}
+	catch (std::exception& e)
+	{
+		error_message = QString::fromLocal8Bit(e.what());
+	}
+
+	{
+		QMutexLocker locker(&mutex);
+		error = error_message;
+		worker_done = true;
+	}
+	emit objectsAvailable();
+	worker_finished.release();
+}
+
+
+bool XmlObjectStream::readBatch(Batch& batch)
+{
+	batch.part = part_index;
+	while (batch.objects.size() < batch_size)
+	{
+		switch (level)
+		{
+			case InParts:
+				if (!xml->readNextStartElement())
+					return false;
+				if (xml->name() == literal::part)
+				{
+					level = InPart;
+					if (first_part_read)
+					{
+						++part_index;
+						batch.part_names.push_back(xml->attributes().value(literal::name).toString());
+						if (!batch.objects.empty())
+							return true;  // The next batch takes the objects of the new part.
+						batch.part = part_index;
+					}
+					first_part_read = true;  // The first part is created by the importer.
+				}
+				else
+				{
+					xml->skipCurrentElement();
+				}
+				break;
+
+			case InPart:
+				if (!xml->readNextStartElement())
+					level = InParts;
+				else if (xml->name() == literal::objects)
+					level = InObjects;
+				else
+					xml->skipCurrentElement();
+				break;
+
+			case InObjects:
+				if (!xml->readNextStartElement())
+				{
+					level = InPart;
+				}
+				else if (xml->name() == literal::object)
+				{
+					std::unique_ptr<Object> object { Object::load(*xml, nullptr, symbol_dict) };
+
+					// Same post processing as in Importer::doImport()
+					if (object->getType() == Object::Path)
+					{
+						PathObject* path = object->asPath();
+						Symbol::Type contained_types = path->getSymbol()->getContainedTypes();
+						if (contained_types & Symbol::Area && !(contained_types & Symbol::Line))
+							path->closeAllParts();
+
+						path->normalize();
+					}
+					batch.objects.push_back(std::move(object));
+				}
+				else
+				{
+					xml->skipCurrentElement();
+				}
+				break;
+		}
+	}
+	return true;
+}
+
+
+std::vector<const Object*> XmlObjectStream::addBatch(Batch& batch)
+{
+	// The stream's parts are appended after all other parts.
+	for (auto& name : batch.part_names)
+	{
+		auto const index = map.parts.size();
+		auto part = new MapPart(name, &map);
+		map.parts.push_back(part);
+		parts.push_back(part);
+		emit map.mapPartAdded(index, part);
+
+		if (parts.size() - 1 == current_part_index && map.current_part_index == 0)
+			map.setCurrentPartIndex(index);
+	}
+
+	auto part = parts[batch.part];
+	std::vector<const Object*> objects;
+	objects.reserve(batch.objects.size());
+	for (auto& loaded : batch.objects)
+	{
+		auto const& coords = loaded->getRawCoordinateVector();
+		auto const irregular = coords.empty() || !coords.front().isRegular() || !coords.back().isRegular();
+		if (irregular && started)
+		{
+			++dropped_objects;
+			continue;
+		}
+
+		auto object = loaded.release();
+		object->setMap(&map);
+		part->appendObject(object);
+		objects.push_back(object);
+		if (irregular)
+			map.markAsIrregular(object);
+	}
+	batch.objects.clear();
+	return objects;
+}
+
+
+void XmlObjectStream::finishStream()
+{
+	finished = true;
+	xml.reset();
+	data.clear();
+
+	if (dialog_parent)
+	{
+		if (!error.isEmpty())
+		{
+			QMessageBox::warning(dialog_parent, tr("Warning"),
+			                     tr("Not all objects could be loaded.") + QLatin1String("\n\n") + error);
+		}
+		else if (dropped_objects > 0)
+		{
+			QMessageBox::warning(dialog_parent, tr("Warning"),
+			                     ::OpenOrienteering::Importer::tr("Dropped %n irregular object(s).", nullptr, int(dropped_objects)));
+		}
+	}
+
+	emit map.objectsLoaded();
+}
+
+
+}  // namespace OpenOrienteering
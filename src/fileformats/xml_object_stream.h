@@ -0,0 +1,213 @@
+/*
+ *    Copyright 2018 The OpenOrienteering developers
+ *
+ *    This file is part of OpenOrienteering.
+ *
+ *    OpenOrienteering is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    OpenOrienteering is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with OpenOrienteering.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef OPENORIENTEERING_XML_OBJECT_STREAM_H
+#define OPENORIENTEERING_XML_OBJECT_STREAM_H
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+#include <QtGlobal>
+#include <QByteArray>
+#include <QMutex>
+#include <QObject>
+#include <QPointer>
+#include <QSemaphore>
+#include <QString>
+
+#include "core/map_coord.h"
+#include "core/symbols/symbol.h"
+
+class QWidget;
+class QXmlStreamReader;
+
+namespace OpenOrienteering {
+
+class Map;
+class MapPart;
+class Object;
+
+
+/**
+ * Loads the objects of the map parts section of a native XML file
+ * on a worker thread.
+ *
+ * The XML importer hands the map parts section to this class when the map
+ * is loaded with object streaming enabled. The first objects are read on the
+ * calling thread, during the import, in order to determine the bounds offset
+ * (cf. MapCoord::boundsOffset()). All other objects are read on a worker
+ * thread after the import, while the map is already displayed. They arrive
+ * on the map's thread in batches: each batch is added to its map part, and
+ * the renderables of its objects are created.
+ *
+ * The batches are added to the map from the event loop. finish() adds all
+ * remaining objects at once. The map calls this function for operations
+ * which need all objects, which may invalidate symbols or map parts, or
+ * which add objects. So new objects never end up before loaded objects.
+ */
+class XmlObjectStream : public QObject
+{
+	Q_OBJECT
+
+public:
+	/** The number of objects which are read into a single batch. */
+	static constexpr std::size_t batch_size = 1000;
+
+	/**
+	 * Creates a stream for the map parts section of the given XML data.
+	 *
+	 * The section must be well-formed XML by itself. The map's parts must
+	 * already contain the first part of the section.
+	 */
+	XmlObjectStream(const QByteArray& data, int begin, int end, Map& map, const SymbolDictionary& symbol_dict, std::size_t current_part_index);
+
+	XmlObjectStream(const XmlObjectStream&) = delete;
+	XmlObjectStream& operator=(const XmlObjectStream&) = delete;
+
+	/**
+	 * Destroys the stream.
+	 *
+	 * If the worker thread is still running, it is canceled. Objects which
+	 * are not yet added to the map are dropped.
+	 */
+	~XmlObjectStream() override;
+
+
+	/**
+	 * Reads the first batch of objects on the calling thread, and adds them
+	 * to the map without creating renderables.
+	 *
+	 * Returns false if there are no more objects. Throws FileFormatException
+	 * on errors.
+	 */
+	bool readFirstObjects();
+
+	/**
+	 * Starts reading the remaining objects on a worker thread.
+	 *
+	 * If dialog_parent is not nullptr, errors and warnings are reported in
+	 * a message box when all objects are loaded.
+	 */
+	void start(QWidget* dialog_parent);
+
+	/**
+	 * Waits for the worker thread, and adds all remaining objects to the map.
+	 */
+	void finish();
+
+	/**
+	 * Returns true when all objects are added to the map.
+	 */
+	bool isFinished() const { return finished; }
+
+
+signals:
+	/**
+	 * Emitted from the worker thread when objects are waiting to be added,
+	 * or when reading has come to an end.
+	 */
+	void objectsAvailable();
+
+
+private slots:
+	/**
+	 * Adds the next batch of objects to the map.
+	 *
+	 * When there are more batches, another call is scheduled, so that the
+	 * event loop may handle input and repaint in between.
+	 */
+	void addObjects();
+
+
+private:
+	friend class XmlObjectStreamRunnable;
+
+	struct Batch
+	{
+		std::size_t part;                ///< The stream's index of the objects' part
+		std::vector<QString> part_names; ///< The names of the parts started in this batch
+		std::vector<std::unique_ptr<Object>> objects;
+	};
+
+	/**
+	 * Reads the remaining objects.
+	 *
+	 * This runs on the worker thread, or on the calling thread of finish()
+	 * if the stream was not started.
+	 */
+	void readRemainingObjects();
+
+	/**
+	 * Reads the next batch of objects.
+	 *
+	 * A batch holds objects from a single map part only. Returns false at the
+	 * end of the map parts section.
+	 */
+	bool readBatch(Batch& batch);
+
+	/**
+	 * Adds the objects of a batch to the map, and returns them.
+	 *
+	 * Irregular objects are marked for the importer during the import,
+	 * and dropped later.
+	 */
+	std::vector<const Object*> addBatch(Batch& batch);
+
+	/** Releases the data, and reports errors and warnings. */
+	void finishStream();
+
+
+	enum Level
+	{
+		InParts,
+		InPart,
+		InObjects
+	};
+
+	Map& map;
+	QByteArray data;
+	std::unique_ptr<QXmlStreamReader> xml;
+	SymbolDictionary symbol_dict;
+	MapCoord::BoundsOffset bounds_offset;
+
+	Level level = InParts;
+	std::size_t part_index = 0;
+	bool first_part_read = false;
+	std::vector<MapPart*> parts;
+	std::size_t current_part_index;
+
+	QMutex mutex;
+	std::vector<Batch> batches;     ///< Read, but not yet added. Guarded by mutex.
+	bool worker_done = false;       ///< Guarded by mutex.
+	QString error;                  ///< Set by the worker before worker_done.
+	std::size_t dropped_objects = 0; ///< Irregular objects which were not added
+
+	QSemaphore worker_finished;
+	std::atomic_bool canceled;
+	bool started = false;
+	bool finished = false;
+	QPointer<QWidget> dialog_parent;
+};
+
+
+}  // namespace OpenOrienteering
+
+#endif
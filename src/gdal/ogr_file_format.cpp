@@ -21,6 +21,7 @@
 #include "ogr_file_format_p.h"
 
 #include <algorithm>
+#include <cstddef>
 #include <iterator>
 #include <memory>
 #include <vector>
@@ -913,9 +914,9 @@ PathObject* OgrFileImport::importLineStringGeometry(OGRFeatureH feature, OGRGeom
 	
 	auto style = OGR_F_GetStyleString(feature);
 	auto object = new PathObject(getSymbol(Symbol::Line, style));
-	for (int i = 0; i < num_points; ++i)
+	for (auto& coord : toMapCoords(geometry))
 	{
-		object->addCoordinate(toMapCoord(OGR_G_GetX(geometry, i), OGR_G_GetY(geometry, i)));
+		object->addCoordinate(coord);
 	}
 	return object;
 }
@@ -945,19 +946,18 @@ PathObject* OgrFileImport::importPolygonGeometry(OGRFeatureH feature, OGRGeometr
 	
 	auto style = OGR_F_GetStyleString(feature);
 	auto object = new PathObject(getSymbol(Symbol::Area, style));
-	for (int i = 0; i < num_points; ++i)
+	for (auto& coord : toMapCoords(outline))
 	{
-		object->addCoordinate(toMapCoord(OGR_G_GetX(outline, i), OGR_G_GetY(outline, i)));
+		object->addCoordinate(coord);
 	}
 	
 	for (int g = 1; g < num_geometries; ++g)
 	{
 		bool start_new_part = true;
 		auto hole = /*OGR_G_ForceToLineString*/(OGR_G_GetGeometryRef(geometry, g));
-		auto num_points = OGR_G_GetPointCount(hole);
-		for (int i = 0; i < num_points; ++i)
+		for (auto& coord : toMapCoords(hole))
 		{
-			object->addCoordinate(toMapCoord(OGR_G_GetX(hole, i), OGR_G_GetY(hole, i)), start_new_part);
+			object->addCoordinate(coord, start_new_part);
 			start_new_part = false;
 		}
 	}
@@ -1360,6 +1360,36 @@ AreaSymbol* OgrFileImport::getSymbolForBrush(OGRStyleToolH tool, const QByteArra
 }
 
 
+MapCoordVector OgrFileImport::toMapCoords(OGRGeometryH geometry) const
+{
+	MapCoordVector coords;
+	auto num_points = OGR_G_GetPointCount(geometry);
+	if (num_points <= 0)
+		return coords;
+	
+	auto const size = std::size_t(num_points);
+	std::vector<double> x(size), y(size);
+	OGR_G_GetPoints(geometry, x.data(), sizeof(double), y.data(), sizeof(double), nullptr, 0);
+	
+	coords.reserve(size);
+	if (to_map_coord == &OgrFileImport::fromProjected)
+	{
+		std::vector<QPointF> projected_coords(size);
+		for (std::size_t i = 0; i < size; ++i)
+			projected_coords[i] = { x[i], y[i] };
+		std::vector<MapCoordF> map_coords(size);
+		map->getGeoreferencing().toMapCoordF(projected_coords.data(), size, map_coords.data());
+		for (const auto& map_coord : map_coords)
+			coords.push_back(MapCoord::load(map_coord, MapCoord::Flags{}));
+	}
+	else
+	{
+		for (std::size_t i = 0; i < size; ++i)
+			coords.push_back(toMapCoord(x[i], y[i]));
+	}
+	return coords;
+}
+
 MapCoord OgrFileImport::fromDrawing(double x, double y) const
 {
 	return MapCoord::load(x, -y, MapCoord::Flags{});
@@ -206,6 +206,13 @@ protected:
 	
 	MapCoord toMapCoord(double x, double y) const;
 	
+	/**
+	 * Returns the points of the given geometry as map coordinates.
+	 * 
+	 * All points are fetched and converted in a single batch.
+	 */
+	MapCoordVector toMapCoords(OGRGeometryH geometry) const;
+	
 	/**
 	 * A MapCoordConstructor which interpretes the given coordinates in millimeters on paper.
 	 */
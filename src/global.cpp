@@ -23,6 +23,7 @@
 
 #include "mapper_config.h" // IWYU pragma: keep
 
+#include "fileformats/binary_file_format.h"
 #include "fileformats/file_format_registry.h"
 #include "fileformats/native_file_format.h"
 #include "fileformats/xml_file_format.h"
@@ -36,6 +37,7 @@ void doStaticInitializations()
 {
 	// Register the supported file formats
 	FileFormats.registerFormat(new XMLFileFormat());
+	FileFormats.registerFormat(new BinaryFileFormat());
 #ifndef MAPPER_BIG_ENDIAN
 	FileFormats.registerFormat(new OcdFileFormat());
 #endif
@@ -974,8 +974,9 @@ void MainWindow::setHasAutosaveConflict(bool value)
 	}
 }
 
-bool MainWindow::removeAutosaveFile() const
+bool MainWindow::removeAutosaveFile()
 {
+	waitForAutosave();
 	if (!currentPath().isEmpty() && !has_autosave_conflict)
 	{
 		QFile autosave_file(autosavePath(currentPath()));
@@ -1013,6 +1014,48 @@ Autosave::AutosaveResult MainWindow::autosave()
 	}
 }
 
+Autosave::BackgroundAutosave MainWindow::prepareAutosave(Autosave::AutosaveResult& result)
+{
+	QString path = currentPath();
+	if (path.isEmpty() || !controller)
+	{
+		result = Autosave::PermanentFailure;
+		return {};
+	}
+	else if (controller->isEditingInProgress())
+	{
+		result = Autosave::TemporaryFailure;
+		return {};
+	}
+	
+	auto export_snapshot = controller->exportSnapshot(autosavePath(path));
+	if (!export_snapshot)
+	{
+		result = autosave();
+		return {};
+	}
+	
+	showStatusBarMessage(tr("Autosaving..."), 0);
+	return [export_snapshot]() {
+		return export_snapshot() ? Autosave::Success : Autosave::PermanentFailure;
+	};
+}
+
+void MainWindow::autosaveFinished(Autosave::AutosaveResult result)
+{
+	if (result == Autosave::Success)
+	{
+		clearStatusBarMessage();
+		// The file may have been saved while autosaving.
+		if (!autosaveNeeded())
+			removeAutosaveFile();
+	}
+	else
+	{
+		showStatusBarMessage(tr("Autosaving failed!"), 6000);
+	}
+}
+
 bool MainWindow::save()
 {
 	return savePath(currentPath());
@@ -308,6 +308,16 @@ public slots:
 	 */
 	Autosave::AutosaveResult autosave() override;
 	
+	/** Take a snapshot of the current content for saving it to the
+	 *  autosave path on a worker thread.
+	 *  Falls back to autosave() if the controller doesn't support snapshots.
+	 */
+	Autosave::BackgroundAutosave prepareAutosave(Autosave::AutosaveResult& result) override;
+	
+	/** Reports the result of saving a snapshot.
+	 */
+	void autosaveFinished(Autosave::AutosaveResult result) override;
+	
 	/**
 	 * Close the file currently opened.
 	 * 
@@ -419,9 +429,10 @@ protected:
 	/**
 	 * Removes the autosave file if it exists.
 	 * 
+	 * Waits for a running autosave to finish before.
 	 * Returns true if the file was removed or didn't exist, false otherwise.
 	 */
-	bool removeAutosaveFile() const;
+	bool removeAutosaveFile();
 	
 	bool event(QEvent* event) override;
 	void closeEvent(QCloseEvent *event) override;
@@ -46,6 +46,12 @@ bool MainWindowController::exportTo(const QString& path, const FileFormat* forma
 	return false;
 }
 
+std::function<bool ()> MainWindowController::exportSnapshot(const QString& path)
+{
+	Q_UNUSED(path);
+	return {};
+}
+
 bool MainWindowController::load(const QString& path, QWidget* dialog_parent)
 {
 	Q_UNUSED(path);
@@ -22,6 +22,8 @@
 #ifndef OPENORIENTEERING_MAIN_WINDOW_CONTROLLER_H
 #define OPENORIENTEERING_MAIN_WINDOW_CONTROLLER_H
 
+#include <functional>
+
 #include <QObject>
 #include <QString>
 
@@ -59,6 +61,16 @@ public:
 	 */
 	virtual bool exportTo(const QString& path, const FileFormat* format = nullptr);
 
+	/** Take a snapshot for exporting to a file in the background.
+	 *  The returned function writes the snapshot to the given path. It may
+	 *  be called from another thread, and without the controller.
+	 *  The default implementation returns an empty function, meaning that
+	 *  the controller doesn't support background export.
+	 *  @param path the path to export to
+	 *  @return a function which exports the snapshot, or an empty function
+	 */
+	virtual std::function<bool ()> exportSnapshot(const QString& path);
+
 	/** Load from a file.
 	 *  @param path the path to load from
 	 *  @param dialog_parent Alternative parent widget for all dialogs.
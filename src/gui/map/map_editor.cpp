@@ -24,9 +24,11 @@
 
 #include <algorithm>
 #include <cstddef>
+#include <exception>
 #include <functional>
 #include <iterator>
 #include <limits>
+#include <memory>
 #include <set>
 #include <vector>
 // IWYU pragma: no_include <ext/alloc_traits.h>
@@ -110,6 +112,7 @@
 #include "core/symbols/symbol_icon_decorator.h"
 #include "fileformats/file_format.h"
 #include "fileformats/file_format_registry.h"
+#include "fileformats/xml_file_format.h"
 #include "gui/configure_grid_dialog.h"
 #include "gui/file_dialog.h"
 #include "gui/georeferencing_dialog.h"
@@ -570,6 +573,27 @@ bool MapEditorController::exportTo(const QString& path, const FileFormat* format
 	return false;
 }
 
+std::function<bool ()> MapEditorController::exportSnapshot(const QString& path)
+{
+	if (!map || editing_in_progress || map->isLoadingObjects())
+		return {};
+	
+	auto const format = FileFormats.findFormatForFilename(path);
+	if (format && qstrcmp(format->id(), "XML") != 0)
+		return {};
+	
+	try
+	{
+		auto snapshot = std::make_shared<XMLFileSnapshot>(*map, main_view, path);
+		return [snapshot, path]() { return snapshot->save(path); };
+	}
+	catch (std::exception&)
+	{
+		// Fall back to saving in the foreground.
+		return {};
+	}
+}
+
 bool MapEditorController::load(const QString& path, QWidget* dialog_parent)
 {
 	if (!dialog_parent)
@@ -581,7 +605,7 @@ bool MapEditorController::load(const QString& path, QWidget* dialog_parent)
 		main_view = new MapView(this, map);
 	}
 	
-	bool success = map->loadFrom(path, dialog_parent, main_view);
+	bool success = map->loadFrom(path, dialog_parent, main_view, false, true, true);
 	if (success)
 	{
 		setMapAndView(map, main_view);
@@ -1592,6 +1616,9 @@ bool MapEditorController::keyReleaseEventFilter(QKeyEvent* event)
 void MapEditorController::printClicked(int task)
 {
 #ifdef QT_PRINTSUPPORT_LIB
+	// Printing and exporting must not see objects arriving in between.
+	map->finishLoadingObjects();
+	
 	if (!print_dock_widget)
 	{
 		print_dock_widget = new EditorDockWidget(QString{}, nullptr, this, window);
@@ -1821,13 +1848,13 @@ void MapEditorController::hatchAreas(bool checked)
 {
 	map->setAreaHatchingEnabled(checked);
 	// Update all areas
-	map->applyOnMatchingObjects(&Object::forceUpdate, ObjectOp::ContainsSymbolType{Symbol::Area});
+	map->updateRenderableOptions(ObjectOp::ContainsSymbolType{Symbol::Area});
 }
 
 void MapEditorController::baselineView(bool checked)
 {
 	map->setBaselineViewEnabled(checked);
-	map->updateAllObjects();
+	map->updateRenderableOptions();
 }
 
 void MapEditorController::hideAllTemplates(bool checked)
@@ -2616,7 +2643,7 @@ void MapEditorController::switchSymbolClicked()
 				Q_ASSERT(!new_objects.empty());
 				if (!new_objects.empty())
 				{
-					new_objects.front()->setTags(path_object->tags());
+					new_objects.front()->setTags(path_object->tagList());
 				}
 			}
 		}
@@ -2720,6 +2747,8 @@ void MapEditorController::fillBorderClicked()
 }
 void MapEditorController::selectObjectsClicked(bool select_exclusively)
 {
+	map->finishLoadingObjects();
+	
 	bool selection_changed = false;
 	if (select_exclusively)
 	{
@@ -2757,6 +2786,8 @@ void MapEditorController::selectObjectsClicked(bool select_exclusively)
 
 void MapEditorController::deselectObjectsClicked()
 {
+	map->finishLoadingObjects();
+	
 	bool selection_changed = false;
 	
 	MapPart* part = map->getCurrentPart();
@@ -2781,6 +2812,8 @@ void MapEditorController::deselectObjectsClicked()
 
 void MapEditorController::selectAll()
 {
+	map->finishLoadingObjects();
+	
 	auto num_selected_objects = map->getNumSelectedObjects();
 	map->clearObjectSelection(false);
 	map->getCurrentPart()->applyOnAllObjects([this](Object* object) {
@@ -2803,6 +2836,8 @@ void MapEditorController::selectNothing()
 
 void MapEditorController::invertSelection()
 {
+	map->finishLoadingObjects();
+	
 	auto selection = Map::ObjectSelection{ map->selectedObjects() };
 	map->clearObjectSelection(false);
 	map->getCurrentPart()->applyOnAllObjects([this, &selection](Object* object) {
@@ -22,6 +22,7 @@
 #ifndef OPENORIENTEERING_MAP_EDITOR_H
 #define OPENORIENTEERING_MAP_EDITOR_H
 
+#include <functional>
 #include <memory>
 
 #include <QClipboard>
@@ -232,6 +233,11 @@ public:
 	bool save(const QString& path) override;
 	/** Override from MainWindowController */
 	bool exportTo(const QString& path, const FileFormat* format = nullptr) override;
+	/**
+	 * @copybrief MainWindowController::exportSnapshot
+	 * This implementation supports the XML file format only.
+	 */
+	std::function<bool ()> exportSnapshot(const QString& path) override;
 	/** Override from MainWindowController */
 	bool load(const QString& path, QWidget* dialog_parent = nullptr) override;
 	
@@ -20,7 +20,6 @@
 
 #include "map_find_feature.h"
 
-#include <functional>
 
 #include <QAction>
 #include <QAbstractButton>
@@ -168,6 +167,7 @@ ObjectQuery MapFindFeature::makeQuery() const
 void MapFindFeature::findNext()
 {
 	auto map = controller.getMap();
+	map->finishLoadingObjects();
 	auto first_object = map->getFirstSelectedObject();
 	map->clearObjectSelection(false);
 	
@@ -180,7 +180,8 @@ void MapFindFeature::findNext()
 		return;
 	}
 		
-	auto search = [&first_object, &next_object, &query](Object* object) {
+	const auto compiled_query = CompiledObjectQuery(query);
+	auto search = [&first_object, &next_object, &compiled_query](Object* object) {
 		if (!next_object)
 		{
 			if (first_object)
@@ -188,7 +189,7 @@ void MapFindFeature::findNext()
 				if (object == first_object)
 					first_object = nullptr;
 			}
-			else if (query(object))
+			else if (compiled_query(object))
 			{
 				next_object = object;
 			}
@@ -217,6 +218,7 @@ void MapFindFeature::findNext()
 void MapFindFeature::findAll()
 {
 	auto map = controller.getMap();
+	map->finishLoadingObjects();
 	map->clearObjectSelection(false);
 	
 	auto query = makeQuery();
@@ -228,7 +230,7 @@ void MapFindFeature::findAll()
 	
 	map->getCurrentPart()->applyOnMatchingObjects([map](auto object) {
 		map->addObjectToSelection(object, false);
-	}, std::cref(query));
+	}, query);
 	map->emitSelectionChanged();
 	controller.getWindow()->showStatusBarMessage(OpenOrienteering::TagSelectWidget::tr("%n object(s) selected", nullptr, map->getNumSelectedObjects()), 2000);
 	
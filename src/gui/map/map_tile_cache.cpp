@@ -0,0 +1,275 @@
+/*
+ *    Copyright 2018 The OpenOrienteering developers
+ *
+ *    This file is part of OpenOrienteering.
+ *
+ *    OpenOrienteering is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    OpenOrienteering is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with OpenOrienteering.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "map_tile_cache.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <iterator>
+#include <utility>
+#include <vector>
+
+#include <Qt>
+#include <QElapsedTimer>
+#include <QPainter>
+#include <QRegion>
+#include <QThread>
+
+#include "util/parallel.h"
+
+
+namespace OpenOrienteering {
+
+MapTileCache::MapTileCache() = default;
+
+MapTileCache::~MapTileCache() = default;
+
+
+void MapTileCache::setTransform(const QTransform& transform)
+{
+	Q_ASSERT(transform.type() <= QTransform::TxRotate);
+	if (transform == map_to_tile)
+		return;
+
+	if (!tiles.empty())
+	{
+		fallback_tiles.swap(tiles);
+		fallback_to_tile = tile_to_map * transform;
+	}
+	else if (!fallback_tiles.empty())
+	{
+		fallback_to_tile = fallback_to_tile * tile_to_map * transform;
+	}
+	tiles.clear();
+
+	map_to_tile = transform;
+	tile_to_map = transform.inverted();
+}
+
+
+void MapTileCache::invalidate()
+{
+	for (auto& tile : tiles)
+		tile.second.dirty = true;
+}
+
+void MapTileCache::invalidate(const QRectF& map_rect)
+{
+	if (!map_rect.isValid())
+		return;
+
+	// One pixel extra for antialiasing
+	auto const rect = map_to_tile.mapRect(map_rect).toAlignedRect().adjusted(-1, -1, +1, +1);
+	invalidate(tiles, rect);
+
+	// Outdated fallback tiles are simply dropped.
+	if (!fallback_tiles.empty())
+	{
+		auto const range = tileRange(fallback_to_tile.inverted().mapRect(QRectF(rect)).toAlignedRect());
+		for (auto y = range.top(); y <= range.bottom(); ++y)
+		{
+			for (auto x = range.left(); x <= range.right(); ++x)
+				fallback_tiles.erase(key(x, y));
+		}
+	}
+}
+
+void MapTileCache::invalidatePixels(const QRect& rect)
+{
+	invalidate(tiles, rect);
+}
+
+// static
+void MapTileCache::invalidate(TileMap& tiles, const QRect& rect)
+{
+	auto const range = tileRange(rect);
+	if (qint64(range.width()) * qint64(range.height()) > qint64(tiles.size()))
+	{
+		// Visiting the tiles directly is cheaper.
+		for (auto& tile : tiles)
+		{
+			auto const x = qint32(tile.first >> 32);
+			auto const y = qint32(tile.first & 0xffffffff);
+			if (range.contains(x, y))
+				tile.second.dirty = true;
+		}
+		return;
+	}
+
+	for (auto y = range.top(); y <= range.bottom(); ++y)
+	{
+		for (auto x = range.left(); x <= range.right(); ++x)
+		{
+			auto tile = tiles.find(key(x, y));
+			if (tile != end(tiles))
+				tile->second.dirty = true;
+		}
+	}
+}
+
+void MapTileCache::clear()
+{
+	tiles.clear();
+	fallback_tiles.clear();
+}
+
+void MapTileCache::prune(const QRect& rect)
+{
+	auto const range = tileRange(rect);
+	for (auto tile = begin(tiles); tile != end(tiles); )
+	{
+		auto const x = qint32(tile->first >> 32);
+		auto const y = qint32(tile->first & 0xffffffff);
+		if (range.contains(x, y))
+			++tile;
+		else
+			tile = tiles.erase(tile);
+	}
+}
+
+
+bool MapTileCache::render(const QRect& rect, const Renderer& renderer, int time_limit)
+{
+	QElapsedTimer timer;
+	timer.start();
+
+	auto const range = tileRange(rect);
+	std::vector<QPoint> pending;
+	for (auto y = range.top(); y <= range.bottom(); ++y)
+	{
+		for (auto x = range.left(); x <= range.right(); ++x)
+		{
+			auto tile = tiles.find(key(x, y));
+			if (tile == end(tiles) || tile->second.dirty)
+				pending.emplace_back(x, y);
+		}
+	}
+
+	// Fill in from the center
+	auto const center = range.center();
+	std::sort(begin(pending), end(pending), [center](QPoint a, QPoint b) {
+		return (a - center).manhattanLength() < (b - center).manhattanLength();
+	});
+
+	auto const batch_size = std::size_t(std::max(1, QThread::idealThreadCount()));
+	std::vector<QImage> images;
+	auto first = begin(pending);
+	while (first != end(pending))
+	{
+		auto const last = first + std::min(batch_size, std::size_t(std::distance(first, end(pending))));
+		images.resize(std::size_t(std::distance(first, last)));
+		parallelFor(images.size(), [this, first, &images, &renderer](std::size_t i) {
+			auto const& pos = *(first + i);
+			images[i] = renderTile(pos.x(), pos.y(), renderer);
+		});
+		for (auto& image : images)
+		{
+			tiles[key(first->x(), first->y())] = { std::move(image), false };
+			++first;
+		}
+
+		if (timer.elapsed() >= time_limit)
+			break;
+	}
+
+	auto const complete = first == end(pending);
+	if (complete)
+		fallback_tiles.clear();
+	return complete;
+}
+
+QImage MapTileCache::renderTile(qint32 x, qint32 y, const Renderer& renderer) const
+{
+	QImage image(tile_size, tile_size, QImage::Format_ARGB32_Premultiplied);
+	image.fill(Qt::transparent);
+
+	auto const tile_rect = QRectF(qreal(x) * tile_size, qreal(y) * tile_size, tile_size, tile_size);
+	auto map_rect = tile_to_map.mapRect(tile_rect);
+	map_rect.adjust(-0.001, -0.001, +0.001, +0.001);
+
+	QPainter painter(&image);
+	painter.translate(-tile_rect.topLeft());
+	painter.setWorldTransform(map_to_tile, true);
+	renderer(&painter, map_rect);
+	painter.end();
+
+	return image;
+}
+
+
+void MapTileCache::draw(QPainter* painter, const QRect& rect, QPoint origin) const
+{
+	QRegion missing(rect.translated(origin));
+
+	auto const range = tileRange(rect);
+	for (auto y = range.top(); y <= range.bottom(); ++y)
+	{
+		for (auto x = range.left(); x <= range.right(); ++x)
+		{
+			auto tile = tiles.find(key(x, y));
+			if (tile == end(tiles))
+				continue;
+
+			auto const target = QRect(origin.x() + x * tile_size, origin.y() + y * tile_size, tile_size, tile_size);
+			painter->drawImage(target.topLeft(), tile->second.image);
+			missing -= target;
+		}
+	}
+
+	if (fallback_tiles.empty() || missing.isEmpty())
+		return;
+
+	painter->save();
+	painter->setClipRegion(missing, Qt::IntersectClip);
+	painter->translate(origin);
+	painter->setWorldTransform(fallback_to_tile, true);
+	painter->setRenderHint(QPainter::SmoothPixmapTransform);
+	for (auto const& tile : fallback_tiles)
+	{
+		auto const x = qint32(tile.first >> 32);
+		auto const y = qint32(tile.first & 0xffffffff);
+		painter->drawImage(QPoint(x * tile_size, y * tile_size), tile.second.image);
+	}
+	painter->restore();
+}
+
+
+// static
+quint64 MapTileCache::key(qint32 x, qint32 y)
+{
+	return (quint64(quint32(x)) << 32) | quint64(quint32(y));
+}
+
+// static
+qint32 MapTileCache::tileIndex(int pixel)
+{
+	// Rounding towards negative infinity
+	return pixel >= 0 ? pixel / tile_size : -((-pixel - 1) / tile_size) - 1;
+}
+
+// static
+QRect MapTileCache::tileRange(const QRect& rect)
+{
+	return QRect(QPoint(tileIndex(rect.left()), tileIndex(rect.top())),
+	             QPoint(tileIndex(rect.right()), tileIndex(rect.bottom())));
+}
+
+
+}  // namespace OpenOrienteering
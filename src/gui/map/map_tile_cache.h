@@ -0,0 +1,176 @@
+/*
+ *    Copyright 2018 The OpenOrienteering developers
+ *
+ *    This file is part of OpenOrienteering.
+ *
+ *    OpenOrienteering is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    OpenOrienteering is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with OpenOrienteering.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef OPENORIENTEERING_MAP_TILE_CACHE_H
+#define OPENORIENTEERING_MAP_TILE_CACHE_H
+
+#include <functional>
+#include <unordered_map>
+
+#include <QtGlobal>
+#include <QImage>
+#include <QPoint>
+#include <QRect>
+#include <QRectF>
+#include <QTransform>
+
+class QPainter;
+
+namespace OpenOrienteering {
+
+
+/**
+ * A cache of rendered map tiles.
+ *
+ * The tiles are square images of a fixed size. They are addressed in tile
+ * pixel coordinates, which are map coordinates transformed by the zoom and
+ * rotation of a view, but not by the view's center. So the tiles remain
+ * valid when the view is moved.
+ *
+ * Tiles are rendered by worker threads. Dirty tiles keep their old image
+ * until they are rendered again, and after a change of the transformation,
+ * the old tiles are used as a scaled fallback until the new tiles are ready.
+ */
+class MapTileCache
+{
+public:
+	/**
+	 * A function which draws the given map area to the painter.
+	 *
+	 * The painter is already set up with the transformation to tile pixels.
+	 * The function is called concurrently from multiple threads. It must not
+	 * access Settings or other unsynchronized state of the GUI thread, cf.
+	 * RenderConfig::screenOptions().
+	 */
+	using Renderer = std::function<void (QPainter*, const QRectF&)>;
+
+	/** The width and height of the tiles, in pixels. */
+	static constexpr int tile_size = 256;
+
+
+	/** Constructs an empty cache. */
+	MapTileCache();
+
+	MapTileCache(const MapTileCache&) = delete;
+	MapTileCache& operator=(const MapTileCache&) = delete;
+
+	~MapTileCache();
+
+
+	/**
+	 * Returns the transformation from map coordinates to tile pixels.
+	 */
+	const QTransform& transform() const { return map_to_tile; }
+
+	/**
+	 * Sets the transformation from map coordinates to tile pixels.
+	 *
+	 * The transformation must not contain a translation.
+	 * If it differs from the current one, the current tiles become the
+	 * fallback tiles.
+	 */
+	void setTransform(const QTransform& transform);
+
+
+	/**
+	 * Marks all tiles as dirty.
+	 */
+	void invalidate();
+
+	/**
+	 * Marks the tiles which intersect the given area (in map coordinates)
+	 * as dirty.
+	 */
+	void invalidate(const QRectF& map_rect);
+
+	/**
+	 * Marks the tiles which intersect the given rectangle (in tile pixels)
+	 * as dirty.
+	 */
+	void invalidatePixels(const QRect& rect);
+
+	/**
+	 * Removes all tiles, including the fallback tiles.
+	 */
+	void clear();
+
+	/**
+	 * Removes all tiles which do not intersect the given rectangle
+	 * (in tile pixels).
+	 */
+	void prune(const QRect& rect);
+
+
+	/**
+	 * Renders the missing and dirty tiles which intersect the given rectangle
+	 * (in tile pixels).
+	 *
+	 * Tiles are rendered in batches, starting in the center of the rectangle.
+	 * No further batch is started after time_limit milliseconds.
+	 *
+	 * Each batch has one tile per worker thread, and the calling thread waits
+	 * until the batch is finished. So the time limit is not a hard limit: The
+	 * call may return up to the rendering time of the slowest tile later.
+	 *
+	 * Returns true if all tiles intersecting the rectangle are up to date.
+	 */
+	bool render(const QRect& rect, const Renderer& renderer, int time_limit);
+
+	/**
+	 * Draws the tiles which intersect the given rectangle (in tile pixels).
+	 *
+	 * The origin is the position of tile pixel (0, 0) in painter coordinates.
+	 * Where there are no current tiles, fallback tiles are drawn, if available.
+	 */
+	void draw(QPainter* painter, const QRect& rect, QPoint origin) const;
+
+
+private:
+	struct Tile
+	{
+		QImage image;
+		bool dirty;
+	};
+
+	using TileMap = std::unordered_map<quint64, Tile>;
+
+	static quint64 key(qint32 x, qint32 y);
+
+	static qint32 tileIndex(int pixel);
+
+	static QRect tileRange(const QRect& rect);
+
+	static void invalidate(TileMap& tiles, const QRect& rect);
+
+	QImage renderTile(qint32 x, qint32 y, const Renderer& renderer) const;
+
+
+	TileMap tiles;
+	QTransform map_to_tile;
+	QTransform tile_to_map;
+
+	TileMap fallback_tiles;
+	QTransform fallback_to_tile;  ///< Maps fallback tile pixels to current tile pixels
+};
+
+
+}  // namespace OpenOrienteering
+
+#endif
@@ -86,7 +86,6 @@ MapWidget::MapWidget(bool show_help, bool force_antialiasing, QWidget* parent)
  , pinching_factor(1.0)
  , below_template_cache_dirty_rect(rect())
  , above_template_cache_dirty_rect(rect())
- , map_cache_dirty_rect(rect())
  , drawing_dirty_rect_border(0)
  , activity_dirty_rect_border(0)
  , last_mouse_release_time(QTime::currentTime())
@@ -263,7 +262,11 @@ void MapWidget::viewChanged(MapView::ChangeFlags changes)
 {
 	setDrawingBoundingBox(drawing_dirty_rect_map, drawing_dirty_rect_border, true);
 	setActivityBoundingBox(activity_dirty_rect_map, activity_dirty_rect_border, true);
-	updateEverything();
+	// The map cache tiles do not depend on the center of the view,
+	// and zoom and rotation are taken care of in updateMapCache().
+	below_template_cache_dirty_rect = rect();
+	above_template_cache_dirty_rect = below_template_cache_dirty_rect;
+	update();
 	if (changes.testFlag(MapView::ZoomChange))
 		updateZoomDisplay();
 }
@@ -439,7 +442,8 @@ void MapWidget::markTemplateCacheDirty(const QRectF& view_rect, int pixel_border
 
 void MapWidget::markObjectAreaDirty(const QRectF& map_rect)
 {
-	updateMapRect(map_rect, 0, map_cache_dirty_rect);
+	map_cache.invalidate(map_rect);
+	updateDrawing(map_rect, 0);
 }
 
 void MapWidget::setDrawingBoundingBox(QRectF map_rect, int pixel_border, bool do_update)
@@ -538,15 +542,15 @@ void MapWidget::updateDrawingLaterSlot()
 
 void MapWidget::updateEverything()
 {
-	map_cache_dirty_rect = rect();
-	below_template_cache_dirty_rect = map_cache_dirty_rect;
-	above_template_cache_dirty_rect = map_cache_dirty_rect;
-	update(map_cache_dirty_rect);
+	map_cache.invalidate();
+	below_template_cache_dirty_rect = rect();
+	above_template_cache_dirty_rect = below_template_cache_dirty_rect;
+	update();
 }
 
 void MapWidget::updateEverythingInRect(const QRect& dirty_rect)
 {
-	rectIncludeSafe(map_cache_dirty_rect, dirty_rect);
+	map_cache.invalidatePixels(dirty_rect.translated(-mapCacheOrigin()));
 	rectIncludeSafe(below_template_cache_dirty_rect, dirty_rect);
 	rectIncludeSafe(above_template_cache_dirty_rect, dirty_rect);
 	update(dirty_rect);
@@ -796,8 +800,7 @@ void MapWidget::paintEvent(QPaintEvent* event)
 	
 	QTransform transform = painter.worldTransform();
 	
-	// Update all dirty caches
-	// TODO: It would be an idea to do these updates in a background thread and use the old caches in the meantime
+	// Update all dirty template caches
 	updateAllDirtyCaches();
 	
 	QRect target = exposed;
@@ -847,11 +850,19 @@ void MapWidget::paintEvent(QPaintEvent* event)
 	}
 	
 	const auto map_visibility = view->effectiveMapVisibility();
-	if (!map_cache.isNull() && map_visibility.visible)
+	if (map_visibility.visible)
 	{
+		// Tiles which are not ready yet are filled in by subsequent paint events.
+		if (!updateMapCache(exposed))
+			QTimer::singleShot(0, this, SLOT(update()));  // clazy:exclude=old-style-connect
+		
 		qreal saved_opacity = painter.opacity();
 		painter.setOpacity(map_visibility.opacity);
-		painter.drawImage(target, map_cache, exposed);
+		painter.save();
+		painter.setClipRect(target, Qt::IntersectClip);
+		auto const origin = mapCacheOrigin();
+		map_cache.draw(&painter, exposed.translated(-origin), origin + target.topLeft() - exposed.topLeft());
+		painter.restore();
 		painter.setOpacity(saved_opacity);
 	}
 	
@@ -886,15 +897,17 @@ void MapWidget::paintEvent(QPaintEvent* event)
 
 void MapWidget::resizeEvent(QResizeEvent* event)
 {
-	map_cache_dirty_rect = rect();
-	below_template_cache_dirty_rect = map_cache_dirty_rect;
-	above_template_cache_dirty_rect = map_cache_dirty_rect;
+	below_template_cache_dirty_rect = rect();
+	above_template_cache_dirty_rect = below_template_cache_dirty_rect;
 	
-	if (map_cache.width() < map_cache_dirty_rect.width() ||
-	    map_cache.height() < map_cache_dirty_rect.height())
+	if (below_template_cache.width() < width() ||
+	    below_template_cache.height() < height())
 	{
-		map_cache = QImage();
 		below_template_cache = QImage();
+	}
+	if (above_template_cache.width() < width() ||
+	    above_template_cache.height() < height())
+	{
 		above_template_cache = QImage();
 	}
 	
@@ -1259,73 +1272,67 @@ void MapWidget::updateTemplateCache(QImage& cache, QRect& dirty_rect, int first_
 	dirty_rect.setWidth(-1); // => !dirty_rect.isValid()
 }
 
-void MapWidget::updateMapCache(bool use_background)
+bool MapWidget::updateMapCache(const QRect& viewport_rect)
 {
-	if (map_cache.isNull())
-	{
-		// Lazy allocation of cache image
-		map_cache = QImage(size(), QImage::Format_ARGB32_Premultiplied);
-		map_cache_dirty_rect = rect();
-	}
-	else
-	{
-		// Make sure not to use a bigger draw rect than necessary
-		map_cache_dirty_rect = map_cache_dirty_rect.intersected(rect());
-	}
+	const auto& world_transform = view->worldTransform();
+	map_cache.setTransform({ world_transform.m11(), world_transform.m12(),
+	                         world_transform.m21(), world_transform.m22(),
+	                         0, 0 });
 	
-	// Start drawing
-	QPainter painter;
-	painter.begin(&map_cache);
-	painter.setClipRect(map_cache_dirty_rect);
-	
-	// Fill with background color (TODO: make configurable)
-	if (use_background)
-	{
-		painter.fillRect(map_cache_dirty_rect, Qt::white);
-	}
-	else
-	{
-		QPainter::CompositionMode mode = painter.compositionMode();
-		painter.setCompositionMode(QPainter::CompositionMode_Clear);
-		painter.fillRect(map_cache_dirty_rect, Qt::transparent);
-		painter.setCompositionMode(mode);
-	}
+	// Dirty objects must be updated before rendering concurrently.
+	Map* map = view->getMap();
+	map->updateObjects();
 	
-	RenderConfig::Options options(RenderConfig::Screen | RenderConfig::HelperSymbols);
+	auto options = RenderConfig::screenOptions(RenderConfig::HelperSymbols);
 	bool use_antialiasing = force_antialiasing || Settings::getInstance().getSettingCached(Settings::MapDisplay_Antialiasing).toBool();
-	if (use_antialiasing)
-		painter.setRenderHint(QPainter::Antialiasing);
-	else
+	if (!use_antialiasing)
 		options |= RenderConfig::DisableAntialiasing | RenderConfig::ForceMinSize;
-		
-	Map* map = view->getMap();
-	QRectF map_view_rect = view->calculateViewedRect(viewportToView(map_cache_dirty_rect));
-
-	RenderConfig config = { *map, map_view_rect, view->calculateFinalZoomFactor(), options, 1.0 };
 	
-	painter.translate(width() / 2.0, height() / 2.0);
-	painter.setWorldTransform(view->worldTransform(), true);
+	auto const scaling = view->calculateFinalZoomFactor();
 #ifndef Q_OS_ANDROID
-	if (view->isOverprintingSimulationEnabled())
-		map->drawOverprintingSimulation(&painter, config);
-	else
+	auto const overprinting_simulation = view->isOverprintingSimulationEnabled();
+#else
+	auto const overprinting_simulation = false;
 #endif
-		map->draw(&painter, config);
+	auto const grid_visible = view->isGridVisible();
+	
+	auto renderer = [map, options, scaling, use_antialiasing, overprinting_simulation, grid_visible]
+	                (QPainter* painter, const QRectF& map_rect)
+	{
+		if (use_antialiasing)
+			painter->setRenderHint(QPainter::Antialiasing);
+		
+		RenderConfig config = { *map, map_rect, scaling, options, 1.0 };
+		if (overprinting_simulation)
+			map->drawOverprintingSimulation(painter, config);
+		else
+			map->draw(painter, config);
+		
+		if (grid_visible)
+			map->drawGrid(painter, map_rect);
+	};
 	
-	if (view->isGridVisible())
-		map->drawGrid(&painter, map_view_rect);
+	// Keep the UI responsive: Rendering is continued in another paint event
+	// when this takes too long.
+	const int time_limit = 40; // ms
+	auto const origin = mapCacheOrigin();
+	auto const complete = map_cache.render(viewport_rect.translated(-origin), renderer, time_limit);
 	
-	// Finish drawing
-	painter.end();
+	// Keep tiles around the visible area, for panning.
+	auto const keep_rect = rect().translated(-origin);
+	map_cache.prune(keep_rect.adjusted(-width() / 2, -height() / 2, width() / 2, height() / 2));
 	
-	map_cache_dirty_rect.setWidth(-1); // => !map_cache_dirty_rect.isValid()
+	return complete;
+}
+
+QPoint MapWidget::mapCacheOrigin() const
+{
+	const auto& world_transform = view->worldTransform();
+	return QPointF(width() / 2.0 + world_transform.dx(), height() / 2.0 + world_transform.dy()).toPoint();
 }
 
 void MapWidget::updateAllDirtyCaches()
 {
-	if (map_cache_dirty_rect.isValid())
-		updateMapCache(false);
-	
 	if (!view->areAllTemplatesHidden())
 	{
 		if (below_template_cache_dirty_rect.isValid() && isBelowTemplateVisible())
@@ -43,6 +43,7 @@
 
 #include "core/map_coord.h"
 #include "core/map_view.h"
+#include "gui/map/map_tile_cache.h"
 
 class QContextMenuEvent;
 class QEvent;
@@ -76,7 +77,9 @@ class TouchCursor;
  * are of the same size as the widget area. If then for example the map changes,
  * the other caches do not need to be redrawn.
  * <ul>
- * <li>The <b>map cache</b> contains the currently visible part of the map</li>
+ * <li>The <b>map cache</b> contains tiles of the map around the visible part.
+ *     The tiles are rendered by worker threads, and they are filled in
+ *     progressively when there are many of them.</li>
  * <li>The <b>below template cache</b> contains the currently
  *     visible part of all templates below the map</li>
  * <li>The <b>above template cache</b> contains the currently
@@ -407,12 +410,21 @@ private:
 	 */
 	void updateTemplateCache(QImage& cache, QRect& dirty_rect, int first_template, int last_template, bool use_background);
 	/**
-	 * Redraws the map cache in the map cache dirty rect.
-	 * @param use_background If set to true, fills the cache with white before
-	 *     drawing the map, else makes it transparent.
+	 * Renders the missing and dirty map cache tiles for the given viewport rect.
+	 * 
+	 * Rendering stops after a short time limit. The return value is true if
+	 * all tiles are up to date, and false if another paint event is needed.
+	 */
+	bool updateMapCache(const QRect& viewport_rect);
+	/**
+	 * Returns the position of the map cache's tile pixel (0, 0) in viewport
+	 * coordinates, without pan offset.
+	 * 
+	 * The tiles are placed at whole pixels, so the map may be off by up to
+	 * half a pixel from the exact view position.
 	 */
-	void updateMapCache(bool use_background);
-	/** Redraws all dirty caches. */
+	QPoint mapCacheOrigin() const;
+	/** Redraws all dirty template caches. */
 	void updateAllDirtyCaches();
 	/** Shifts the content in the cache by the given amount of pixels. */
 	void shiftCache(int sx, int sy, QImage& cache);
@@ -503,8 +515,7 @@ private:
 	QRect above_template_cache_dirty_rect;
 	
 	/** Map layer cache  */
-	QImage map_cache;
-	QRect map_cache_dirty_rect;
+	MapTileCache map_cache;
 	
 	// Dirty regions for drawings (tools) and activities
 	/** Dirty rect for the current tool, in viewport coordinates (pixels). */
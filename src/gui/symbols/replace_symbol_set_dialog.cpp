@@ -23,7 +23,6 @@
 
 #include <algorithm>
 #include <cstddef>
-#include <functional>
 #include <iterator>
 
 #include <Qt>
@@ -469,7 +468,7 @@ void ReplaceSymbolSetDialog::updateMappingTable()
 					}
 				}
 			};
-			object_map.applyOnMatchingObjects(update_matching, std::cref(item.query));
+			object_map.applyOnMatchingObjects(update_matching, item.query);
 			if (matching_types != Symbol::NoSymbol)
 			{
 				compatible_symbols = matching_types;
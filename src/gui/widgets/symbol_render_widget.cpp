@@ -42,6 +42,7 @@
 #include "core/symbols/line_symbol.h"
 #include "core/symbols/point_symbol.h"
 #include "core/symbols/symbol.h"
+#include "core/symbols/symbol_icon_cache.h"
 #include "core/symbols/symbol_icon_decorator.h"
 #include "core/symbols/text_symbol.h"
 #include "gui/symbols/symbol_setting_dialog.h"
@@ -87,6 +88,7 @@ SymbolRenderWidget::SymbolRenderWidget(Map* map, bool mobile_mode, QWidget* pare
 , icons_per_row(6)
 , num_rows(5)
 , preferred_size(icons_per_row * icon_size, num_rows * icon_size)
+, icon_cache(new SymbolIconCache(*map))
 , hidden_symbol_decoration(new HiddenSymbolDecorator(icon_size))
 , protected_symbol_decoration(new ProtectedSymbolDecorator(icon_size))
 {	
@@ -156,6 +158,7 @@ SymbolRenderWidget::SymbolRenderWidget(Map* map, bool mobile_mode, QWidget* pare
 	connect(map, &Map::symbolChanged, this, &SymbolRenderWidget::symbolChanged);
 	connect(map, &Map::symbolIconChanged, this, &SymbolRenderWidget::updateSingleIcon);
 	connect(map, &Map::symbolIconZoomChanged, this, &SymbolRenderWidget::updateAll);
+	connect(icon_cache.data(), &SymbolIconCache::iconChanged, this, &SymbolRenderWidget::updateSingleIcon);
 	connect(&Settings::getInstance(), &Settings::settingsChanged, this, &SymbolRenderWidget::settingsChanged);
 }
 
@@ -222,7 +225,8 @@ void SymbolRenderWidget::settingsChanged()
 		for (int i = 0; i < map->getNumSymbols(); ++i)
 		{
 			auto symbol = map->getSymbol(i);
-			if (symbol->getIcon(map).width() != new_size)
+			auto icon = symbol->getCachedIcon();
+			if (!icon.isNull() && icon.width() != new_size)
 				symbol->resetIcon();
 		}
 		updateAll();
@@ -401,7 +405,7 @@ void SymbolRenderWidget::drawIcon(QPainter &painter, int i) const
 	painter.save();
 	
 	Symbol* symbol = map->getSymbol(i);
-	painter.drawImage(0, 0, symbol->getIcon(map));
+	painter.drawImage(0, 0, icon_cache->icon(symbol, Settings::getInstance().getSymbolWidgetIconSizePx()));
 	
 	if (isSymbolSelected(i) || i == current_symbol_index)
 	{
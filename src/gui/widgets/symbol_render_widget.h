@@ -47,6 +47,7 @@ namespace OpenOrienteering {
 
 class Map;
 class Symbol;
+class SymbolIconCache;
 class SymbolIconDecorator;
 class SymbolToolTip;
 
@@ -364,6 +365,7 @@ private:
 	
 	SymbolToolTip* tooltip;
 	
+	QScopedPointer<SymbolIconCache> icon_cache;
 	QScopedPointer<SymbolIconDecorator> hidden_symbol_decoration;
 	QScopedPointer<SymbolIconDecorator> protected_symbol_decoration;
 };
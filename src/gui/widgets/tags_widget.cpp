@@ -139,14 +139,14 @@ void TagsWidget::objectTagsChanged()
 	const Object* object = map->getFirstSelectedObject();
 	if (object)
 	{
-		const Object::Tags& tags = object->tags();
+		const auto& tags = object->tagList();
 		tags_table->clearContents();
-		tags_table->setRowCount(tags.size() + 1);
-		for (Object::Tags::const_iterator tag = tags.constBegin(), end = tags.constEnd(); tag != end; ++tag)
+		tags_table->setRowCount(int(tags.size()) + 1);
+		for (const auto& tag : tags)
 		{
-			tags_table->setItem(row, 0, new QTableWidgetItem(tag.key()));
-			tags_table->item(row, 0)->setData(Qt::UserRole, tag.key());
-			tags_table->setItem(row, 1, new QTableWidgetItem(tag.value()));
+			tags_table->setItem(row, 0, new QTableWidgetItem(tag.first));
+			tags_table->item(row, 0)->setData(Qt::UserRole, tag.first);
+			tags_table->setItem(row, 1, new QTableWidgetItem(tag.second));
 			++row;
 		}
 		tags_table->sortItems(0);
@@ -228,7 +228,7 @@ void TagsWidget::cellChange(int row, int column)
 		else if (!key.isEmpty())
 		{
 			// Key edited: update the tags
-			if (object->tags().contains(key))
+			if (object->findTag(key) != end(object->tagList()))
 			{
 				QMessageBox::critical(window(), tr("Key exists"),
 				  tr("The key \"%1\" already exists and must not be used twice.").arg(key)
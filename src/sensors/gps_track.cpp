@@ -21,6 +21,10 @@
 
 #include "gps_track.h"
 
+#include <algorithm>
+#include <iterator>
+#include <vector>
+
 #include <QApplication>
 #include <QFile>
 #include <QFileInfo>  // IWYU pragma: keep
@@ -161,23 +165,31 @@ bool Track::loadFrom(const QString& path, bool project_points, QWidget* dialog_p
 
 	if (path.endsWith(QLatin1String(".gpx"), Qt::CaseInsensitive))
 	{
-		if (!loadFromGPX(&file, project_points, dialog_parent))
+		if (!loadFromGPX(&file, dialog_parent))
 			return false;
 	}
 	else if (path.endsWith(QLatin1String(".dxf"), Qt::CaseInsensitive))
 	{
-		if (!loadFromDXF(&file, project_points, dialog_parent))
+		if (!loadFromDXF(&file, dialog_parent))
 			return false;
 	}
 	else if (path.endsWith(QLatin1String(".osm"), Qt::CaseInsensitive))
 	{
-		if (!loadFromOSM(&file, project_points, dialog_parent))
+		if (!loadFromOSM(&file, dialog_parent))
 			return false;
 	}
 	else
 		return false;
 
 	file.close();
+	
+	// Projecting all points at once is much faster than point by point.
+	if (project_points)
+	{
+		auto const failed = projectPoints();
+		if (failed > 0)
+			QMessageBox::warning(dialog_parent, OpenOrienteering::TemplateTrack::tr("Problems"), OpenOrienteering::TemplateTrack::tr("%1 points could not be projected.").arg(failed));
+	}
 	return true;
 }
 bool Track::saveTo(const QString& path) const
@@ -344,7 +356,7 @@ LatLon Track::calcAveragePosition() const
 				  (num_samples > 0) ? (avg_longitude / num_samples) : 0);
 }
 
-bool Track::loadFromGPX(QFile* file, bool project_points, QWidget* dialog_parent)
+bool Track::loadFromGPX(QFile* file, QWidget* dialog_parent)
 {
 	Q_UNUSED(dialog_parent);
 	
@@ -367,8 +379,6 @@ bool Track::loadFromGPX(QFile* file, bool project_points, QWidget* dialog_parent
 			{
 				point = TrackPoint(LatLon(stream.attributes().value(QLatin1String("lat")).toDouble(),
 				                          stream.attributes().value(QLatin1String("lon")).toDouble()));
-				if (project_points)
-					point.map_coord = map_georef.toMapCoordF(point.gps_coord); // TODO: check for errors
 				point_name.clear();
 			}
 			else if (stream.name().compare(QLatin1String("trkseg"), Qt::CaseInsensitive) == 0
@@ -415,7 +425,7 @@ bool Track::loadFromGPX(QFile* file, bool project_points, QWidget* dialog_parent
 	return true;
 }
 
-bool Track::loadFromDXF(QFile* file, bool project_points, QWidget* dialog_parent)
+bool Track::loadFromDXF(QFile* file, QWidget* dialog_parent)
 {
 	DXFParser* parser = new DXFParser();
 	parser->setData(file);
@@ -441,8 +451,6 @@ bool Track::loadFromDXF(QFile* file, bool project_points, QWidget* dialog_parent
 			if(path.coords.size() < 1)
 				continue;
 			TrackPoint point = TrackPoint(LatLon(path.coords.at(0).y, path.coords.at(0).x));
-			if (project_points)
-				point.map_coord = map_georef.toMapCoordF(track_crs, fakeMapCoordF(point.gps_coord)); // TODO: check for errors
 			waypoints.push_back(point);
 			waypoint_names.push_back(path.layer);
 		}
@@ -457,8 +465,6 @@ bool Track::loadFromDXF(QFile* file, bool project_points, QWidget* dialog_parent
 			for (auto&& coord : path.coords)
 			{
 				TrackPoint point = TrackPoint(LatLon(coord.y, coord.x), QDateTime());
-				if (project_points)
-					point.map_coord = map_georef.toMapCoordF(track_crs, fakeMapCoordF(point.gps_coord)); // TODO: check for errors
 				if (path.type == SPLINE &&
 					i % 3 == 0 &&
 					i < path.coords.size() - 3)
@@ -482,7 +488,7 @@ bool Track::loadFromDXF(QFile* file, bool project_points, QWidget* dialog_parent
 	return true;
 }
 
-bool Track::loadFromOSM(QFile* file, bool project_points, QWidget* dialog_parent)
+bool Track::loadFromOSM(QFile* file, QWidget* dialog_parent)
 {
 	track_crs = new Georeferencing();
 	track_crs->setProjectedCRS({}, Georeferencing::geographic_crs_spec);
@@ -555,10 +561,6 @@ bool Track::loadFromOSM(QFile* file, bool project_points, QWidget* dialog_parent
 			}
 			
 			TrackPoint point(LatLon(lat, lon));
-			if (project_points)
-			{
-				point.map_coord = map_georef.toMapCoordF(point.gps_coord); // TODO: check for errors
-			}
 			nodes.insert(id, point);
 			
 			while (xml.readNextStartElement())
@@ -622,28 +624,48 @@ bool Track::loadFromOSM(QFile* file, bool project_points, QWidget* dialog_parent
 	return true;
 }
 
-void Track::projectPoints()
+std::size_t Track::projectPoints()
 {
-	if (track_crs->getProjectedCRSSpec() == Georeferencing::geographic_crs_spec)
+	// All points are transformed in a single batch.
+	std::vector<MapCoordF> coords;
+	coords.reserve(waypoints.size() + segment_points.size());
+	std::vector<bool> ok;
+	if (track_crs && track_crs->getProjectedCRSSpec() == Georeferencing::geographic_crs_spec)
 	{
-		int size = waypoints.size();
-		for (int i = 0; i < size; ++i)
-			waypoints[i].map_coord = map_georef.toMapCoordF(waypoints[i].gps_coord, nullptr); // FIXME: check for errors
-			
-		size = segment_points.size();
-		for (int i = 0; i < size; ++i)
-			segment_points[i].map_coord = map_georef.toMapCoordF(segment_points[i].gps_coord, nullptr); // FIXME: check for errors
+		std::vector<LatLon> gps_coords;
+		gps_coords.reserve(coords.capacity());
+		for (const auto& point : waypoints)
+			gps_coords.push_back(point.gps_coord);
+		for (const auto& point : segment_points)
+			gps_coords.push_back(point.gps_coord);
+		coords.resize(gps_coords.size());
+		map_georef.toMapCoordF(gps_coords.data(), gps_coords.size(), coords.data(), &ok);
 	}
 	else
 	{
-		int size = waypoints.size();
-		for (int i = 0; i < size; ++i)
-			waypoints[i].map_coord = map_georef.toMapCoordF(track_crs, fakeMapCoordF(waypoints[i].gps_coord), nullptr); // FIXME: check for errors
-			
-		size = segment_points.size();
-		for (int i = 0; i < size; ++i)
-			segment_points[i].map_coord = map_georef.toMapCoordF(track_crs, fakeMapCoordF(segment_points[i].gps_coord), nullptr); // FIXME: check for errors
+		for (const auto& point : waypoints)
+			coords.push_back(fakeMapCoordF(point.gps_coord));
+		for (const auto& point : segment_points)
+			coords.push_back(fakeMapCoordF(point.gps_coord));
+		map_georef.toMapCoordF(track_crs, coords.data(), coords.size(), coords.data(), &ok);
+	}
+	
+	// Points which cannot be projected keep their previous map coordinates.
+	auto coord = begin(coords);
+	auto point_ok = begin(ok);
+	for (auto& point : waypoints)
+	{
+		if (*point_ok++)
+			point.map_coord = *coord;
+		++coord;
+	}
+	for (auto& point : segment_points)
+	{
+		if (*point_ok++)
+			point.map_coord = *coord;
+		++coord;
 	}
+	return std::size_t(std::count(begin(ok), end(ok), false));
 }
 
 
@@ -21,6 +21,7 @@
 #ifndef OPENORIENTEERING_GPS_TRACK_H
 #define OPENORIENTEERING_GPS_TRACK_H
 
+#include <cstddef>
 #include <vector>
 
 #include <QDateTime>
@@ -143,11 +144,17 @@ public:
 	Track& operator=(const Track& rhs);
 	
 private:
-	bool loadFromGPX(QFile* file, bool project_points, QWidget* dialog_parent);
-	bool loadFromDXF(QFile* file, bool project_points, QWidget* dialog_parent);
-	bool loadFromOSM(QFile* file, bool project_points, QWidget* dialog_parent);
+	bool loadFromGPX(QFile* file, QWidget* dialog_parent);
+	bool loadFromDXF(QFile* file, QWidget* dialog_parent);
+	bool loadFromOSM(QFile* file, QWidget* dialog_parent);
 	
-	void projectPoints();
+	/**
+	 * Updates the map coordinates of all points.
+	 * 
+	 * Points which cannot be projected keep their previous map coordinates.
+	 * Returns the number of these points.
+	 */
+	std::size_t projectPoints();
 	
 	
 	/** A mapping of element id to tags. */
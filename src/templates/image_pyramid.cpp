@@ -0,0 +1,385 @@
+/*
+ *    Copyright 2018 The OpenOrienteering developers
+ *
+ *    This file is part of OpenOrienteering.
+ *
+ *    OpenOrienteering is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    OpenOrienteering is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with OpenOrienteering.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "image_pyramid.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <iterator>
+
+#include <Qt>
+#include <QByteArray>
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QDateTime>
+#include <QDir>
+#include <QFileInfo>
+#include <QIODevice>
+#include <QLatin1String>
+#include <QMutexLocker>
+#include <QPainter>
+#include <QPoint>
+#include <QPointF>
+#include <QRect>
+#include <QRectF>
+#include <QSaveFile>
+#include <QSizeF>
+#include <QStandardPaths>
+
+#include "util/parallel.h"
+
+
+namespace OpenOrienteering {
+
+namespace {
+
+constexpr quint32 cache_magic = 0x4f4f4950;  // "OOIP"
+constexpr quint32 cache_version = 1;
+
+/// Images with at least this number of pixels are handled by a pyramid.
+constexpr qint64 min_pyramid_pixels = qint64(64) * 1024 * 1024;
+
+/// The number of bytes per pixel in tiles.
+constexpr int bytes_per_pixel = 4;
+
+quint64 tileKey(int level, int x, int y)
+{
+	return (quint64(level) << 48) | (quint64(x) << 24) | quint64(y);
+}
+
+}  // namespace
+
+
+
+// ### ImagePyramid ###
+
+// static
+bool ImagePyramid::isSuitableFor(const QSize& image_size)
+{
+	return qint64(image_size.width()) * qint64(image_size.height()) >= min_pyramid_pixels;
+}
+
+
+ImagePyramid::ImagePyramid() = default;
+
+ImagePyramid::~ImagePyramid() = default;
+
+
+bool ImagePyramid::open(const QString& image_path)
+{
+	for (auto const& path : { cachePath(image_path), fallbackCachePath(image_path) })
+	{
+		file.setFileName(path);
+		if (file.open(QIODevice::ReadOnly))
+		{
+			if (readIndex(image_path))
+				return true;
+			file.close();
+		}
+	}
+
+	levels.clear();
+	return false;
+}
+
+bool ImagePyramid::build(const QString& image_path, const QImage& image)
+{
+	if (image.isNull())
+		return false;
+
+	file.close();
+	cached_tiles.clear();
+	cache_index.clear();
+
+	image_size = image.size();
+	format = image.hasAlphaChannel() ? QImage::Format_ARGB32_Premultiplied : QImage::Format_RGB32;
+	levels = makeLevels(image_size);
+
+	auto const fallback_path = fallbackCachePath(image_path);
+	if (!write(cachePath(image_path), image_path, image)
+	    && !(QDir().mkpath(QFileInfo(fallback_path).absolutePath())
+	         && write(fallback_path, image_path, image)))
+	{
+		levels.clear();
+		return false;
+	}
+	return open(image_path);
+}
+
+
+int ImagePyramid::levelForResolution(qreal pixels_per_image_pixel) const
+{
+	if (levels.empty() || !(pixels_per_image_pixel > 0))
+		return 0;
+
+	auto const level = int(std::floor(std::log2(1 / pixels_per_image_pixel)));
+	return qBound(0, level, levelCount() - 1);
+}
+
+
+void ImagePyramid::draw(QPainter* painter, const QRectF& rect, int level) const
+{
+	if (level < 0 || level >= levelCount())
+		return;
+
+	auto const& l = levels[std::size_t(level)];
+	auto const scale_x = qreal(image_size.width()) / l.size.width();
+	auto const scale_y = qreal(image_size.height()) / l.size.height();
+
+	auto const visible = QRectF(rect.left() / scale_x, rect.top() / scale_y, rect.width() / scale_x, rect.height() / scale_y)
+	                     .intersected(QRectF(QPointF(0, 0), QSizeF(l.size)));
+	if (visible.isEmpty())
+		return;
+
+	auto const left   = int(visible.left()) / tile_size;
+	auto const top    = int(visible.top()) / tile_size;
+	auto const right  = std::min(l.columns - 1, int(visible.right()) / tile_size);
+	auto const bottom = std::min(l.rows - 1, int(visible.bottom()) / tile_size);
+	for (auto y = top; y <= bottom; ++y)
+	{
+		for (auto x = left; x <= right; ++x)
+		{
+			auto const image = tile(level, x, y);
+			if (image.isNull())
+				continue;
+
+			auto const target = QRectF(x * tile_size * scale_x, y * tile_size * scale_y,
+			                           image.width() * scale_x, image.height() * scale_y);
+			painter->drawImage(target, image);
+		}
+	}
+}
+
+
+// static
+QString ImagePyramid::cachePath(const QString& image_path)
+{
+	return image_path + QLatin1String(".pyramid");
+}
+
+// static
+QString ImagePyramid::fallbackCachePath(const QString& image_path)
+{
+	auto const key = QCryptographicHash::hash(QFileInfo(image_path).absoluteFilePath().toUtf8(), QCryptographicHash::Sha1);
+	return QStandardPaths::writableLocation(QStandardPaths::CacheLocation)
+	       + QLatin1String("/pyramids/")
+	       + QString::fromLatin1(key.toHex())
+	       + QLatin1String(".pyramid");
+}
+
+// static
+std::vector<ImagePyramid::Level> ImagePyramid::makeLevels(const QSize& image_size)
+{
+	std::vector<Level> levels;
+	if (image_size.isEmpty())
+		return levels;
+
+	auto size = image_size;
+	while (true)
+	{
+		auto const columns = (size.width() + tile_size - 1) / tile_size;
+		auto const rows = (size.height() + tile_size - 1) / tile_size;
+		levels.push_back({ size, columns, rows, {} });
+		levels.back().tiles.resize(std::size_t(columns) * std::size_t(rows));
+		if (columns == 1 && rows == 1)
+			break;
+		size = QSize((size.width() + 1) / 2, (size.height() + 1) / 2);
+	}
+	return levels;
+}
+
+// static
+QByteArray ImagePyramid::encodeTile(const QImage& tile, QImage::Format format)
+{
+	auto const image = tile.convertToFormat(format);
+	auto const line_length = image.width() * bytes_per_pixel;
+
+	QByteArray data;
+	data.resize(line_length * image.height());
+	for (int y = 0; y < image.height(); ++y)
+		std::memcpy(data.data() + y * line_length, image.constScanLine(y), std::size_t(line_length));
+
+	// Fast compression: the pyramid is built while the user waits.
+	return qCompress(data, 1);
+}
+
+
+bool ImagePyramid::readIndex(const QString& image_path)
+{
+	QFileInfo const image_info(image_path);
+
+	QDataStream stream(&file);
+	quint32 magic, version;
+	qint64 source_size, source_time;
+	qint32 width, height, image_format, level_count;
+	stream >> magic >> version >> source_size >> source_time >> width >> height >> image_format >> level_count;
+	if (stream.status() != QDataStream::Ok
+	    || magic != cache_magic
+	    || version != cache_version
+	    || source_size != image_info.size()
+	    || source_time != image_info.lastModified().toMSecsSinceEpoch()
+	    || (image_format != QImage::Format_RGB32 && image_format != QImage::Format_ARGB32_Premultiplied))
+	{
+		return false;
+	}
+
+	image_size = QSize(width, height);
+	format = QImage::Format(image_format);
+	levels = makeLevels(image_size);
+	if (level_count != levelCount())
+		return false;
+
+	for (auto& level : levels)
+	{
+		for (auto& entry : level.tiles)
+		{
+			stream >> entry.first >> entry.second;
+			if (entry.first < 0 || entry.second < 0 || entry.first + entry.second > file.size())
+				return false;
+		}
+	}
+	if (stream.status() != QDataStream::Ok)
+		return false;
+
+	cached_tiles.clear();
+	cache_index.clear();
+	overview_image = loadTile(levelCount() - 1, 0, 0);
+	return !overview_image.isNull();
+}
+
+bool ImagePyramid::write(const QString& cache_path, const QString& image_path, const QImage& image)
+{
+	QSaveFile out(cache_path);
+	if (!out.open(QIODevice::WriteOnly))
+		return false;
+
+	QFileInfo const image_info(image_path);
+
+	QDataStream stream(&out);
+	stream << cache_magic << cache_version
+	       << qint64(image_info.size()) << qint64(image_info.lastModified().toMSecsSinceEpoch())
+	       << qint32(image_size.width()) << qint32(image_size.height()) << qint32(format)
+	       << qint32(levelCount());
+
+	// The index is written again when all tile positions are known.
+	auto const index_pos = out.pos();
+	for (auto const& level : levels)
+	{
+		for (std::size_t i = 0; i < level.tiles.size(); ++i)
+			stream << qint64(0) << qint32(0);
+	}
+
+	auto level_image = image;
+	for (auto& level : levels)
+	{
+		if (level_image.size() != level.size)
+			level_image = level_image.scaled(level.size, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+
+		std::vector<QByteArray> row(std::size_t(level.columns));
+		for (int y = 0; y < level.rows; ++y)
+		{
+			parallelFor(row.size(), [&row, &level_image, &level, y, this](std::size_t x) {
+				auto const rect = QRect(int(x) * tile_size, y * tile_size, tile_size, tile_size)
+				                  .intersected(QRect(QPoint(0, 0), level.size));
+				row[x] = encodeTile(level_image.copy(rect), format);
+			});
+			for (std::size_t x = 0; x < row.size(); ++x)
+			{
+				level.tiles[std::size_t(y * level.columns) + x] = { out.pos(), qint32(row[x].size()) };
+				if (out.write(row[x]) != row[x].size())
+				{
+					out.cancelWriting();
+					return false;
+				}
+			}
+		}
+	}
+
+	out.seek(index_pos);
+	for (auto const& level : levels)
+	{
+		for (auto const& entry : level.tiles)
+			stream << entry.first << entry.second;
+	}
+
+	if (stream.status() != QDataStream::Ok)
+	{
+		out.cancelWriting();
+		return false;
+	}
+	return out.commit();
+}
+
+
+QImage ImagePyramid::tile(int level, int x, int y) const
+{
+	if (level == levelCount() - 1)
+		return overview_image;
+
+	QMutexLocker locker(&mutex);
+	auto const key = tileKey(level, x, y);
+	auto const found = cache_index.find(key);
+	if (found != end(cache_index))
+	{
+		cached_tiles.splice(begin(cached_tiles), cached_tiles, found->second);
+		return found->second->second;
+	}
+
+	auto image = loadTile(level, x, y);
+	if (image.isNull())
+		return image;
+
+	cached_tiles.emplace_front(key, image);
+	cache_index[key] = begin(cached_tiles);
+	if (cached_tiles.size() > std::size_t(max_cached_tiles))
+	{
+		cache_index.erase(cached_tiles.back().first);
+		cached_tiles.pop_back();
+	}
+	return image;
+}
+
+QImage ImagePyramid::loadTile(int level, int x, int y) const
+{
+	auto const& l = levels[std::size_t(level)];
+	auto const& entry = l.tiles[std::size_t(y * l.columns + x)];
+	if (!file.seek(entry.first))
+		return {};
+
+	auto const data = qUncompress(file.read(entry.second));
+	auto const rect = QRect(x * tile_size, y * tile_size, tile_size, tile_size)
+	                  .intersected(QRect(QPoint(0, 0), l.size));
+	auto const line_length = rect.width() * bytes_per_pixel;
+	if (data.size() != line_length * rect.height())
+		return {};
+
+	QImage image(rect.size(), format);
+	if (image.isNull())
+		return image;
+
+	for (int line = 0; line < image.height(); ++line)
+		std::memcpy(image.scanLine(line), data.constData() + line * line_length, std::size_t(line_length));
+	return image;
+}
+
+
+}  // namespace OpenOrienteering
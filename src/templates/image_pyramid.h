@@ -0,0 +1,168 @@
+/*
+ *    Copyright 2018 The OpenOrienteering developers
+ *
+ *    This file is part of OpenOrienteering.
+ *
+ *    OpenOrienteering is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    OpenOrienteering is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with OpenOrienteering.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef OPENORIENTEERING_IMAGE_PYRAMID_H
+#define OPENORIENTEERING_IMAGE_PYRAMID_H
+
+#include <list>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <QtGlobal>
+#include <QFile>
+#include <QImage>
+#include <QMutex>
+#include <QSize>
+#include <QString>
+
+class QByteArray;
+class QPainter;
+class QRectF;
+
+namespace OpenOrienteering {
+
+
+/**
+ * A tiled, multi-resolution representation of a large raster image.
+ *
+ * The pyramid consists of the full resolution image (level 0) and of
+ * overview levels which are reduced by a factor of two from level to level,
+ * until the image fits into a single tile. All levels are split into tiles
+ * which are stored in a cache file beside the image file. The pyramid is
+ * built once, when the cache file is missing or outdated.
+ *
+ * Tiles are loaded from the cache file on demand. Only a bounded number of
+ * tiles is kept in memory, plus the single tile of the coarsest level.
+ */
+class ImagePyramid
+{
+public:
+	/** The width and height of the tiles, in pixels. */
+	static constexpr int tile_size = 512;
+
+	/** The maximum number of tiles which are kept in memory. */
+	static constexpr int max_cached_tiles = 64;
+
+	/**
+	 * Returns true if an image of the given size shall be handled
+	 * by a pyramid instead of a plain QImage.
+	 */
+	static bool isSuitableFor(const QSize& image_size);
+
+
+	/** Constructs an empty pyramid. */
+	ImagePyramid();
+
+	ImagePyramid(const ImagePyramid&) = delete;
+	ImagePyramid& operator=(const ImagePyramid&) = delete;
+
+	~ImagePyramid();
+
+
+	/**
+	 * Opens the cache file for the given image file.
+	 *
+	 * Returns false if there is no cache file, or if the cache file does not
+	 * match the current image file.
+	 */
+	bool open(const QString& image_path);
+
+	/**
+	 * Builds the pyramid from the decoded image, writes it to the cache file
+	 * for the given image file, and opens the new cache file.
+	 *
+	 * The cache file is written beside the image file if possible, and to
+	 * the application's cache directory otherwise.
+	 */
+	bool build(const QString& image_path, const QImage& image);
+
+
+	/** Returns the size of the full resolution image. */
+	QSize size() const { return image_size; }
+
+	/** Returns the number of levels. */
+	int levelCount() const { return int(levels.size()); }
+
+	/** Returns the coarsest level, i.e. the whole image as a single tile. */
+	const QImage& overview() const { return overview_image; }
+
+	/**
+	 * Returns the coarsest level which still provides the given number of
+	 * pixels per full resolution image pixel.
+	 */
+	int levelForResolution(qreal pixels_per_image_pixel) const;
+
+	/**
+	 * Draws the tiles of the given level which intersect the given rectangle.
+	 *
+	 * The rectangle and the painter's coordinates are full resolution image
+	 * pixels, with (0, 0) at the top left corner of the image.
+	 *
+	 * This function may be called concurrently from multiple threads.
+	 */
+	void draw(QPainter* painter, const QRectF& rect, int level) const;
+
+
+private:
+	struct Level
+	{
+		QSize size;
+		int columns;
+		int rows;
+		std::vector<std::pair<qint64, qint32>> tiles;  ///< Offset and length in the cache file
+	};
+
+	using CacheList = std::list<std::pair<quint64, QImage>>;
+
+	static QString cachePath(const QString& image_path);
+
+	static QString fallbackCachePath(const QString& image_path);
+
+	static std::vector<Level> makeLevels(const QSize& image_size);
+
+	static QByteArray encodeTile(const QImage& tile, QImage::Format format);
+
+	bool readIndex(const QString& image_path);
+
+	bool write(const QString& cache_path, const QString& image_path, const QImage& image);
+
+	/** Returns a tile from the cache, loading it if needed. Thread-safe. */
+	QImage tile(int level, int x, int y) const;
+
+	/** Reads a tile from the cache file. Requires exclusive access to the file. */
+	QImage loadTile(int level, int x, int y) const;
+
+
+	QSize image_size;
+	QImage::Format format = QImage::Format_Invalid;
+	std::vector<Level> levels;
+	QImage overview_image;
+
+	mutable QMutex mutex;  ///< Guards the file and the tile cache in tile().
+	mutable QFile file;
+	mutable CacheList cached_tiles;  ///< Most recently used first
+	mutable std::unordered_map<quint64, CacheList::iterator> cache_index;
+};
+
+
+}  // namespace OpenOrienteering
+
+#endif
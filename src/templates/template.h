@@ -25,6 +25,7 @@
 #include <memory>
 
 #include <QtGlobal>
+#include <QMutex>
 #include <QObject>
 #include <QPointF>
 #include <QString>
@@ -322,9 +323,17 @@ public:
 	 * The clip rect is in template coordinates.
 	 * The scale is the combined view & template scale. It can be used to give
 	 * a minimum size to elements.
+	 * 
+	 * Templates may keep caches for drawing. Callers which may draw from
+	 * different threads must hold drawingMutex() (cf. Map::drawTemplates()).
 	 */
     virtual void drawTemplate(QPainter* painter, const QRectF& clip_rect, double scale, bool on_screen, float opacity) const = 0;
 	
+	/**
+	 * Returns the mutex which serializes drawing of this template.
+	 */
+	QMutex& drawingMutex() const { return drawing_mutex; }
+	
 	
 	/** 
 	 * Calculates the template's bounding box in map coordinates.
@@ -698,6 +707,10 @@ protected:
 	// Transformation matrices calculated from cur_trans
 	Matrix map_to_template;
 	Matrix template_to_map;
+	
+private:
+	/// Serializes drawTemplate() calls, cf. drawingMutex()
+	mutable QMutex drawing_mutex;
 	Matrix template_to_map_other;
 };
 
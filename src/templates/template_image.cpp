@@ -21,6 +21,7 @@
 
 #include "template_image.h"
 
+#include <cmath>
 #include <iterator>
 
 #include <Qt>
@@ -65,6 +66,7 @@
 #ifdef QT_PRINTSUPPORT_LIB
 #include "printsupport/advanced_pdf_printer.h"
 #endif
+#include "templates/image_pyramid.h"
 #include "templates/world_file.h"
 #include "util/transformation.h"
 #include "util/util.h"
@@ -105,6 +107,10 @@ TemplateImage::~TemplateImage()
 
 bool TemplateImage::saveTemplateFile() const
 {
+	// An image pyramid cannot be modified, so the file is unchanged.
+	if (pyramid)
+		return true;
+	
 	const auto result = image.save(template_path);
 #ifdef Q_OS_ANDROID
 	// Make the MediaScanner aware of the *updated* file.
@@ -154,9 +160,8 @@ bool TemplateImage::loadTypeSpecificTemplateConfiguration(QXmlStreamReader& xml)
 	return true;
 }
 
-bool TemplateImage::loadTemplateFileImpl(bool configuring)
+bool TemplateImage::readImage(QImageReader& reader)
 {
-	QImageReader reader(template_path);
 	const QSize size = reader.size();
 	const QImage::Format format = reader.imageFormat();
 	if (size.isEmpty() || format == QImage::Format_Invalid)
@@ -183,6 +188,36 @@ bool TemplateImage::loadTemplateFileImpl(bool configuring)
 		return false;
 	}
 	
+	return true;
+}
+
+bool TemplateImage::loadTemplateFileImpl(bool configuring)
+{
+	QImageReader reader(template_path);
+	
+	// Huge images are drawn from a tiled image pyramid which is cached beside
+	// the file. The full image is decoded only when the pyramid is (re)built.
+	if (ImagePyramid::isSuitableFor(reader.size()))
+	{
+		pyramid = std::make_shared<ImagePyramid>();
+		if (!pyramid->open(template_path))
+		{
+			if (!readImage(reader))
+			{
+				pyramid.reset();
+				return false;
+			}
+			if (pyramid->build(template_path, image))
+				image = QImage();
+			else
+				pyramid.reset();  // Fall back to the plain image
+		}
+	}
+	else if (!readImage(reader))
+	{
+		return false;
+	}
+	
 	// Check if georeferencing information is available
 	available_georef = Georeferencing_None;
 	
@@ -224,7 +259,7 @@ bool TemplateImage::postLoadConfiguration(QWidget* dialog_parent, bool& out_cent
 			// Make sure that the map is georeferenced;
 			// use the center coordinates of the image as initial reference point.
 			calculateGeoreferencing();
-			QPointF template_coords_center = georef->toProjectedCoords(MapCoordF(0.5 * (image.width() - 1), 0.5 * (image.height() - 1)));
+			QPointF template_coords_center = georef->toProjectedCoords(MapCoordF(0.5 * (imageSize().width() - 1), 0.5 * (imageSize().height() - 1)));
 			bool template_coords_probably_geographic =
 				template_coords_center.x() >= -90 && template_coords_center.x() <= 90 &&
 				template_coords_center.y() >= -90 && template_coords_center.y() <= 90;
@@ -281,11 +316,11 @@ bool TemplateImage::postLoadConfiguration(QWidget* dialog_parent, bool& out_cent
 void TemplateImage::unloadTemplateFileImpl()
 {
 	image = QImage();
+	pyramid.reset();
 }
 
 void TemplateImage::drawTemplate(QPainter* painter, const QRectF& clip_rect, double scale, bool on_screen, float opacity) const
 {
-	Q_UNUSED(clip_rect);
 	Q_UNUSED(scale);
 	Q_UNUSED(on_screen);
 	
@@ -309,29 +344,64 @@ void TemplateImage::drawTemplate(QPainter* painter, const QRectF& clip_rect, dou
 			painter->setBrush(Qt::white);
 	}
 #endif
-	painter->drawImage(QPointF(-image.width() * 0.5, -image.height() * 0.5), image);
+	if (pyramid)
+	{
+		// Determine the visible part of the image, in image pixels
+		QRectF image_rect;
+		rectIncludeSafe(image_rect, mapToTemplate(MapCoordF(clip_rect.topLeft())));
+		rectIncludeSafe(image_rect, mapToTemplate(MapCoordF(clip_rect.topRight())));
+		rectIncludeSafe(image_rect, mapToTemplate(MapCoordF(clip_rect.bottomLeft())));
+		rectIncludeSafe(image_rect, mapToTemplate(MapCoordF(clip_rect.bottomRight())));
+		const auto size = pyramid->size();
+		image_rect.translate(size.width() * 0.5, size.height() * 0.5);
+		
+		painter->translate(-size.width() * 0.5, -size.height() * 0.5);
+		
+		// Determine the number of device pixels per image pixel,
+		// from the painter's transform which includes the template transform.
+		const auto resolution = std::sqrt(std::abs(painter->combinedTransform().determinant()));
+		pyramid->draw(painter, image_rect, pyramid->levelForResolution(resolution));
+	}
+	else
+	{
+		painter->drawImage(QPointF(-image.width() * 0.5, -image.height() * 0.5), image);
+	}
 	painter->setRenderHint(QPainter::SmoothPixmapTransform, false);
 }
 QRectF TemplateImage::getTemplateExtent() const
 {
-    // If the image is invalid, the extent is an empty rectangle.
-    if (image.isNull())
+	// If the image is invalid, the extent is an empty rectangle.
+	const auto size = imageSize();
+	if (size.isEmpty())
 		return QRectF();
-	return QRectF(-image.width() * 0.5, -image.height() * 0.5, image.width(), image.height());
+	return QRectF(-size.width() * 0.5, -size.height() * 0.5, size.width(), size.height());
+}
+
+bool TemplateImage::canBeDrawnOnto() const
+{
+	return !pyramid;
+}
+
+QSize TemplateImage::imageSize() const
+{
+	return pyramid ? pyramid->size() : image.size();
 }
 
 QPointF TemplateImage::calcCenterOfGravity(QRgb background_color)
 {
+	// For an image pyramid, the overview is a good approximation.
+	const QImage& source = pyramid ? pyramid->overview() : image;
+	
 	int num_points = 0;
 	QPointF center = QPointF(0, 0);
-	int width = image.width();
-	int height = image.height();
+	int width = source.width();
+	int height = source.height();
 	
 	for (int x = 0; x < width; ++x)
 	{
 		for (int y = 0; y < height; ++y)
 		{
-			QRgb pixel = image.pixel(x, y);
+			QRgb pixel = source.pixel(x, y);
 			if (qAlpha(pixel) < 127 || pixel == background_color)
 				continue;
 			
@@ -342,7 +412,15 @@ QPointF TemplateImage::calcCenterOfGravity(QRgb background_color)
 	
 	if (num_points > 0)
 		center = QPointF(center.x() / num_points, center.y() / num_points);
-	center -= QPointF(image.width() * 0.5 - 0.5, image.height() * 0.5 - 0.5);
+	
+	// Map pixel centers from the source to the full image
+	const auto size = imageSize();
+	if (width > 0 && height > 0)
+	{
+		center = QPointF((center.x() + 0.5) * size.width() / width,
+		                 (center.y() + 0.5) * size.height() / height);
+	}
+	center -= QPointF(size.width() * 0.5, size.height() * 0.5);
 	
 	return center;
 }
@@ -357,6 +435,7 @@ Template* TemplateImage::duplicateImpl() const
 {
 	auto new_template = new TemplateImage(template_path, map);
 	new_template->image = image;
+	new_template->pyramid = pyramid;
 	new_template->available_georef = available_georef;
 	return new_template;
 }
@@ -541,6 +620,7 @@ void TemplateImage::updatePosFromGeoreferencing()
 {
 	// Determine map coords of three image corner points
 	// by transforming the points from one Georeferencing into the other
+	const auto size = imageSize();
 	bool ok;
 	MapCoordF top_left = map->getGeoreferencing().toMapCoordF(georef.data(), MapCoordF(-0.5, -0.5), &ok);
 	if (!ok)
@@ -548,13 +628,13 @@ void TemplateImage::updatePosFromGeoreferencing()
 		qDebug() << "updatePosFromGeoreferencing() failed";
 		return; // TODO: proper error message?
 	}
-	MapCoordF top_right = map->getGeoreferencing().toMapCoordF(georef.data(), MapCoordF(image.width() - 0.5, -0.5), &ok);
+	MapCoordF top_right = map->getGeoreferencing().toMapCoordF(georef.data(), MapCoordF(size.width() - 0.5, -0.5), &ok);
 	if (!ok)
 	{
 		qDebug() << "updatePosFromGeoreferencing() failed";
 		return; // TODO: proper error message?
 	}
-	MapCoordF bottom_left = map->getGeoreferencing().toMapCoordF(georef.data(), MapCoordF(-0.5, image.height() - 0.5), &ok);
+	MapCoordF bottom_left = map->getGeoreferencing().toMapCoordF(georef.data(), MapCoordF(-0.5, size.height() - 0.5), &ok);
 	if (!ok)
 	{
 		qDebug() << "updatePosFromGeoreferencing() failed";
@@ -565,13 +645,13 @@ void TemplateImage::updatePosFromGeoreferencing()
 	PassPointList pp_list;
 	
 	PassPoint pp;
-	pp.src_coords = MapCoordF(-0.5 * image.width(), -0.5 * image.height());
+	pp.src_coords = MapCoordF(-0.5 * size.width(), -0.5 * size.height());
 	pp.dest_coords = top_left;
 	pp_list.push_back(pp);
-	pp.src_coords = MapCoordF(0.5 * image.width(), -0.5 * image.height());
+	pp.src_coords = MapCoordF(0.5 * size.width(), -0.5 * size.height());
 	pp.dest_coords = top_right;
 	pp_list.push_back(pp);
-	pp.src_coords = MapCoordF(-0.5 * image.width(), 0.5 * image.height());
+	pp.src_coords = MapCoordF(-0.5 * size.width(), 0.5 * size.height());
 	pp.dest_coords = bottom_left;
 	pp_list.push_back(pp);
 	
@@ -594,8 +674,8 @@ TemplateImageOpenDialog::TemplateImageOpenDialog(TemplateImage* templ, QWidget*
 	setWindowTitle(tr("Opening %1").arg(templ->getTemplateFilename()));
 	
 	QLabel* size_label = new QLabel(QLatin1String("<b>") + tr("Image size:") + QLatin1String("</b> ")
-	                                + QString::number(templ->getImage().width()) + QLatin1String(" x ")
-	                                + QString::number(templ->getImage().height()));
+	                                + QString::number(templ->imageSize().width()) + QLatin1String(" x ")
+	                                + QString::number(templ->imageSize().height()));
 	QLabel* desc_label = new QLabel(tr("Specify how to position or scale the image:"));
 	
 	bool use_meters_per_pixel;
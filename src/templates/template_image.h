@@ -22,6 +22,7 @@
 #ifndef OPENORIENTEERING_TEMPLATE_IMAGE_H
 #define OPENORIENTEERING_TEMPLATE_IMAGE_H
 
+#include <memory>
 #include <vector>
 
 #include <QColor>
@@ -32,12 +33,14 @@
 #include <QRectF>
 #include <QRgb>
 #include <QScopedPointer>
+#include <QSize>
 #include <QString>
 
 #include "templates/template.h"
 
 class QByteArray;
 class QIODevice;
+class QImageReader;
 class QLineEdit;
 class QPainter;
 class QPointF;
@@ -51,6 +54,7 @@ class QXmlStreamWriter;
 namespace OpenOrienteering {
 
 class Georeferencing;
+class ImagePyramid;
 class Map;
 class MapCoordF;
 
@@ -93,7 +97,13 @@ public:
 	
     void drawTemplate(QPainter* painter, const QRectF& clip_rect, double scale, bool on_screen, float opacity) const override;
 	QRectF getTemplateExtent() const override;
-	bool canBeDrawnOnto() const override {return true;}
+	
+	/**
+	 * Returns true unless the image is drawn from an image pyramid.
+	 * 
+	 * Huge images are not kept in memory, so they cannot be drawn onto.
+	 */
+	bool canBeDrawnOnto() const override;
 
 	/**
 	 * Calculates the image's center of gravity in template coordinates by
@@ -101,9 +111,16 @@ public:
 	 */
 	QPointF calcCenterOfGravity(QRgb background_color);
 	
-	/** Returns the internal QImage. */
+	/**
+	 * Returns the internal QImage.
+	 * 
+	 * This is a null image when the template is drawn from an image pyramid.
+	 */
 	inline const QImage& getImage() const {return image;}
 	
+	/** Returns the size of the image in pixels. */
+	QSize imageSize() const;
+	
 	/**
 	 * Returns which georeferencing method (if any) is available.
 	 * (This does not mean that the image is in georeferenced mode)
@@ -127,6 +144,12 @@ protected:
 		int y;
 	};
 	
+	/**
+	 * Reads the full image into the image member.
+	 * Sets the error string and returns false on error.
+	 */
+	bool readImage(QImageReader& reader);
+	
 	Template* duplicateImpl() const override;
 	void drawOntoTemplateImpl(MapCoordF* coords, int num_coords, QColor color, float width) override;
 	void drawOntoTemplateUndo(bool redo) override;
@@ -135,6 +158,8 @@ protected:
 	void updatePosFromGeoreferencing();
 
 	QImage image;
+	/// Replaces the image for huge images. Shared by duplicates.
+	std::shared_ptr<ImagePyramid> pyramid;
 	
 	std::vector< DrawOnImageUndoStep > undo_steps;
 	/// Current index in undo_steps, where 0 means before the first item.
@@ -144,7 +144,7 @@ void TemplateMap::drawTemplate(QPainter* painter, const QRectF& clip_rect, doubl
 	auto scaling = scale;
 	if (on_screen)
 	{
-		options |= RenderConfig::Screen;
+		options = RenderConfig::screenOptions(options);
 		/// \todo Get the actual screen's resolution.
 		scaling = Util::mmToPixelPhysical(scale);
 	}
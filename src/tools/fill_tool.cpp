@@ -22,13 +22,18 @@
 #include "fill_tool.h"
 
 #include <algorithm>
+#include <cmath>
 #include <cstddef>
 #include <iterator>
 #include <limits>
+#include <map>
 #include <memory>
 #include <type_traits>
+#include <utility>
+#include <vector>
 
 #include <QtGlobal>
+#include <QtMath>
 #include <QCursor>
 #include <QDir>  // IWYU pragma: keep
 #include <QFlags>
@@ -38,6 +43,7 @@
 #include <QPoint>
 #include <QPointF>
 #include <QRect>
+#include <QRectF>
 #include <QRgb>
 #include <QSize>
 #include <QString>
@@ -48,6 +54,8 @@
 #include "core/map_part.h"
 #include "core/map_view.h"
 #include "core/path_coord.h"
+#include "core/spatial_index.h"
+#include "core/virtual_path.h"
 #include "core/objects/object.h"
 #include "core/renderables/renderable.h"
 #include "core/symbols/area_symbol.h"
@@ -57,6 +65,7 @@
 #include "tools/tool.h"
 #include "tools/tool_base.h"
 #include "undo/object_undo.h"
+#include "util/util.h"
 
 
 // Uncomment this to generate an image file of the rasterized map
@@ -87,6 +96,531 @@ struct PathSection
 
 constexpr auto background = QRgb(0xffffffffu);
 
+
+/**
+ * Appends the given section of a path to the fill object.
+ */
+void appendSection(PathObject* path, const PathSection& section)
+{
+	if (!section.object)
+		return;
+	
+	const auto& part = section.object->parts()[section.part];
+	if (section.end_clen == section.start_clen)
+	{
+		path->addCoordinate(MapCoord(SplitPathCoord::at(section.start_clen, SplitPathCoord::begin(part.path_coords)).pos));
+		return;
+	}
+	
+	PathObject part_copy { part };
+	if (section.end_clen < section.start_clen)
+	{
+		part_copy.changePathBounds(0, section.end_clen, section.start_clen);
+		part_copy.reverse();
+	}
+	else
+	{
+		part_copy.changePathBounds(0, section.start_clen, section.end_clen);
+	}
+	
+	if (path->getCoordinateCount() == 0)
+		path->appendPath(&part_copy);
+	else
+		path->connectPathParts(0, &part_copy, 0, false, false);
+}
+
+
+
+/**
+ * The planar arrangement of the boundaries of a set of path objects.
+ * 
+ * The path parts are split at their mutual intersections. The resulting
+ * sections are the edges of the graph, the split points are its nodes.
+ * Each edge is approximated by the polyline of its path coords.
+ */
+class FillGraph
+{
+public:
+	/** The maximum distance (in native map coordinates) of merged nodes. */
+	static constexpr qint32 node_tolerance = 10;
+	
+	explicit FillGraph(const std::vector<PathObject*>& objects);
+	
+	/**
+	 * Returns the rings of sections enclosing the face which contains pos,
+	 * or an empty vector if there is no such face.
+	 * 
+	 * An open end of a line inside the face may leave a gap which is only
+	 * closed by the line width. In this case, an empty vector is returned,
+	 * too.
+	 * 
+	 * The first ring is the outer boundary of the face. The other rings are
+	 * the boundaries of the islands in the face, i.e. the holes.
+	 * The extent of the outer boundary is returned in out_extent.
+	 */
+	std::vector<std::vector<PathSection>> findFace(const MapCoordF& pos, QRectF& out_extent) const;
+	
+private:
+	struct Edge
+	{
+		PathSection section;
+		std::size_t from;
+		std::size_t to;
+		std::vector<MapCoordF> points;
+		bool removed;
+	};
+	
+	using HalfEdge = std::size_t;  ///< Edge index * 2, plus 1 for the reversed direction
+	
+	/**
+	 * A closed walk along the half-edges.
+	 * 
+	 * Cycles with positive area are the boundaries of bounded faces. Each
+	 * connected component also has one cycle with negative area, its outer
+	 * boundary.
+	 */
+	struct Cycle
+	{
+		std::vector<HalfEdge> half_edges;
+		std::vector<MapCoordF> polygon;
+		double area;
+		std::size_t component;
+	};
+	
+	std::size_t node(const MapCoordF& pos);
+	
+	void addEdges(PathObject* object, PathPartVector::size_type part, std::vector<PathCoord::length_type>& splits);
+	
+	void pruneDanglingEdges();
+	
+	std::vector<Cycle> cycles() const;
+	
+	std::vector<PathSection> sections(const Cycle& cycle) const;
+	
+	HalfEdge next(HalfEdge half_edge) const;
+	
+	double startAngle(HalfEdge half_edge) const;
+	
+	std::size_t origin(HalfEdge half_edge) const;
+	
+	std::size_t destination(HalfEdge half_edge) const;
+	
+	std::vector<Edge> edges;
+	std::vector<std::vector<HalfEdge>> outgoing;  ///< The outgoing half-edges per node
+	std::vector<MapCoordF> open_ends;             ///< The positions of nodes with a single edge
+	std::map<std::pair<qint32, qint32>, std::size_t> nodes;
+};
+
+
+FillGraph::FillGraph(const std::vector<PathObject*>& objects)
+{
+	// The split positions per object and part
+	std::vector<std::vector<std::vector<PathCoord::length_type>>> splits(objects.size());
+	for (std::size_t i = 0; i < objects.size(); ++i)
+	{
+		const auto& parts = objects[i]->parts();
+		splits[i].resize(parts.size());
+		for (std::size_t j = 0; j < parts.size(); ++j)
+		{
+			splits[i][j].push_back(0);
+			if (!parts[j].isClosed())
+				splits[i][j].push_back(parts[j].length());
+		}
+	}
+	
+	// Only paths with touching extents can intersect.
+	SpatialIndex<std::size_t> index;
+	for (std::size_t i = 0; i < objects.size(); ++i)
+		index.insert(i, objects[i]->getExtent());
+	
+	// Each path is also intersected with itself, to find self-intersections.
+	// Trivial results at the same position of the same part are skipped.
+	constexpr auto self_tolerance = PathCoord::length_type(0.001);
+	PathObject::Intersections intersections;
+	for (std::size_t i = 0; i < objects.size(); ++i)
+	{
+		index.query(objects[i]->getExtent(), [&](std::size_t k) {
+			if (k < i)
+				return;
+			
+			intersections.clear();
+			objects[i]->calcAllIntersectionsWith(objects[k], intersections);
+			for (const auto& intersection : intersections)
+			{
+				if (k == i
+				    && intersection.part_index == intersection.other_part_index
+				    && std::abs(intersection.length - intersection.other_length) < self_tolerance)
+					continue;
+				
+				splits[i][intersection.part_index].push_back(intersection.length);
+				splits[k][intersection.other_part_index].push_back(intersection.other_length);
+			}
+		});
+	}
+	
+	for (std::size_t i = 0; i < objects.size(); ++i)
+	{
+		for (std::size_t j = 0; j < splits[i].size(); ++j)
+			addEdges(objects[i], j, splits[i][j]);
+	}
+	
+	pruneDanglingEdges();
+}
+
+
+std::size_t FillGraph::node(const MapCoordF& pos)
+{
+	// Floor division, so that the buckets are not skewed around zero.
+	const auto coord = MapCoord(pos);
+	const auto x = qFloor(coord.nativeX() / qreal(node_tolerance));
+	const auto y = qFloor(coord.nativeY() / qreal(node_tolerance));
+	for (auto dx : { 0, -1, 1 })
+	{
+		for (auto dy : { 0, -1, 1 })
+		{
+			auto found = nodes.find({ x + dx, y + dy });
+			if (found != end(nodes))
+				return found->second;
+		}
+	}
+	
+	auto index = outgoing.size();
+	outgoing.emplace_back();
+	nodes.emplace(std::make_pair(x, y), index);
+	return index;
+}
+
+
+void FillGraph::addEdges(PathObject* object, PathPartVector::size_type part_index, std::vector<PathCoord::length_type>& splits)
+{
+	const auto& part = object->parts()[part_index];
+	const auto length = part.length();
+	for (auto& split : splits)
+		split = qBound(PathCoord::length_type(0), split, length);
+	std::sort(begin(splits), end(splits));
+	splits.erase(std::unique(begin(splits), end(splits)), end(splits));
+	if (part.isClosed())
+		splits.push_back(length);
+	
+	const auto& path_coords = part.path_coords;
+	auto path_coord = begin(path_coords);
+	auto split = SplitPathCoord::begin(path_coords);
+	for (std::size_t i = 1; i < splits.size(); ++i)
+	{
+		auto next_split = SplitPathCoord::at(splits[i], split);
+		
+		Edge edge { { object, part_index, splits[i-1], splits[i] }, 0, 0, { split.pos }, false };
+		while (path_coord != end(path_coords) && path_coord->clen <= splits[i-1])
+			++path_coord;
+		for (; path_coord != end(path_coords) && path_coord->clen < splits[i]; ++path_coord)
+			edge.points.push_back(path_coord->pos);
+		edge.points.push_back(next_split.pos);
+		split = next_split;
+		
+		if (edge.points.size() == 2 && edge.points.front() == edge.points.back())
+			continue;
+		
+		edge.from = node(edge.points.front());
+		edge.to = node(edge.points.back());
+		outgoing[edge.from].push_back(2 * edges.size());
+		outgoing[edge.to].push_back(2 * edges.size() + 1);
+		edges.push_back(std::move(edge));
+	}
+}
+
+
+void FillGraph::pruneDanglingEdges()
+{
+	std::vector<std::size_t> degree(outgoing.size());
+	for (std::size_t n = 0; n < outgoing.size(); ++n)
+		degree[n] = outgoing[n].size();
+	
+	std::vector<std::size_t> pending;
+	for (std::size_t n = 0; n < degree.size(); ++n)
+	{
+		if (degree[n] == 1)
+		{
+			pending.push_back(n);
+			const auto half_edge = outgoing[n].front();
+			const auto& points = edges[half_edge / 2].points;
+			open_ends.push_back((half_edge % 2) ? points.back() : points.front());
+		}
+	}
+	
+	while (!pending.empty())
+	{
+		auto n = pending.back();
+		pending.pop_back();
+		for (auto half_edge : outgoing[n])
+		{
+			auto& edge = edges[half_edge / 2];
+			if (edge.removed)
+				continue;
+			
+			edge.removed = true;
+			--degree[edge.from];
+			--degree[edge.to];
+			auto other = destination(half_edge);
+			if (degree[other] == 1)
+				pending.push_back(other);
+		}
+	}
+	
+	for (auto& half_edges : outgoing)
+	{
+		half_edges.erase(std::remove_if(begin(half_edges), end(half_edges), [this](HalfEdge half_edge) {
+			return edges[half_edge / 2].removed;
+		}), end(half_edges));
+	}
+}
+
+
+std::size_t FillGraph::origin(HalfEdge half_edge) const
+{
+	const auto& edge = edges[half_edge / 2];
+	return (half_edge % 2) ? edge.to : edge.from;
+}
+
+std::size_t FillGraph::destination(HalfEdge half_edge) const
+{
+	const auto& edge = edges[half_edge / 2];
+	return (half_edge % 2) ? edge.from : edge.to;
+}
+
+
+double FillGraph::startAngle(HalfEdge half_edge) const
+{
+	const auto& points = edges[half_edge / 2].points;
+	auto direction = MapCoordF{};
+	if (half_edge % 2)
+	{
+		for (auto point = points.rbegin() + 1; point != points.rend() && direction.lengthSquared() == 0; ++point)
+			direction = *point - points.back();
+	}
+	else
+	{
+		for (auto point = points.begin() + 1; point != points.end() && direction.lengthSquared() == 0; ++point)
+			direction = *point - points.front();
+	}
+	return std::atan2(direction.y(), direction.x());
+}
+
+
+FillGraph::HalfEdge FillGraph::next(HalfEdge half_edge) const
+{
+	// Take the outgoing half-edge with the smallest clockwise turn from the
+	// reversed incoming direction. The face is on the left-hand side then.
+	// Going back on the same edge is the last option.
+	constexpr auto two_pi = 2 * M_PI;
+	const auto twin = half_edge ^ 1;
+	const auto reverse_angle = startAngle(twin);
+	auto result = twin;
+	auto best_turn = two_pi;
+	for (auto candidate : outgoing[destination(half_edge)])
+	{
+		if (candidate == twin)
+			continue;
+		auto turn = std::fmod(reverse_angle - startAngle(candidate), two_pi);
+		if (turn <= 0)
+			turn += two_pi;
+		if (turn < best_turn)
+		{
+			best_turn = turn;
+			result = candidate;
+		}
+	}
+	return result;
+}
+
+
+std::vector<FillGraph::Cycle> FillGraph::cycles() const
+{
+	// The connected components, by node
+	std::vector<std::size_t> component(outgoing.size(), outgoing.size());
+	for (std::size_t n = 0; n < outgoing.size(); ++n)
+	{
+		if (component[n] != outgoing.size())
+			continue;
+		std::vector<std::size_t> pending = { n };
+		component[n] = n;
+		while (!pending.empty())
+		{
+			auto current = pending.back();
+			pending.pop_back();
+			for (auto half_edge : outgoing[current])
+			{
+				auto other = destination(half_edge);
+				if (component[other] == outgoing.size())
+				{
+					component[other] = n;
+					pending.push_back(other);
+				}
+			}
+		}
+	}
+	
+	std::vector<Cycle> result;
+	std::vector<bool> visited(2 * edges.size(), false);
+	for (HalfEdge start = 0; start < visited.size(); ++start)
+	{
+		if (visited[start] || edges[start / 2].removed)
+			continue;
+		
+		Cycle cycle { {}, {}, 0.0, component[origin(start)] };
+		auto half_edge = start;
+		do
+		{
+			visited[half_edge] = true;
+			cycle.half_edges.push_back(half_edge);
+			half_edge = next(half_edge);
+		}
+		while (half_edge != start && !visited[half_edge]);
+		if (half_edge != start)
+			continue;
+		
+		for (auto h : cycle.half_edges)
+		{
+			const auto& points = edges[h / 2].points;
+			if (h % 2)
+				cycle.polygon.insert(end(cycle.polygon), points.rbegin(), points.rend() - 1);
+			else
+				cycle.polygon.insert(end(cycle.polygon), points.begin(), points.end() - 1);
+		}
+		for (std::size_t i = 0, j = cycle.polygon.size() - 1; i < cycle.polygon.size(); j = i++)
+		{
+			const auto& a = cycle.polygon[i];
+			const auto& b = cycle.polygon[j];
+			cycle.area += b.x() * a.y() - a.x() * b.y();
+		}
+		result.push_back(std::move(cycle));
+	}
+	return result;
+}
+
+
+std::vector<PathSection> FillGraph::sections(const Cycle& cycle) const
+{
+	// Merge contiguous sections
+	std::vector<PathSection> result;
+	for (auto h : cycle.half_edges)
+	{
+		auto section = edges[h / 2].section;
+		if (h % 2)
+			std::swap(section.start_clen, section.end_clen);
+		if (!result.empty()
+		    && result.back().object == section.object
+		    && result.back().part == section.part
+		    && result.back().end_clen == section.start_clen)
+			result.back().end_clen = section.end_clen;
+		else
+			result.push_back(section);
+	}
+	return result;
+}
+
+
+std::vector<std::vector<PathSection>> FillGraph::findFace(const MapCoordF& pos, QRectF& out_extent) const
+{
+	auto contains = [](const std::vector<MapCoordF>& polygon, const MapCoordF& pos) {
+		auto inside = false;
+		for (std::size_t i = 0, j = polygon.size() - 1; i < polygon.size(); j = i++)
+		{
+			const auto& a = polygon[i];
+			const auto& b = polygon[j];
+			if ( ((a.y() > pos.y()) != (b.y() > pos.y()))
+			     && pos.x() < (b.x() - a.x()) * (pos.y() - a.y()) / (b.y() - a.y()) + a.x() )
+				inside = !inside;
+		}
+		return inside;
+	};
+	
+	const auto all_cycles = cycles();
+	std::vector<std::size_t> cycle_index(2 * edges.size(), all_cycles.size());
+	for (std::size_t c = 0; c < all_cycles.size(); ++c)
+	{
+		for (auto h : all_cycles[c].half_edges)
+			cycle_index[h] = c;
+	}
+	
+	// Collect the edges hit by a horizontal ray from pos to the right.
+	std::vector<std::pair<double, HalfEdge>> hits;
+	for (std::size_t e = 0; e < edges.size(); ++e)
+	{
+		const auto& edge = edges[e];
+		if (edge.removed)
+			continue;
+		for (std::size_t i = 1; i < edge.points.size(); ++i)
+		{
+			const auto& a = edge.points[i-1];
+			const auto& b = edge.points[i];
+			if ((a.y() > pos.y()) == (b.y() > pos.y()))
+				continue;
+			auto x = a.x() + (b.x() - a.x()) * (pos.y() - a.y()) / (b.y() - a.y());
+			if (x > pos.x())
+			{
+				// The half-edge which has pos on its left-hand side
+				hits.emplace_back(x - pos.x(), 2 * e + (b.y() > a.y() ? 0 : 1));
+			}
+		}
+	}
+	std::sort(begin(hits), end(hits));
+	
+	// The nearest bounded face which contains pos
+	auto face = std::find_if(begin(hits), end(hits), [&](const auto& hit) {
+		auto c = cycle_index[hit.second];
+		return c < all_cycles.size()
+		       && all_cycles[c].area > 0
+		       && contains(all_cycles[c].polygon, pos);
+	});
+	if (face == end(hits))
+		return {};
+	
+	const auto& outer = all_cycles[cycle_index[face->second]];
+	out_extent = QRectF(outer.polygon.front(), outer.polygon.front());
+	for (const auto& point : outer.polygon)
+		rectInclude(out_extent, point);
+	
+	std::vector<std::vector<PathSection>> result = { sections(outer) };
+	
+	// The outer boundaries of other components which are directly inside the
+	// face are its holes. Components inside a face of another such component,
+	// or surrounding pos, do not contribute.
+	auto isHole = [&](const Cycle& cycle) {
+		if (cycle.area >= 0
+		    || cycle.component == outer.component
+		    || !contains(outer.polygon, cycle.polygon.front())
+		    || contains(cycle.polygon, pos))
+			return false;
+		return std::none_of(begin(all_cycles), end(all_cycles), [&](const Cycle& other) {
+			return other.area > 0
+			       && other.component != outer.component
+			       && other.component != cycle.component
+			       && contains(other.polygon, cycle.polygon.front())
+			       && !contains(other.polygon, pos);
+		});
+	};
+	std::vector<const Cycle*> holes;
+	for (const auto& cycle : all_cycles)
+	{
+		if (isHole(cycle))
+			holes.push_back(&cycle);
+	}
+	
+	auto isInFace = [&](const MapCoordF& point) {
+		return contains(outer.polygon, point)
+		       && std::none_of(begin(holes), end(holes), [&](const Cycle* hole) {
+			return contains(hole->polygon, point);
+		});
+	};
+	if (std::any_of(begin(open_ends), end(open_ends), isInFace))
+		return {};
+	
+	for (const auto hole : holes)
+		result.push_back(sections(*hole));
+	return result;
+}
+
+
 }  // namespace
 
 
@@ -126,6 +660,11 @@ void FillTool::clickPress()
 	// First try to apply with current viewport only as extent (for speed)
 	auto widget = editor->getMainWidget();
 	QRectF viewport_extent = widget->getMapView()->calculateViewedRect(widget->viewportToView(widget->geometry()));
+	
+	// The vector fill is exact and fast, and it keeps islands as holes.
+	// The raster fill is the fallback which can close gaps.
+	if (fillVector(viewport_extent))
+		return;
 	int result = fill(viewport_extent);
 	if (result == -1 || result == 1)
 		return;
@@ -133,7 +672,7 @@ void FillTool::clickPress()
 	// If not successful, try again with rasterizing the whole map part
 	QRectF map_part_extent = map()->getCurrentPart()->calculateExtent(true);
 	if (viewport_extent.united(map_part_extent) != viewport_extent)
-		result = fill(map_part_extent);
+		result = fillVector(map_part_extent) ? 1 : fill(map_part_extent);
 	if (result == -1 || result == 1)
 		return;
 	
@@ -144,6 +683,54 @@ void FillTool::clickPress()
 	);
 }
 
+bool FillTool::fillVector(const QRectF& extent)
+{
+	const auto click_pos_map = cur_map_widget->viewportToMapF(click_pos);
+	
+	std::vector<Object*> candidates;
+	map()->getCurrentPart()->findObjectsAtBox(MapCoordF(extent.topLeft()), MapCoordF(extent.bottomRight()), false, true, candidates);
+	
+	std::vector<PathObject*> objects;
+	objects.reserve(candidates.size());
+	for (auto object : candidates)
+	{
+		if (object->getType() != Object::Path)
+			continue;
+		
+		// The raster fill reports that the clicked position is not free.
+		auto path = object->asPath();
+		if ((path->getSymbol()->getContainedTypes() & Symbol::Area)
+		    && path->isPointInsideArea(click_pos_map))
+			return false;
+		objects.push_back(path);
+	}
+	
+	QRectF face_extent;
+	auto rings = FillGraph(objects).findFace(click_pos_map, face_extent);
+	if (rings.empty() || extent.united(face_extent) != extent)
+		return false;
+	
+	auto path = new PathObject(drawing_symbol);
+	for (const auto& ring : rings)
+	{
+		PathObject ring_path;
+		for (const auto& section : ring)
+			appendSection(&ring_path, section);
+		if (ring_path.getCoordinateCount() < 2)
+			continue;
+		ring_path.closeAllParts();
+		path->appendPath(&ring_path);
+	}
+	if (path->getCoordinateCount() < 2)
+	{
+		delete path;
+		return false;
+	}
+	
+	addFillObject(path);
+	return true;
+}
+
 int FillTool::fill(const QRectF& extent)
 {
 	constexpr auto extent_area_warning_threshold = qreal(600 * 600); // 60 cm x 60 cm
@@ -286,14 +873,14 @@ QImage FillTool::rasterizeMap(const QRectF& extent, QTransform& out_transform)
 	{
 		// Temporarily enable baseline view and draw map once.
 		map()->setBaselineViewEnabled(true);
-		map()->getCurrentPart()->applyOnAllObjects(&Object::forceUpdate);
+		map()->getCurrentPart()->applyOnAllObjects(&Object::updateRenderableOptions);
 		drawObjectIDs(map(), &painter, config);
 		map()->setBaselineViewEnabled(false);
-		map()->getCurrentPart()->applyOnAllObjects(&Object::forceUpdate);
+		map()->getCurrentPart()->applyOnAllObjects(&Object::updateRenderableOptions);
 	}
 	else if (original_area_hatching)
 	{
-		map()->getCurrentPart()->applyOnAllObjects(&Object::forceUpdate);
+		map()->getCurrentPart()->applyOnAllObjects(&Object::updateRenderableOptions);
 	}
 	
 	// Draw the map in original mode (but without area hatching)
@@ -302,7 +889,7 @@ QImage FillTool::rasterizeMap(const QRectF& extent, QTransform& out_transform)
 	if (original_area_hatching)
 	{
 		map()->setAreaHatchingEnabled(original_area_hatching);
-		map()->getCurrentPart()->applyOnAllObjects(&Object::forceUpdate);
+		map()->getCurrentPart()->applyOnAllObjects(&Object::updateRenderableOptions);
 	}
 	
 	out_transform = painter.combinedTransform();
@@ -421,35 +1008,6 @@ int FillTool::traceBoundary(const QImage& image, QPoint free_pixel, QPoint bound
 bool FillTool::fillBoundary(const QImage& image, const std::vector<QPoint>& boundary, const QTransform& image_to_map)
 {
 	auto path = new PathObject(drawing_symbol);
-	auto append_section = [path](const PathSection& section)
-	{
-		if (!section.object)
-			return;
-		
-		const auto& part = section.object->parts()[section.part];
-		if (section.end_clen == section.start_clen)
-		{
-			path->addCoordinate(MapCoord(SplitPathCoord::at(section.start_clen, SplitPathCoord::begin(part.path_coords)).pos));
-			return;
-		}
-		
-		PathObject part_copy { part };
-		if (section.end_clen < section.start_clen)
-		{
-			part_copy.changePathBounds(0, section.end_clen, section.start_clen);
-			part_copy.reverse();
-		}
-		else
-		{
-			part_copy.changePathBounds(0, section.start_clen, section.end_clen);
-		}
-		
-		if (path->getCoordinateCount() == 0)
-			path->appendPath(&part_copy);
-		else
-			path->connectPathParts(0, &part_copy, 0, false, false);
-	};
-	
 	auto last_pixel = background; // no object
 	const auto pixel_length = PathCoord::length_type((image_to_map.map(QPointF(0, 0)) - image_to_map.map(QPointF(1, 1))).manhattanLength());
 	auto threshold = std::numeric_limits<PathCoord::length_type>::max();
@@ -467,7 +1025,7 @@ bool FillTool::fillBoundary(const QImage& image, const std::vector<QPoint>& boun
 		if (pixel != last_pixel)
 		{
 			// Change of object
-			append_section(section);
+			appendSection(path, section);
 			
 			section.object = map()->getCurrentPart()->getObject(int(pixel & RGB_MASK))->asPath();
 			section.object->calcClosestPointOnPath(map_pos, distance_sq, path_coord);
@@ -484,7 +1042,7 @@ bool FillTool::fillBoundary(const QImage& image, const std::vector<QPoint>& boun
 		if (Q_UNLIKELY(part != section.part))
 		{
 			// Change of path part
-			append_section(section);
+			appendSection(path, section);
 			
 			section.part = part;
 			section.start_clen = path_coord.clen;
@@ -497,20 +1055,20 @@ bool FillTool::fillBoundary(const QImage& image, const std::vector<QPoint>& boun
 		{
 			// Forward over closing point
 			section.end_clen = section.object->parts()[section.part].length();
-			append_section(section);
+			appendSection(path, section);
 			section.start_clen = 0;
 		}
 		else if (path_coord.clen - section.end_clen >= threshold)
 		{
 			// Backward over closing point
 			section.end_clen = 0;
-			append_section(section);
+			appendSection(path, section);
 			section.start_clen = section.object->parts()[section.part].length();
 		}
 		section.end_clen = path_coord.clen;
 	}
 	// Final section
-	append_section(section);
+	appendSection(path, section);
 	
 	if (path->getCoordinateCount() < 2)
 	{
@@ -525,6 +1083,12 @@ bool FillTool::fillBoundary(const QImage& image, const std::vector<QPoint>& boun
 	//   const auto simplify_epsilon = 1e-2;
 	//   path->simplify(nullptr, simplify_epsilon);
 	
+	addFillObject(path);
+	return true;
+}
+
+void FillTool::addFillObject(PathObject* path)
+{
 	int index = map()->addObject(path);
 	map()->clearObjectSelection(false);
 	map()->addObjectToSelection(path, true);
@@ -535,8 +1099,6 @@ bool FillTool::fillBoundary(const QImage& image, const std::vector<QPoint>& boun
 	
 	map()->setObjectsDirty();
 	updateDirtyRect();
-	
-	return true;
 }
 
 
@@ -40,6 +40,7 @@ namespace OpenOrienteering {
 
 class Map;
 class MapEditorController;
+class PathObject;
 class RenderConfig;
 class Symbol;
 
@@ -63,6 +64,19 @@ protected:
 	
 	void clickPress() override;
 	
+	/**
+	 * Tries to apply the fill tool at the current click position,
+	 * using the vector geometry of the objects in the given extent.
+	 * 
+	 * This builds the planar arrangement of the line and area boundaries
+	 * and extracts the face which encloses the click position, including
+	 * islands as holes. Unlike the raster fill, it does not close gaps
+	 * between the bounding objects. So it fails if an open line ends inside
+	 * the face, or if the face doesn't fit into the given extent.
+	 * Returns true if the fill object was created.
+	 */
+	bool fillVector(const QRectF& extent);
+	
 	/**
 	 * Tries to apply the fill tool at the current click position,
 	 * rasterizing the given extent of the map.
@@ -104,6 +118,11 @@ protected:
 	 */
 	bool fillBoundary(const QImage& image, const std::vector<QPoint>& boundary, const QTransform& image_to_map);
 	
+	/**
+	 * Adds the given fill object to the map, selects it, and pushes an undo step.
+	 */
+	void addFillObject(PathObject* path);
+	
 	const Symbol* drawing_symbol;
 };
 
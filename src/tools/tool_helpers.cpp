@@ -51,6 +51,7 @@
 #include "core/map_part.h"
 #include "core/map_view.h"
 #include "core/objects/object.h"
+#include "core/snapping_index.h"
 #include "gui/map/map_widget.h"
 #include "tools/tool.h"
 #include "util/util.h"
@@ -339,75 +340,53 @@ MapCoord SnappingToolHelper::snapToObject(MapCoordF position, MapWidget* widget,
 	
 	if (filter & (ObjectCorners | ObjectPaths))
 	{
-		// Find map objects at the given position
-		SelectionInfoVector objects;
-		map->findAllObjectsAt(position, snap_distance, true, false, false, true, objects);
+		// Query the vertices and path segments near the given position
+		const auto& snapping_index = map->getSnappingIndex();
+		auto const accept = [exclude_object](const Object* object) {
+			return object != exclude_object && !object->getSymbol()->isHidden();
+		};
 		
-		// Find closest snap spot from map objects
-		for (const auto& info : objects)
+		if (filter & ObjectCorners)
 		{
-			Object* object = info.second;
-			if (object == exclude_object)
-				continue;
+			// With ObjectPaths, the corners of paths are found below.
+			auto const accept_vertex = [&accept, this](const Object* object) {
+				return accept(object) && (object->getType() == Object::Point || !(filter & ObjectPaths));
+			};
 			
-			auto distance_sq = float(-1); /// \todo Change to qreal when Path::calcClosestPointOnPath accepts that.
-			if (object->getType() == Object::Point && filter & ObjectCorners)
+			SnappingIndex::Vertex vertex;
+			if (snapping_index.findClosestVertex(position, snap_distance, accept_vertex, vertex)
+			    && vertex.distance_sq < closest_distance_sq)
 			{
-				PointObject* point = object->asPoint();
-				distance_sq = point->getCoordF().distanceSquaredTo(position);
-				if (distance_sq < closest_distance_sq)
-				{
-					closest_distance_sq = distance_sq;
-					result_position = point->getCoord();
-					result_info.type = ObjectCorners;
-					result_info.object = object;
-					result_info.coord_index = 0;
-				}
+				closest_distance_sq = vertex.distance_sq;
+				result_position = vertex.object->getRawCoordinateVector()[vertex.coord_index];
+				result_info.type = ObjectCorners;
+				result_info.object = const_cast<Object*>(vertex.object);
+				result_info.coord_index = vertex.coord_index;
 			}
-			else if (object->getType() == Object::Path)
+		}
+		
+		if (filter & ObjectPaths)
+		{
+			SnappingIndex::PathPoint path_point;
+			if (snapping_index.findClosestPathPoint(position, snap_distance, accept, path_point)
+			    && path_point.distance_sq < closest_distance_sq)
 			{
-				PathObject* path = object->asPath();
-				if (filter & ObjectPaths)
+				auto const& path_coord = path_point.path_coord;
+				closest_distance_sq = path_point.distance_sq;
+				result_position = MapCoord(path_coord.pos);
+				result_info.object = const_cast<Object*>(path_point.object);
+				if (path_coord.param == 0)
 				{
-					PathCoord path_coord;
-					path->calcClosestPointOnPath(position, distance_sq, path_coord);
-					if (distance_sq < closest_distance_sq)
-					{
-						closest_distance_sq = distance_sq;
-						result_position = MapCoord(path_coord.pos);
-						result_info.object = object;
-						if (path_coord.param == 0)
-						{
-							result_info.type = ObjectCorners;
-							result_info.coord_index = path_coord.index;
-						}
-						else
-						{
-							result_info.type = ObjectPaths;
-							result_info.coord_index = std::numeric_limits<decltype(result_info.coord_index)>::max();
-							result_info.path_coord = path_coord;
-						}
-					}
+					result_info.type = ObjectCorners;
+					result_info.coord_index = path_coord.index;
 				}
 				else
 				{
-					MapCoordVector::size_type index;
-					path->calcClosestCoordinate(position, distance_sq, index);
-					if (distance_sq < closest_distance_sq)
-					{
-						closest_distance_sq = distance_sq;
-						result_position = path->getCoordinate(index);
-						result_info.type = ObjectCorners;
-						result_info.object = object;
-						result_info.coord_index = index;
-					}
+					result_info.type = ObjectPaths;
+					result_info.coord_index = std::numeric_limits<decltype(result_info.coord_index)>::max();
+					result_info.path_coord = path_coord;
 				}
 			}
-			else if (object->getType() == Object::Text)
-			{
-				// No snapping to texts
-				continue;
-			}
 		}
 	}
 	
@@ -747,7 +747,7 @@ void ObjectTagsUndoStep::addObject(int index)
 	ObjectModifyingUndoStep::addObject(index);
 	
 	MapPart* const map_part = map->getPart(getPartIndex());
-	object_tags_map[index] = map_part->getObject(index)->tags();
+	object_tags_map[index] = map_part->getObject(index)->tagList();
 }
 
 UndoStep* ObjectTagsUndoStep::undo()
@@ -809,7 +809,9 @@ void ObjectTagsUndoStep::loadImpl(QXmlStreamReader &xml, SymbolDictionary &symbo
 				XmlElementReader tags_element(xml);
 				int index = tags_element.attribute<int>(literal::object);
 				modified_objects.push_back(index);
-				tags_element.read(object_tags_map[index]);
+				Object::Tags tags;
+				tags_element.read(tags);
+				object_tags_map[index] = Object::toTagList(tags);
 			}
 			else
 			{
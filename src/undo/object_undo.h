@@ -433,7 +433,7 @@ protected:
 	
 	void loadImpl(QXmlStreamReader& xml, SymbolDictionary& symbol_dict) override;
 	
-	typedef std::map<int, Object::Tags> ObjectTagsMap;
+	typedef std::map<int, Object::TagList> ObjectTagsMap;
 	
 	ObjectTagsMap object_tags_map;
 };
@@ -23,7 +23,10 @@
 
 #include <vector>
 
+#include <QBuffer>
+#include <QIODevice>
 #include <QXmlStreamReader>
+#include <QXmlStreamWriter>
 
 #include "object_undo.h"
 #include "map_part_undo.h"
@@ -89,6 +92,7 @@ UndoStep* UndoStep::getUndoStepForType(Type type, Map* map)
 UndoStep::UndoStep(Type type, Map* map)
 : type(type)
 , map(map)
+, saved_generation(-1)
 {
 	; // nothing else
 }
@@ -134,6 +138,20 @@ void UndoStep::save(QXmlStreamWriter& xml)
 	saveImpl(xml);
 }
 
+QByteArray UndoStep::saveData(int generation)
+{
+	if (saved_generation != generation)
+	{
+		saved_data.clear();
+		QBuffer buffer(&saved_data);
+		buffer.open(QIODevice::WriteOnly);
+		QXmlStreamWriter xml(&buffer);
+		save(xml);
+		saved_generation = generation;
+	}
+	return saved_data;
+}
+
 void UndoStep::saveImpl(QXmlStreamWriter& xml) const
 {
 	Q_UNUSED(xml);
@@ -27,6 +27,8 @@
 #include <set>
 #include <vector>
 
+#include <QByteArray>
+
 class QIODevice;
 class QXmlStreamReader;
 class QXmlStreamWriter;
@@ -180,6 +182,15 @@ public:
 	 */
 	void save(QXmlStreamWriter& xml);
 	
+	/**
+	 * Returns the data which save() writes, as a separate XML fragment.
+	 * 
+	 * The data is kept for subsequent calls with the same generation.
+	 * 
+	 * @see UndoManager::undoData()
+	 */
+	QByteArray saveData(int generation);
+	
 protected:	
 	/**
 	 * Saves undo properties to the the xml stream.
@@ -208,6 +219,10 @@ protected:
 	 * The map this undo step belongs.
 	 */
 	Map* const map;
+	
+private:
+	QByteArray saved_data;  ///< Kept by saveData()
+	int saved_generation;   ///< The generation of saved_data
 };
 
 
@@ -37,6 +37,7 @@
 #include <QXmlStreamReader>
 
 #include "core/map.h"
+#include "fileformats/xml_file_format.h"
 #include "undo/undo.h"
 #include "util/xml_stream_util.h"
 
@@ -56,6 +57,16 @@ void saveSteps(QXmlStreamWriter& xml, iterator first, iterator last)
 		(*step)->save(xml);
 }
 
+template <class iterator>
+std::vector<QByteArray> saveStepData(iterator first, iterator last, int generation)
+{
+	std::vector<QByteArray> data;
+	data.reserve(std::size_t(std::distance(first, last)));
+	for (auto step = first; step != last; ++step)
+		data.push_back((*step)->saveData(generation));
+	return data;
+}
+
 }  // namespace
 
 
@@ -81,6 +92,8 @@ UndoManager::UndoManager(Map* map)
 , current_index(0)
 , clean_state_index(-1)
 , loaded_state_index(-1)
+, data_version(0)
+, data_generation(0)
 {
 	undo_steps.reserve(max_undo_steps + 1);  // +1 is for push before trim
 	if (map)
@@ -142,6 +155,9 @@ bool UndoManager::canUndo() const
 
 bool UndoManager::undo(QWidget* dialog_parent)
 {
+	// Steps from the file may refer to objects which are still loading.
+	map->finishLoadingObjects();
+	
 	UndoManager::State const old_state(this);
 	
 	if (!old_state.can_undo)
@@ -187,6 +203,9 @@ bool UndoManager::canRedo() const
 
 bool UndoManager::redo(QWidget* dialog_parent)
 {
+	// Steps from the file may refer to objects which are still loading.
+	map->finishLoadingObjects();
+	
 	UndoManager::State const old_state(this);
 	
 	if (!old_state.can_redo)
@@ -466,6 +485,42 @@ void UndoManager::saveRedo(QXmlStreamWriter& xml)
 	saveSteps(xml, first, last);
 }
 
+std::vector<QByteArray> UndoManager::undoData()
+{
+	validateUndoSteps();
+	auto first = begin(undo_steps);
+	auto last  = first + StepList::difference_type(undoStepCount());
+	first = std::find_if(first, last, [](auto&& undo_step) { return undo_step->isValid(); });
+	return saveStepData(first, last, dataGeneration());
+}
+
+std::vector<QByteArray> UndoManager::redoData()
+{
+	validateRedoSteps();
+	auto first = undo_steps.rbegin();
+	auto last  = undo_steps.rbegin() + StepList::difference_type(redoStepCount());
+	return saveStepData(first, last, dataGeneration());
+}
+
+int UndoManager::dataGeneration()
+{
+	// The steps refer to symbols by index.
+	std::vector<const Symbol*> symbols;
+	if (map)
+	{
+		symbols.reserve(std::size_t(map->getNumSymbols()));
+		for (int i = 0; i < map->getNumSymbols(); ++i)
+			symbols.push_back(map->getSymbol(i));
+	}
+	if (symbols != data_symbols || data_version != XMLFileFormat::active_version)
+	{
+		data_symbols.swap(symbols);
+		data_version = XMLFileFormat::active_version;
+		++data_generation;
+	}
+	return data_generation;
+}
+
 
 void UndoManager::loadUndo(QXmlStreamReader& xml, SymbolDictionary& symbol_dict)
 {
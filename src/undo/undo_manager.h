@@ -27,6 +27,7 @@
 #include <memory>
 #include <vector>
 
+#include <QByteArray>
 #include <QObject>
 
 #include "core/symbols/symbol.h"
@@ -185,6 +186,23 @@ public:
 	 */
 	void saveRedo(QXmlStreamWriter& xml);
 	
+	/**
+	 * Returns the XML data of the steps which saveUndo() writes,
+	 * one fragment per step.
+	 * 
+	 * The data of each step is kept for subsequent calls, until the map's
+	 * symbols change. So repeated calls need to save new steps only.
+	 */
+	std::vector<QByteArray> undoData();
+	
+	/**
+	 * Returns the XML data of the steps which saveRedo() writes,
+	 * one fragment per step.
+	 * 
+	 * @see undoData()
+	 */
+	std::vector<QByteArray> redoData();
+	
 	/**
 	 * Loads the undo steps from the file in xml format.
 	 * 
@@ -301,6 +319,14 @@ private:
 	
 	StepList loadSteps(QXmlStreamReader& xml, SymbolDictionary& symbol_dict) const;
 	
+	/**
+	 * Returns the generation of the steps' XML data, cf. UndoStep::saveData().
+	 * 
+	 * There is a new generation whenever the map's symbols or the active
+	 * XML file format version have changed.
+	 */
+	int dataGeneration();
+	
 	/**
 	 * The list of all steps available for undo() and redo().
 	 * 
@@ -342,6 +368,23 @@ private:
 	 */
 	int loaded_state_index;
 	
+	/**
+	 * The symbols which the current data generation refers to.
+	 * 
+	 * @see dataGeneration()
+	 */
+	std::vector<const Symbol*> data_symbols;
+	
+	/**
+	 * The file format version which the current data generation refers to.
+	 */
+	int data_version;
+	
+	/**
+	 * The current generation of the steps' XML data.
+	 */
+	int data_generation;
+	
 };
 
 
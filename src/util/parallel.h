@@ -0,0 +1,88 @@
+/*
+ *    Copyright 2018 The OpenOrienteering developers
+ *
+ *    This file is part of OpenOrienteering.
+ *
+ *    OpenOrienteering is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    OpenOrienteering is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with OpenOrienteering.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef OPENORIENTEERING_UTIL_PARALLEL_H
+#define OPENORIENTEERING_UTIL_PARALLEL_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+
+#include <QRunnable>
+#include <QSemaphore>
+#include <QThreadPool>
+
+namespace OpenOrienteering {
+
+
+/**
+ * Calls function(i) for each i in the range [0, count), distributed over
+ * the calling thread and the idle threads of the global QThreadPool.
+ *
+ * Returns when all calls are finished. The order of the calls is unspecified.
+ * The function must be safe to be called concurrently for different indices,
+ * and it must not throw.
+ *
+ * Only threads which are idle at the time of the call are used. Thus it is
+ * safe to call this function from a thread of the pool, too.
+ */
+template <class Function>
+void parallelFor(std::size_t count, const Function& function)
+{
+	std::atomic<std::size_t> next { 0 };
+	auto work = [&next, count, &function]() {
+		for (auto i = next++; i < count; i = next++)
+			function(i);
+	};
+
+	class Helper : public QRunnable
+	{
+	public:
+		Helper(const decltype(work)& work, QSemaphore& done) : work(work), done(done) {}
+		void run() override { work(); done.release(); }
+	private:
+		const decltype(work)& work;
+		QSemaphore& done;
+	};
+
+	auto pool = QThreadPool::globalInstance();
+	auto const max_helpers = count > 1 ? std::min(std::size_t(pool->maxThreadCount()), count) - 1 : 0;
+
+	QSemaphore done;
+	std::size_t helpers = 0;
+	while (helpers < max_helpers)
+	{
+		auto helper = new Helper(work, done);
+		if (!pool->tryStart(helper))
+		{
+			delete helper;
+			break;
+		}
+		++helpers;
+	}
+
+	work();
+	done.acquire(int(helpers));
+}
+
+
+}  // namespace OpenOrienteering
+
+#endif
@@ -21,6 +21,7 @@
 #include "xml_stream_util.h"
 
 #include <algorithm>
+#include <cstddef>
 #include <exception>
 #include <limits>
 #include <stdexcept>
@@ -170,12 +171,23 @@ void XmlElementWriter::write(const MapCoordVector& coords)
 	{
 		// Default: efficient plain text format
 		//   Note that it is more efficient to concatenate the data
-		// than to call writeCharacters() multiple times.
+		// than to call writeCharacters() multiple times. The text is
+		// encoded straight into a pre-sized buffer, in chunks of
+		// limited size.
+		constexpr std::size_t chunk_size = 4096;
 		QString data;
-		data.reserve(coords.size() * 16);
-		for (auto& coord : coords)
-			data.append(coord.toString());
-		xml.writeCharacters(data);
+		data.resize(int(std::min(coords.size(), chunk_size)) * MapCoord::max_string_length);
+		auto first = begin(coords);
+		do
+		{
+			auto const last = first + std::ptrdiff_t(std::min(chunk_size, std::size_t(end(coords) - first)));
+			auto const buffer = data.data();
+			auto pos = buffer;
+			for (; first != last; ++first)
+				pos = first->toUtf16(pos);
+			xml.writeCharacters(QString::fromRawData(buffer, int(pos - buffer)));
+		}
+		while (first != end(coords));
 	}
 }
 
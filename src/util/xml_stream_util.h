@@ -20,6 +20,7 @@
 #ifndef OPENORIENTEERING_XML_STREAM_UTIL_H
 #define OPENORIENTEERING_XML_STREAM_UTIL_H
 
+#include <utility>
 #include <vector>
 
 #include <QtGlobal>
@@ -252,6 +253,11 @@ public:
 	 */
 	void write(const QHash<QString, QString>& tags);
 	
+	/**
+	 * Writes tags from a list of key/value pairs.
+	 */
+	void write(const std::vector<std::pair<QString, QString>>& tags);
+	
 private:
 	QXmlStreamWriter& xml;
 };
@@ -582,6 +588,19 @@ void XmlElementWriter::write(const QHash<QString, QString> &tags)
 	}
 }
 
+inline
+void XmlElementWriter::write(const std::vector<std::pair<QString, QString>>& tags)
+{
+	namespace literal = XmlStreamLiteral;
+	
+	for (const auto& tag : tags)
+	{
+		XmlElementWriter tag_element(xml, literal::t);
+		tag_element.writeAttribute(literal::k, tag.first);
+		xml.writeCharacters(tag.second);
+	}
+}
+
 //### XmlElementReader inline implemenentation ###
 
 inline
@@ -0,0 +1,387 @@
+/*
+ *    Copyright 2018 The OpenOrienteering developers
+ *
+ *    This file is part of OpenOrienteering.
+ *
+ *    OpenOrienteering is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    OpenOrienteering is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with OpenOrienteering.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "area_symbol_t.h"
+
+#include <cmath>
+#include <cstdlib>
+#include <memory>
+
+#include <QtMath>
+#include <QtTest>
+#include <QColor>
+#include <QImage>
+#include <QPainter>
+#include <QRect>
+#include <QRectF>
+#include <QRgb>
+
+#include "global.h"
+#include "core/map.h"
+#include "core/map_color.h"
+#include "core/map_coord.h"
+#include "core/objects/object.h"
+#include "core/renderables/renderable.h"
+#include "core/renderables/renderable_implementation.h"
+#include "core/symbols/area_symbol.h"
+#include "core/symbols/line_symbol.h"
+#include "core/symbols/point_symbol.h"
+#include "core/symbols/symbol.h"
+
+using namespace OpenOrienteering;
+
+
+namespace
+{
+
+/// Pixels per millimeter
+constexpr auto resolution = 10;
+
+/**
+ * Renders the renderables of the given color to an image of the map area
+ * from (0, 0) to (30, 30), with the given bounding box.
+ */
+QImage render(const Map& map, const ObjectRenderables& renderables, const MapColor& color, const QRectF& bounding_box)
+{
+	QImage image(30 * resolution, 30 * resolution, QImage::Format_ARGB32_Premultiplied);
+	image.fill(Qt::white);
+	
+	QPainter painter(&image);
+	painter.setRenderHint(QPainter::Antialiasing);
+	painter.scale(resolution, resolution);
+	RenderConfig config = { map, bounding_box, resolution, RenderConfig::NoOptions, 1.0 };
+	renderables.draw(color.getPriority(), Qt::black, &painter, config);
+	painter.end();
+	
+	return image;
+}
+
+/**
+ * Returns the number of pixels in the given rectangle which differ
+ * noticeably between the two images.
+ */
+int countDifferences(const QImage& a, const QImage& b, const QRect& rect)
+{
+	auto count = 0;
+	for (auto y = rect.top(); y <= rect.bottom(); ++y)
+	{
+		for (auto x = rect.left(); x <= rect.right(); ++x)
+		{
+			auto const pa = a.pixel(x, y);
+			auto const pb = b.pixel(x, y);
+			if (std::abs(qGray(pa) - qGray(pb)) > 8 || std::abs(qAlpha(pa) - qAlpha(pb)) > 8)
+				++count;
+		}
+	}
+	return count;
+}
+
+/**
+ * Returns the number of pixels in the given rectangle which are not white.
+ */
+int countInk(const QImage& image, const QRect& rect)
+{
+	auto count = 0;
+	for (auto y = rect.top(); y <= rect.bottom(); ++y)
+	{
+		for (auto x = rect.left(); x <= rect.right(); ++x)
+		{
+			if (qGray(image.pixel(x, y)) < 255 - 8)
+				++count;
+		}
+	}
+	return count;
+}
+
+
+/**
+ * Compares the rendering of the compact renderables with the rendering of
+ * the reference renderables, for the whole area and for a detail.
+ * 
+ * The number of differing pixels must not exceed the given fraction of the
+ * pixels covered by the reference rendering.
+ */
+void compareRendering(const ObjectRenderables& compact, const ObjectRenderables& reference, const MapColor& color, double tolerance)
+{
+	Map map;
+	
+	auto const full_area = QRectF(0, 0, 30, 30);
+	auto const full_pixels = QRect(0, 0, 30 * resolution, 30 * resolution);
+	auto const expected = render(map, reference, color, full_area);
+	auto const max_differences = [&expected, tolerance](const QRect& rect) {
+		return int(countInk(expected, rect) * tolerance);
+	};
+	QVERIFY(countDifferences(render(map, compact, color, full_area), expected, full_pixels) <= max_differences(full_pixels));
+	
+	// Only the visible part is generated for a detail.
+	auto const detail = QRectF(7.5, 8.5, 10, 6);
+	auto const detail_pixels = QRect(75, 85, 100, 60);
+	auto const blank = render(map, reference, color, QRectF());
+	QVERIFY(countDifferences(expected, blank, detail_pixels) > 0);
+	QVERIFY(countDifferences(render(map, compact, color, detail), expected, detail_pixels) <= max_differences(detail_pixels));
+}
+
+/**
+ * Initializes the object as the area which is used for testing patterns.
+ */
+void initTestArea(PathObject& object)
+{
+	object.addCoordinate(MapCoord(3, 5));
+	object.addCoordinate(MapCoord(25, 2));
+	object.addCoordinate(MapCoord(27, 26));
+	object.addCoordinate(MapCoord(4, 22));
+	object.closeAllParts();
+	object.update();
+}
+
+}  // namespace
+
+
+
+AreaSymbolTest::AreaSymbolTest(QObject* parent)
+: QObject(parent)
+{
+	// nothing
+}
+
+void AreaSymbolTest::initTestCase()
+{
+	Q_INIT_RESOURCE(resources);
+	doStaticInitializations();
+	// Static map initializations
+	Map map;
+}
+
+
+void AreaSymbolTest::linePatternTest_data()
+{
+	QTest::addColumn<float>("angle");
+	QTest::addColumn<bool>("rotatable");
+	QTest::addColumn<float>("delta_rotation");
+	
+	QTest::newRow("horizontal")     <<   0.0f << false << 0.0f;
+	QTest::newRow("vertical")       <<  90.0f << false << 0.0f;
+	QTest::newRow("30 deg")         <<  30.0f << false << 0.0f;
+	QTest::newRow("135 deg")        << 135.0f << false << 0.0f;
+	QTest::newRow("rotated 0 deg")  <<   0.0f << true  << 0.7f;
+	QTest::newRow("rotated 60 deg") <<  60.0f << true  << 2.1f;
+}
+
+void AreaSymbolTest::linePatternTest()
+{
+	QFETCH(float, angle);
+	QFETCH(bool, rotatable);
+	QFETCH(float, delta_rotation);
+	
+	MapColor color(QStringLiteral("black"), 0);
+	
+	AreaSymbol symbol;
+	symbol.setNumFillPatterns(1);
+	auto& pattern = symbol.getFillPattern(0);
+	pattern.type = AreaSymbol::FillPattern::LinePattern;
+	pattern.angle = qDegreesToRadians(angle);
+	pattern.setRotatable(rotatable);
+	pattern.line_spacing = 1300;
+	pattern.line_offset = 200;
+	pattern.line_color = &color;
+	pattern.line_width = 250;
+	
+	PathObject object(&symbol);
+	initTestArea(object);
+	AreaRenderable outline(&symbol, object.parts());
+	auto const origin = MapCoord(1.3, 0.7);
+	
+	ObjectRenderables compact(object);
+	pattern.createRenderables(outline, delta_rotation, origin, compact);
+	
+	// The reference: a separate renderable for each line,
+	// on the lines where dotProduct(normal, p) == offset + k * spacing.
+	LineSymbol line;
+	line.setColor(&color);
+	line.setLineWidth(0.001 * pattern.line_width);
+	
+	auto rotation = std::fmod(double(pattern.angle + (rotatable ? delta_rotation : 0)), M_PI);
+	if (rotation < 0)
+		rotation += M_PI;
+	auto const normal = MapCoordF(std::sin(rotation), std::cos(rotation));
+	auto const direction = MapCoordF(normal.y(), -normal.x());
+	auto offset = 0.001 * pattern.line_offset;
+	if (rotatable)
+		offset += MapCoordF::dotProduct(normal, MapCoordF(origin));
+	auto const spacing = 0.001 * pattern.line_spacing;
+	
+	// Long enough lines around the center of the test area
+	auto const center = MapCoordF(15, 15);
+	auto const radius = 30.0;
+	auto const center_offset = MapCoordF::dotProduct(normal, center);
+	auto const first = int(std::floor((center_offset - radius - offset) / spacing));
+	auto const last = int(std::ceil((center_offset + radius - offset) / spacing));
+	
+	ObjectRenderables reference(object);
+	reference.setClipPath(outline.painterPath());
+	for (auto k = first; k <= last; ++k)
+	{
+		auto const base = center + normal * (offset + k * spacing - center_offset);
+		reference.insertRenderable(new LineRenderable(&line, base - direction * radius, base + direction * radius));
+	}
+	
+	compareRendering(compact, reference, color, 0);
+}
+
+
+void AreaSymbolTest::pointPatternTest_data()
+{
+	QTest::addColumn<float>("angle");
+	QTest::addColumn<bool>("rotatable");
+	QTest::addColumn<float>("delta_rotation");
+	
+	QTest::newRow("horizontal")     <<   0.0f << false << 0.0f;
+	QTest::newRow("45 deg")         <<  45.0f << false << 0.0f;
+	QTest::newRow("rotated 30 deg") <<  30.0f << true  << 1.1f;
+}
+
+void AreaSymbolTest::pointPatternTest()
+{
+	QFETCH(float, angle);
+	QFETCH(bool, rotatable);
+	QFETCH(float, delta_rotation);
+	
+	MapColor color(QStringLiteral("black"), 0);
+	
+	auto point = new PointSymbol();
+	point->setInnerRadius(300);
+	point->setInnerColor(&color);
+	
+	AreaSymbol symbol;
+	symbol.setNumFillPatterns(1);
+	auto& pattern = symbol.getFillPattern(0);
+	pattern.type = AreaSymbol::FillPattern::PointPattern;
+	pattern.angle = qDegreesToRadians(angle);
+	pattern.setRotatable(rotatable);
+	pattern.line_spacing = 1500;
+	pattern.line_offset = 100;
+	pattern.offset_along_line = 400;
+	pattern.point_distance = 1700;
+	pattern.point = point;  // owned by symbol
+	
+	PathObject object(&symbol);
+	initTestArea(object);
+	AreaRenderable outline(&symbol, object.parts());
+	
+	// The pattern generates a single stamping renderable.
+	ObjectRenderables compact(object);
+	pattern.createRenderables(outline, delta_rotation, MapCoord(1.3, 0.7), compact);
+	Map map;
+	QVERIFY(countInk(render(map, compact, color, QRectF(0, 0, 30, 30)), QRect(0, 0, 30 * resolution, 30 * resolution)) > 0);
+	
+	// The stamped rendering of a skewed lattice of points,
+	// compared to a separate set of renderables for each point.
+	auto const rotation = double(pattern.angle + (rotatable ? delta_rotation : 0));
+	auto const step = MapCoordF(std::cos(rotation), -std::sin(rotation)) * (0.001 * pattern.point_distance);
+	auto const normal = MapCoordF(std::sin(rotation), std::cos(rotation)) * (0.001 * pattern.line_spacing);
+	auto const center = MapCoordF(15, 15);
+	auto const count = int(std::ceil(60 / (0.001 * pattern.point_distance))) + 1;
+	
+	PointObject point_object(point);
+	point_object.setRotation(float(rotation));
+	point_object.update();
+	ObjectRenderables prototype(point_object);
+	point->createRenderablesScaled(MapCoordF(0, 0), -float(rotation), prototype);
+	QVERIFY(PointPatternRenderable::canStamp(prototype));
+	
+	auto rows = std::make_shared<PointPatternRenderable::Rows>();
+	ObjectRenderables reference(object);
+	reference.setClipPath(outline.painterPath());
+	for (auto j = -25; j <= 25; ++j)
+	{
+		auto const shift = std::fmod(0.4 * j, 1.0) - 0.5 * (count - 1);
+		auto const start = center + normal * j + step * shift;
+		rows->push_back({ start, step, count });
+		for (auto i = 0; i < count; ++i)
+			point->createRenderablesScaled(start + step * i, -float(rotation), reference);
+	}
+	
+	ObjectRenderables stamped(object);
+	stamped.setClipPath(outline.painterPath());
+	PointPatternRenderable::create(prototype, rows, stamped);
+	
+	// Points are stamped from an image at whole pixel positions.
+	// This may move the edges of the points by up to half a pixel.
+	compareRendering(stamped, reference, color, 0.05);
+}
+
+
+void AreaSymbolTest::renderableOptionsTest()
+{
+	Map map;
+	auto color = new MapColor(QStringLiteral("black"), 0);
+	map.addColor(color, 0);
+	auto symbol = new AreaSymbol();
+	symbol->setColor(color);
+	map.addSymbol(symbol, 0);
+	
+	auto object = new PathObject(symbol);
+	object->addCoordinate(MapCoord(3, 5));
+	object->addCoordinate(MapCoord(25, 2));
+	object->addCoordinate(MapCoord(27, 26));
+	object->addCoordinate(MapCoord(4, 22));
+	object->closeAllParts();
+	map.addObject(object);
+	object->update();
+	
+	auto const full_area = QRectF(0, 0, 30, 30);
+	auto const full_pixels = QRect(0, 0, 30 * resolution, 30 * resolution);
+	auto const normal = render(map, object->renderables(), *color, full_area);
+	
+	map.setAreaHatchingEnabled(true);
+	map.updateRenderableOptions();
+	QCOMPARE(object->renderables().renderableOptions(), int(Symbol::RenderAreasHatched));
+	auto const hatched = render(map, object->renderables(), *color, full_area);
+	QVERIFY(countDifferences(hatched, normal, full_pixels) > 0);
+	
+	// The normal renderables are kept.
+	map.setAreaHatchingEnabled(false);
+	map.updateRenderableOptions();
+	QCOMPARE(object->renderables().renderableOptions(), int(Symbol::RenderNormal));
+	QCOMPARE(countDifferences(render(map, object->renderables(), *color, full_area), normal, full_pixels), 0);
+	
+	map.setAreaHatchingEnabled(true);
+	map.updateRenderableOptions();
+	QCOMPARE(countDifferences(render(map, object->renderables(), *color, full_area), hatched, full_pixels), 0);
+	
+	// Modifications discard the kept renderables.
+	object->move(MapCoord(1, 1));
+	object->update();
+	map.setAreaHatchingEnabled(false);
+	map.updateRenderableOptions();
+	auto const moved = render(map, object->renderables(), *color, full_area);
+	QVERIFY(countDifferences(moved, normal, full_pixels) > 0);
+	QVERIFY(countDifferences(moved, hatched, full_pixels) > 0);
+}
+
+
+
+/*
+ * We don't need a real GUI window.
+ */
+auto qpa_selected = qputenv("QT_QPA_PLATFORM", "minimal");
+
+
+QTEST_MAIN(AreaSymbolTest)
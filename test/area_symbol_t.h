@@ -0,0 +1,57 @@
+/*
+ *    Copyright 2018 The OpenOrienteering developers
+ *
+ *    This file is part of OpenOrienteering.
+ *
+ *    OpenOrienteering is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    OpenOrienteering is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with OpenOrienteering.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef OPENORIENTEERING_AREA_SYMBOL_T_H
+#define OPENORIENTEERING_AREA_SYMBOL_T_H
+
+#include <QObject>
+
+
+/**
+ * @test Tests the rendering of AreaSymbol fill patterns.
+ * 
+ * The compact pattern renderables must produce the same output as
+ * reference renderables which are built by the test, with a separate
+ * renderable for each single line or point.
+ */
+class AreaSymbolTest : public QObject
+{
+Q_OBJECT
+public:
+	/** Constructor */
+	explicit AreaSymbolTest(QObject* parent = nullptr);
+	
+private slots:
+	void initTestCase();
+	
+	/** Compares the rendering of line patterns. */
+	void linePatternTest();
+	void linePatternTest_data();
+	
+	/** Compares the rendering of point patterns. */
+	void pointPatternTest();
+	void pointPatternTest_data();
+	
+	/** Tests switching between renderable options. */
+	void renderableOptionsTest();
+	
+};
+
+#endif
@@ -66,6 +66,38 @@ int AutosaveTestDocument::autosaveCount() const
 }
 
 
+//### BackgroundAutosaveTestDocument ###
+
+BackgroundAutosaveTestDocument::BackgroundAutosaveTestDocument(unsigned long duration)
+: AutosaveTestDocument(Autosave::Success),
+  duration(duration),
+  finished_count(0)
+{
+	// nothing
+}
+
+Autosave::BackgroundAutosave BackgroundAutosaveTestDocument::prepareAutosave(Autosave::AutosaveResult& /*result*/)
+{
+	autosave();
+	auto duration = this->duration;
+	return [duration]() {
+		QThread::msleep(duration);
+		return Autosave::Success;
+	};
+}
+
+void BackgroundAutosaveTestDocument::autosaveFinished(Autosave::AutosaveResult result)
+{
+	QCOMPARE(result, Autosave::Success);
+	++finished_count;
+}
+
+int BackgroundAutosaveTestDocument::finishedCount() const
+{
+	return finished_count;
+}
+
+
 //### AutosaveTest ###
 
 AutosaveTest::AutosaveTest(QObject* parent)
@@ -248,6 +280,47 @@ void AutosaveTest::autosaveStopTest()
 	}
 }
 
+void AutosaveTest::backgroundTest()
+{
+	{
+		BackgroundAutosaveTestDocument doc(1000);
+		
+		// Enable and trigger Autosave
+		doc.setAutosaveNeeded(true);
+		QThread::msleep(msecs(1.1 * autosave_interval));
+		QCoreApplication::processEvents();
+		QCOMPARE(doc.autosaveCount(), 1);
+		QCOMPARE(doc.finishedCount(), 0);
+		
+		// Verify that the result is reported when the worker has finished
+		QThread::msleep(1500);
+		QCoreApplication::processEvents();
+		QCOMPARE(doc.autosaveCount(), 1);
+		QCOMPARE(doc.finishedCount(), 1);
+		
+		// Verify that Autosave does trigger again after the regular interval
+		QThread::msleep(msecs(1.1 * autosave_interval));
+		QCoreApplication::processEvents();
+		QCOMPARE(doc.autosaveCount(), 2);
+	}
+	
+	{
+		BackgroundAutosaveTestDocument doc(1000);
+		
+		// Verify that waiting reports the result immediately
+		doc.setAutosaveNeeded(true);
+		QThread::msleep(msecs(1.1 * autosave_interval));
+		QCoreApplication::processEvents();
+		QCOMPARE(doc.autosaveCount(), 1);
+		doc.waitForAutosave();
+		QCOMPARE(doc.finishedCount(), 1);
+		
+		// Verify that the queued notification is ignored
+		QCoreApplication::processEvents();
+		QCOMPARE(doc.finishedCount(), 1);
+	}
+}
+
 /*
  * We don't need a real GUI window.
  */
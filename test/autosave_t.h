@@ -67,6 +67,47 @@ private:
 };
 
 
+/**
+ * @test A document class which autosaves on a worker thread.
+ */
+class BackgroundAutosaveTestDocument : public AutosaveTestDocument
+{
+public:
+	/**
+	 * @brief Constructs a document which takes the given time for autosaving.
+	 */
+	BackgroundAutosaveTestDocument(unsigned long duration);
+	
+	~BackgroundAutosaveTestDocument() override = default;
+	
+	/**
+	 * @brief Returns a function which sleeps and then returns Autosave::Success.
+	 */
+	Autosave::BackgroundAutosave prepareAutosave(Autosave::AutosaveResult& result) override;
+	
+	/**
+	 * @brief Counts the finished background autosaves.
+	 */
+	void autosaveFinished(Autosave::AutosaveResult result) override;
+	
+	/**
+	 * @brief Returns the number of invocations of autosaveFinished().
+	 */
+	int finishedCount() const;
+	
+private:
+	/**
+	 * @brief The duration of the background autosave, in milliseconds.
+	 */
+	unsigned long duration;
+	
+	/**
+	 * @brief The number of invocations of autosaveFinished().
+	 */
+	int finished_count;
+};
+
+
 /**
  * @test Tests the autosave feature.
  */
@@ -93,6 +134,9 @@ private slots:
 	/** @brief Tests autosave stopping on normal saving. */
 	void autosaveStopTest();
 	
+	/** @brief Tests autosaving on a worker thread. */
+	void backgroundTest();
+	
 protected:
 	/** @brief The autosave interval, unit: minutes. */
 	const double autosave_interval;
@@ -0,0 +1,154 @@
+/*
+ *    Copyright 2018 The OpenOrienteering developers
+ *
+ *    This file is part of OpenOrienteering.
+ *
+ *    OpenOrienteering is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    OpenOrienteering is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with OpenOrienteering.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "batch_converter_t.h"
+
+#include <vector>
+
+#include <QtTest>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QString>
+#include <QStringList>
+#include <QTemporaryDir>
+#include <QTextStream>
+
+#include "test_config.h"
+
+#include "global.h"
+#include "cli/batch_converter.h"
+#include "core/map.h"
+#include "core/map_view.h"
+
+using namespace OpenOrienteering;
+
+
+namespace
+{
+	const auto test_files = {
+	    "data:test_map.omap",
+	    "data:spotcolor_overprint.xmap",
+	};
+	
+}  // namespace
+
+
+
+void BatchConverterTest::initTestCase()
+{
+	QCoreApplication::setOrganizationName(QString::fromLatin1("OpenOrienteering.org"));
+	QCoreApplication::setApplicationName(QString::fromLatin1("BatchConverterTest"));
+	
+	doStaticInitializations();
+	
+	static const auto prefix = QString::fromLatin1("data");
+	QDir::addSearchPath(prefix, QDir(QString::fromUtf8(MAPPER_TEST_SOURCE_DIR)).absoluteFilePath(prefix));
+}
+
+
+void BatchConverterTest::convertTest()
+{
+	QTemporaryDir dir;
+	QVERIFY(dir.isValid());
+	
+	// Several XML exports of each input run concurrently.
+	std::vector<BatchJob> jobs;
+	for (auto raw_path : test_files)
+	{
+		const auto input = QFileInfo(QString::fromUtf8(raw_path)).absoluteFilePath();
+		QVERIFY(QFile::exists(input));
+		
+		const auto base = dir.path() + QLatin1Char('/') + QFileInfo(input).completeBaseName();
+		for (auto i = 0; i < 4; ++i)
+		{
+			const auto n = QString::number(i);
+			jobs.push_back({ input, { base + n + QLatin1String(".xmap"), base + n + QLatin1String(".omap") } });
+		}
+	}
+	
+	QString log_text;
+	QTextStream log(&log_text);
+	BatchConverter converter(log);
+	converter.setMaxParallelJobs(int(jobs.size()));
+	QCOMPARE(converter.run(jobs), 0);
+	QCOMPARE(log_text.count(QLatin1String(" failed: ")), 0);
+	
+	for (const auto& job : jobs)
+	{
+		Map expected;
+		MapView expected_view { nullptr, &expected };
+		QVERIFY(expected.loadFrom(job.input, nullptr, &expected_view, false, false));
+		
+		for (const auto& output : job.outputs)
+		{
+			Map actual;
+			MapView actual_view { nullptr, &actual };
+			QVERIFY2(actual.loadFrom(output, nullptr, &actual_view, false, false), qPrintable(output));
+			QCOMPARE(actual.getNumColors(), expected.getNumColors());
+			QCOMPARE(actual.getNumSymbols(), expected.getNumSymbols());
+			QCOMPARE(actual.getNumParts(), expected.getNumParts());
+			QCOMPARE(actual.getNumObjects(), expected.getNumObjects());
+		}
+	}
+}
+
+
+void BatchConverterTest::importErrorTest()
+{
+	QTemporaryDir dir;
+	QVERIFY(dir.isValid());
+	
+	const auto missing = dir.path() + QLatin1String("/missing.omap");
+	const auto invalid = dir.path() + QLatin1String("/invalid.omap");
+	QFile invalid_file(invalid);
+	QVERIFY(invalid_file.open(QIODevice::WriteOnly));
+	invalid_file.write("This is not a map.\n");
+	invalid_file.close();
+	
+	const auto output = dir.path() + QLatin1String("/output.xmap");
+	const std::vector<BatchJob> jobs = {
+	    { missing, { output } },
+	    { invalid, { output } },
+	};
+	
+	QString log_text;
+	QTextStream log(&log_text);
+	BatchConverter converter(log);
+	QCOMPARE(converter.run(jobs), 2);
+	QVERIFY(!QFile::exists(output));
+	
+	const auto lines = log_text.split(QLatin1Char('\n'));
+	const auto missing_line = lines.filter(missing);
+	QCOMPARE(missing_line.size(), 1);
+	QVERIFY(missing_line.front().length() > missing.length() + QString::fromLatin1(": Cannot open file: ").length());
+	const auto invalid_line = lines.filter(invalid);
+	QCOMPARE(invalid_line.size(), 1);
+	QVERIFY(invalid_line.front().endsWith(BatchConverter::tr("Invalid file type.")));
+}
+
+
+
+/*
+ * We don't need a real GUI window.
+ */
+auto qpa_selected = qputenv("QT_QPA_PLATFORM", "minimal");
+
+
+QTEST_MAIN(BatchConverterTest)
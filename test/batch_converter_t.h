@@ -0,0 +1,44 @@
+/*
+ *    Copyright 2018 The OpenOrienteering developers
+ *
+ *    This file is part of OpenOrienteering.
+ *
+ *    OpenOrienteering is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    OpenOrienteering is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with OpenOrienteering.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef OPENORIENTEERING_BATCH_CONVERTER_T_H
+#define OPENORIENTEERING_BATCH_CONVERTER_T_H
+
+#include <QObject>
+
+
+/**
+ * @test Tests the headless batch converter.
+ */
+class BatchConverterTest : public QObject
+{
+Q_OBJECT
+private slots:
+	void initTestCase();
+	
+	/** Tests that parallel jobs save maps which equal their input. */
+	void convertTest();
+	
+	/** Tests that failed imports are counted, and reported with their cause. */
+	void importErrorTest();
+	
+};
+
+#endif
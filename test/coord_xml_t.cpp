@@ -344,6 +344,125 @@ void CoordXmlTest::writeCompressed()
 }
 
 
+void CoordXmlTest::writeToString_data()
+{
+	common_data();
+}
+
+namespace {
+
+/**
+ * The implementation of MapCoord::toString() before the introduction of
+ * MapCoord::toUtf16().
+ */
+QString legacyToString(const MapCoord& coord)
+{
+	constexpr std::size_t buf_size = 1+2+2+20+3;
+	static const QChar encoded[10] = {
+	    QLatin1Char{'0'}, QLatin1Char{'1'},
+	    QLatin1Char{'2'}, QLatin1Char{'3'},
+	    QLatin1Char{'4'}, QLatin1Char{'5'},
+	    QLatin1Char{'6'}, QLatin1Char{'7'},
+	    QLatin1Char{'8'}, QLatin1Char{'9'}
+	};
+	QChar buffer[buf_size];
+	
+	std::size_t j = buf_size - 1;
+	buffer[j] = QLatin1Char{';'};
+	--j;
+	
+	auto flags = coord.flags();
+	if (flags > 0)
+	{
+		do
+		{
+			buffer[j] = encoded[flags % 10];
+			flags = flags / 10;
+			--j;
+		}
+		while (flags != 0);
+		
+		buffer[j] = QChar::Space;
+		--j;
+	}
+	
+	qint64 tmp = coord.nativeY();
+	QChar sign { QChar::Null };
+	if (tmp < 0)
+	{
+		sign = QLatin1Char{'-'};
+		tmp = -tmp;
+	}
+	do
+	{
+		buffer[j] = encoded[tmp % 10];
+		tmp = tmp / 10;
+		--j;
+	}
+	while (tmp != 0);
+	if (!sign.isNull())
+	{
+		buffer[j] = sign;
+		--j;
+		sign = QChar::Null;
+	}
+	
+	buffer[j] = QChar::Space;
+	--j;
+	
+	tmp = coord.nativeX();
+	if (tmp < 0)
+	{
+		sign = QLatin1Char{'-'};
+		tmp = -tmp;
+	}
+	do
+	{
+		buffer[j] = encoded[tmp % 10];
+		tmp = tmp / 10;
+		--j;
+	}
+	while (tmp != 0);
+	if (!sign.isNull())
+	{
+		buffer[j] = sign;
+		--j;
+	}
+	
+	++j;
+	return QString(buffer+j, int(buf_size-j));
+}
+
+}  // namespace
+
+void CoordXmlTest::writeToString()
+{
+	buffer.open(QBuffer::ReadWrite);
+	QXmlStreamWriter xml(&buffer);
+	xml.setAutoFormatting(false);
+	xml.writeStartDocument();
+	
+	QFETCH(int, num_coords);
+	MapCoordVector coords(num_coords, proto_coord);
+	QBENCHMARK
+	{
+		QString data;
+		data.reserve(int(coords.size()) * 16);
+		for (auto& coord : coords)
+			data.append(legacyToString(coord));
+		xml.writeCharacters(data);
+	}
+	
+	xml.writeEndDocument();
+	buffer.close();
+	
+	// The fast implementation must produce the same text.
+	QChar text[MapCoord::max_string_length];
+	QCOMPARE(QString(text, int(proto_coord.toUtf16(text) - text)), legacyToString(proto_coord));
+	QCOMPARE(proto_coord.toString(), legacyToString(proto_coord));
+}
+
+
 void CoordXmlTest::writeFastImplementation_data()
 {
 	common_data();
@@ -58,6 +58,11 @@ private slots:
 	void writeCompressed();
 	void writeCompressed_data();
 	
+	/** Concatenates strings from a copy of the former MapCoord::toString(),
+	 *  for comparison with the fast implementation. */
+	void writeToString();
+	void writeToString_data();
+	
 	/** Calls the actual fast implementation from MapCoord. */
 	void writeFastImplementation();
 	void writeFastImplementation_data();
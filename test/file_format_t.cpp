@@ -30,6 +30,7 @@
 #include "core/map.h"
 #include "core/map_color.h"
 #include "core/map_grid.h"
+#include "core/map_part.h"
 #include "core/map_printer.h"
 #include "core/objects/object.h"
 #include "fileformats/file_format.h"
@@ -38,6 +39,7 @@
 #include "fileformats/ocad8_file_format.h"
 #include "fileformats/xml_file_format.h"
 #include "templates/template.h"
+#include "undo/object_undo.h"
 #include "undo/undo.h"
 #include "undo/undo_manager.h"
 #include "util/backports.h"
@@ -363,6 +365,21 @@ void FileFormatTest::mapCoordtoString()
 	static_assert(sizeof(decltype(native_x)) == sizeof(qint32), "This test assumes qint32 native coordinates");
 	QCOMPARE(MapCoord::fromNative(bounds::max(), bounds::max(), MapCoord::Flags{MapCoord::Flags::Int(8)}).toString(), QString::fromLatin1("2147483647 2147483647 8;"));
 	QCOMPARE(MapCoord::fromNative(bounds::min(), bounds::min(), MapCoord::Flags{MapCoord::Flags::Int(1)}).toString(), QString::fromLatin1("-2147483648 -2147483648 1;"));
+	
+	// Verify that the text is parsed back to the original coordinates,
+	// for numbers shorter and longer than eight digits.
+	MapCoord::boundsOffset().reset(false);
+	for (auto const& coord : {
+	         MapCoord::fromNative(7, -12345678),
+	         MapCoord::fromNative(-123456789, 98765432, MapCoord::Flags{MapCoord::Flags::Int(255)}),
+	         MapCoord::fromNative(bounds::max(), bounds::min(), MapCoord::Flags{MapCoord::Flags::Int(16)}) })
+	{
+		auto const text = coord.toString() + coord.toString();
+		auto ref = QStringRef(&text);
+		QCOMPARE(MapCoord(ref), coord);
+		QCOMPARE(MapCoord(ref), coord);
+		QVERIFY(ref.isEmpty());
+	}
 }
 
 
@@ -482,6 +499,94 @@ void FileFormatTest::saveAndLoad()
 
 
 
+void FileFormatTest::streamObjects_data()
+{
+	QTest::addColumn<QString>("filename");
+	
+	for (auto raw_path : test_files)
+		QTest::newRow(raw_path) << QString::fromUtf8(raw_path);
+}
+
+void FileFormatTest::streamObjects()
+{
+	QFETCH(QString, filename);
+	
+	Map expected {};
+	QVERIFY(expected.loadFrom(filename, nullptr, nullptr, false, false));
+	
+	Map actual {};
+	QVERIFY(actual.loadFrom(filename, nullptr, nullptr, false, false, true));
+	QVERIFY(!actual.hasUnsavedChanges());
+	
+	// An object which is added while loading goes after the loaded objects.
+	auto part = actual.getCurrentPart();
+	auto object = new PointObject(Map::getUndefinedPoint());
+	part->addObject(object);
+	QVERIFY(!actual.isLoadingObjects());
+	QCOMPARE(part->getObject(part->getNumObjects() - 1), static_cast<Object*>(object));
+	part->deleteObject(object, false);
+	
+	actual.finishLoadingObjects();
+	QVERIFY(!actual.isLoadingObjects());
+	
+	QString error;
+	bool equal = compareMaps(expected, actual, error);
+	if (!equal)
+		QFAIL(QString::fromLatin1("Streamed map does not equal loaded map, error: %1").arg(error).toLocal8Bit());
+}
+
+
+
+void FileFormatTest::snapshot_data()
+{
+	QTest::addColumn<QString>("filename");
+	
+	for (auto raw_path : test_files)
+		QTest::newRow(raw_path) << QString::fromUtf8(raw_path);
+}
+
+void FileFormatTest::snapshot()
+{
+	QFETCH(QString, filename);
+	
+	Map map {};
+	QVERIFY(map.loadFrom(filename, nullptr, nullptr, false, false));
+	
+	QTemporaryDir dir;
+	QVERIFY(dir.isValid());
+	auto const path = dir.path() + QLatin1String("/snapshot.xmap");
+	auto const compareSnapshot = [&map, &path]() {
+		QString error;
+		XMLFileSnapshot snapshot(map, nullptr, path);
+		Map loaded {};
+		if (!snapshot.save(path))
+			error = QString::fromLatin1("Cannot save the snapshot.");
+		else if (!loaded.loadFrom(path, nullptr, nullptr, false, false))
+			error = QString::fromLatin1("Cannot load the snapshot.");
+		else
+			compareMaps(map, loaded, error);
+		return error;
+	};
+	
+	auto error = compareSnapshot();
+	QVERIFY2(error.isEmpty(), qPrintable(error));
+	
+	// Changes after the first snapshot
+	auto part = map.getPart(0);
+	QVERIFY(part->getNumObjects() > 0);
+	part->getObject(0)->setTag(QStringLiteral("snapshot"), QStringLiteral("1"));
+	part->addObject(part->getObject(0)->duplicate());
+	auto undo_step = new AddObjectsUndoStep(&map);
+	undo_step->addObject(0, part->getObject(0)->duplicate());
+	part->deleteObject(0, false);
+	map.push(undo_step);
+	
+	error = compareSnapshot();
+	QVERIFY2(error.isEmpty(), qPrintable(error));
+}
+
+
+
 void FileFormatTest::pristineMapTest()
 {
 	auto spot_color = std::make_unique<MapColor>(QString::fromLatin1("spot color"), 0);
@@ -56,6 +56,19 @@ private slots:
 	void saveAndLoad();
 	void saveAndLoad_data();
 	
+	/**
+	 * Tests that maps loaded with object streaming equal maps loaded at once.
+	 */
+	void streamObjects();
+	void streamObjects_data();
+	
+	/**
+	 * Tests that snapshots, including later snapshots which reuse cached
+	 * data, contain the same information as the map.
+	 */
+	void snapshot();
+	void snapshot_data();
+	
 	/**
 	 * Test saving and loading a map which is created in memory and does not go
 	 * through an implicit export-import-cycle before the test.
@@ -19,6 +19,9 @@
 
 #include "georeferencing_t.h"
 
+#include <cstddef>
+#include <vector>
+
 #include <QtTest>
 
 #include <proj_api.h>
@@ -221,5 +224,76 @@ void GeoreferencingTest::testProjection()
 }
 
 
+void GeoreferencingTest::testBatchProjection_data()
+{
+	testProjection_data();
+}
+
+void GeoreferencingTest::testBatchProjection()
+{
+	QFETCH(QString, proj);
+	QVERIFY2(georef.setProjectedCRS(proj, proj), proj.toLatin1());
+	
+	QFETCH(double, easting);
+	QFETCH(double, northing);
+	QFETCH(double, latitude);
+	QFETCH(double, longitude);
+	
+	const std::vector<LatLon> lat_lon = {
+	    { latitude, longitude },
+	    { latitude + 0.01, longitude },
+	    { latitude, longitude - 0.01 },
+	};
+	std::vector<QPointF> proj_coords(lat_lon.size());
+	QVERIFY(georef.toProjectedCoords(lat_lon.data(), lat_lon.size(), proj_coords.data()));
+	for (std::size_t i = 0; i < lat_lon.size(); ++i)
+	{
+		bool ok;
+		QCOMPARE(proj_coords[i], georef.toProjectedCoords(lat_lon[i], &ok));
+		QVERIFY(ok);
+	}
+	
+	proj_coords = { { easting, northing }, { easting + 1000, northing }, { easting, northing - 1000 } };
+	std::vector<LatLon> geo_coords(proj_coords.size());
+	QVERIFY(georef.toGeographicCoords(proj_coords.data(), proj_coords.size(), geo_coords.data()));
+	for (std::size_t i = 0; i < proj_coords.size(); ++i)
+	{
+		bool ok;
+		auto expected = georef.toGeographicCoords(proj_coords[i], &ok);
+		QVERIFY(ok);
+		QCOMPARE(geo_coords[i].latitude(), expected.latitude());
+		QCOMPARE(geo_coords[i].longitude(), expected.longitude());
+	}
+	
+	// Map coordinates from another georeferencing, transformed in place
+	Georeferencing other(georef);
+	other.setProjectedRefPoint(QPointF(easting, northing));
+	std::vector<MapCoordF> map_coords = { { 0, 0 }, { 100, 0 }, { 0, -100 } };
+	std::vector<MapCoordF> expected;
+	for (const auto& map_coord : map_coords)
+	{
+		bool ok;
+		expected.push_back(georef.toMapCoordF(&other, map_coord, &ok));
+		QVERIFY(ok);
+	}
+	QVERIFY(georef.toMapCoordF(&other, map_coords.data(), map_coords.size(), map_coords.data()));
+	for (std::size_t i = 0; i < map_coords.size(); ++i)
+		QCOMPARE(map_coords[i], expected[i]);
+	
+	// A coordinate which cannot be transformed fails on its own.
+	const std::vector<LatLon> invalid_lat_lon = {
+	    { latitude, longitude },
+	    { 100.0, longitude },
+	    { latitude, longitude - 0.01 },
+	};
+	std::vector<bool> ok;
+	proj_coords.resize(invalid_lat_lon.size());
+	QVERIFY(!georef.toProjectedCoords(invalid_lat_lon.data(), invalid_lat_lon.size(), proj_coords.data(), &ok));
+	QCOMPARE(ok, (std::vector<bool>{ true, false, true }));
+	QCOMPARE(proj_coords[0], georef.toProjectedCoords(invalid_lat_lon[0]));
+	QCOMPARE(proj_coords[2], georef.toProjectedCoords(invalid_lat_lon[2]));
+}
+
+
 
 QTEST_GUILESS_MAIN(GeoreferencingTest)
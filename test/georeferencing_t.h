@@ -70,6 +70,14 @@ private slots:
 	
 	void testProjection_data();
 	
+	/**
+	 * Tests whether the batch transformations give the same results as
+	 * the transformation of single points.
+	 */
+	void testBatchProjection();
+	
+	void testBatchProjection_data();
+	
 private:
 	Georeferencing georef;
 };
@@ -0,0 +1,194 @@
+/*
+ *    Copyright 2018 The OpenOrienteering developers
+ *
+ *    This file is part of OpenOrienteering.
+ *
+ *    OpenOrienteering is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    OpenOrienteering is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with OpenOrienteering.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "glyph_path_cache_t.h"
+
+#include <QtTest>
+#include <QColor>
+#include <QFont>
+#include <QImage>
+#include <QPainter>
+#include <QPainterPath>
+#include <QRect>
+#include <QRectF>
+#include <QString>
+
+#include "core/renderables/glyph_path_cache.h"
+
+using namespace OpenOrienteering;
+
+
+namespace
+{
+	/**
+	 * Renders the path to an image of the given area, without antialiasing.
+	 */
+	QImage render(const QPainterPath& path, const QRect& area)
+	{
+		QImage image(area.size(), QImage::Format_ARGB32_Premultiplied);
+		image.fill(Qt::white);
+		QPainter painter(&image);
+		painter.translate(-area.topLeft());
+		painter.fillPath(path, Qt::black);
+		painter.end();
+		return image;
+	}
+	
+	/**
+	 * Returns the number of pixels which differ between the images.
+	 */
+	int countDifferentPixels(const QImage& a, const QImage& b)
+	{
+		auto count = 0;
+		for (int y = 0; y < a.height(); ++y)
+		{
+			for (int x = 0; x < a.width(); ++x)
+			{
+				if (a.pixel(x, y) != b.pixel(x, y))
+					++count;
+			}
+		}
+		return count;
+	}
+	
+	/**
+	 * Returns the number of black pixels in the image.
+	 */
+	int countBlackPixels(const QImage& image)
+	{
+		auto count = 0;
+		for (int y = 0; y < image.height(); ++y)
+		{
+			for (int x = 0; x < image.width(); ++x)
+			{
+				if (image.pixel(x, y) == QColor(Qt::black).rgb())
+					++count;
+			}
+		}
+		return count;
+	}
+	
+}  // namespace
+
+
+
+void GlyphPathCacheTest::addTextTest_data()
+{
+	QTest::addColumn<QString>("text");
+	QTest::addColumn<bool>("kerning");
+	QTest::addColumn<bool>("underline");
+	
+	auto const plain  = QStringLiteral("Hello World 123");
+	auto const kerned = QStringLiteral("AVATAR Wavy To");
+	QTest::newRow("plain")             << plain  << false << false;
+	QTest::newRow("kerned")            << kerned << true  << false;
+	QTest::newRow("unkerned")          << kerned << false << false;
+	QTest::newRow("underline")         << plain  << false << true;
+	QTest::newRow("kerned, underline") << kerned << true  << true;
+	QTest::newRow("ligatures")         << QStringLiteral("office affluent") << true << false;
+	QTest::newRow("combining mark")    << QString::fromUtf8("Cafe\xcc\x81") << true << false;
+	QTest::newRow("Greek, Cyrillic")   << QString::fromUtf8("\xce\x91\xce\xb8\xce\xae\xce\xbd\xce\xb1 \xd0\x9c\xd0\xbe\xd1\x81\xd0\xba\xd0\xb2\xd0\xb0") << true << false;
+}
+
+
+void GlyphPathCacheTest::addTextTest()
+{
+	QFETCH(QString, text);
+	QFETCH(bool, kerning);
+	QFETCH(bool, underline);
+	
+	QFont font;
+	font.setPixelSize(100);
+	font.setKerning(kerning);
+	font.setUnderline(underline);
+	
+	auto const x = 10.0;
+	auto const y = 150.0;
+	
+	QPainterPath expected;
+	expected.addText(x, y, font, text);
+	
+	GlyphPathCache cache;
+	QPainterPath actual;
+	cache.addText(actual, x, y, font, text);
+	
+	// The second pass takes all glyphs from the cache.
+	QPainterPath cached;
+	cache.addText(cached, x, y, font, text);
+	QVERIFY(cached == actual);
+	
+	auto const expected_rect = expected.boundingRect();
+	auto const actual_rect = actual.boundingRect();
+	auto const tolerance = 0.5;
+	QVERIFY(qAbs(actual_rect.left() - expected_rect.left()) < tolerance);
+	QVERIFY(qAbs(actual_rect.top() - expected_rect.top()) < tolerance);
+	QVERIFY(qAbs(actual_rect.right() - expected_rect.right()) < tolerance);
+	QVERIFY(qAbs(actual_rect.bottom() - expected_rect.bottom()) < tolerance);
+	
+	// Allow for rounding at the edges of the glyphs.
+	auto const area = expected_rect.united(actual_rect).adjusted(-2, -2, 2, 2).toAlignedRect();
+	auto const expected_image = render(expected, area);
+	auto const actual_image = render(actual, area);
+	auto const black_pixels = countBlackPixels(expected_image);
+	QVERIFY(black_pixels > 0);
+	QVERIFY(countDifferentPixels(expected_image, actual_image) <= black_pixels / 100);
+}
+
+
+void GlyphPathCacheTest::statisticsTest()
+{
+	QFont font;
+	font.setPixelSize(100);
+	font.setKerning(false);
+	
+	GlyphPathCache cache;
+	QPainterPath path;
+	cache.addText(path, 0, 0, font, QStringLiteral("abcabc"));
+	
+	auto stats = cache.statistics();
+	if (stats.fallbacks > 0)
+		QSKIP("The default font's glyphs cannot be taken from the cache.");
+	
+	QCOMPARE(stats.misses, quint64(3));
+	QCOMPARE(stats.hits, quint64(3));
+	QCOMPARE(stats.glyphs, 3);
+	
+	// Text in other scripts is handled by QPainterPath::addText().
+	cache.addText(path, 0, 0, font, QString::fromUtf8("\xd8\xa7\xd9\x84\xd8\xb9\xd8\xb1\xd8\xa8\xd9\x8a\xd8\xa9"));
+	stats = cache.statistics();
+	QCOMPARE(stats.fallbacks, quint64(1));
+	QCOMPARE(stats.glyphs, 3);
+	
+	cache.clear();
+	stats = cache.statistics();
+	QCOMPARE(stats.misses, quint64(0));
+	QCOMPARE(stats.hits, quint64(0));
+	QCOMPARE(stats.fallbacks, quint64(0));
+	QCOMPARE(stats.glyphs, 0);
+}
+
+
+
+/*
+ * We don't need a real GUI window.
+ */
+auto qpa_selected = qputenv("QT_QPA_PLATFORM", "minimal");
+
+
+QTEST_MAIN(GlyphPathCacheTest)
@@ -0,0 +1,46 @@
+/*
+ *    Copyright 2018 The OpenOrienteering developers
+ *
+ *    This file is part of OpenOrienteering.
+ *
+ *    OpenOrienteering is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    OpenOrienteering is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with OpenOrienteering.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef OPENORIENTEERING_GLYPH_PATH_CACHE_T_H
+#define OPENORIENTEERING_GLYPH_PATH_CACHE_T_H
+
+#include <QObject>
+
+
+/**
+ * @test Tests the glyph path cache against QPainterPath::addText().
+ */
+class GlyphPathCacheTest : public QObject
+{
+Q_OBJECT
+private slots:
+	/**
+	 * Tests that text assembled from cached glyphs, or handled by the
+	 * fallback, matches QPainterPath::addText().
+	 */
+	void addTextTest_data();
+	void addTextTest();
+	
+	/** Tests that the cache is used for plain text, and the statistics. */
+	void statisticsTest();
+	
+};
+
+#endif
@@ -19,6 +19,12 @@
 
 #include "map_t.h"
 
+#include <algorithm>
+#include <iterator>
+#include <memory>
+#include <utility>
+#include <vector>
+
 #include <QtTest>
 #include <QBuffer>
 #include <QMessageBox>
@@ -31,6 +37,9 @@
 #include "core/map_color.h"
 #include "core/map_printer.h" // IWYU pragma: keep
 #include "core/map_view.h"
+#include "core/map_coord.h"
+#include "core/map_part.h"
+#include "core/snapping_index.h"
 #include "core/objects/object.h"
 #include "core/objects/symbol_rule_set.h"
 #include "core/symbols/symbol.h"
@@ -297,6 +306,241 @@ void MapTest::hasAlpha()
 
 
 
+void MapTest::findObjectsTest()
+{
+	Map map;
+	MapView view{ &map };
+	QVERIFY(map.loadFrom(examples_dir.absoluteFilePath(QStringLiteral("complete map.omap")), nullptr, &view, false, false));
+	
+	auto const* part = map.getCurrentPart();
+	QVERIFY(part->getNumObjects() > 0);
+	
+	auto full_scan = [part](MapCoordF coord, float tolerance) {
+		SelectionInfoVector result;
+		for (int i = 0; i < part->getNumObjects(); ++i)
+		{
+			auto* object = const_cast<Object*>(part->getObject(i));
+			if (object->getSymbol()->isHidden() || object->getSymbol()->isProtected())
+				continue;
+			object->update();
+			int selected_type = object->isPointOnObject(coord, tolerance, false, false);
+			if (selected_type != Symbol::NoSymbol)
+				result.emplace_back(selected_type, object);
+		}
+		return result;
+	};
+	
+	auto indexed = [&map](MapCoordF coord, float tolerance) {
+		SelectionInfoVector result;
+		// Results must come in part order, like a full scan.
+		map.findObjectsAt(coord, tolerance, false, false, false, false, result);
+		return result;
+	};
+	
+	for (int i = 0; i < part->getNumObjects(); ++i)
+	{
+		auto const coord = MapCoordF(part->getObject(i)->getRawCoordinateVector().front());
+		QCOMPARE(indexed(coord, 0.5f), full_scan(coord, 0.5f));
+		QCOMPARE(indexed(coord + MapCoordF(1, 1), 0.1f), full_scan(coord + MapCoordF(1, 1), 0.1f));
+	}
+	
+	// Modified objects must be found at their new location.
+	auto* object = [&map]() -> Object* {
+		auto* part = map.getCurrentPart();
+		for (int i = 0; i < part->getNumObjects(); ++i)
+		{
+			if (part->getObject(i)->getType() == Object::Point)
+				return part->getObject(i);
+		}
+		return nullptr;
+	}();
+	QVERIFY(object);
+	auto const old_coord = MapCoordF(object->getRawCoordinateVector().front());
+	auto const offset = MapCoord(100.0, 100.0);
+	object->move(offset);
+	auto const new_coord = MapCoordF(object->getRawCoordinateVector().front());
+	QCOMPARE(indexed(new_coord, 0.5f), full_scan(new_coord, 0.5f));
+	QCOMPARE(indexed(old_coord, 0.5f), full_scan(old_coord, 0.5f));
+	
+	auto const box = QRectF(new_coord - MapCoordF(1, 1), new_coord + MapCoordF(1, 1));
+	std::vector<Object*> in_box;
+	map.findObjectsAtBox(MapCoordF(box.topLeft()), MapCoordF(box.bottomRight()), true, true, in_box);
+	QVERIFY(std::find(begin(in_box), end(in_box), object) != end(in_box));
+	QVERIFY(map.countObjectsInRect(box, true) >= 1);
+}
+
+
+
+void MapTest::snappingIndexTest()
+{
+	Map map;
+	MapView view{ &map };
+	QVERIFY(map.loadFrom(examples_dir.absoluteFilePath(QStringLiteral("complete map.omap")), nullptr, &view, false, false));
+	
+	auto* part = map.getCurrentPart();
+	QVERIFY(part->getNumObjects() > 0);
+	
+	auto const max_distance = 2.0;
+	
+	// Brute force, as in the former SnappingToolHelper::snapToObject()
+	auto closest_path_point = [part, max_distance](MapCoordF coord) {
+		auto best = float(max_distance * max_distance);
+		const Object* result = nullptr;
+		for (int i = 0; i < part->getNumObjects(); ++i)
+		{
+			auto const* object = part->getObject(i);
+			if (object->getType() != Object::Path)
+				continue;
+			float distance_sq;
+			PathCoord path_coord;
+			object->asPath()->calcClosestPointOnPath(coord, distance_sq, path_coord);
+			if (distance_sq < best)
+			{
+				best = distance_sq;
+				result = object;
+			}
+		}
+		return std::make_pair(result, best);
+	};
+	
+	auto closest_vertex = [part, max_distance](MapCoordF coord) {
+		auto best = float(max_distance * max_distance);
+		for (int i = 0; i < part->getNumObjects(); ++i)
+		{
+			auto const* object = part->getObject(i);
+			if (object->getType() == Object::Point)
+			{
+				best = std::min(best, float(object->asPoint()->getCoordF().distanceSquaredTo(coord)));
+			}
+			else if (object->getType() == Object::Path)
+			{
+				float distance_sq;
+				MapCoordVector::size_type index;
+				object->asPath()->calcClosestCoordinate(coord, distance_sq, index);
+				best = std::min(best, distance_sq);
+			}
+		}
+		return best;
+	};
+	
+	auto const& index = map.getSnappingIndex();
+	auto const offsets = { MapCoordF(0, 0), MapCoordF(0.3, -0.2), MapCoordF(-1, 1.5) };
+	for (int i = 0; i < part->getNumObjects(); ++i)
+	{
+		for (auto const& offset : offsets)
+		{
+			auto const coord = MapCoordF(part->getObject(i)->getRawCoordinateVector().front()) + offset;
+			
+			auto const expected_path_point = closest_path_point(coord);
+			SnappingIndex::PathPoint path_point;
+			QCOMPARE(index.findClosestPathPoint(coord, max_distance, {}, path_point), expected_path_point.first != nullptr);
+			if (expected_path_point.first)
+				QCOMPARE(path_point.distance_sq, expected_path_point.second);
+			
+			auto const expected_vertex = closest_vertex(coord);
+			auto const has_vertex = expected_vertex < float(max_distance * max_distance);
+			SnappingIndex::Vertex vertex;
+			QCOMPARE(index.findClosestVertex(coord, max_distance, {}, vertex), has_vertex);
+			if (has_vertex)
+				QCOMPARE(vertex.distance_sq, expected_vertex);
+		}
+	}
+	
+	auto* object = [part]() -> Object* {
+		for (int i = 0; i < part->getNumObjects(); ++i)
+		{
+			if (part->getObject(i)->getType() != Object::Text)
+				return part->getObject(i);
+		}
+		return nullptr;
+	}();
+	QVERIFY(object);
+	
+	auto const coord = MapCoordF(object->getRawCoordinateVector().front());
+	auto const nearest = index.findNearestVertices(coord, 5, max_distance, {});
+	QVERIFY(!nearest.empty());
+	QVERIFY(nearest.size() <= 5);
+	QCOMPARE(nearest.front().distance_sq, 0.0f);
+	QVERIFY(std::is_sorted(begin(nearest), end(nearest), [](auto const& a, auto const& b) { return a.distance_sq < b.distance_sq; }));
+	
+	// Modified objects must be found at their new location.
+	auto const offset = MapCoord(100.0, 100.0);
+	object->move(offset);
+	auto const new_coord = MapCoordF(object->getRawCoordinateVector().front());
+	SnappingIndex::Vertex vertex;
+	QVERIFY(map.getSnappingIndex().findClosestVertex(new_coord, max_distance, {}, vertex));
+	QCOMPARE(vertex.object, static_cast<const Object*>(object));
+	
+	// Deleted objects must not be found.
+	part->deleteObject(object, false);
+	QVERIFY(!map.getSnappingIndex().findClosestVertex(new_coord, max_distance, {}, vertex)
+	        || vertex.object != object);
+}
+
+
+void MapTest::objectTagsTest()
+{
+	Map map;
+	auto symbol = new PointSymbol();
+	map.addSymbol(symbol, 0);
+	
+	auto object_1 = new PointObject(symbol);
+	object_1->setTag(QStringLiteral("b"), QStringLiteral("2"));
+	object_1->setTag(QStringLiteral("a"), QStringLiteral("1"));
+	object_1->setTag(QStringLiteral("c"), QStringLiteral("3"));
+	QCOMPARE(object_1->tagList().size(), std::size_t(3));
+	QCOMPARE(object_1->tagList().front().first, QStringLiteral("a"));
+	QCOMPARE(object_1->tagList().back().first, QStringLiteral("c"));
+	QCOMPARE(object_1->getTag(QStringLiteral("b")), QStringLiteral("2"));
+	QVERIFY(object_1->getTag(QStringLiteral("d")).isEmpty());
+	
+	auto const expected = Object::Tags {
+	    { QStringLiteral("a"), QStringLiteral("1") },
+	    { QStringLiteral("b"), QStringLiteral("2") },
+	    { QStringLiteral("c"), QStringLiteral("3") },
+	};
+	QCOMPARE(object_1->tags(), expected);
+	
+	object_1->setTag(QStringLiteral("b"), QStringLiteral("4"));
+	QCOMPARE(object_1->getTag(QStringLiteral("b")), QStringLiteral("4"));
+	object_1->removeTag(QStringLiteral("b"));
+	QVERIFY(object_1->findTag(QStringLiteral("b")) == end(object_1->tagList()));
+	QCOMPARE(object_1->tagList().size(), std::size_t(2));
+	object_1->setTags(expected);
+	QCOMPARE(object_1->tags(), expected);
+	
+	// Objects in the same map share equal keys and values.
+	map.addObject(object_1);
+	auto object_2 = new PointObject(symbol);
+	map.addObject(object_2);
+	object_2->setTags(expected);
+	QVERIFY(object_1->equals(object_2, true));
+	for (std::size_t i = 0; i < object_1->tagList().size(); ++i)
+	{
+		auto const& tag_1 = object_1->tagList()[i];
+		auto const& tag_2 = object_2->tagList()[i];
+		QVERIFY(tag_1.first.constData() == tag_2.first.constData());
+		QVERIFY(tag_1.second.constData() == tag_2.second.constData());
+	}
+	QCOMPARE(map.tagPool().size(), 6);
+	
+	// Strings which are no longer used can be released.
+	object_1->setTag(QStringLiteral("d"), QString::number(4));
+	QCOMPARE(map.tagPool().size(), 8);
+	QCOMPARE(map.tagPool().prune(), 0);
+	object_1->removeTag(QStringLiteral("d"));
+	QCOMPARE(map.tagPool().prune(), 1);
+	QCOMPARE(map.tagPool().size(), 7);
+	
+	// Pooled strings remain valid without the pool.
+	auto copy = std::unique_ptr<Object>(object_2->duplicate());
+	map.deleteObject(object_2, false);
+	map.tagPool().clear();
+	QCOMPARE(copy->tags(), expected);
+	QCOMPARE(object_1->tags(), expected);
+}
+
+
 void MapTest::crtFileTest()
 {
 	auto original =  symbol_set_dir.absoluteFilePath(QString::fromLatin1("15000/ISOM2000_15000.omap"));
@@ -51,6 +51,15 @@ private slots:
 	/** Tests hasAlpha() functions. */
 	void hasAlpha();
 	
+	/** Tests spatial object lookup against a full scan. */
+	void findObjectsTest();
+	
+	/** Tests the snapping index against a full scan. */
+	void snappingIndexTest();
+	
+	/** Tests the interned tag storage of the map's objects. */
+	void objectTagsTest();
+	
 	/** Basic tests for symbol set replacements. */
 	void crtFileTest();
 	
@@ -0,0 +1,158 @@
+/*
+ *    Copyright 2018 The OpenOrienteering developers
+ *
+ *    This file is part of OpenOrienteering.
+ *
+ *    OpenOrienteering is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    OpenOrienteering is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with OpenOrienteering.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "native_formats_t.h"
+
+#include <QtTest>
+#include <QBuffer>
+#include <QDir>
+#include <QIODevice>
+#include <QScopedPointer>
+#include <QString>
+
+#include "test_config.h"
+
+#include "global.h"
+#include "core/map.h"
+#include "core/map_part.h"
+#include "core/objects/object.h"
+#include "fileformats/file_format.h"
+#include "fileformats/file_format_registry.h"
+#include "fileformats/file_import_export.h"
+
+
+namespace OpenOrienteering {
+
+namespace {
+
+/// The number of copies of the example map's objects in the benchmark map.
+constexpr int copies = 20;
+
+}  // namespace
+
+
+
+NativeFormatsTest::NativeFormatsTest(QObject* parent)
+: QObject(parent)
+{
+	// nothing
+}
+
+NativeFormatsTest::~NativeFormatsTest() = default;
+
+
+void NativeFormatsTest::initTestCase()
+{
+	Q_INIT_RESOURCE(resources);
+	doStaticInitializations();
+	
+	map = std::make_unique<Map>();
+	auto const filename = QDir(QString::fromUtf8(MAPPER_TEST_SOURCE_DIR)).absoluteFilePath(QStringLiteral("../examples/forest sample.omap"));
+	QVERIFY(map->loadFrom(filename, nullptr, nullptr, false, false));
+	
+	auto part = map->getCurrentPart();
+	auto const num_objects = part->getNumObjects();
+	for (int i = 1; i < copies; ++i)
+	{
+		for (int j = 0; j < num_objects; ++j)
+			part->addObject(part->getObject(j)->duplicate());
+	}
+	
+	for (auto format_id : { "XML", "Binary" })
+	{
+		auto format = FileFormats.findFormat(format_id);
+		QVERIFY(format);
+		
+		QBuffer buffer;
+		buffer.open(QIODevice::WriteOnly);
+		QScopedPointer<Exporter> exporter(format->createExporter(&buffer, map.get(), nullptr));
+		exporter->doExport();
+		exported.insert(format_id, buffer.data());
+	}
+}
+
+
+void NativeFormatsTest::addData()
+{
+	QTest::addColumn<QByteArray>("format_id");
+	
+	QTest::newRow("XML") << QByteArray("XML");
+	QTest::newRow("Binary") << QByteArray("Binary");
+}
+
+
+void NativeFormatsTest::save()
+{
+	QFETCH(QByteArray, format_id);
+	auto format = FileFormats.findFormat(format_id);
+	QVERIFY(format);
+	
+	QBENCHMARK
+	{
+		QBuffer buffer;
+		buffer.open(QIODevice::WriteOnly);
+		QScopedPointer<Exporter> exporter(format->createExporter(&buffer, map.get(), nullptr));
+		exporter->doExport();
+	}
+}
+
+void NativeFormatsTest::save_data()
+{
+	addData();
+}
+
+
+void NativeFormatsTest::load()
+{
+	QFETCH(QByteArray, format_id);
+	auto format = FileFormats.findFormat(format_id);
+	QVERIFY(format);
+	
+	auto data = exported.value(format_id);
+	QBENCHMARK
+	{
+		Map loaded_map;
+		QBuffer buffer(&data);
+		buffer.open(QIODevice::ReadOnly);
+		QScopedPointer<Importer> importer(format->createImporter(&buffer, &loaded_map, nullptr));
+		importer->doImport(false);
+		QCOMPARE(loaded_map.getNumObjects(), map->getNumObjects());
+	}
+}
+
+void NativeFormatsTest::load_data()
+{
+	addData();
+}
+
+
+}  // namespace OpenOrienteering
+
+
+
+/*
+ * We don't need a real GUI window.
+ */
+namespace  {
+	auto qpa_selected = qputenv("QT_QPA_PLATFORM", "minimal");  // clazy:exclude=non-pod-global-static
+}
+
+
+QTEST_MAIN(OpenOrienteering::NativeFormatsTest)
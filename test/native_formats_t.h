@@ -0,0 +1,70 @@
+/*
+ *    Copyright 2018 The OpenOrienteering developers
+ *
+ *    This file is part of OpenOrienteering.
+ *
+ *    OpenOrienteering is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    OpenOrienteering is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with OpenOrienteering.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef OPENORIENTEERING_NATIVE_FORMATS_T_H
+#define OPENORIENTEERING_NATIVE_FORMATS_T_H
+
+#include <memory>
+
+#include <QByteArray>
+#include <QHash>
+#include <QObject>
+
+namespace OpenOrienteering {
+
+class Map;
+
+
+/**
+ * @test Benchmarks saving and loading a large map
+ *       in the XML and in the binary native format.
+ */
+class NativeFormatsTest : public QObject
+{
+Q_OBJECT
+	
+public:
+	explicit NativeFormatsTest(QObject* parent = nullptr);
+	
+	~NativeFormatsTest() override;
+	
+private slots:
+	/** Initialization. */
+	void initTestCase();
+	
+	/** Exports the map to a memory buffer. */
+	void save();
+	void save_data();
+	
+	/** Imports the map from a memory buffer. */
+	void load();
+	void load_data();
+	
+private:
+	void addData();
+	
+	std::unique_ptr<Map> map;
+	QHash<QByteArray, QByteArray> exported;  ///< Exported data by format id
+};
+
+
+}  // namespace OpenOrienteering
+
+#endif
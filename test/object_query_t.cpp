@@ -22,6 +22,7 @@
 
 #include <memory>
 #include <algorithm>
+#include <vector>
 
 #include <QtGlobal>
 #include <QtTest>
@@ -29,9 +30,11 @@
 #include <QLatin1String>
 #include <QString>
 
+#include "core/map.h"
 #include "core/objects/object.h"
 #include "core/objects/text_object.h"
 #include "core/objects/object_query.h"
+#include "core/objects/object_query_index.h"
 #include "core/symbols/point_symbol.h"
 
 using namespace OpenOrienteering;
@@ -389,4 +392,106 @@ void ObjectQueryTest::testParser()
 }
 
 
-QTEST_APPLESS_MAIN(ObjectQueryTest)
+void ObjectQueryTest::testCompiledQuery()
+{
+	auto object = testObject();
+	ObjectQueryParser p;
+	for (auto text : {
+	         "a = 1", "a = 2", "d = 1", "a != 1", "a != 2", "d != 1",
+	         "abc ~= 2", "abc ~= 4", "d ~= 1",
+	         "1", "abc", "xyz", "AC 1",
+	         "a = 1 AND b = 2", "a = 1 AND b = 3", "a = 2 AND b = 2",
+	         "a = 2 OR b = 2", "a = 2 OR b = 3",
+	         "a = 1 AND (b = 3 OR c = 3)", "(a = 2 OR b = 2) AND c != 3",
+	         "a = 2 OR (b = 3 OR (c = 4 OR abc = 123))",
+	         "a != 1 OR (b = 2 AND c = 3 AND d != 4)",
+	     })
+	{
+		auto query = p.parse(QString::fromLatin1(text));
+		QVERIFY2(bool(query), text);
+		QVERIFY2(CompiledObjectQuery(query)(object) == query(object), text);
+	}
+	
+	auto text_query = ObjectQuery(ObjectQuery::OperatorObjectText, QStringLiteral("c 1"));
+	QCOMPARE(CompiledObjectQuery(text_query)(object), text_query(object));
+	
+	PointSymbol symbol;
+	PointObject point(&symbol);
+	auto symbol_query = ObjectQuery(&symbol);
+	QVERIFY(CompiledObjectQuery(symbol_query)(&point));
+	QVERIFY(!CompiledObjectQuery(symbol_query)(object));
+	
+	QVERIFY(!CompiledObjectQuery(ObjectQuery())(object));
+}
+
+
+void ObjectQueryTest::testQueryIndex()
+{
+	Map map;
+	auto symbol_1 = new PointSymbol();
+	symbol_1->setName(QStringLiteral("Boulder"));
+	map.addSymbol(symbol_1, 0);
+	auto symbol_2 = new PointSymbol();
+	symbol_2->setName(QStringLiteral("Pit"));
+	map.addSymbol(symbol_2, 1);
+	
+	for (int i = 0; i < 20; ++i)
+	{
+		auto object = new PointObject(i % 3 ? symbol_1 : symbol_2);
+		object->setTag(QStringLiteral("n"), QString::number(i));
+		if (i % 2)
+			object->setTag(QStringLiteral("odd"), QStringLiteral("yes"));
+		map.addObject(object);
+	}
+	
+	ObjectQueryParser p;
+	auto check = [&map](const ObjectQuery& query) -> bool {
+		const auto& index = map.getObjectQueryIndex();
+		std::vector<quint32> expected;
+		for (auto number = quint32(0); number < index.size(); ++number)
+		{
+			auto object = index.entry(number).object;
+			if (object && query(object))
+				expected.push_back(number);
+		}
+		return index.findMatching(query) == expected;
+	};
+	for (auto text : {
+	         "n = 1", "n = 99", "n != 1", "n ~= 1", "odd = yes", "odd != yes",
+	         "1", "bould", "PIT", "odd",
+	         "odd = yes AND n ~= 1", "odd != yes AND n ~= 1", "n = 1 OR n = 2",
+	         "n = 1 OR odd != yes", "(n = 3 OR n = 4) AND pit",
+	     })
+	{
+		auto query = p.parse(QString::fromLatin1(text));
+		QVERIFY2(bool(query), text);
+		QVERIFY2(check(query), text);
+	}
+	QVERIFY(check(ObjectQuery(symbol_1)));
+	QVERIFY(check(ObjectQuery(symbol_2)));
+	QVERIFY(map.getObjectQueryIndex().findMatching(ObjectQuery()).empty());
+	
+	// Changes update the index.
+	auto count = 0;
+	auto query = ObjectQuery(QStringLiteral("n"), ObjectQuery::OperatorIs, QStringLiteral("1"));
+	map.applyOnMatchingObjects([&count](Object* object) {
+		object->setTag(QStringLiteral("n"), QStringLiteral("one"));
+		++count;
+	}, query);
+	QCOMPARE(count, 1);
+	QVERIFY(map.getObjectQueryIndex().findMatching(query).empty());
+	
+	map.getPart(0)->getObject(0)->setSymbol(symbol_1, false);
+	QCOMPARE(map.getObjectQueryIndex().findMatching(ObjectQuery(symbol_2)).size(), std::size_t(6));
+	
+	map.addObject(new PointObject(symbol_2));
+	QCOMPARE(map.getObjectQueryIndex().findMatching(ObjectQuery(symbol_2)).size(), std::size_t(7));
+	
+	map.deleteObject(map.getPart(0)->getObject(3), false);
+	QCOMPARE(map.getObjectQueryIndex().findMatching(ObjectQuery(symbol_2)).size(), std::size_t(6));
+	QVERIFY(check(ObjectQuery(symbol_2)));
+	QVERIFY(check(ObjectQuery(QStringLiteral("odd"), ObjectQuery::OperatorIsNot, QStringLiteral("yes"))));
+}
+
+
+QTEST_GUILESS_MAIN(ObjectQueryTest)
@@ -47,6 +47,8 @@ private slots:
 	void testSymbol();
 	void testToString();
 	void testParser();
+	void testCompiledQuery();
+	void testQueryIndex();
 
 private:
 	const Object* testObject();
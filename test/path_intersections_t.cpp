@@ -0,0 +1,493 @@
+/*
+ *    Copyright 2018 The OpenOrienteering developers
+ *
+ *    This file is part of OpenOrienteering.
+ *
+ *    OpenOrienteering is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    OpenOrienteering is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with OpenOrienteering.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "path_intersections_t.h"
+
+#include <cmath>
+#include <cstddef>
+
+#include <QtTest>
+#include <QDir>
+#include <QString>
+
+#include "test_config.h"
+
+#include "global.h"
+#include "core/map.h"
+#include "core/map_coord.h"
+#include "core/map_part.h"
+#include "core/path_coord.h"
+#include "core/virtual_path.h"
+#include "core/objects/object.h"
+#include "util/util.h"
+
+namespace OpenOrienteering {
+
+namespace {
+
+/**
+ * The original implementation of PathObject::calcAllIntersectionsWith(),
+ * which tests every segment of one path against every segment of the other.
+ */
+void calcAllIntersectionsBruteForce(const PathObject* path, const PathObject* other, PathObject::Intersections& out)
+{
+	path->update();
+	other->update();
+	
+	const double epsilon = 1e-10;
+	const double zero_minus_epsilon = 0 - epsilon;
+	const double one_plus_epsilon = 1 + epsilon;
+	
+	for (size_t part_index = 0; part_index < path->parts().size(); ++part_index)
+	{
+		const PathPart& part = path->parts()[part_index];
+		auto path_coord_end_index = part.path_coords.size() - 1;
+		for (auto i = PathCoordVector::size_type { 1 }; i <= path_coord_end_index; ++i)
+		{
+			// Get information about this path coord
+			bool has_segment_before = (i > 1) || part.isClosed();
+			MapCoordF ingoing_direction;
+			if (has_segment_before && i == 1)
+			{
+				Q_ASSERT(path_coord_end_index >= 1);
+				ingoing_direction = part.path_coords[path_coord_end_index].pos - part.path_coords[path_coord_end_index - 1].pos;
+				ingoing_direction.normalize();
+			}
+			else if (has_segment_before)
+			{
+				Q_ASSERT(i >= 1 && i < part.path_coords.size());
+				ingoing_direction = part.path_coords[i-1].pos - part.path_coords[i-2].pos;
+				ingoing_direction.normalize();
+			}
+			
+			bool has_segment_after = (i < path_coord_end_index) || part.isClosed();
+			MapCoordF outgoing_direction;
+			if (has_segment_after && i == path_coord_end_index)
+			{
+				Q_ASSERT(part.path_coords.size() > 1);
+				outgoing_direction = part.path_coords[1].pos - part.path_coords[0].pos;
+				outgoing_direction.normalize();
+			}
+			else if (has_segment_after)
+			{
+				Q_ASSERT(i < path_coord_end_index);
+				outgoing_direction = part.path_coords[i+1].pos - part.path_coords[i].pos;
+				outgoing_direction.normalize();
+			}
+			
+			// Collision state with other object at current other path coord
+			bool colliding = false;
+			// Last known intersecting point.
+			// This is valid as long as colliding == true and entered as intersection
+			// when the next segment suddenly is not colliding anymore.
+			PathObject::Intersection last_intersection;
+			
+			for (size_t other_part_index = 0; other_part_index < other->parts().size(); ++other_part_index)
+			{
+				const PathPart& other_part = other->parts()[other_part_index];
+				auto other_path_coord_end_index = other_part.path_coords.size() - 1;
+				for (auto k = PathCoordVector::size_type { 1 }; k <= other_path_coord_end_index; ++k)
+				{
+					// Test the two line segments against each other.
+					// Naming: segment in this path is a, segment in other path is b
+					const PathCoord& a0 = part.path_coords[i-1];
+					const PathCoord& a1 = part.path_coords[i];
+					const PathCoord& b0 = other_part.path_coords[k-1];
+					const PathCoord& b1 = other_part.path_coords[k];
+					MapCoordF b_direction = b1.pos - b0.pos;
+					b_direction.normalize();
+					
+					bool first_other_segment = (k == 1);
+					if (first_other_segment)
+					{
+						colliding = isPointOnSegment(a0.pos, a1.pos, b0.pos);
+						if (colliding && !other_part.isClosed())
+						{
+							// Enter intersection at start of other segment
+							bool ok;
+							double a = parameterOfPointOnLine(a0.pos.x(), a0.pos.y(), a1.pos.x() - a0.pos.x(), a1.pos.y() - a0.pos.y(), b0.pos.x(), b0.pos.y(), ok);
+							Q_ASSERT(ok);
+							out.push_back(PathObject::Intersection::makeIntersectionAt(a, 0, a0, a1, b0, b1, part_index, other_part_index));
+						}
+					}
+					
+					bool last_other_segment = (k == other_path_coord_end_index);
+					if (last_other_segment)
+					{
+						bool collision_at_end = isPointOnSegment(a0.pos, a1.pos, b1.pos);
+						if (collision_at_end && !other_part.isClosed())
+						{
+							// Enter intersection at end of other segment
+							bool ok;
+							double a = parameterOfPointOnLine(a0.pos.x(), a0.pos.y(), a1.pos.x() - a0.pos.x(), a1.pos.y() - a0.pos.y(), b1.pos.x(), b1.pos.y(), ok);
+							Q_ASSERT(ok);
+							out.push_back(PathObject::Intersection::makeIntersectionAt(a, 1, a0, a1, b0, b1, part_index, other_part_index));
+						}
+					}
+					
+					double denominator = a0.pos.x()*b0.pos.y() - a0.pos.y()*b0.pos.x() - a0.pos.x()*b1.pos.y() - a1.pos.x()*b0.pos.y() + a0.pos.y()*b1.pos.x() + a1.pos.y()*b0.pos.x() + a1.pos.x()*b1.pos.y() - a1.pos.y()*b1.pos.x();
+					if (denominator == 0)
+					{
+						// Parallel lines, calculate parameters for b's start and end points in a and b.
+						// This also checks whether the lines are actually on the same level.
+						bool ok;
+						double b_start = 0;
+						double a_start = parameterOfPointOnLine(a0.pos.x(), a0.pos.y(), a1.pos.x() - a0.pos.x(), a1.pos.y() - a0.pos.y(), b0.pos.x(), b0.pos.y(), ok);
+						if (!ok)
+						{
+							if (colliding) out.push_back(last_intersection);
+							colliding = false;
+							continue;
+						}
+						double b_end = 1;
+						double a_end = parameterOfPointOnLine(a0.pos.x(), a0.pos.y(), a1.pos.x() - a0.pos.x(), a1.pos.y() - a0.pos.y(), b1.pos.x(), b1.pos.y(), ok);
+						if (!ok)
+						{
+							if (colliding) out.push_back(last_intersection);
+							colliding = false;
+							continue;
+						}
+						
+						// Cull ranges
+						if (a_start < zero_minus_epsilon && a_end < zero_minus_epsilon)
+						{
+							if (colliding) out.push_back(last_intersection);
+							colliding = false;
+							continue;
+						}
+						if (a_start > one_plus_epsilon && a_end > one_plus_epsilon)
+						{
+							if (colliding) out.push_back(last_intersection);
+							colliding = false;
+							continue;
+						}
+						
+						// b overlaps somehow with a, check if we have to enter one or two collisions
+						// (provided the incoming / outgoing tangents are not parallel!)
+						if (!colliding)
+						{
+							if (a_start <= 0)
+							{
+								// b comes in over the start of a
+								Q_ASSERT(a_end >= 0);
+								
+								// Check for parallel tangent case
+								if (!has_segment_before || MapCoordF::dotProduct(b_direction, ingoing_direction) < 1 - epsilon)
+								{
+									// Enter intersection at a=0
+									double b = b_start + (0 - a_start) / (a_end - a_start) * (b_end - b_start);
+									out.push_back(PathObject::Intersection::makeIntersectionAt(0, b, a0, a1, b0, b1, part_index, other_part_index));
+								}
+								
+								colliding = true;
+							}
+							else if (a_start >= 1)
+							{
+								// b comes in over the end of a
+								Q_ASSERT(a_end <= 1);
+								
+								// Check for parallel tangent case
+								if (!has_segment_after || -1 * MapCoordF::dotProduct(b_direction, outgoing_direction) < 1 - epsilon)
+								{
+									// Enter intersection at a=1
+									double b = b_start + (1 - a_start) / (a_end - a_start) * (b_end - b_start);
+									out.push_back(PathObject::Intersection::makeIntersectionAt(1, b, a0, a1, b0, b1, part_index, other_part_index));
+								}
+								
+								colliding = true;
+							}
+							else
+								Q_ASSERT(false);
+						}
+						if (colliding)
+						{
+							if (a_end > 1)
+							{
+								// b goes out over the end of a
+								Q_ASSERT(a_start <= 1);
+								
+								// Check for parallel tangent case
+								if (!has_segment_after || MapCoordF::dotProduct(b_direction, outgoing_direction) < 1 - epsilon)
+								{
+									// Enter intersection at a=1
+									double b = b_start + (1 - a_start) / (a_end - a_start) * (b_end - b_start);
+									out.push_back(PathObject::Intersection::makeIntersectionAt(1, b, a0, a1, b0, b1, part_index, other_part_index));
+								}
+								
+								colliding = false;
+							}
+							else if (a_end < 0)
+							{
+								// b goes out over the start of a
+								Q_ASSERT(a_start >= 1);
+								
+								// Check for parallel tangent case
+								if (!has_segment_before || -1 * MapCoordF::dotProduct(b_direction, ingoing_direction) < 1 - epsilon)
+								{
+									// Enter intersection at a=0
+									double b = b_start + (0 - a_start) / (a_end - a_start) * (b_end - b_start);
+									out.push_back(PathObject::Intersection::makeIntersectionAt(1, b, a0, a1, b0, b1, part_index, other_part_index));
+								}
+								
+								colliding = false;
+							}
+							else
+							{
+								// b stops in the middle of a.
+								// Remember last known colliding point, the endpoint of b.
+								last_intersection = PathObject::Intersection::makeIntersectionAt(a_end, 1, a0, a1, b0, b1, part_index, other_part_index);
+							}
+						}
+						
+						// Check if there is a collision at the endpoint
+						Q_ASSERT(colliding == (a_end >= 0 && a_end <= 1));
+					}
+					else
+					{
+						// Non-parallel lines, calculate intersection parameters and check if in range
+						double a = +(a0.pos.x()*b0.pos.y() - a0.pos.y()*b0.pos.x() - a0.pos.x()*b1.pos.y() + a0.pos.y()*b1.pos.x() + b0.pos.x()*b1.pos.y() - b1.pos.x()*b0.pos.y()) / denominator;
+						if (a < zero_minus_epsilon || a > one_plus_epsilon)
+						{
+							if (colliding) out.push_back(last_intersection);
+							colliding = false;
+							continue;
+						}
+						
+						double b = -(a0.pos.x()*a1.pos.y() - a1.pos.x()*a0.pos.y() - a0.pos.x()*b0.pos.y() + a0.pos.y()*b0.pos.x() + a1.pos.x()*b0.pos.y() - a1.pos.y()*b0.pos.x()) / denominator;
+						if (b < zero_minus_epsilon || b > one_plus_epsilon)
+						{
+							if (colliding) out.push_back(last_intersection);
+							colliding = false;
+							continue;
+						}
+						
+						// Special case for overlapping (cloned / traced) polylines: check if b is parallel to adjacent direction.
+						// If so, set colliding to true / false without entering an intersection because the other line
+						// simply continues along / comes from the path of both polylines instead of intersecting.
+						double dot = -1;
+						if (has_segment_before && a <= 0 + epsilon)
+						{
+							// Ingoing direction
+							dot = MapCoordF::dotProduct(b_direction, ingoing_direction);
+							if (b <= 0 + epsilon)
+								dot = -1 * dot;
+						}
+						else if (has_segment_after && a >= 1 - epsilon)
+						{
+							// Outgoing direction
+							dot = MapCoordF::dotProduct(b_direction, outgoing_direction);
+							if (b >= 1 - epsilon)
+								dot = -1 * dot;
+						}
+						if (dot >= 1 - epsilon)
+						{
+							colliding = (b > 0.5);
+							continue;
+						}
+						
+						// Enter the intersection
+						last_intersection = PathObject::Intersection::makeIntersectionAt(a, b, a0, a1, b0, b1, part_index, other_part_index);
+						out.push_back(last_intersection);
+						colliding = (b == 1);
+					}
+				}
+			}
+		}
+	}
+}
+
+
+/**
+ * Creates a closed, wavy ring of the given number of coordinates.
+ * 
+ * Two rings with different waves intersect frequently, like contours
+ * in steep terrain after careless editing.
+ */
+PathObject* makeRing(int num_coords, double waves, double phase)
+{
+	auto path = new PathObject(Map::getCoveringRedLine());
+	for (int i = 0; i < num_coords; ++i)
+	{
+		auto const t = 2 * M_PI * i / num_coords;
+		auto const r = 100 + 5 * std::sin(waves * t + phase);
+		path->addCoordinate(MapCoord(r * std::cos(t), r * std::sin(t)));
+	}
+	path->closeAllParts();
+	return path;
+}
+
+/**
+ * Creates an open path which follows the first half of the given path.
+ * 
+ * This exercises the handling of overlapping segments.
+ */
+PathObject* makeTrace(const PathObject* path)
+{
+	auto trace = new PathObject(Map::getCoveringRedLine());
+	for (auto i = MapCoordVector::size_type(0); i < path->getCoordinateCount() / 2; ++i)
+		trace->addCoordinate(path->getCoordinate(i));
+	return trace;
+}
+
+}  // namespace
+
+
+
+PathIntersectionsTest::PathIntersectionsTest(QObject* parent)
+: QObject(parent)
+{
+	// nothing
+}
+
+PathIntersectionsTest::~PathIntersectionsTest() = default;
+
+
+void PathIntersectionsTest::initTestCase()
+{
+	Q_INIT_RESOURCE(resources);
+	doStaticInitializations();
+	
+	for (auto num_coords : { 100, 1000, 10000 })
+	{
+		paths.emplace_back(makeRing(num_coords, 37, 0));
+		paths.emplace_back(makeRing(num_coords, 41, 1));
+		paths.emplace_back(makeTrace(paths[paths.size() - 2].get()));
+	}
+	
+	// Real data: The longest path in the example map,
+	// and the longest path which may intersect with it.
+	Map map;
+	auto const filename = QDir(QString::fromUtf8(MAPPER_TEST_SOURCE_DIR)).absoluteFilePath(QStringLiteral("../examples/forest sample.omap"));
+	QVERIFY(map.loadFrom(filename, nullptr, nullptr, false, false));
+	
+	const PathObject* longest[2] = { nullptr, nullptr };
+	auto part = map.getCurrentPart();
+	for (int round = 0; round < 2; ++round)
+	{
+		for (int i = 0; i < part->getNumObjects(); ++i)
+		{
+			auto object = part->getObject(i);
+			if (object->getType() != Object::Path || object == longest[0])
+				continue;
+			auto path = object->asPath();
+			path->update();
+			if (round == 1 && !path->getExtent().intersects(longest[0]->getExtent()))
+				continue;
+			if (!longest[round] || path->getCoordinateCount() > longest[round]->getCoordinateCount())
+				longest[round] = path;
+		}
+		QVERIFY(longest[round]);
+	}
+	for (auto path : longest)
+		paths.emplace_back(path->duplicate());
+}
+
+
+void PathIntersectionsTest::addData()
+{
+	QTest::addColumn<int>("path1");
+	QTest::addColumn<int>("path2");
+	
+	int index = 0;
+	for (auto num_coords : { "100", "1000", "10000" })
+	{
+		QTest::newRow(qPrintable(QString::fromLatin1("rings %1").arg(QLatin1String(num_coords)))) << index << index + 1;
+		QTest::newRow(qPrintable(QString::fromLatin1("trace %1").arg(QLatin1String(num_coords)))) << index << index + 2;
+		index += 3;
+	}
+	QTest::newRow("forest sample") << index << index + 1;
+}
+
+
+void PathIntersectionsTest::compare()
+{
+	QFETCH(int, path1);
+	QFETCH(int, path2);
+	auto const a = paths[std::size_t(path1)].get();
+	auto const b = paths[std::size_t(path2)].get();
+	
+	PathObject::Intersections expected;
+	calcAllIntersectionsBruteForce(a, b, expected);
+	PathObject::Intersections actual;
+	a->calcAllIntersectionsWith(b, actual);
+	QCOMPARE(actual.size(), expected.size());
+	QVERIFY(actual == expected);
+	
+	expected.clear();
+	calcAllIntersectionsBruteForce(b, a, expected);
+	actual.clear();
+	b->calcAllIntersectionsWith(a, actual);
+	QCOMPARE(actual.size(), expected.size());
+	QVERIFY(actual == expected);
+}
+
+void PathIntersectionsTest::compare_data()
+{
+	addData();
+}
+
+
+void PathIntersectionsTest::bruteForce()
+{
+	QFETCH(int, path1);
+	QFETCH(int, path2);
+	auto const a = paths[std::size_t(path1)].get();
+	auto const b = paths[std::size_t(path2)].get();
+	
+	PathObject::Intersections intersections;
+	QBENCHMARK
+	{
+		intersections.clear();
+		calcAllIntersectionsBruteForce(a, b, intersections);
+	}
+}
+
+void PathIntersectionsTest::bruteForce_data()
+{
+	addData();
+}
+
+
+void PathIntersectionsTest::sweepLine()
+{
+	QFETCH(int, path1);
+	QFETCH(int, path2);
+	auto const a = paths[std::size_t(path1)].get();
+	auto const b = paths[std::size_t(path2)].get();
+	
+	PathObject::Intersections intersections;
+	QBENCHMARK
+	{
+		intersections.clear();
+		a->calcAllIntersectionsWith(b, intersections);
+	}
+}
+
+void PathIntersectionsTest::sweepLine_data()
+{
+	addData();
+}
+
+
+}  // namespace OpenOrienteering
+
+
+
+QTEST_MAIN(OpenOrienteering::PathIntersectionsTest)
@@ -0,0 +1,71 @@
+/*
+ *    Copyright 2018 The OpenOrienteering developers
+ *
+ *    This file is part of OpenOrienteering.
+ *
+ *    OpenOrienteering is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    OpenOrienteering is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with OpenOrienteering.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef OPENORIENTEERING_PATH_INTERSECTIONS_T_H
+#define OPENORIENTEERING_PATH_INTERSECTIONS_T_H
+
+#include <memory>
+#include <vector>
+
+#include <QObject>
+
+namespace OpenOrienteering {
+
+class PathObject;
+
+
+/**
+ * @test Benchmarks PathObject::calcAllIntersectionsWith() against
+ *       the plain O(n*m) comparison of all segments.
+ */
+class PathIntersectionsTest : public QObject
+{
+Q_OBJECT
+	
+public:
+	explicit PathIntersectionsTest(QObject* parent = nullptr);
+	
+	~PathIntersectionsTest() override;
+	
+private slots:
+	/** Initialization. */
+	void initTestCase();
+	
+	/** Verifies that both implementations find the same intersections. */
+	void compare();
+	void compare_data();
+	
+	/** Runs the plain comparison of all segments. */
+	void bruteForce();
+	void bruteForce_data();
+	
+	/** Runs the actual implementation from PathObject. */
+	void sweepLine();
+	void sweepLine_data();
+	
+private:
+	void addData();
+	
+	std::vector<std::unique_ptr<PathObject>> paths;
+};
+
+
+}  // namespace OpenOrienteering
+
+#endif
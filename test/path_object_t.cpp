@@ -427,6 +427,33 @@ void PathObjectTest::calcIntersectionsTest_data()
 	intersections_bia->push_back(intersection);
 	
 	QTest::newRow("b inside a") << (void*)aib2 << (void*)aib1 << (void*)intersections_bia;
+	
+	
+	// Intersection with the second part of the other path
+	DummyPathObject* multipart = new DummyPathObject();
+	multipart->addCoordinate(MapCoord(50, 50));
+	multipart->addCoordinate(MapCoord(60, 50));
+	multipart->addCoordinate(MapCoord(20, 10), true);
+	multipart->addCoordinate(MapCoord(20, 30));
+	
+	PathObject::Intersections* intersections_multipart = new PathObject::Intersections();
+	intersection.coord = MapCoordF(20, 20);
+	intersection.part_index = 0;
+	intersection.length = 10;
+	intersection.other_part_index = 1;
+	intersection.other_length = 10;
+	intersections_multipart->push_back(intersection);
+	
+	QTest::newRow("Intersection with other part") << (void*)perpendicular1 << (void*)multipart << (void*)intersections_multipart;
+	
+	
+	// Intersection of the second part with the other path
+	PathObject::Intersections* intersections_multipart_reversed = new PathObject::Intersections();
+	intersection.part_index = 1;
+	intersection.other_part_index = 0;
+	intersections_multipart_reversed->push_back(intersection);
+	
+	QTest::newRow("Intersection of other part") << (void*)multipart << (void*)perpendicular1 << (void*)intersections_multipart_reversed;
 }
 
 void PathObjectTest::atypicalPathTest()
@@ -118,6 +118,37 @@ void QPainterTest::darkenComposition()
 	QCOMPARE(result.pixel(0,0), qRgba(0, 0, 0, 0)); // Now correct!
 }
 
+void QPainterTest::transparencyFixup()
+{
+	// An odd size, to cover the vectorized loop and the remainder.
+	QImage image(13, 7, QImage::Format_ARGB32_Premultiplied);
+	QImage expected(image.size(), image.format());
+	for (int y = 0; y < image.height(); ++y)
+	{
+		for (int x = 0; x < image.width(); ++x)
+		{
+			switch ((x + 3 * y) % 4)
+			{
+				case 0:
+					image.setPixel(x, y, qRgba(0, 0, 0, 1));
+					expected.setPixel(x, y, qRgba(0, 0, 0, 0));
+					break;
+				case 1:
+					image.setPixel(x, y, qRgba(0, 0, 1, 1));
+					expected.setPixel(x, y, qRgba(0, 0, 1, 1));
+					break;
+				default:
+					image.setPixel(x, y, qRgba(0, 0, 0, 255));
+					expected.setPixel(x, y, qRgba(0, 0, 0, 255));
+			}
+		}
+	}
+	
+	ImageTransparencyFixup fixup(&image);
+	fixup();
+	QCOMPARE(image, expected);
+}
+
 template <typename ColorT>
 QImage QPainterTest::makeImage(ColorT color) const
 {
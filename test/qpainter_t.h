@@ -67,6 +67,12 @@ private slots:
 	 */
 	void darkenComposition();
 	
+	/**
+	 * ImageTransparencyFixup shall fix all affected pixels of a larger image,
+	 * and leave all other pixels unchanged.
+	 */
+	void transparencyFixup();
+	
 protected:
 	/** 
 	 * Creates a single pixel image of the given color.
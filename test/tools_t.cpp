@@ -21,27 +21,35 @@
 
 #include "tools_t.h"
 
+#include <initializer_list>
+
 #include <Qt>
 #include <QtGlobal>
 #include <QtTest>
 #include <QApplication>
+#include <QByteArray>
 #include <QEvent>
 #include <QMouseEvent>
 #include <QPoint>
 #include <QPointF>
+#include <QRectF>
 #include <QString>
 
 #include "core/map.h"
 #include "core/map_color.h"
 #include "core/map_coord.h"
+#include "core/map_part.h"
 #include "core/objects/object.h"
+#include "core/symbols/area_symbol.h"
 #include "core/symbols/line_symbol.h"
 #include "global.h"
 #include "gui/main_window.h"
 #include "gui/map/map_editor.h"
 #include "gui/map/map_widget.h"
+#include "gui/widgets/symbol_widget.h"
 #include "tools/edit_point_tool.h"
 #include "tools/edit_tool.h"
+#include "tools/fill_tool.h"
 
 using namespace OpenOrienteering;
 
@@ -206,6 +214,81 @@ void ToolsTest::editTool()
 }
 
 
+void ToolsTest::fillTool_data()
+{
+	QTest::addColumn<QByteArray>("layout");
+	QTest::addColumn<QPointF>("click_pos");
+	QTest::addColumn<QRectF>("expected_extent");
+	QTest::addColumn<int>("expected_parts");
+	
+	// An open square inside a closed square. The gap is closed by the line
+	// width, so the inner square is filled, not the outer one.
+	QTest::newRow("gap")               << QByteArray("gap")   << QPointF(0, 0)  << QRectF(-8, -8, 16, 16)  << 1;
+	// A single closed line which crosses itself. Only one loop is filled.
+	QTest::newRow("self-intersection") << QByteArray("cross") << QPointF(5, 0)  << QRectF(0, -10, 10, 20)  << 1;
+	// A closed square inside a closed square. The inner one is a hole.
+	QTest::newRow("hole")              << QByteArray("hole")  << QPointF(12, 0) << QRectF(-20, -20, 40, 40) << 2;
+}
+
+void ToolsTest::fillTool()
+{
+	QFETCH(QByteArray, layout);
+	QFETCH(QPointF, click_pos);
+	QFETCH(QRectF, expected_extent);
+	QFETCH(int, expected_parts);
+	
+	TestMap map;
+	auto area_symbol = new AreaSymbol();
+	area_symbol->setColor(map.map->getColor(0));
+	map.map->addSymbol(area_symbol, 1);
+	map.map->deleteObject(map.line_object, false);
+	
+	auto addLine = [&map](std::initializer_list<QPointF> points, bool closed) {
+		auto object = new PathObject(map.line_symbol);
+		for (const auto& point : points)
+			object->addCoordinate(MapCoord(point));
+		if (closed)
+			object->closeAllParts();
+		map.map->addObject(object);
+	};
+	if (layout == "gap")
+	{
+		addLine({ {-20, -20}, {20, -20}, {20, 20}, {-20, 20} }, true);
+		addLine({ {-7.9, -8}, {8, -8}, {8, 8}, {-8, 8}, {-8, -8} }, false);
+	}
+	else if (layout == "cross")
+	{
+		addLine({ {-10, -10}, {10, 10}, {10, -10}, {-10, 10} }, true);
+	}
+	else if (layout == "hole")
+	{
+		addLine({ {-20, -20}, {20, -20}, {20, 20}, {-20, 20} }, true);
+		addLine({ {-5, -5}, {5, -5}, {5, 5}, {-5, 5} }, true);
+	}
+	const auto num_objects = map.map->getCurrentPart()->getNumObjects();
+	
+	TestMapEditor editor(map.map);
+	editor.editor->getSymbolWidget()->selectSingleSymbol(area_symbol);
+	editor.editor->setTool(new FillTool(editor.editor, nullptr));
+	editor.simulateClick(editor.map_widget->mapToViewport(MapCoordF(click_pos)));
+	
+	auto part = map.map->getCurrentPart();
+	QCOMPARE(part->getNumObjects(), num_objects + 1);
+	auto fill_object = part->getObject(num_objects)->asPath();
+	QVERIFY(fill_object->getSymbol() == area_symbol);
+	QCOMPARE(int(fill_object->parts().size()), expected_parts);
+	
+	// The raster fill result may deviate by a fraction of the line width.
+	const auto extent = fill_object->getExtent();
+	QVERIFY(qAbs(extent.left() - expected_extent.left()) < 0.6);
+	QVERIFY(qAbs(extent.top() - expected_extent.top()) < 0.6);
+	QVERIFY(qAbs(extent.right() - expected_extent.right()) < 0.6);
+	QVERIFY(qAbs(extent.bottom() - expected_extent.bottom()) < 0.6);
+	
+	editor.editor->setTool(nullptr);
+}
+
+
 /*
  * We select a non-standard QPA because we don't need a real GUI window.
  * 
@@ -34,6 +34,9 @@ private slots:
 	void initTestCase();
 	
 	void editTool();
+	
+	void fillTool();
+	void fillTool_data();
 };
 
 #endif